@@ -56,6 +56,7 @@ typedef struct __attribute__((packed)) slab_obj {
     unsigned char padding[OBJ_PADDING];
     union {
         LIST_TYPE(slab_obj) __list;
+        struct slab_obj* cache_next; /* used while the object sits in a per-thread cache */
         unsigned char* raw;
     };
 } SLAB_OBJ_TYPE, *SLAB_OBJ;
@@ -294,41 +295,23 @@ static inline int maybe_enlarge_slab_mgr(SLAB_MGR mgr, int level) {
     return 0;
 }
 
-__attribute_no_sanitize_address
-static inline void* slab_alloc(SLAB_MGR mgr, size_t size) {
-    SLAB_OBJ mobj;
-    size_t level = -1;
-
+/* Returns the level for objects of `size` bytes, or -1 if such objects don't fit in any level. */
+static inline int slab_size_to_level(size_t size) {
     for (size_t i = 0; i < SLAB_LEVEL; i++)
-        if (size <= slab_levels[i]) {
-            level = i;
-            break;
-        }
-
-    if (level == (size_t)-1) {
-        size = ALIGN_UP_POW2(size, MIN_MALLOC_ALIGNMENT);
-
-        LARGE_MEM_OBJ mem = (LARGE_MEM_OBJ)system_malloc(sizeof(LARGE_MEM_OBJ_TYPE) + size);
-        if (!mem)
-            return NULL;
-
-        mem->size = size;
-        OBJ_LEVEL(mem) = (unsigned char)-1;
-
-#ifdef ASAN
-        asan_unpoison_region((uintptr_t)OBJ_RAW(mem), size);
-#endif
-        return OBJ_RAW(mem);
-    }
+        if (size <= slab_levels[i])
+            return i;
+    return -1;
+}
 
-    SYSTEM_LOCK();
+// SYSTEM_LOCK needs to be held by the caller on entry. Returns NULL on out-of-memory.
+__attribute_no_sanitize_address
+static inline SLAB_OBJ __slab_take_obj(SLAB_MGR mgr, int level) {
+    SLAB_OBJ mobj;
     assert(mgr->addr[level] <= mgr->addr_top[level]);
 
     int ret = maybe_enlarge_slab_mgr(mgr, level);
-    if (ret < 0) {
-        SYSTEM_UNLOCK();
+    if (ret < 0)
         return NULL;
-    }
 
     bool use_free_list;
 #ifdef ASAN
@@ -350,19 +333,193 @@ static inline void* slab_alloc(SLAB_MGR mgr, size_t size) {
     }
     assert(mgr->addr[level] <= mgr->addr_top[level]);
     OBJ_LEVEL(mobj) = level;
-    SYSTEM_UNLOCK();
+    return mobj;
+}
+
+// SYSTEM_LOCK needs to be held by the caller on entry.
+__attribute_no_sanitize_address
+static inline void __slab_put_obj(SLAB_MGR mgr, SLAB_OBJ mobj, int level) {
+    INIT_LIST_HEAD(mobj, __list);
+    LISTP_ADD_TAIL(mobj, &mgr->free_list[level], __list);
+}
 
+__attribute_no_sanitize_address
+static inline void* __slab_obj_to_user(SLAB_OBJ mobj, int level, size_t size) {
 #ifdef SLAB_CANARY
     unsigned long* m = (unsigned long*)((void*)OBJ_RAW(mobj) + slab_levels[level]);
     *m = SLAB_CANARY_STRING;
+#else
+    __UNUSED(level);
 #endif
 #ifdef ASAN
     asan_unpoison_region((uintptr_t)OBJ_RAW(mobj), size);
+#else
+    __UNUSED(size);
 #endif
-
     return OBJ_RAW(mobj);
 }
 
+/* With ASan, freed objects must go back to the global lists (see `__slab_take_obj()`), so the
+ * per-thread caches are not used at all. */
+#ifdef ASAN
+#undef SLAB_THREAD_CACHE
+#endif
+
+#ifdef SLAB_THREAD_CACHE
+/*
+ * Per-thread caches of free objects ("magazines"): one stack of objects per level, linked through
+ * `SLAB_OBJ::cache_next`. Most allocations and frees of small objects are served from the cache of
+ * the current thread without taking SYSTEM_LOCK; objects are moved between a cache and the global
+ * free lists in batches of SLAB_THREAD_CACHE_BATCH, i.e., SYSTEM_LOCK is taken at most once per
+ * batch.
+ *
+ * The user of this library enables the caches by defining `SLAB_THREAD_CACHE()`, which must
+ * evaluate to a pointer to a `void*` slot private to the current thread (initially NULL), or to
+ * NULL if the current thread cannot use a cache (e.g. during early initialization). The cache is
+ * allocated on first use and must be given back with `slab_thread_cache_destroy()` before the
+ * thread exits; the thread then uses the global lists until it exits.
+ *
+ * The cache is not protected by any lock, so (similarly to SYSTEM_LOCK being non-recursive)
+ * slab_alloc() and slab_free() must not be re-entered on the same thread, e.g. from a signal
+ * handler.
+ */
+#ifndef SLAB_THREAD_CACHE_SIZE
+#define SLAB_THREAD_CACHE_SIZE 32
+#endif
+#define SLAB_THREAD_CACHE_BATCH (SLAB_THREAD_CACHE_SIZE / 2)
+#define SLAB_THREAD_CACHE_DESTROYED ((void*)1)
+
+static_assert(SLAB_THREAD_CACHE_BATCH > 0, "SLAB_THREAD_CACHE_SIZE is too small");
+
+struct slab_thread_cache {
+    SLAB_OBJ objs[SLAB_LEVEL];
+    size_t count[SLAB_LEVEL];
+};
+
+/* Returns the cache of the current thread (allocating it if needed) or NULL if it cannot be used. */
+__attribute_no_sanitize_address
+static inline struct slab_thread_cache* __get_slab_thread_cache(SLAB_MGR mgr) {
+    void** slot = SLAB_THREAD_CACHE();
+    if (!slot || *slot == SLAB_THREAD_CACHE_DESTROYED)
+        return NULL;
+    if (*slot)
+        return *slot;
+
+    int level = slab_size_to_level(sizeof(struct slab_thread_cache));
+    assert(level >= 0);
+
+    SYSTEM_LOCK();
+    SLAB_OBJ mobj = __slab_take_obj(mgr, level);
+    SYSTEM_UNLOCK();
+    if (!mobj)
+        return NULL;
+
+    struct slab_thread_cache* cache = __slab_obj_to_user(mobj, level,
+                                                         sizeof(struct slab_thread_cache));
+    memset(cache, 0, sizeof(*cache));
+    *slot = cache;
+    return cache;
+}
+
+/* Takes an object from the thread cache, refilling the cache from the global lists if needed. */
+__attribute_no_sanitize_address
+static inline SLAB_OBJ __slab_thread_cache_alloc(SLAB_MGR mgr, struct slab_thread_cache* cache,
+                                                 int level) {
+    if (!cache->count[level]) {
+        SYSTEM_LOCK();
+        for (size_t i = 0; i < SLAB_THREAD_CACHE_BATCH; i++) {
+            SLAB_OBJ mobj = __slab_take_obj(mgr, level);
+            if (!mobj)
+                break;
+            mobj->cache_next = cache->objs[level];
+            cache->objs[level] = mobj;
+            cache->count[level]++;
+        }
+        SYSTEM_UNLOCK();
+        if (!cache->count[level])
+            return NULL;
+    }
+
+    SLAB_OBJ mobj = cache->objs[level];
+    cache->objs[level] = mobj->cache_next;
+    cache->count[level]--;
+    return mobj;
+}
+
+/* Moves the `count` least recently freed objects of `level` from the thread cache back to the
+ * global free list. */
+__attribute_no_sanitize_address
+static inline void __slab_thread_cache_flush(SLAB_MGR mgr, struct slab_thread_cache* cache,
+                                             int level, size_t count) {
+    assert(count <= cache->count[level]);
+    if (!count)
+        return;
+
+    size_t keep = cache->count[level] - count;
+    SLAB_OBJ mobj;
+    if (keep) {
+        SLAB_OBJ last = cache->objs[level];
+        for (size_t i = 1; i < keep; i++)
+            last = last->cache_next;
+        mobj = last->cache_next;
+        last->cache_next = NULL;
+    } else {
+        mobj = cache->objs[level];
+        cache->objs[level] = NULL;
+    }
+    cache->count[level] = keep;
+
+    SYSTEM_LOCK();
+    while (mobj) {
+        SLAB_OBJ next = mobj->cache_next;
+        __slab_put_obj(mgr, mobj, level);
+        mobj = next;
+    }
+    SYSTEM_UNLOCK();
+}
+
+#endif /* SLAB_THREAD_CACHE */
+
+__attribute_no_sanitize_address
+static inline void* slab_alloc(SLAB_MGR mgr, size_t size) {
+    SLAB_OBJ mobj;
+    int level = slab_size_to_level(size);
+
+    if (level < 0) {
+        size = ALIGN_UP_POW2(size, MIN_MALLOC_ALIGNMENT);
+
+        LARGE_MEM_OBJ mem = (LARGE_MEM_OBJ)system_malloc(sizeof(LARGE_MEM_OBJ_TYPE) + size);
+        if (!mem)
+            return NULL;
+
+        mem->size = size;
+        OBJ_LEVEL(mem) = (unsigned char)-1;
+
+#ifdef ASAN
+        asan_unpoison_region((uintptr_t)OBJ_RAW(mem), size);
+#endif
+        return OBJ_RAW(mem);
+    }
+
+#ifdef SLAB_THREAD_CACHE
+    struct slab_thread_cache* cache = __get_slab_thread_cache(mgr);
+    if (cache) {
+        mobj = __slab_thread_cache_alloc(mgr, cache, level);
+        if (!mobj)
+            return NULL;
+        return __slab_obj_to_user(mobj, level, size);
+    }
+#endif
+
+    SYSTEM_LOCK();
+    mobj = __slab_take_obj(mgr, level);
+    SYSTEM_UNLOCK();
+    if (!mobj)
+        return NULL;
+
+    return __slab_obj_to_user(mobj, level, size);
+}
+
 // Returns user buffer size (i.e. excluding size of control structures).
 __attribute_no_sanitize_address
 static inline size_t slab_get_buf_size(const void* ptr) {
@@ -437,8 +594,47 @@ static inline void slab_free(SLAB_MGR mgr, void* obj) {
     asan_poison_region((uintptr_t)obj, slab_levels[level], ASAN_POISON_HEAP_AFTER_FREE);
 #endif
 
+#ifdef SLAB_THREAD_CACHE
+    void** slot = SLAB_THREAD_CACHE();
+    if (slot && *slot && *slot != SLAB_THREAD_CACHE_DESTROYED) {
+        struct slab_thread_cache* cache = *slot;
+        if (cache->count[level] >= SLAB_THREAD_CACHE_SIZE)
+            __slab_thread_cache_flush(mgr, cache, level, SLAB_THREAD_CACHE_BATCH);
+        mobj->cache_next = cache->objs[level];
+        cache->objs[level] = mobj;
+        cache->count[level]++;
+        return;
+    }
+#endif
+
     SYSTEM_LOCK();
-    INIT_LIST_HEAD(mobj, __list);
-    LISTP_ADD_TAIL(mobj, &mgr->free_list[level], __list);
+    __slab_put_obj(mgr, mobj, level);
     SYSTEM_UNLOCK();
 }
+
+#ifdef SLAB_THREAD_CACHE
+/* Returns all cached objects of the current thread to the global lists and frees the cache. Must
+ * be called by a thread (that used slab_alloc/slab_free) before it exits, otherwise the cached
+ * objects leak. */
+__attribute_no_sanitize_address
+static inline void slab_thread_cache_destroy(SLAB_MGR mgr) {
+    void** slot = SLAB_THREAD_CACHE();
+    if (!slot)
+        return;
+
+    struct slab_thread_cache* cache = *slot;
+    *slot = SLAB_THREAD_CACHE_DESTROYED;
+    if (!cache || cache == SLAB_THREAD_CACHE_DESTROYED)
+        return;
+
+    for (int i = 0; i < SLAB_LEVEL; i++)
+        __slab_thread_cache_flush(mgr, cache, i, cache->count[i]);
+
+    /* the slot is already marked as destroyed, so this goes directly to the global list */
+    slab_free(mgr, cache);
+}
+#else
+static inline void slab_thread_cache_destroy(SLAB_MGR mgr) {
+    __UNUSED(mgr);
+}
+#endif /* SLAB_THREAD_CACHE */
@@ -4,186 +4,265 @@
  * Copyright (C) 2020 Intel Corporation
  */
 
-/* TODO: add regression tests for this */
+/*
+ * The cache is a single open-addressing hash table (linear probing) whose slots are also the nodes
+ * of an intrusive, index-linked LRU list. All entries live in one array, so adding an entry does
+ * not allocate (except when the table grows), a lookup touches only a few adjacent slots, and
+ * removing an entry uses backward-shift deletion instead of tombstones.
+ *
+ * Eviction order is exact LRU: the protected-files code relies on every parent MHT node being more
+ * recently used than its children (so that `lruc_get_last()` never returns a node that is still
+ * referenced by a cached child), which approximations like CLOCK would not guarantee.
+ */
 
 #include "assert.h"
 #include "lru_cache.h"
-#include "list.h"
 
 #ifdef IN_TOOLS
 
-#include <stdio.h>
 #include <stdlib.h>
 
-#define uthash_fatal(msg)                            \
-    do {                                             \
-        fprintf(stderr, "uthash error: %s\n", msg);  \
-        exit(-1);                                    \
-    } while(0)
-
 #else
 
 #include "api.h"
 
-#define uthash_fatal(msg)                            \
-    do {                                             \
-        log_error("uthash error: %s", msg);          \
-        abort();                                     \
-    } while(0)
-
 #endif
 
-#include "uthash.h"
+#define LRUC_NIL          UINT32_MAX
+#define LRUC_MIN_CAPACITY 64 /* must be a power of two */
 
-DEFINE_LIST(_lruc_list_node);
-typedef struct _lruc_list_node {
-    LIST_TYPE(_lruc_list_node) list;
+struct lruc_entry {
     uint64_t key;
-} lruc_list_node_t;
-DEFINE_LISTP(_lruc_list_node);
-
-typedef struct _lruc_map_node {
-    uint64_t key;
-    void* data;
-    lruc_list_node_t* list_ptr;
-    UT_hash_handle hh;
-} lruc_map_node_t;
+    void* data;    /* NULL marks an empty slot */
+    uint32_t prev; /* more recently used neighbour (or LRUC_NIL for the head) */
+    uint32_t next; /* less recently used neighbour (or LRUC_NIL for the tail) */
+};
 
 struct lruc_context {
-    /* list and map both contain the same objects (list contains keys, map contains actual data).
-     * They're kept in sync so that map is used for fast lookups and list is used for fast LRU.
-     */
-    LISTP_TYPE(_lruc_list_node) list;
-    lruc_map_node_t* map;
-    lruc_list_node_t* current; /* current head of the cache */
+    struct lruc_entry* slots;
+    uint32_t capacity; /* number of slots, always a power of two */
+    uint32_t count;
+    uint32_t head;     /* most recently used entry */
+    uint32_t tail;     /* least recently used entry */
+    uint32_t current;  /* iterator position for `lruc_get_first()`/`lruc_get_next()` */
 };
 
+static inline uint32_t lruc_hash(uint64_t key, uint32_t capacity) {
+    /* finalizer of MurmurHash3; keys are usually consecutive node numbers */
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (uint32_t)key & (capacity - 1);
+}
+
+static uint32_t lruc_lookup(lruc_context_t* lruc, uint64_t key) {
+    uint32_t mask = lruc->capacity - 1;
+    for (uint32_t i = lruc_hash(key, lruc->capacity); lruc->slots[i].data; i = (i + 1) & mask) {
+        if (lruc->slots[i].key == key)
+            return i;
+    }
+    return LRUC_NIL;
+}
+
+static void lruc_link_head(lruc_context_t* lruc, uint32_t idx) {
+    struct lruc_entry* e = &lruc->slots[idx];
+    e->prev = LRUC_NIL;
+    e->next = lruc->head;
+    if (lruc->head != LRUC_NIL)
+        lruc->slots[lruc->head].prev = idx;
+    else
+        lruc->tail = idx;
+    lruc->head = idx;
+}
+
+static void lruc_link_tail(lruc_context_t* lruc, uint32_t idx) {
+    struct lruc_entry* e = &lruc->slots[idx];
+    e->prev = lruc->tail;
+    e->next = LRUC_NIL;
+    if (lruc->tail != LRUC_NIL)
+        lruc->slots[lruc->tail].next = idx;
+    else
+        lruc->head = idx;
+    lruc->tail = idx;
+}
+
+static void lruc_unlink(lruc_context_t* lruc, uint32_t idx) {
+    struct lruc_entry* e = &lruc->slots[idx];
+    if (e->prev != LRUC_NIL)
+        lruc->slots[e->prev].next = e->next;
+    else
+        lruc->head = e->next;
+    if (e->next != LRUC_NIL)
+        lruc->slots[e->next].prev = e->prev;
+    else
+        lruc->tail = e->prev;
+}
+
+/* Returns the free slot where `key` should be inserted; `key` must not be present in the table */
+static uint32_t lruc_free_slot(struct lruc_entry* slots, uint32_t capacity, uint64_t key) {
+    uint32_t i = lruc_hash(key, capacity);
+    while (slots[i].data)
+        i = (i + 1) & (capacity - 1);
+    return i;
+}
+
+static bool lruc_grow(lruc_context_t* lruc) {
+    if (lruc->capacity > UINT32_MAX / 4)
+        return false;
+
+    uint32_t new_capacity = lruc->capacity * 2;
+    struct lruc_entry* new_slots = calloc(new_capacity, sizeof(*new_slots));
+    if (!new_slots)
+        return false;
+
+    struct lruc_entry* old_slots = lruc->slots;
+    uint32_t old_head = lruc->head;
+    uint32_t old_current = lruc->current;
+
+    lruc->slots    = new_slots;
+    lruc->capacity = new_capacity;
+    lruc->head     = LRUC_NIL;
+    lruc->tail     = LRUC_NIL;
+    lruc->current  = LRUC_NIL;
+
+    /* re-insert in LRU order, appending at the tail, so that the recency order is preserved */
+    for (uint32_t old = old_head; old != LRUC_NIL; old = old_slots[old].next) {
+        uint32_t idx = lruc_free_slot(new_slots, new_capacity, old_slots[old].key);
+        new_slots[idx].key  = old_slots[old].key;
+        new_slots[idx].data = old_slots[old].data;
+        lruc_link_tail(lruc, idx);
+        if (old == old_current)
+            lruc->current = idx;
+    }
+
+    free(old_slots);
+    return true;
+}
+
+/* Moves the entry in slot `from` to the (empty) slot `to`, fixing up the LRU links */
+static void lruc_move(lruc_context_t* lruc, uint32_t from, uint32_t to) {
+    struct lruc_entry* e = &lruc->slots[to];
+    *e = lruc->slots[from];
+    lruc->slots[from].data = NULL;
+
+    if (e->prev != LRUC_NIL)
+        lruc->slots[e->prev].next = to;
+    else
+        lruc->head = to;
+    if (e->next != LRUC_NIL)
+        lruc->slots[e->next].prev = to;
+    else
+        lruc->tail = to;
+    if (lruc->current == from)
+        lruc->current = to;
+}
+
+/* Removes the entry in slot `idx` (already unlinked from the LRU list) from the hash table */
+static void lruc_delete(lruc_context_t* lruc, uint32_t idx) {
+    uint32_t mask = lruc->capacity - 1;
+
+    lruc->slots[idx].data = NULL;
+    lruc->count--;
+    if (lruc->current == idx)
+        lruc->current = LRUC_NIL;
+
+    /* backward-shift deletion: move following entries of the probe run into the hole unless their
+     * home slot lies cyclically in (hole, j] */
+    uint32_t hole = idx;
+    for (uint32_t j = (hole + 1) & mask; lruc->slots[j].data; j = (j + 1) & mask) {
+        uint32_t home = lruc_hash(lruc->slots[j].key, lruc->capacity);
+        if (((j - home) & mask) < ((j - hole) & mask))
+            continue;
+        lruc_move(lruc, j, hole);
+        hole = j;
+    }
+}
+
 lruc_context_t* lruc_create(void) {
     lruc_context_t* lruc = calloc(1, sizeof(*lruc));
     if (!lruc)
         return NULL;
 
-    INIT_LISTP(&lruc->list);
-    lruc->map     = NULL;
-    lruc->current = NULL;
-    return lruc;
-}
+    lruc->slots = calloc(LRUC_MIN_CAPACITY, sizeof(*lruc->slots));
+    if (!lruc->slots) {
+        free(lruc);
+        return NULL;
+    }
 
-static lruc_map_node_t* get_map_node(lruc_context_t* lruc, uint64_t key) {
-    lruc_map_node_t* mn = NULL;
-    HASH_FIND(hh, lruc->map, &key, sizeof(key), mn);
-    return mn;
+    lruc->capacity = LRUC_MIN_CAPACITY;
+    lruc->count    = 0;
+    lruc->head     = LRUC_NIL;
+    lruc->tail     = LRUC_NIL;
+    lruc->current  = LRUC_NIL;
+    return lruc;
 }
 
 void lruc_destroy(lruc_context_t* lruc) {
-    struct _lruc_list_node* ln;
-    struct _lruc_list_node* tmp;
-    lruc_map_node_t* mn;
-
-    LISTP_FOR_EACH_ENTRY_SAFE(ln, tmp, &lruc->list, list) {
-        mn = get_map_node(lruc, ln->key);
-        if (mn) {
-            HASH_DEL(lruc->map, mn);
-            free(mn);
-        }
-        LISTP_DEL(ln, &lruc->list, list);
-        free(ln);
-    }
-
-    assert(LISTP_EMPTY(&lruc->list));
-    assert(HASH_COUNT(lruc->map) == 0);
+    free(lruc->slots);
     free(lruc);
 }
 
 bool lruc_add(lruc_context_t* lruc, uint64_t key, void* data) {
-    if (get_map_node(lruc, key))
-        return false;
-
-    lruc_map_node_t* map_node = calloc(1, sizeof(*map_node));
-    if (!map_node)
+    assert(data);
+    if (!data || lruc_lookup(lruc, key) != LRUC_NIL)
         return false;
 
-    lruc_list_node_t* list_node = calloc(1, sizeof(*list_node));
-    if (!list_node) {
-        free(map_node);
+    /* keep the load factor at most 3/4 */
+    if ((uint64_t)(lruc->count + 1) * 4 > (uint64_t)lruc->capacity * 3 && !lruc_grow(lruc))
         return false;
-    }
 
-    list_node->key = key;
-    map_node->key = key;
-    LISTP_ADD(list_node, &lruc->list, list);
-    map_node->data     = data;
-    map_node->list_ptr = list_node;
-    HASH_ADD(hh, lruc->map, key, sizeof(key), map_node);
+    uint32_t idx = lruc_free_slot(lruc->slots, lruc->capacity, key);
+    lruc->slots[idx].key  = key;
+    lruc->slots[idx].data = data;
+    lruc_link_head(lruc, idx);
+    lruc->count++;
     return true;
 }
 
 void* lruc_find(lruc_context_t* lruc, uint64_t key) {
-    lruc_map_node_t* mn = get_map_node(lruc, key);
-    if (mn)
-        return mn->data;
-    return NULL;
+    uint32_t idx = lruc_lookup(lruc, key);
+    return idx != LRUC_NIL ? lruc->slots[idx].data : NULL;
 }
 
 void* lruc_get(lruc_context_t* lruc, uint64_t key) {
-    lruc_map_node_t* mn = get_map_node(lruc, key);
-    if (!mn)
+    uint32_t idx = lruc_lookup(lruc, key);
+    if (idx == LRUC_NIL)
         return NULL;
-    lruc_list_node_t* ln = mn->list_ptr;
-    assert(ln != NULL);
+
     // move node to the front of the list
-    LISTP_DEL(ln, &lruc->list, list);
-    LISTP_ADD(ln, &lruc->list, list);
-    return mn->data;
+    if (lruc->head != idx) {
+        lruc_unlink(lruc, idx);
+        lruc_link_head(lruc, idx);
+    }
+    return lruc->slots[idx].data;
 }
 
 size_t lruc_size(lruc_context_t* lruc) {
-    return HASH_COUNT(lruc->map);
+    return lruc->count;
 }
 
 void* lruc_get_first(lruc_context_t* lruc) {
-    if (LISTP_EMPTY(&lruc->list))
-        return NULL;
-
-    lruc->current = LISTP_FIRST_ENTRY(&lruc->list, /*unused*/ 0, list);
-    lruc_map_node_t* mn = get_map_node(lruc, lruc->current->key);
-    assert(mn != NULL);
-    return mn ? mn->data : NULL;
+    lruc->current = lruc->head;
+    return lruc->current != LRUC_NIL ? lruc->slots[lruc->current].data : NULL;
 }
 
 void* lruc_get_next(lruc_context_t* lruc) {
-    if (LISTP_EMPTY(&lruc->list) || !lruc->current)
-        return NULL;
-
-    lruc->current = LISTP_NEXT_ENTRY(lruc->current, &lruc->list, list);
-    if (!lruc->current)
+    if (lruc->current == LRUC_NIL)
         return NULL;
 
-    lruc_map_node_t* mn = get_map_node(lruc, lruc->current->key);
-    assert(mn != NULL);
-    return mn ? mn->data : NULL;
+    lruc->current = lruc->slots[lruc->current].next;
+    return lruc->current != LRUC_NIL ? lruc->slots[lruc->current].data : NULL;
 }
 
 void* lruc_get_last(lruc_context_t* lruc) {
-    if (LISTP_EMPTY(&lruc->list))
-        return NULL;
-
-    lruc_list_node_t* ln = LISTP_LAST_ENTRY(&lruc->list, /*unused*/ 0, list);
-    lruc_map_node_t* mn = get_map_node(lruc, ln->key);
-    assert(mn != NULL);
-    return mn ? mn->data : NULL;
+    return lruc->tail != LRUC_NIL ? lruc->slots[lruc->tail].data : NULL;
 }
 
 void lruc_remove_last(lruc_context_t* lruc) {
-    if (LISTP_EMPTY(&lruc->list))
+    uint32_t idx = lruc->tail;
+    if (idx == LRUC_NIL)
         return;
 
-    lruc_list_node_t* ln = LISTP_LAST_ENTRY(&lruc->list, /*unused*/ 0, list);
-    LISTP_DEL(ln, &lruc->list, list);
-    lruc_map_node_t* mn = get_map_node(lruc, ln->key);
-    assert(mn != NULL);
-    if (mn)
-        HASH_DEL(lruc->map, mn);
-    free(ln);
-    free(mn);
+    lruc_unlink(lruc, idx);
+    lruc_delete(lruc, idx);
 }
@@ -5,7 +5,7 @@
  */
 
 /* Least-recently used cache, used by the protected file implementation for optimizing
-   data and MHT node access */
+   data and MHT node access. Not thread-safe; `data` must not be NULL. */
 
 #pragma once
 
@@ -21,6 +21,8 @@ static pf_aes_gcm_encrypt_f g_cb_aes_gcm_encrypt = NULL;
 static pf_aes_gcm_decrypt_f g_cb_aes_gcm_decrypt = NULL;
 static pf_random_f          g_cb_random          = NULL;
 
+static pf_write_vectored_f g_cb_write_vectored = NULL;
+
 #ifdef DEBUG
 #define PF_DEBUG_PRINT_SIZE_MAX 4096
 
@@ -41,6 +43,13 @@ static pf_random_f          g_cb_random          = NULL;
 static pf_iv_t g_empty_iv = {0};
 static bool g_initialized = false;
 
+/* Limits of the node caches (in nodes) and their statistics; shared by all contexts, which may be
+ * used concurrently, hence the atomics */
+static size_t g_max_nodes_in_cache = DEFAULT_MAX_PAGES_IN_CACHE;
+static size_t g_max_nodes_in_all_caches = 0;
+static size_t g_nodes_in_all_caches = 0;
+static pf_cache_stats_t g_cache_stats = {0};
+
 static const char* g_pf_error_list[] = {
     [PF_STATUS_SUCCESS] = "Success",
     [-PF_STATUS_UNKNOWN_ERROR] = "Unknown error",
@@ -76,52 +85,61 @@ static void memcpy_or_zero_initialize(void* dest, const void* src, size_t size)
         memset(dest, 0, size);
 }
 
-const char* pf_strerror(int err) {
-    unsigned err_idx = err >= 0 ? err : -err;
-    if (err_idx >= ARRAY_SIZE(g_pf_error_list) || !g_pf_error_list[err_idx]) {
-        return "Unknown error";
-    }
-    return g_pf_error_list[err_idx];
+static void ipf_count_stat(uint64_t* counter) {
+    __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
 }
 
-static void swap_nodes(file_node_t** data, size_t idx1, size_t idx2) {
-    file_node_t* tmp = data[idx1];
-    data[idx1] = data[idx2];
-    data[idx2] = tmp;
+static bool ipf_cache_add(pf_context_t* pf, file_node_t* file_node) {
+    if (!lruc_add(pf->cache, file_node->physical_node_number, file_node))
+        return false;
+    __atomic_add_fetch(&g_nodes_in_all_caches, 1, __ATOMIC_RELAXED);
+    return true;
 }
 
-// TODO: better sort?
-static size_t partition(file_node_t** data, size_t low, size_t high) {
-    assert(low <= high);
-    file_node_t* pivot = data[(low + high) / 2];
-    size_t i = low;
-    size_t j = high;
-
-    while (true) {
-        while (data[i]->node_number < pivot->node_number)
-            i++;
-        while (data[j]->node_number > pivot->node_number)
-            j--;
-        if (i >= j)
-            return j;
-        swap_nodes(data, i, j);
-        i++;
-        j--;
-    }
+static void ipf_cache_remove_last(pf_context_t* pf) {
+    lruc_remove_last(pf->cache);
+    __atomic_sub_fetch(&g_nodes_in_all_caches, 1, __ATOMIC_RELAXED);
 }
 
-static void sort_nodes(file_node_t** data, size_t low, size_t high) {
-    if (high - low == 1) {
-        if (data[low]->node_number > data[high]->node_number)
-            swap_nodes(data, low, high);
-        return;
+static bool ipf_cache_over_limit(pf_context_t* pf) {
+    size_t size = lruc_size(pf->cache);
+    if (size > pf->max_cache_size)
+        return true;
+
+    size_t max_all = __atomic_load_n(&g_max_nodes_in_all_caches, __ATOMIC_RELAXED);
+    return max_all && size > MIN_PAGES_IN_CACHE
+           && __atomic_load_n(&g_nodes_in_all_caches, __ATOMIC_RELAXED) > max_all;
+}
+
+// bump the mht node and all its parents to the head of the lru (parents end up before children)
+static void ipf_cache_bump_mht_nodes(pf_context_t* pf, file_node_t* file_mht_node) {
+    while (file_mht_node->node_number != 0) {
+        lruc_get(pf->cache, file_mht_node->physical_node_number);
+        file_mht_node->evict_skipped = false;
+        file_mht_node = file_mht_node->parent;
     }
-    if (low < high) {
-        size_t pi = partition(data, low, high);
-        if (pi > 0)
-            sort_nodes(data, low, pi);
-        sort_nodes(data, pi + 1, high);
+}
+
+void pf_set_cache_limits(size_t max_nodes_per_file, size_t max_nodes_total) {
+    if (!max_nodes_per_file)
+        max_nodes_per_file = DEFAULT_MAX_PAGES_IN_CACHE;
+    __atomic_store_n(&g_max_nodes_in_cache, MAX(max_nodes_per_file, (size_t)MIN_PAGES_IN_CACHE),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&g_max_nodes_in_all_caches, max_nodes_total, __ATOMIC_RELAXED);
+}
+
+void pf_get_cache_stats(pf_cache_stats_t* stats) {
+    stats->hits      = __atomic_load_n(&g_cache_stats.hits, __ATOMIC_RELAXED);
+    stats->misses    = __atomic_load_n(&g_cache_stats.misses, __ATOMIC_RELAXED);
+    stats->evictions = __atomic_load_n(&g_cache_stats.evictions, __ATOMIC_RELAXED);
+}
+
+const char* pf_strerror(int err) {
+    unsigned err_idx = err >= 0 ? err : -err;
+    if (err_idx >= ARRAY_SIZE(g_pf_error_list) || !g_pf_error_list[err_idx]) {
+        return "Unknown error";
     }
+    return g_pf_error_list[err_idx];
 }
 
 static bool ipf_generate_random_key(pf_context_t* pf, pf_key_t* output) {
@@ -200,109 +218,81 @@ static void ipf_init_root_mht(file_node_t* mht) {
     mht->need_writing         = false;
 }
 
+// encrypt one node with a fresh key; the key and GMAC end up in `gcm_crypto_data`
+static bool ipf_encrypt_node(pf_context_t* pf, gcm_crypto_data_t* gcm_crypto_data,
+                             const void* input, void* output) {
+    if (!ipf_generate_random_key(pf, &gcm_crypto_data->key))
+        return false;
+
+    pf_status_t status = g_cb_aes_gcm_encrypt(&gcm_crypto_data->key, &g_empty_iv, NULL, 0,  // aad
+                                              input, PF_NODE_SIZE, output, &gcm_crypto_data->gmac);
+    if (PF_FAILURE(status)) {
+        pf->last_error = status;
+        return false;
+    }
+    return true;
+}
+
 static bool ipf_update_all_data_and_mht_nodes(pf_context_t* pf) {
-    bool ret = false;
-    file_node_t** mht_array = NULL;
     pf_status_t status;
-    void* data = lruc_get_first(pf->cache);
+    // dirty mht nodes, in singly-linked lists (via `flush_next`) by their depth in the tree
+    file_node_t* dirty_mht_nodes[MAX_MHT_NODE_DEPTH] = {0};
 
     // 1. encrypt the changed data
     // 2. set the IV+GMAC in the parent MHT
     // [3. set the need_writing flag for all the parents]
-    while (data != NULL) {
-        if (((file_node_t*)data)->type == FILE_DATA_NODE_TYPE) {
-            file_node_t* data_node = (file_node_t*)data;
-
-            if (data_node->need_writing) {
-                gcm_crypto_data_t* gcm_crypto_data =
-                    &data_node->parent->decrypted.mht
-                         .data_nodes_crypto[data_node->node_number % ATTACHED_DATA_NODES_COUNT];
-
-                if (!ipf_generate_random_key(pf, &gcm_crypto_data->key))
-                    goto out;
-
-                // encrypt the data, this also saves the gmac of the operation in the mht crypto
-                // node
-                status = g_cb_aes_gcm_encrypt(&gcm_crypto_data->key, &g_empty_iv, NULL, 0,  // aad
-                                              data_node->decrypted.data.data, PF_NODE_SIZE,
-                                              data_node->encrypted.cipher, &gcm_crypto_data->gmac);
-                if (PF_FAILURE(status)) {
-                    pf->last_error = status;
-                    goto out;
-                }
-
-#ifdef DEBUG
-                file_node_t* file_mht_node = data_node->parent;
-                // this loop should do nothing, add it here just to be safe
-                while (file_mht_node->node_number != 0) {
-                    assert(file_mht_node->need_writing == true);
-                    file_mht_node = file_mht_node->parent;
-                }
-#endif
-            }
-        }
-        data = lruc_get_next(pf->cache);
-    }
-
-    size_t dirty_count = 0;
+    // and collect the changed mht nodes on the way
+    for (void* data = lruc_get_first(pf->cache); data != NULL; data = lruc_get_next(pf->cache)) {
+        file_node_t* file_node = (file_node_t*)data;
+        if (!file_node->need_writing)
+            continue;
 
-    // count dirty mht nodes
-    data = lruc_get_first(pf->cache);
-    while (data != NULL) {
-        if (((file_node_t*)data)->type == FILE_MHT_NODE_TYPE) {
-            if (((file_node_t*)data)->need_writing)
-                dirty_count++;
-        }
-        data = lruc_get_next(pf->cache);
-    }
+        if (file_node->type == FILE_DATA_NODE_TYPE) {
+            gcm_crypto_data_t* gcm_crypto_data =
+                &file_node->parent->decrypted.mht
+                     .data_nodes_crypto[file_node->node_number % ATTACHED_DATA_NODES_COUNT];
 
-    // add all the mht nodes that needs writing to a list
-    mht_array = malloc(dirty_count * sizeof(*mht_array));
-    if (!mht_array) {
-        pf->last_error = PF_STATUS_NO_MEMORY;
-        goto out;
-    }
+            // encrypt the data, this also saves the gmac of the operation in the mht crypto node
+            if (!ipf_encrypt_node(pf, gcm_crypto_data, file_node->decrypted.data.data,
+                                  file_node->encrypted.cipher))
+                return false;
 
-    data = lruc_get_first(pf->cache);
-    uint64_t dirty_idx = 0;
-    while (data != NULL) {
-        if (((file_node_t*)data)->type == FILE_MHT_NODE_TYPE) {
-            file_node_t* file_mht_node = (file_node_t*)data;
+#ifdef DEBUG
+            file_node_t* file_mht_node = file_node->parent;
+            // this loop should do nothing, add it here just to be safe
+            while (file_mht_node->node_number != 0) {
+                assert(file_mht_node->need_writing == true);
+                file_mht_node = file_mht_node->parent;
+            }
+#endif
+        } else {
+            size_t depth = 0;
+            for (file_node_t* node = file_node; node->node_number != 0; node = node->parent)
+                depth++;
 
-            if (file_mht_node->need_writing)
-                mht_array[dirty_idx++] = file_mht_node;
+            assert(depth > 0 && depth <= MAX_MHT_NODE_DEPTH);
+            file_node->flush_next = dirty_mht_nodes[depth - 1];
+            dirty_mht_nodes[depth - 1] = file_node;
         }
-
-        data = lruc_get_next(pf->cache);
     }
 
-    if (dirty_count > 0)
-        sort_nodes(mht_array, 0, dirty_count - 1);
-
-    // update the gmacs in the parents from last node to first (bottom layers first)
-    for (dirty_idx = dirty_count; dirty_idx > 0; dirty_idx--) {
-        file_node_t* file_mht_node = mht_array[dirty_idx - 1];
-
-        gcm_crypto_data_t* gcm_crypto_data =
-            &file_mht_node->parent->decrypted.mht
-                 .mht_nodes_crypto[(file_mht_node->node_number - 1) % CHILD_MHT_NODES_COUNT];
-
-        if (!ipf_generate_random_key(pf, &gcm_crypto_data->key)) {
-            goto out;
-        }
+    // update the gmacs in the parents level by level, bottom layers first
+    for (size_t depth = MAX_MHT_NODE_DEPTH; depth > 0; depth--) {
+        for (file_node_t* file_mht_node = dirty_mht_nodes[depth - 1]; file_mht_node != NULL;
+                file_mht_node = file_mht_node->flush_next) {
+            gcm_crypto_data_t* gcm_crypto_data =
+                &file_mht_node->parent->decrypted.mht
+                     .mht_nodes_crypto[(file_mht_node->node_number - 1) % CHILD_MHT_NODES_COUNT];
 
-        status = g_cb_aes_gcm_encrypt(&gcm_crypto_data->key, &g_empty_iv, NULL, 0,
-                                      &file_mht_node->decrypted.mht, PF_NODE_SIZE,
-                                      &file_mht_node->encrypted.cipher, &gcm_crypto_data->gmac);
-        if (PF_FAILURE(status)) {
-            pf->last_error = status;
-            goto out;
+            if (!ipf_encrypt_node(pf, gcm_crypto_data, &file_mht_node->decrypted.mht,
+                                  &file_mht_node->encrypted.cipher))
+                return false;
         }
     }
 
     // update mht root gmac in the meta data node
     if (!ipf_generate_random_key(pf, &pf->encrypted_part_plain.mht_key))
-        goto out;
+        return false;
 
     status = g_cb_aes_gcm_encrypt(&pf->encrypted_part_plain.mht_key, &g_empty_iv,
                                   NULL, 0,
@@ -311,14 +301,10 @@ static bool ipf_update_all_data_and_mht_nodes(pf_context_t* pf) {
                                   &pf->encrypted_part_plain.mht_gmac);
     if (PF_FAILURE(status)) {
         pf->last_error = status;
-        goto out;
+        return false;
     }
 
-    ret = true;
-
-out:
-    free(mht_array);
-    return ret;
+    return true;
 }
 
 static bool ipf_read_node(pf_context_t* pf, pf_handle_t handle, uint64_t node_number, void* buffer,
@@ -334,14 +320,61 @@ static bool ipf_read_node(pf_context_t* pf, pf_handle_t handle, uint64_t node_nu
     return true;
 }
 
+// read a data or mht node that is not cached; on sequential access, the following nodes are read
+// from disk in the same call and kept (still encrypted) for later calls, so they are decrypted and
+// verified exactly like nodes read one by one
+static bool ipf_read_node_ahead(pf_context_t* pf, uint64_t node_number, void* buffer) {
+    bool sequential = node_number > pf->last_read_node && node_number - pf->last_read_node <= 2;
+    pf->last_read_node = node_number;
+
+    if (node_number >= pf->read_ahead_first_node
+            && node_number - pf->read_ahead_first_node < pf->read_ahead_nodes) {
+        memcpy(buffer,
+               pf->read_ahead_buffer + (node_number - pf->read_ahead_first_node) * PF_NODE_SIZE,
+               PF_NODE_SIZE);
+        return true;
+    }
+
+    uint64_t nodes_on_disk = pf->real_file_size / PF_NODE_SIZE;
+    if (sequential && node_number + 1 < nodes_on_disk) {
+        if (!pf->read_ahead_buffer)
+            pf->read_ahead_buffer = malloc(PF_READ_AHEAD_NODES * PF_NODE_SIZE);
+
+        if (pf->read_ahead_buffer) {
+            size_t count = MIN(nodes_on_disk - node_number, (uint64_t)PF_READ_AHEAD_NODES);
+            pf->read_ahead_nodes = 0;
+            pf_status_t status = g_cb_read(pf->file, pf->read_ahead_buffer,
+                                           node_number * PF_NODE_SIZE, count * PF_NODE_SIZE);
+            if (PF_SUCCESS(status)) {
+                pf->read_ahead_first_node = node_number;
+                pf->read_ahead_nodes = count;
+                memcpy(buffer, pf->read_ahead_buffer, PF_NODE_SIZE);
+                return true;
+            }
+            // fall back to reading just the requested node
+        }
+    }
+
+    return ipf_read_node(pf, pf->file, node_number, buffer, PF_NODE_SIZE);
+}
+
+static void ipf_file_written(pf_context_t* pf, uint64_t offset, size_t size) {
+    // the nodes in the read-ahead buffer may be stale now
+    pf->read_ahead_nodes = 0;
+    pf->real_file_size = MAX(pf->real_file_size, offset + size);
+}
+
 static bool ipf_write_file(pf_context_t* pf, pf_handle_t handle, uint64_t offset, void* buffer,
                            uint32_t size) {
     pf_status_t status = g_cb_write(handle, buffer, offset, size);
     if (PF_FAILURE(status)) {
+        // the write may have been partial, so the read-ahead nodes may be stale
+        pf->read_ahead_nodes = 0;
         pf->last_error = status;
         return false;
     }
 
+    ipf_file_written(pf, offset, size);
     return true;
 }
 
@@ -350,6 +383,31 @@ static bool ipf_write_node(pf_context_t* pf, pf_handle_t handle, uint64_t node_n
     return ipf_write_file(pf, handle, node_number * node_size, buffer, node_size);
 }
 
+// write `count` nodes with consecutive physical numbers
+static bool ipf_write_nodes(pf_context_t* pf, uint64_t first_node_number, const pf_iovec_t* iov,
+                            size_t count) {
+    if (count == 1 || !g_cb_write_vectored) {
+        for (size_t i = 0; i < count; i++) {
+            if (!ipf_write_node(pf, pf->file, first_node_number + i, (void*)iov[i].base,
+                                PF_NODE_SIZE))
+                return false;
+        }
+        return true;
+    }
+
+    pf_status_t status = g_cb_write_vectored(pf->file, iov, count,
+                                             first_node_number * PF_NODE_SIZE);
+    if (PF_FAILURE(status)) {
+        // the write may have been partial, so the read-ahead nodes may be stale
+        pf->read_ahead_nodes = 0;
+        pf->last_error = status;
+        return false;
+    }
+
+    ipf_file_written(pf, first_node_number * PF_NODE_SIZE, count * PF_NODE_SIZE);
+    return true;
+}
+
 // this is a very 'specific' function, tied to the architecture of the file layout,
 // returning the node numbers according to the data offset in the file
 static void get_node_numbers(uint64_t offset, uint64_t* mht_node_number, uint64_t* data_node_number,
@@ -393,11 +451,37 @@ static void get_node_numbers(uint64_t offset, uint64_t* mht_node_number, uint64_
         *physical_data_node_number = _physical_data_node_number;
 }
 
+// write the run of dirty cached nodes starting at `file_node`, coalescing adjacent nodes
+static bool ipf_write_node_run(pf_context_t* pf, file_node_t* file_node) {
+    pf_iovec_t iov[PF_WRITE_RUN_MAX];
+    file_node_t* nodes[PF_WRITE_RUN_MAX];
+
+    while (file_node != NULL && file_node->need_writing) {
+        uint64_t first_node_number = file_node->physical_node_number;
+        size_t count = 0;
+
+        while (count < PF_WRITE_RUN_MAX && file_node != NULL && file_node->need_writing) {
+            nodes[count] = file_node;
+            iov[count] = (pf_iovec_t){ .base = &file_node->encrypted, .size = PF_NODE_SIZE };
+            count++;
+            file_node = (file_node_t*)lruc_find(pf->cache, first_node_number + count);
+        }
+
+        if (!ipf_write_nodes(pf, first_node_number, iov, count))
+            return false;
+
+        for (size_t i = 0; i < count; i++) {
+            nodes[i]->need_writing = false;
+            nodes[i]->new_node = false;
+        }
+    }
+
+    return true;
+}
+
 static bool ipf_write_all_changes_to_disk(pf_context_t* pf) {
     if (pf->encrypted_part_plain.size > MD_USER_DATA_SIZE && pf->root_mht.need_writing) {
         void* data = NULL;
-        uint8_t* data_to_write;
-        uint64_t node_number;
         file_node_t* file_node;
 
         for (data = lruc_get_first(pf->cache); data != NULL; data = lruc_get_next(pf->cache)) {
@@ -405,15 +489,14 @@ static bool ipf_write_all_changes_to_disk(pf_context_t* pf) {
             if (!file_node->need_writing)
                 continue;
 
-            data_to_write = (uint8_t*)&file_node->encrypted;
-            node_number = file_node->physical_node_number;
+            // runs of adjacent dirty nodes are written starting from their first node
+            file_node_t* prev_node = (file_node_t*)lruc_find(pf->cache,
+                                                             file_node->physical_node_number - 1);
+            if (prev_node != NULL && prev_node->need_writing)
+                continue;
 
-            if (!ipf_write_node(pf, pf->file, node_number, data_to_write, PF_NODE_SIZE)) {
+            if (!ipf_write_node_run(pf, file_node))
                 return false;
-            }
-
-            file_node->need_writing = false;
-            file_node->new_node = false;
         }
 
         if (!ipf_write_node(pf, pf->file, /*node_number=*/1, &pf->root_mht.encrypted,
@@ -542,7 +625,7 @@ static file_node_t* ipf_append_mht_node(pf_context_t* pf, uint64_t mht_node_numb
     new_file_mht_node->node_number = mht_node_number;
     new_file_mht_node->physical_node_number = physical_node_number;
 
-    if (!lruc_add(pf->cache, new_file_mht_node->physical_node_number, new_file_mht_node)) {
+    if (!ipf_cache_add(pf, new_file_mht_node)) {
         free(new_file_mht_node);
         pf->last_error = PF_STATUS_NO_MEMORY;
         return NULL;
@@ -570,17 +653,11 @@ static file_node_t* ipf_get_data_node(pf_context_t* pf, uint64_t offset) {
     }
 
     // bump all the parents mht to reside before the data node in the cache
-    if (file_data_node != NULL) {
-        file_node_t* file_mht_node = file_data_node->parent;
-        while (file_mht_node->node_number != 0) {
-            // bump the mht node to the head of the lru
-            lruc_get(pf->cache, file_mht_node->physical_node_number);
-            file_mht_node = file_mht_node->parent;
-        }
-    }
+    if (file_data_node != NULL)
+        ipf_cache_bump_mht_nodes(pf, file_data_node->parent);
 
     // even if we didn't get the required data_node, we might have read other nodes in the process
-    while (lruc_size(pf->cache) > MAX_PAGES_IN_CACHE) {
+    while (ipf_cache_over_limit(pf)) {
         void* data = lruc_get_last(pf->cache);
         assert(data != NULL);
         // for production -
@@ -589,11 +666,21 @@ static file_node_t* ipf_get_data_node(pf_context_t* pf, uint64_t offset) {
             return NULL;
         }
 
-        if (!((file_node_t*)data)->need_writing) {
-            lruc_remove_last(pf->cache);
+        file_node_t* file_node = (file_node_t*)data;
+        if (file_node->type == FILE_MHT_NODE_TYPE && !file_node->evict_skipped) {
+            // an mht node is needed to access any of its many children, so it's cheaper to keep it
+            // than a data node: give it one more round in the cache (together with its parents, so
+            // that they stay before it)
+            ipf_cache_bump_mht_nodes(pf, file_node);
+            file_node->evict_skipped = true;
+            continue;
+        }
+
+        if (!file_node->need_writing) {
+            ipf_cache_remove_last(pf);
+            ipf_count_stat(&g_cache_stats.evictions);
 
             // before deleting the memory, need to scrub the plain secrets
-            file_node_t* file_node = (file_node_t*)data;
             erase_memory(&file_node->decrypted, sizeof(file_node->decrypted));
             free(file_node);
         } else {
@@ -632,7 +719,7 @@ static file_node_t* ipf_append_data_node(pf_context_t* pf, uint64_t offset) {
     new_file_data_node->node_number = node_number;
     new_file_data_node->physical_node_number = physical_node_number;
 
-    if (!lruc_add(pf->cache, new_file_data_node->physical_node_number, new_file_data_node)) {
+    if (!ipf_cache_add(pf, new_file_data_node)) {
         free(new_file_data_node);
         pf->last_error = PF_STATUS_NO_MEMORY;
         return NULL;
@@ -650,8 +737,11 @@ static file_node_t* ipf_read_data_node(pf_context_t* pf, uint64_t offset) {
     get_node_numbers(offset, NULL, &data_node_number, NULL, &physical_node_number);
 
     file_node_t* file_data_node = (file_node_t*)lruc_get(pf->cache, physical_node_number);
-    if (file_data_node != NULL)
+    if (file_data_node != NULL) {
+        ipf_count_stat(&g_cache_stats.hits);
         return file_data_node;
+    }
+    ipf_count_stat(&g_cache_stats.misses);
 
     // need to read the data node from the disk
 
@@ -670,8 +760,8 @@ static file_node_t* ipf_read_data_node(pf_context_t* pf, uint64_t offset) {
     file_data_node->physical_node_number = physical_node_number;
     file_data_node->parent = file_mht_node;
 
-    if (!ipf_read_node(pf, pf->file, file_data_node->physical_node_number,
-                       file_data_node->encrypted.cipher, PF_NODE_SIZE)) {
+    if (!ipf_read_node_ahead(pf, file_data_node->physical_node_number,
+                             file_data_node->encrypted.cipher)) {
         free(file_data_node);
         return NULL;
     }
@@ -693,7 +783,7 @@ static file_node_t* ipf_read_data_node(pf_context_t* pf, uint64_t offset) {
         return NULL;
     }
 
-    if (!lruc_add(pf->cache, file_data_node->physical_node_number, file_data_node)) {
+    if (!ipf_cache_add(pf, file_data_node)) {
         // scrub the plaintext data
         erase_memory(&file_data_node->decrypted, sizeof(file_data_node->decrypted));
         free(file_data_node);
@@ -715,8 +805,11 @@ static file_node_t* ipf_read_mht_node(pf_context_t* pf, uint64_t mht_node_number
                                     mht_node_number * (1 + ATTACHED_DATA_NODES_COUNT);
 
     file_node_t* file_mht_node = (file_node_t*)lruc_find(pf->cache, physical_node_number);
-    if (file_mht_node != NULL)
+    if (file_mht_node != NULL) {
+        ipf_count_stat(&g_cache_stats.hits);
         return file_mht_node;
+    }
+    ipf_count_stat(&g_cache_stats.misses);
 
     file_node_t* parent_file_mht_node =
         ipf_read_mht_node(pf, (mht_node_number - 1) / CHILD_MHT_NODES_COUNT);
@@ -735,8 +828,8 @@ static file_node_t* ipf_read_mht_node(pf_context_t* pf, uint64_t mht_node_number
     file_mht_node->physical_node_number = physical_node_number;
     file_mht_node->parent               = parent_file_mht_node;
 
-    if (!ipf_read_node(pf, pf->file, file_mht_node->physical_node_number,
-                       file_mht_node->encrypted.cipher, PF_NODE_SIZE)) {
+    if (!ipf_read_node_ahead(pf, file_mht_node->physical_node_number,
+                             file_mht_node->encrypted.cipher)) {
         free(file_mht_node);
         return NULL;
     }
@@ -757,7 +850,7 @@ static file_node_t* ipf_read_mht_node(pf_context_t* pf, uint64_t mht_node_number
         return NULL;
     }
 
-    if (!lruc_add(pf->cache, file_mht_node->physical_node_number, file_mht_node)) {
+    if (!ipf_cache_add(pf, file_mht_node)) {
         erase_memory(&file_mht_node->decrypted, sizeof(file_mht_node->decrypted));
         free(file_mht_node);
         pf->last_error = PF_STATUS_NO_MEMORY;
@@ -802,7 +895,13 @@ static bool ipf_init_fields(pf_context_t* pf) {
     pf->last_error     = PF_STATUS_SUCCESS;
     pf->real_file_size = 0;
 
+    pf->read_ahead_buffer     = NULL;
+    pf->read_ahead_first_node = 0;
+    pf->read_ahead_nodes      = 0;
+    pf->last_read_node        = 1; // the root mht node is read when opening the file
+
     pf->cache = lruc_create();
+    pf->max_cache_size = __atomic_load_n(&g_max_nodes_in_cache, __ATOMIC_RELAXED);
     return true;
 }
 
@@ -1152,13 +1251,14 @@ static bool ipf_close(pf_context_t* pf) {
         file_node_t* file_node = (file_node_t*)data;
         erase_memory(&file_node->decrypted, sizeof(file_node->decrypted));
         free(file_node);
-        lruc_remove_last(pf->cache);
+        ipf_cache_remove_last(pf);
     }
 
     // scrub first MD_USER_DATA_SIZE of file data and the gmac_key
     erase_memory(&pf->encrypted_part_plain, sizeof(pf->encrypted_part_plain));
 
     lruc_destroy(pf->cache);
+    free(pf->read_ahead_buffer);
 
 #ifdef DEBUG
     free(pf->debug_buffer);
@@ -1185,6 +1285,10 @@ void pf_set_callbacks(pf_read_f read_f, pf_write_f write_f, pf_truncate_f trunca
     g_initialized = true;
 }
 
+void pf_set_batch_callbacks(pf_write_vectored_f write_vectored_f) {
+    g_cb_write_vectored = write_vectored_f;
+}
+
 pf_status_t pf_open(pf_handle_t handle, const char* path, uint64_t underlying_size,
                     pf_file_mode_t mode, bool create, const pf_key_t* key, pf_context_t** context) {
     if (!g_initialized)
@@ -1261,12 +1365,13 @@ pf_status_t pf_set_size(pf_context_t* pf, uint64_t size) {
 
         pf->need_writing = true;
         pf->real_file_size = 0;
+        pf->read_ahead_nodes = 0;
 
         while ((data = lruc_get_last(pf->cache)) != NULL) {
             file_node_t* file_node = (file_node_t*)data;
             erase_memory(&file_node->decrypted, sizeof(file_node->decrypted));
             free(file_node);
-            lruc_remove_last(pf->cache);
+            ipf_cache_remove_last(pf);
         }
 
         return PF_STATUS_SUCCESS;
@@ -91,6 +91,25 @@ typedef pf_status_t (*pf_read_f)(pf_handle_t handle, void* buffer, uint64_t offs
 typedef pf_status_t (*pf_write_f)(pf_handle_t handle, const void* buffer, uint64_t offset,
                                   size_t size);
 
+/*! Buffer for vectored writes */
+typedef struct pf_iovec {
+    const void* base;
+    size_t size;
+} pf_iovec_t;
+
+/*!
+ * \brief File vectored write callback.
+ *
+ * \param handle     File handle.
+ * \param iov        Buffers to write, in order.
+ * \param iov_count  Number of buffers in \p iov.
+ * \param offset     Offset to write the first buffer to; the others follow contiguously.
+ *
+ * \returns PF status.
+ */
+typedef pf_status_t (*pf_write_vectored_f)(pf_handle_t handle, const pf_iovec_t* iov,
+                                           size_t iov_count, uint64_t offset);
+
 /*!
  * \brief File truncate callback.
  *
@@ -186,6 +205,42 @@ void pf_set_callbacks(pf_read_f read_f, pf_write_f write_f, pf_truncate_f trunca
                       pf_aes_gcm_decrypt_f aes_gcm_decrypt_f, pf_random_f random_f,
                       pf_debug_f debug_f);
 
+/*!
+ * \brief Initialize optional batch callbacks, used when flushing many nodes at once.
+ *
+ * \param write_vectored_f  (optional) File vectored write callback. If NULL, adjacent nodes are
+ *                          written one by one with the file write callback.
+ */
+void pf_set_batch_callbacks(pf_write_vectored_f write_vectored_f);
+
+/*!
+ * \brief Set limits of the caches of decrypted nodes.
+ *
+ * \param max_nodes_per_file  Maximum number of nodes cached by each open file (0 means the default
+ *                            of 48 nodes). Values smaller than a built-in minimum are rounded up
+ *                            to it.
+ * \param max_nodes_total     Maximum number of nodes cached by all open files together (0 means no
+ *                            limit). To honour this limit, files evict their own nodes, but never
+ *                            below the built-in minimum.
+ *
+ * Affects only files opened afterwards.
+ */
+void pf_set_cache_limits(size_t max_nodes_per_file, size_t max_nodes_total);
+
+/*! Statistics of the caches of decrypted nodes, accumulated over all files */
+typedef struct pf_cache_stats {
+    uint64_t hits;      /*!< node lookups served from a cache */
+    uint64_t misses;    /*!< node lookups that had to read and decrypt the node */
+    uint64_t evictions; /*!< nodes evicted from a cache to respect its limits */
+} pf_cache_stats_t;
+
+/*!
+ * \brief Get statistics of the caches of decrypted nodes.
+ *
+ * \param[out] stats  Current values of the counters.
+ */
+void pf_get_cache_stats(pf_cache_stats_t* stats);
+
 /*! Context representing an open protected file */
 typedef struct pf_context pf_context_t;
 
@@ -100,7 +100,20 @@ typedef struct _encrypted_node {
 
 static_assert(sizeof(encrypted_node_t) == PF_NODE_SIZE, "sizeof(encrypted_node_t)");
 
-#define MAX_PAGES_IN_CACHE 48
+/* Default and minimum number of decrypted nodes cached by each open file (see
+ * `pf_set_cache_limits()`); the minimum must accommodate a data node and all its parent MHT nodes */
+#define DEFAULT_MAX_PAGES_IN_CACHE 48
+#define MIN_PAGES_IN_CACHE         16
+
+/* Maximum number of nodes read from disk at once on sequential access */
+#define PF_READ_AHEAD_NODES 32
+
+/* Maximum number of adjacent dirty nodes written to disk in one call during flush */
+#define PF_WRITE_RUN_MAX 32
+
+/* Upper bound on the depth of MHT nodes below the root: MHT node numbers are 64-bit and every
+ * level has CHILD_MHT_NODES_COUNT times more nodes than the previous one, so at most 13 levels */
+#define MAX_MHT_NODE_DEPTH 16
 
 typedef enum {
     FILE_MHT_NODE_TYPE  = 1,
@@ -119,6 +132,8 @@ typedef struct _file_node {
     struct _file_node* parent;
     bool need_writing;
     bool new_node;
+    bool evict_skipped; // MHT node got a second chance when it was about to be evicted
+    struct _file_node* flush_next; // next dirty MHT node of the same depth, used only during flush
     struct {
         uint64_t physical_node_number;
         encrypted_node_t encrypted; // the actual data from the disk
@@ -25,6 +25,11 @@ struct pf_context {
     pf_status_t file_status;
     pf_key_t user_kdk_key;
     lruc_context_t* cache;
+    size_t max_cache_size; // in nodes
+    uint8_t* read_ahead_buffer; // encrypted nodes read ahead of time, allocated on first use
+    uint64_t read_ahead_first_node; // physical number of the first node in `read_ahead_buffer`
+    size_t read_ahead_nodes; // number of valid nodes in `read_ahead_buffer`
+    uint64_t last_read_node; // physical number of the last node read, to detect sequential access
 #ifdef DEBUG
     char* debug_buffer; // buffer for debug output
 #endif
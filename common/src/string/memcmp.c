@@ -1,6 +1,7 @@
 /* SPDX-License-Identifier: LGPL-3.0-or-later */
 
 #include "api.h"
+#include "string_block.h"
 
 #ifndef ASAN
 __attribute__((alias("_real_memcmp")))
@@ -11,6 +12,13 @@ __attribute_no_sanitize_address
 int _real_memcmp(const void* lhs, const void* rhs, size_t count) {
     const unsigned char* l = lhs;
     const unsigned char* r = rhs;
+    /* skip equal words, then find the differing byte */
+    while (count >= sizeof(uint64_t)
+            && *(const unaligned_u64*)l == *(const unaligned_u64*)r) {
+        count -= sizeof(uint64_t);
+        l += sizeof(uint64_t);
+        r += sizeof(uint64_t);
+    }
     while (count && *l == *r) {
         count--;
         l++;
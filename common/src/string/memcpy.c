@@ -2,6 +2,7 @@
 
 #include "api.h"
 #include "log.h"
+#include "string_block.h"
 
 #undef memcpy
 #undef memmove
@@ -53,10 +54,22 @@ void* _real_memmove(void* dest, const void* src, size_t count) {
     if (s + count <= d || d + count <= s)
         return memcpy(d, s, count);
 
+    /* Copy a word at a time in the direction that does not overwrite bytes before they are read:
+     * each word is read entirely before it is written, and the written word can overlap only the
+     * source bytes that were already copied. */
     if (d < s) {
+        for (; count >= sizeof(uint64_t); count -= sizeof(uint64_t)) {
+            *(unaligned_u64*)d = *(const unaligned_u64*)s;
+            d += sizeof(uint64_t);
+            s += sizeof(uint64_t);
+        }
         while (count--)
             *d++ = *s++;
     } else {
+        for (; count >= sizeof(uint64_t); count -= sizeof(uint64_t)) {
+            *(unaligned_u64*)(d + count - sizeof(uint64_t)) =
+                *(const unaligned_u64*)(s + count - sizeof(uint64_t));
+        }
         while (count--)
             d[count] = s[count];
     }
@@ -4,6 +4,9 @@
  */
 
 #include "api.h"
+#include "string_block.h"
+
+#ifdef ASAN
 
 char* strchr(const char* s, int c) {
     while (true) {
@@ -14,3 +17,18 @@ char* strchr(const char* s, int c) {
         s++;
     }
 }
+
+#else
+
+char* strchr(const char* s, int c) {
+    const char* block = ALIGN_DOWN_PTR_POW2(s, STRING_BLOCK_SIZE);
+    uint64_t mask = string_block_match(block, (char)c, '\0', s - block);
+    while (!mask) {
+        block += STRING_BLOCK_SIZE;
+        mask = string_block_match(block, (char)c, '\0', /*skip=*/0);
+    }
+    const char* found = block + string_block_index(mask);
+    return *found == (char)c ? (char*)found : NULL;
+}
+
+#endif
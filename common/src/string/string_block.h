@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Helpers for string functions that scan a block of bytes at a time instead of a single byte.
+ *
+ * The scanned blocks are aligned to their size, so reading a whole block never crosses a page
+ * boundary, even if the string ends in the middle of the block. Such reads are still reported by
+ * ASan, so the users of this header should fall back to byte-at-a-time loops in ASan builds.
+ *
+ * On x86-64, a block is 16 bytes compared with SSE2 (always available on this architecture, so
+ * there is no need for runtime detection). Elsewhere, a block is a machine word, compared with the
+ * usual "has a zero byte" bit trick.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "api.h"
+
+/* Unaligned, aliasing-safe word access, for functions that do not scan past their arguments */
+typedef uint64_t __attribute__((may_alias, aligned(1))) unaligned_u64;
+
+#if defined(__x86_64__)
+
+#define STRING_BLOCK_SIZE 16
+
+typedef char string_block_t __attribute__((vector_size(STRING_BLOCK_SIZE), may_alias));
+
+/* Bit `i` of the result is set if byte `i` of the block equals `c1` or `c2` (for `i >= skip`). */
+static inline uint64_t string_block_match(const char* block, char c1, char c2, size_t skip) {
+    string_block_t v = *(const string_block_t*)block;
+    string_block_t cmp = (v == (string_block_t){} + c1) | (v == (string_block_t){} + c2);
+    uint64_t mask = (unsigned int)__builtin_ia32_pmovmskb128(cmp);
+    return mask >> skip << skip;
+}
+
+/* Returns the index of the first matching byte, given a non-zero result of the above */
+static inline size_t string_block_index(uint64_t mask) {
+    return __builtin_ctzl(mask);
+}
+
+#else
+
+#define STRING_BLOCK_SIZE 8
+
+#define WORD_ONES  0x0101010101010101UL
+#define WORD_HIGHS 0x8080808080808080UL
+
+/* The lowest set bit of the result is the top bit of the first zero byte of `w` (if any). Higher
+ * bits may be set spuriously, so only the lowest one can be used. */
+static inline uint64_t word_zero_bytes(uint64_t w) {
+    return (w - WORD_ONES) & ~w & WORD_HIGHS;
+}
+
+/* The lowest set bit of the result is the top bit of the first byte (with index `skip` or higher)
+ * that equals `c1` or `c2`. Assumes little endian. */
+static inline uint64_t string_block_match(const char* block, char c1, char c2, size_t skip) {
+    uint64_t w = *(const unaligned_u64*)block;
+    /* make the skipped bytes non-matching, so that they cannot cause spurious matches either */
+    uint64_t skipped = skip ? UINT64_MAX >> (64 - 8 * skip) : 0;
+    return word_zero_bytes((w ^ (WORD_ONES * (uint8_t)c1)) | skipped)
+           | word_zero_bytes((w ^ (WORD_ONES * (uint8_t)c2)) | skipped);
+}
+
+static inline size_t string_block_index(uint64_t mask) {
+    return __builtin_ctzl(mask) / 8;
+}
+
+#endif
@@ -4,6 +4,9 @@
  */
 
 #include "api.h"
+#include "string_block.h"
+
+#ifdef ASAN
 
 size_t strnlen(const char* str, size_t maxlen) {
     size_t len;
@@ -18,3 +21,33 @@ size_t strlen(const char* str) {
         ;
     return len;
 }
+
+#else
+
+size_t strnlen(const char* str, size_t maxlen) {
+    if (!maxlen)
+        return 0;
+
+    const char* block = ALIGN_DOWN_PTR_POW2(str, STRING_BLOCK_SIZE);
+    uint64_t mask = string_block_match(block, '\0', '\0', str - block);
+    while (!mask) {
+        block += STRING_BLOCK_SIZE;
+        if ((size_t)(block - str) >= maxlen)
+            return maxlen;
+        mask = string_block_match(block, '\0', '\0', /*skip=*/0);
+    }
+    size_t len = block + string_block_index(mask) - str;
+    return MIN(len, maxlen);
+}
+
+size_t strlen(const char* str) {
+    const char* block = ALIGN_DOWN_PTR_POW2(str, STRING_BLOCK_SIZE);
+    uint64_t mask = string_block_match(block, '\0', '\0', str - block);
+    while (!mask) {
+        block += STRING_BLOCK_SIZE;
+        mask = string_block_match(block, '\0', '\0', /*skip=*/0);
+    }
+    return block + string_block_index(mask) - str;
+}
+
+#endif
@@ -13,6 +13,7 @@
 #include "libos_defs.h"
 #include "libos_handle.h"
 #include "libos_refcount.h"
+#include "libos_rwlock.h"
 #include "libos_types.h"
 #include "libos_utils.h"
 #include "linux_abi/fs.h"
@@ -35,6 +36,14 @@ struct libos_mount_params {
 
     /* Key name (used by `chroot_encrypted` filesystem), or NULL if not applicable */
     const char* key_name;
+
+    /* Whether the host files under this mount are guaranteed not to change (used by `chroot`
+     * filesystem). On such mounts, failed lookups are remembered in the dentry cache. */
+    bool immutable;
+
+    /* How long (in microseconds) a failed lookup on an immutable mount is remembered, 0 means
+     * forever */
+    uint64_t cache_ttl_us;
 };
 
 struct libos_fs_ops {
@@ -105,6 +114,25 @@ struct libos_fs_ops {
     ssize_t (*writev)(struct libos_handle* handle, struct iovec* iov, size_t iov_len,
                       file_off_t* pos);
 
+    /*!
+     * \brief Copy data from another handle directly, without passing it through LibOS.
+     *
+     * \param         hdl     Handle to write to.
+     * \param         in_hdl  Handle to read from.
+     * \param         count   Maximum number of bytes to copy.
+     * \param[in,out] in_pos  Position in \p in_hdl at which to start reading. Updated on success.
+     * \param[in,out] pos     Position in \p hdl at which to start writing. Might be updated on
+     *                        success.
+     *
+     * \returns Number of bytes copied (0 at the end of \p in_hdl) on success, negative error code
+     *          on failure. `-EOPNOTSUPP` means that the handles cannot be connected; the caller then
+     *          falls back to `read` and `write`.
+     *
+     * Used by `sendfile`, `splice` and `copy_file_range`. Optional.
+     */
+    ssize_t (*splice_from)(struct libos_handle* hdl, struct libos_handle* in_hdl, size_t count,
+                           file_off_t* in_pos, file_off_t* pos);
+
     /*
      * \brief Map file at an address.
      *
@@ -203,6 +231,15 @@ struct libos_fs_ops {
  * pretends to have many files in a directory. */
 #define DENTRY_MAX_CHILDREN 1000000
 
+/* Limit for the number of children of a directory that remember a failed lookup (see
+ * `libos_dentry::negative_until`). Failed lookups beyond it are not remembered, so that probing
+ * many missing files cannot fill the directory up to DENTRY_MAX_CHILDREN. */
+#define DENTRY_MAX_NEGATIVE_CACHED 4096
+
+/* Directories with more children than this get a hash table for looking up children by name;
+ * smaller ones are searched linearly. */
+#define DENTRY_HASH_MIN_CHILDREN 16
+
 /*
  * Describes a single path within a mounted filesystem. If `inode` is set, it is the file at given
  * path.
@@ -229,9 +266,26 @@ struct libos_dentry {
 
     /* The following fields are protected by `g_dcache_lock`. */
     size_t nchildren;
+    size_t nchildren_negative_cached; /* children with non-zero `negative_until` */
     LISTP_TYPE(libos_dentry) children; /* These children and siblings link */
     LIST_TYPE(libos_dentry) siblings;
 
+    /* Hash table of `children`, indexed by `name_hash` and chained through `hash_next`. Allocated
+     * only for directories with more than DENTRY_HASH_MIN_CHILDREN children, NULL otherwise.
+     * `children_hash_size` is the number of buckets (a power of two). Protected by
+     * `g_dcache_lock`. */
+    struct libos_dentry** children_hash;
+    size_t children_hash_size;
+    struct libos_dentry* hash_next;
+    /* Hash of `name`. Does not change. */
+    uint64_t name_hash;
+
+    /* For negative dentries on immutable mounts: time (in microseconds) until which the file is
+     * known not to exist, UINT64_MAX if forever, 0 if unknown. Such dentries are not
+     * garbage-collected until that time, so that repeated lookups do not query the host. Protected
+     * by `g_dcache_lock`, changed only by `dentry_set_negative_until()`. */
+    uint64_t negative_until;
+
     /* Filesystem mounted under this dentry. If set, this dentry is a mountpoint: filesystem
      * operations should use `attached_mount->root` instead of this dentry. Protected by
      * `g_dcache_lock`. */
@@ -497,6 +551,16 @@ struct libos_mount {
     void* cpdata;
     size_t cpsize;
 
+    /* See `libos_mount_params`. */
+    bool immutable;
+    uint64_t cache_ttl_us;
+
+    /* Dentry cache statistics, collected only for immutable mounts: number of lookups answered from
+     * the cache (positive or negative dentries) and number of lookups that had to query the
+     * filesystem. Updated atomically, because lookups of cached dentries can run concurrently. */
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+
     refcount_t ref_count;
     LIST_TYPE(libos_mount) hlist;
     LIST_TYPE(libos_mount) list;
@@ -557,10 +621,20 @@ struct libos_mount* find_mount_from_uri(const char* uri);
 
 int walk_mounts(int (*walk)(struct libos_mount* mount, void* arg), void* arg);
 
+/* Log dentry cache statistics of immutable mounts (see `libos_mount::cache_hits`). */
+void log_mount_cache_stats(void);
+
 /* functions for dcache supports */
 int init_dcache(void);
 
-extern struct libos_lock g_dcache_lock;
+/*
+ * Lock protecting the dentry cache. Functions that modify the cache (including path lookup that
+ * creates dentries or asks the filesystem for missing files) require it to be held for writing:
+ * "the caller should hold `g_dcache_lock`" below means that, unless stated otherwise. Read-only
+ * operations on cached dentries (`path_lookupat_cached`, `lookup_dcache_cached`) can be performed
+ * with the lock held for reading, so that e.g. concurrent `stat` calls do not serialize.
+ */
+extern struct libos_rwlock g_dcache_lock;
 
 /*!
  * \brief Dump dentry cache.
@@ -581,7 +655,7 @@ void dump_dcache(struct libos_dentry* dent);
  * Checks permissions for a dentry. Because Gramine currently has no notion of users, this will
  * always use the "user" part of file mode.
  *
- * The caller should hold `g_dcache_lock`.
+ * The caller should hold `g_dcache_lock` (reading is enough).
  *
  * `dentry` can be negative (in which case the function will return -ENOENT).
  */
@@ -654,6 +728,20 @@ int check_permissions(struct libos_dentry* dent, mode_t mask);
 int path_lookupat(struct libos_dentry* start, const char* path, int flags,
                   struct libos_dentry** found);
 
+/*!
+ * \brief Look up a path using only the dentries already in cache.
+ *
+ * Same as `path_lookupat`, but never modifies the dentry cache, so the caller needs to hold
+ * `g_dcache_lock` only for reading. Fails with -EAGAIN if the path cannot be resolved this way:
+ * some component is not cached or is an unverified negative dentry, or a symbolic link would need
+ * to be followed. In that case, the caller should retry with `path_lookupat` and `g_dcache_lock`
+ * held for writing.
+ *
+ * LOOKUP_CREATE and LOOKUP_MAKE_SYNTHETIC are not supported.
+ */
+int path_lookupat_cached(struct libos_dentry* start, const char* path, int flags,
+                         struct libos_dentry** found);
+
 /*!
  * This function returns a dentry (in *dir) from a handle corresponding to dirfd.
  * If dirfd == AT_FDCWD returns current working directory.
@@ -773,8 +861,9 @@ struct libos_dentry* dentry_up(struct libos_dentry* dent);
  * This function checks if a dentry is unused, and deletes it if that's true. The caller must hold
  * `g_dcache_lock`.
  *
- * A dentry is unused if it has no external references and is negative. Such dentries can remain
- * after failed lookups or file deletion.
+ * A dentry is unused if it has no external references and is negative (except for negative
+ * dentries whose failed lookup is still cached, see `dentry_is_negative_cached()`). Such dentries
+ * can remain after failed lookups or file deletion.
  *
  * The function should be called when processing a list of children, after you're done with a given
  * dentry. It guarantees that the amortized cost of processing such dentries is constant, i.e. they
@@ -793,6 +882,22 @@ struct libos_dentry* dentry_up(struct libos_dentry* dent);
  */
 void dentry_gc(struct libos_dentry* dent);
 
+/*!
+ * \brief Check whether a negative dentry is known not to exist.
+ *
+ * Returns true if a previous lookup of `dent` failed on an immutable mount and the cached result
+ * has not expired yet (see `libos_dentry::negative_until`). The caller must hold `g_dcache_lock`.
+ */
+bool dentry_is_negative_cached(struct libos_dentry* dent);
+
+/*!
+ * \brief Set or clear the time until which a negative dentry is known not to exist.
+ *
+ * Setting it has no effect if the parent already has DENTRY_MAX_NEGATIVE_CACHED such children. The
+ * caller must hold `g_dcache_lock` for writing.
+ */
+void dentry_set_negative_until(struct libos_dentry* dent, uint64_t negative_until);
+
 /*!
  * \brief Compute an absolute path for dentry, allocating memory for it.
  *
@@ -868,12 +973,22 @@ struct libos_dentry* get_new_dentry(struct libos_mount* mount, struct libos_dent
  *
  * \returns The dentry, or NULL if not found.
  *
- * The caller should hold `g_dcache_lock`.
+ * The caller should hold `g_dcache_lock`. While searching, unused negative children of `parent`
+ * may be removed from the cache.
  *
  * If found, the reference count on the returned dentry is incremented.
  */
 struct libos_dentry* lookup_dcache(struct libos_dentry* parent, const char* name, size_t name_len);
 
+/*!
+ * \brief Search for a child of a dentry with a given name, without modifying the cache.
+ *
+ * Same as `lookup_dcache`, but does not remove any dentries, so the caller needs to hold
+ * `g_dcache_lock` only for reading.
+ */
+struct libos_dentry* lookup_dcache_cached(struct libos_dentry* parent, const char* name,
+                                          size_t name_len);
+
 /*
  * Returns true if `anc` is an ancestor of `dent`. Both dentries need to be within the same mounted
  * filesystem.
@@ -975,3 +1090,10 @@ int chroot_dentry_uri(struct libos_dentry* dent, mode_t type, char** out_uri);
 
 int chroot_readdir(struct libos_dentry* dent, readdir_callback_t callback, void* arg);
 int chroot_unlink(struct libos_dentry* dent);
+
+/*
+ * Returns the PAL handle of `hdl` if it is a regular file whose contents are the same as on the host
+ * (i.e. a `chroot` file, but not an encrypted one), so that it can be passed as input to
+ * `PalStreamSplice`. Returns NULL otherwise.
+ */
+PAL_HANDLE chroot_splice_source(struct libos_handle* hdl);
@@ -58,6 +58,11 @@ struct libos_encrypted_file {
  */
 int init_encrypted_files(void);
 
+/*
+ * \brief Log statistics of the caches of decrypted nodes (on debug log level).
+ */
+void log_encrypted_files_stats(void);
+
 /*
  * \brief Retrieve a key.
  *
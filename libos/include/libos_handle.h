@@ -129,9 +129,19 @@ struct libos_epoll_handle {
     /* For details about these fields see `libos_epoll.c`. */
     struct libos_lock lock;
     LISTP_TYPE(libos_epoll_waiter) waiters;
+    /* Items polled with `PalStreamsWaitEvents()` on each wait. */
     LISTP_TYPE(libos_epoll_item) items;
     size_t items_count;
     size_t last_returned_index;
+    /* PAL event set (NULL if not supported) and items monitored by it. */
+    PAL_HANDLE event_set;
+    LISTP_TYPE(libos_epoll_item) set_items;
+    size_t set_items_count;
+    LISTP_TYPE(libos_epoll_item) set_dirty;
+    size_t set_dirty_count;
+    LISTP_TYPE(libos_epoll_item) set_zombies;
+    size_t set_waiters;
+    bool set_busy;
 };
 
 struct libos_handle {
@@ -234,9 +244,17 @@ struct libos_fd_handle {
     uint32_t vfd; /* virtual file descriptor */
     int flags;    /* file descriptor flags, only FD_CLOEXEC */
 
+    /* Modified under the handle map lock, but also read without it by `get_fd_handle`: set (with
+     * release semantics) after `vfd` and `flags`, cleared before them. */
     struct libos_handle* handle;
+
+    /* Number of `get_fd_handle` callers currently reading `handle` without holding the handle map
+     * lock. A detached handle is released only after this drops to zero. */
+    uint32_t readers;
 };
 
+struct libos_retired_fd_map;
+
 struct libos_handle_map {
     /* the top of created file descriptors */
     uint32_t fd_size;
@@ -246,15 +264,26 @@ struct libos_handle_map {
     refcount_t ref_count;
     struct libos_rwlock lock;
 
-    /* An array of file descriptor belong to this mapping */
+    /* An array of file descriptor belong to this mapping. `map` and `fd_size` are modified under
+     * `lock`, but also read without it by `get_fd_handle`: a new array is published before its
+     * size, and the replaced arrays (`retired_maps`) are kept until the handle map is destroyed.
+     * Entries of the array are never freed before that either. */
     struct libos_fd_handle** map;
+    struct libos_retired_fd_map* retired_maps;
+
+    /* Bitmaps for finding the lowest free fd, protected by `lock`: bit `i` of `open_fds` is set if
+     * fd `i` is allocated, bit `i` of `full_fds` is set if word `i` of `open_fds` is all ones. */
+    uint64_t* open_fds;
+    uint64_t* full_fds;
 };
 
 /* allocating file descriptors */
 #define FD_NULL                     UINT32_MAX
 #define HANDLE_ALLOCATED(fd_handle) ((fd_handle) && (fd_handle)->vfd != FD_NULL)
 
+/* Requires `map->lock` to be held (for reading or writing). Does not take a reference. */
 struct libos_handle* __get_fd_handle(uint32_t fd, int* flags, struct libos_handle_map* map);
+/* Does not take `map->lock`. Returns a new reference to the handle, or NULL if `fd` is not open. */
 struct libos_handle* get_fd_handle(uint32_t fd, int* flags, struct libos_handle_map* map);
 
 /*!
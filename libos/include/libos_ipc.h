@@ -36,6 +36,7 @@ enum {
     IPC_MSG_FILE_LOCK_SET,
     IPC_MSG_FILE_LOCK_GET,
     IPC_MSG_FILE_LOCK_CLEAR_PID,
+    IPC_MSG_RING_SETUP,         /*!< Switch the connection to a shared-memory ring. */
     IPC_MSG_CODE_BOUND,
 };
 
@@ -134,6 +135,70 @@ int ipc_send_msg_and_get_response(IDTYPE dest, struct libos_ipc_msg* msg, void**
  */
 int ipc_broadcast(struct libos_ipc_msg* msg, IDTYPE exclude_vmid);
 
+/*!
+ * \brief Run the callback for a received IPC message.
+ *
+ * \param src   ID of sender.
+ * \param code  Code of the message.
+ * \param data  Body of the message.
+ * \param seq   Sequence number of the message.
+ *
+ * This function always takes the ownership of \p data. If the callback fails, the process is
+ * terminated.
+ */
+void ipc_run_callback(IDTYPE src, unsigned char code, void* data, uint64_t seq);
+
+/*
+ * Shared-memory rings, an optional transport for IPC messages (see `libos_ipc_ring.c`). All these
+ * functions do nothing if rings are not enabled in the manifest.
+ */
+struct libos_ipc_ring;
+
+int init_ipc_ring(void);
+int init_ipc_ring_workers(void);
+void terminate_ipc_ring_workers(void);
+
+/*!
+ * \brief Set up a ring for an outgoing IPC connection.
+ *
+ * \param      dest      VMID of the destination process.
+ * \param      pipe      IPC pipe connected to \p dest, used to send the ring to it.
+ * \param[out] out_ring  Contains the new ring, or NULL if the connection should use the pipe.
+ *
+ * Returns an error only if the pipe cannot be used anymore.
+ */
+int ipc_ring_connect(IDTYPE dest, PAL_HANDLE pipe, struct libos_ipc_ring** out_ring);
+void ipc_ring_destroy(struct libos_ipc_ring* ring);
+
+/*!
+ * \brief Send an IPC message through a ring.
+ *
+ * If another thread is writing to the ring, the message is written out (together with others) by
+ * that thread and this function returns immediately; errors are then reported by later calls, and
+ * threads waiting for responses to the lost messages are woken up (see
+ * #ipc_fail_response_waiters).
+ */
+int ipc_ring_send(struct libos_ipc_ring* ring, struct libos_ipc_msg* msg);
+
+/*!
+ * \brief Wake up the threads waiting for responses to messages that could not be sent.
+ *
+ * \param msgs  Buffer with whole IPC messages.
+ * \param size  Size of \p msgs.
+ *
+ * Each thread waiting in #ipc_send_msg_and_get_response for a response to one of the messages
+ * fails as if the destination process died.
+ */
+void ipc_fail_response_waiters(char* msgs, size_t size);
+
+/*!
+ * \brief Handle the messages left in the rings from a disconnected process and remove the rings.
+ *
+ * Also stops threads from waiting for free space in rings to \p src.
+ */
+void ipc_ring_disconnect(IDTYPE src);
+int ipc_ring_setup_callback(IDTYPE src, void* data, uint64_t seq);
+
 /*!
  * \brief Handle a response to a previously sent message.
  *
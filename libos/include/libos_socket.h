@@ -132,3 +132,7 @@ ssize_t do_recvmsg(struct libos_handle* handle, struct iovec* iov, size_t iov_le
 ssize_t do_sendmsg(struct libos_handle* handle, struct iovec* iov, size_t iov_len,
                    void* msg_control, size_t msg_controllen, void* addr, size_t addrlen,
                    unsigned int flags);
+/* Sends up to `count` bytes of a file (see `chroot_splice_source()`) from `*in_pos` directly on the
+ * host. Returns -EOPNOTSUPP if this socket cannot be connected to the file. */
+ssize_t do_sendfile(struct libos_handle* handle, PAL_HANDLE in_pal_handle, file_off_t* in_pos,
+                    size_t count);
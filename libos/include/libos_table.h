@@ -42,6 +42,10 @@ long libos_syscall_pread64(int fd, char* buf, size_t count, loff_t pos);
 long libos_syscall_pwrite64(int fd, char* buf, size_t count, loff_t pos);
 long libos_syscall_readv(unsigned long fd, struct iovec* vec, unsigned long vlen);
 long libos_syscall_writev(unsigned long fd, struct iovec* vec, unsigned long vlen);
+long libos_syscall_preadv(unsigned long fd, struct iovec* vec, unsigned long vlen,
+                          unsigned long pos_l, unsigned long pos_h);
+long libos_syscall_pwritev(unsigned long fd, struct iovec* vec, unsigned long vlen,
+                           unsigned long pos_l, unsigned long pos_h);
 long libos_syscall_access(const char* file, mode_t mode);
 long libos_syscall_pipe(int* fildes);
 long libos_syscall_select(int nfds, struct linux_fd_set* readfds, struct linux_fd_set* writefds,
@@ -187,6 +191,8 @@ long libos_syscall_ppoll(struct pollfd* fds, unsigned int nfds, struct timespec*
                          const __sigset_t* sigmask_ptr, size_t sigsetsize);
 long libos_syscall_set_robust_list(struct robust_list_head* head, size_t len);
 long libos_syscall_get_robust_list(pid_t pid, struct robust_list_head** head, size_t* len);
+long libos_syscall_splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t len,
+                          unsigned int flags);
 long libos_syscall_epoll_pwait(int epfd, struct epoll_event* events, int maxevents, int timeout_ms,
                                const __sigset_t* sigmask, size_t sigsetsize);
 long libos_syscall_accept4(int fd, void* addr, int* addrlen, int flags);
@@ -205,4 +211,6 @@ long libos_syscall_eventfd(unsigned int count);
 long libos_syscall_getcpu(unsigned* cpu, unsigned* node, void* unused_cache);
 long libos_syscall_getrandom(char* buf, size_t count, unsigned int flags);
 long libos_syscall_mlock2(unsigned long start, size_t len, int flags);
+long libos_syscall_copy_file_range(int fd_in, off_t* off_in, int fd_out, off_t* off_out,
+                                   size_t len, unsigned int flags);
 long libos_syscall_sysinfo(struct sysinfo* info);
@@ -27,6 +27,7 @@ struct libos_tcb {
      * an SGX enclave) we lack a way to restore all (or at least some) registers atomically. */
     void*                syscall_scratch_pc;
     void*                vma_cache;
+    void*                slab_thread_cache;
     char                 log_prefix[32];
 };
 
@@ -25,6 +25,8 @@ static inline uint64_t hash64(uint64_t key) {
 
 /* heap allocation functions */
 int init_slab(void);
+/* Must be called by each thread right before PalThreadExit() */
+void destroy_slab_thread_cache(void);
 
 void* malloc(size_t size);
 void free(void* mem);
@@ -7,5 +7,67 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cpu.h"
+
 extern const uint8_t vdso_so[];
 extern const size_t vdso_so_size;
+
+/*
+ * Time page shared between LibOS and the vDSO. It is mapped right before the vDSO image (the vDSO
+ * finds it through the `vdso_time_page` symbol defined in its linker script, so the offset below
+ * must match the one there).
+ *
+ * LibOS publishes a baseline pair of a TSC value and the time since the Epoch, refreshed on the
+ * time syscalls, and the vDSO extrapolates the current time from it with RDTSC. Updates are
+ * protected by `seq`, which is odd while LibOS writes the other fields. If `mult` is zero (RDTSC is
+ * not usable) or the baseline is older than `max_cycles`, the vDSO falls back to the syscall. A
+ * baseline may have a smaller `mult` than the TSC frequency implies, to let the host time catch up
+ * without the time going backwards.
+ */
+#define VDSO_TIME_PAGE_OFFSET 4096
+
+/* nanoseconds = (cycles * mult) >> VDSO_TIME_SHIFT */
+#define VDSO_TIME_SHIFT 32
+
+struct libos_vdso_time {
+    uint32_t seq;
+    uint64_t mult;
+    uint64_t max_cycles;
+    uint64_t base_tsc;
+    uint64_t base_ns;
+};
+
+/* Computes the current time from the baseline in `page`, for both the vDSO and LibOS (which uses
+ * its own copy of the baseline, as the page is writable by the app). Returns false if RDTSC is not
+ * usable, the baseline is too old or is being updated; then LibOS must query the time from PAL and
+ * refresh the baseline. */
+static inline bool vdso_time_read(const struct libos_vdso_time* page, uint64_t* out_ns) {
+    uint32_t seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+        return false;
+
+    uint64_t mult       = __atomic_load_n(&page->mult, __ATOMIC_RELAXED);
+    uint64_t max_cycles = __atomic_load_n(&page->max_cycles, __ATOMIC_RELAXED);
+    uint64_t base_tsc   = __atomic_load_n(&page->base_tsc, __ATOMIC_RELAXED);
+    uint64_t base_ns    = __atomic_load_n(&page->base_ns, __ATOMIC_RELAXED);
+    uint64_t tsc = get_tsc();
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&page->seq, __ATOMIC_RELAXED) != seq)
+        return false;
+
+    /* also catches a TSC value older than the baseline (the difference wraps around) */
+    uint64_t diff = tsc - base_tsc;
+    if (!base_ns || diff >= max_cycles)
+        return false;
+
+    *out_ns = base_ns + ((diff * mult) >> VDSO_TIME_SHIFT);
+    return true;
+}
+
+/* Called by LibOS after mapping a new time page (on startup and on execve). */
+void init_vdso_time(struct libos_vdso_time* time_page);
@@ -50,3 +50,8 @@ struct linux_dirent_tail {
 #define SEEK_END  2 /* seek relative to end of file */
 #define SEEK_DATA 3 /* seek to the next data */
 #define SEEK_HOLE 4 /* seek to the next hole */
+
+#define SPLICE_F_MOVE     1 /* move pages instead of copying (only a hint) */
+#define SPLICE_F_NONBLOCK 2 /* don't block on pipe I/O */
+#define SPLICE_F_MORE     4 /* more data will be coming in a subsequent splice */
+#define SPLICE_F_GIFT     8 /* pages passed in are a gift (vmsplice only) */
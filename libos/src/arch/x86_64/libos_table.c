@@ -289,7 +289,7 @@ libos_syscall_t libos_syscall_table[LIBOS_SYSCALL_BOUND] = {
     [__NR_unshare]                 = (libos_syscall_t)0, // libos_syscall_unshare
     [__NR_set_robust_list]         = (libos_syscall_t)libos_syscall_set_robust_list,
     [__NR_get_robust_list]         = (libos_syscall_t)libos_syscall_get_robust_list,
-    [__NR_splice]                  = (libos_syscall_t)0, // libos_syscall_splice
+    [__NR_splice]                  = (libos_syscall_t)libos_syscall_splice,
     [__NR_tee]                     = (libos_syscall_t)0, // libos_syscall_tee
     [__NR_sync_file_range]         = (libos_syscall_t)0, // libos_syscall_sync_file_range
     [__NR_vmsplice]                = (libos_syscall_t)0, // libos_syscall_vmsplice
@@ -309,8 +309,8 @@ libos_syscall_t libos_syscall_table[LIBOS_SYSCALL_BOUND] = {
     [__NR_dup3]                    = (libos_syscall_t)libos_syscall_dup3,
     [__NR_pipe2]                   = (libos_syscall_t)libos_syscall_pipe2,
     [__NR_inotify_init1]           = (libos_syscall_t)0, // libos_syscall_inotify_init1
-    [__NR_preadv]                  = (libos_syscall_t)0, // libos_syscall_preadv
-    [__NR_pwritev]                 = (libos_syscall_t)0, // libos_syscall_pwritev
+    [__NR_preadv]                  = (libos_syscall_t)libos_syscall_preadv,
+    [__NR_pwritev]                 = (libos_syscall_t)libos_syscall_pwritev,
     [__NR_rt_tgsigqueueinfo]       = (libos_syscall_t)0, // libos_syscall_rt_tgsigqueueinfo
     [__NR_perf_event_open]         = (libos_syscall_t)0, // libos_syscall_perf_event_open
     [__NR_recvmmsg]                = (libos_syscall_t)libos_syscall_recvmmsg,
@@ -340,7 +340,7 @@ libos_syscall_t libos_syscall_table[LIBOS_SYSCALL_BOUND] = {
     [__NR_userfaultfd]             = (libos_syscall_t)0, // libos_syscall_userfaultfd
     [__NR_membarrier]              = (libos_syscall_t)0, // libos_syscall_membarrier
     [__NR_mlock2]                  = (libos_syscall_t)libos_syscall_mlock2,
-    [__NR_copy_file_range]         = (libos_syscall_t)0, // libos_syscall_copy_file_range
+    [__NR_copy_file_range]         = (libos_syscall_t)libos_syscall_copy_file_range,
     [__NR_preadv2]                 = (libos_syscall_t)0, // libos_syscall_preadv2
     [__NR_pwritev2]                = (libos_syscall_t)0, // libos_syscall_pwritev2
     [__NR_pkey_mprotect]           = (libos_syscall_t)0, // libos_syscall_pkey_mprotect
@@ -31,10 +31,18 @@ static MEM_MGR handle_mgr = NULL;
 
 #define INIT_HANDLE_MAP_SIZE 32
 
+#define FD_BITMAP_WORDS(size) (((size) + 63) / 64)
+
+/* An array previously used as `libos_handle_map::map`, see `__enlarge_handle_map()` */
+struct libos_retired_fd_map {
+    struct libos_retired_fd_map* next;
+    struct libos_fd_handle** map;
+};
+
 int open_executable(struct libos_handle* hdl, const char* path) {
     struct libos_dentry* dent = NULL;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     int ret = path_lookupat(/*start=*/NULL, path, LOOKUP_FOLLOW, &dent);
     if (ret < 0) {
         goto out;
@@ -57,7 +65,7 @@ int open_executable(struct libos_handle* hdl, const char* path) {
 
     ret = 0;
 out:
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (dent)
         put_dentry(dent);
 
@@ -127,7 +135,7 @@ out:
 
 static struct libos_handle_map* get_new_handle_map(uint32_t size);
 
-static int __init_handle(struct libos_fd_handle** fdhdl, uint32_t fd, struct libos_handle* hdl,
+static int __init_handle(struct libos_handle_map* map, uint32_t fd, struct libos_handle* hdl,
                          int fd_flags);
 
 static int __enlarge_handle_map(struct libos_handle_map* map, uint32_t size);
@@ -189,8 +197,12 @@ int init_std_handles(void) {
             return ret;
         }
 
-        __init_handle(&handle_map->map[0], /*fd=*/0, stdin_hdl, /*flags=*/0);
+        ret = __init_handle(handle_map, /*fd=*/0, stdin_hdl, /*flags=*/0);
         put_handle(stdin_hdl);
+        if (ret < 0) {
+            rwlock_write_unlock(&handle_map->lock);
+            return ret;
+        }
     }
 
     /* initialize stdout */
@@ -209,14 +221,22 @@ int init_std_handles(void) {
             return ret;
         }
 
-        __init_handle(&handle_map->map[1], /*fd=*/1, stdout_hdl, /*flags=*/0);
+        ret = __init_handle(handle_map, /*fd=*/1, stdout_hdl, /*flags=*/0);
         put_handle(stdout_hdl);
+        if (ret < 0) {
+            rwlock_write_unlock(&handle_map->lock);
+            return ret;
+        }
     }
 
     /* initialize stderr as duplicate of stdout */
     if (!HANDLE_ALLOCATED(handle_map->map[2])) {
         struct libos_handle* stdout_hdl = handle_map->map[1]->handle;
-        __init_handle(&handle_map->map[2], /*fd=*/2, stdout_hdl, /*flags=*/0);
+        ret = __init_handle(handle_map, /*fd=*/2, stdout_hdl, /*flags=*/0);
+        if (ret < 0) {
+            rwlock_write_unlock(&handle_map->lock);
+            return ret;
+        }
     }
 
     if (handle_map->fd_top == FD_NULL || handle_map->fd_top < 2)
@@ -245,18 +265,80 @@ struct libos_handle* __get_fd_handle(uint32_t fd, int* fd_flags, struct libos_ha
     return NULL;
 }
 
+/*
+ * Lock-free lookup, used by most syscalls that take an fd. The array and its entries stay valid
+ * until the handle map is destroyed (see `libos_handle_map::map`), so the only race is with
+ * detaching the handle: the reader announces itself in `fd_handle->readers` before loading
+ * `fd_handle->handle`, and `__detach_fd_handle()` clears `fd_handle->handle` and then waits for
+ * the readers to go away before the slot's reference to the handle can be dropped. Both sides use
+ * sequentially consistent operations, so either the reader sees the cleared pointer, or the writer
+ * sees the reader.
+ */
 struct libos_handle* get_fd_handle(uint32_t fd, int* fd_flags, struct libos_handle_map* map) {
     map = map ?: get_thread_handle_map(NULL);
     assert(map);
 
-    struct libos_handle* hdl = NULL;
-    rwlock_read_lock(&map->lock);
-    if ((hdl = __get_fd_handle(fd, fd_flags, map)))
+    /* `map->map` is published before `map->fd_size`, so the array is at least that large */
+    if (fd >= __atomic_load_n(&map->fd_size, __ATOMIC_ACQUIRE))
+        return NULL;
+    struct libos_fd_handle** fds = __atomic_load_n(&map->map, __ATOMIC_ACQUIRE);
+    struct libos_fd_handle* fd_handle = __atomic_load_n(&fds[fd], __ATOMIC_ACQUIRE);
+    if (!fd_handle)
+        return NULL;
+
+    __atomic_add_fetch(&fd_handle->readers, 1, __ATOMIC_SEQ_CST);
+    struct libos_handle* hdl = __atomic_load_n(&fd_handle->handle, __ATOMIC_SEQ_CST);
+    if (hdl) {
         get_handle(hdl);
-    rwlock_read_unlock(&map->lock);
+        if (fd_flags)
+            *fd_flags = __atomic_load_n(&fd_handle->flags, __ATOMIC_RELAXED);
+    }
+    __atomic_sub_fetch(&fd_handle->readers, 1, __ATOMIC_RELEASE);
     return hdl;
 }
 
+static void fd_bitmap_set(struct libos_handle_map* map, uint32_t fd) {
+    uint32_t word = fd / 64;
+    map->open_fds[word] |= 1UL << (fd % 64);
+    if (map->open_fds[word] == UINT64_MAX)
+        map->full_fds[word / 64] |= 1UL << (word % 64);
+}
+
+static void fd_bitmap_clear(struct libos_handle_map* map, uint32_t fd) {
+    uint32_t word = fd / 64;
+    map->open_fds[word] &= ~(1UL << (fd % 64));
+    map->full_fds[word / 64] &= ~(1UL << (word % 64));
+}
+
+/* Returns the lowest free fd not lower than `fd`. The result may be past the end of `map`. */
+static uint32_t find_free_fd(struct libos_handle_map* map, uint32_t fd) {
+    assert(rwlock_is_write_locked(&map->lock));
+
+    uint32_t words_cnt = FD_BITMAP_WORDS(map->fd_size);
+    uint32_t word = fd / 64;
+    if (word >= words_cnt)
+        return fd;
+
+    uint64_t free_bits = ~map->open_fds[word] & (UINT64_MAX << (fd % 64));
+    if (free_bits)
+        return word * 64 + __builtin_ctzl(free_bits);
+
+    /* skip full words of `open_fds`, 64 at a time */
+    word++;
+    while (word < words_cnt) {
+        uint64_t not_full = ~map->full_fds[word / 64] & (UINT64_MAX << (word % 64));
+        if (!not_full) {
+            word = ALIGN_DOWN(word, 64) + 64;
+            continue;
+        }
+        word = ALIGN_DOWN(word, 64) + __builtin_ctzl(not_full);
+        if (word >= words_cnt)
+            break;
+        return word * 64 + __builtin_ctzl(~map->open_fds[word]);
+    }
+    return words_cnt * 64;
+}
+
 static struct libos_handle* __detach_fd_handle(struct libos_fd_handle* fd, int* flags,
                                                struct libos_handle_map* map) {
     assert(rwlock_is_write_locked(&map->lock));
@@ -270,9 +352,13 @@ static struct libos_handle* __detach_fd_handle(struct libos_fd_handle* fd, int*
         if (flags)
             *flags = fd->flags;
 
-        fd->vfd    = FD_NULL;
-        fd->handle = NULL;
-        fd->flags  = 0;
+        __atomic_store_n(&fd->handle, NULL, __ATOMIC_SEQ_CST);
+        /* wait for lock-free readers which could have loaded the handle, see `get_fd_handle()` */
+        while (__atomic_load_n(&fd->readers, __ATOMIC_SEQ_CST))
+            CPU_RELAX();
+        fd->vfd   = FD_NULL;
+        fd->flags = 0;
+        fd_bitmap_clear(map, vfd);
 
         if (vfd == map->fd_top)
             do {
@@ -365,22 +451,25 @@ struct libos_handle* get_new_handle(void) {
     return new_handle;
 }
 
-static int __init_handle(struct libos_fd_handle** fdhdl, uint32_t fd, struct libos_handle* hdl,
+static int __init_handle(struct libos_handle_map* map, uint32_t fd, struct libos_handle* hdl,
                          int fd_flags) {
-    struct libos_fd_handle* new_handle = *fdhdl;
+    assert(rwlock_is_write_locked(&map->lock));
+    assert(fd < map->fd_size);
     assert((fd_flags & ~FD_CLOEXEC) == 0);  // The only supported flag right now
 
+    struct libos_fd_handle* new_handle = map->map[fd];
     if (!new_handle) {
-        new_handle = malloc(sizeof(struct libos_fd_handle));
+        new_handle = calloc(1, sizeof(struct libos_fd_handle));
         if (!new_handle)
             return -ENOMEM;
-        *fdhdl = new_handle;
+        __atomic_store_n(&map->map[fd], new_handle, __ATOMIC_RELEASE);
     }
 
     new_handle->vfd   = fd;
     new_handle->flags = fd_flags;
     get_handle(hdl);
-    new_handle->handle = hdl;
+    __atomic_store_n(&new_handle->handle, hdl, __ATOMIC_RELEASE);
+    fd_bitmap_set(map, fd);
     return 0;
 }
 
@@ -400,10 +489,7 @@ static int __set_new_fd_handle(uint32_t fd, struct libos_handle* hdl, int fd_fla
     if (handle_map->fd_top != FD_NULL) {
         assert(handle_map->map);
         if (find_free) {
-            // find first free fd
-            while (fd <= handle_map->fd_top && HANDLE_ALLOCATED(handle_map->map[fd])) {
-                fd++;
-            }
+            fd = find_free_fd(handle_map, fd);
         } else {
             // check if requested fd is occupied
             if (fd <= handle_map->fd_top && HANDLE_ALLOCATED(handle_map->map[fd])) {
@@ -438,7 +524,7 @@ static int __set_new_fd_handle(uint32_t fd, struct libos_handle* hdl, int fd_fla
 
     assert(handle_map->map);
     assert(fd < handle_map->fd_size);
-    ret = __init_handle(&handle_map->map[fd], fd, hdl, fd_flags);
+    ret = __init_handle(handle_map, fd, hdl, fd_flags);
     if (ret < 0)
         goto out;
 
@@ -559,6 +645,34 @@ int get_file_size(struct libos_handle* hdl, uint64_t* size) {
     return 0;
 }
 
+static int alloc_fd_bitmaps(uint32_t size, uint64_t** out_open_fds, uint64_t** out_full_fds) {
+    uint64_t* open_fds = calloc(FD_BITMAP_WORDS(size), sizeof(*open_fds));
+    uint64_t* full_fds = calloc(FD_BITMAP_WORDS(FD_BITMAP_WORDS(size)), sizeof(*full_fds));
+    if (!open_fds || !full_fds) {
+        free(open_fds);
+        free(full_fds);
+        return -ENOMEM;
+    }
+    *out_open_fds = open_fds;
+    *out_full_fds = full_fds;
+    return 0;
+}
+
+static void free_handle_map(struct libos_handle_map* map) {
+    struct libos_retired_fd_map* retired = map->retired_maps;
+    while (retired) {
+        struct libos_retired_fd_map* next = retired->next;
+        free(retired->map);
+        free(retired);
+        retired = next;
+    }
+
+    free(map->open_fds);
+    free(map->full_fds);
+    free(map->map);
+    free(map);
+}
+
 static struct libos_handle_map* get_new_handle_map(uint32_t size) {
     struct libos_handle_map* handle_map = calloc(1, sizeof(struct libos_handle_map));
 
@@ -567,16 +681,16 @@ static struct libos_handle_map* get_new_handle_map(uint32_t size) {
 
     handle_map->map = calloc(size, sizeof(*handle_map->map));
 
-    if (!handle_map->map) {
-        free(handle_map);
+    if (!handle_map->map
+            || alloc_fd_bitmaps(size, &handle_map->open_fds, &handle_map->full_fds) < 0) {
+        free_handle_map(handle_map);
         return NULL;
     }
 
     handle_map->fd_top  = FD_NULL;
     handle_map->fd_size = size;
     if (!rwlock_create(&handle_map->lock)) {
-        free(handle_map->map);
-        free(handle_map);
+        free_handle_map(handle_map);
         return NULL;
     }
 
@@ -592,13 +706,33 @@ static int __enlarge_handle_map(struct libos_handle_map* map, uint32_t size) {
         return 0;
 
     struct libos_fd_handle** new_map = calloc(size, sizeof(new_map[0]));
-    if (!new_map)
+    struct libos_retired_fd_map* retired = malloc(sizeof(*retired));
+    uint64_t* open_fds = NULL;
+    uint64_t* full_fds = NULL;
+    if (!new_map || !retired || alloc_fd_bitmaps(size, &open_fds, &full_fds) < 0) {
+        free(new_map);
+        free(retired);
         return -ENOMEM;
+    }
 
     memcpy(new_map, map->map, map->fd_size * sizeof(new_map[0]));
-    free(map->map);
-    map->map     = new_map;
-    map->fd_size = size;
+    memcpy(open_fds, map->open_fds, FD_BITMAP_WORDS(map->fd_size) * sizeof(open_fds[0]));
+    memcpy(full_fds, map->full_fds,
+           FD_BITMAP_WORDS(FD_BITMAP_WORDS(map->fd_size)) * sizeof(full_fds[0]));
+    free(map->open_fds);
+    free(map->full_fds);
+    map->open_fds = open_fds;
+    map->full_fds = full_fds;
+
+    /* The old array may still be used by lock-free readers (see `get_fd_handle()`), so it is freed
+     * only together with the handle map. Arrays grow geometrically, so this at most doubles the
+     * memory used. */
+    retired->map = map->map;
+    retired->next = map->retired_maps;
+    map->retired_maps = retired;
+
+    __atomic_store_n(&map->map, new_map, __ATOMIC_RELEASE);
+    __atomic_store_n(&map->fd_size, size, __ATOMIC_RELEASE);
     return 0;
 }
 
@@ -609,8 +743,10 @@ int dup_handle_map(struct libos_handle_map** new, struct libos_handle_map* old_m
        the old one */
     struct libos_handle_map* new_map = get_new_handle_map(old_map->fd_size);
 
-    if (!new_map)
+    if (!new_map) {
+        rwlock_read_unlock(&old_map->lock);
         return -ENOMEM;
+    }
 
     new_map->fd_top = old_map->fd_top;
 
@@ -628,15 +764,19 @@ int dup_handle_map(struct libos_handle_map** new, struct libos_handle_map* old_m
             struct libos_handle* hdl = fd_old->handle;
             get_handle(hdl);
 
-            fd_new = malloc(sizeof(struct libos_fd_handle));
+            fd_new = calloc(1, sizeof(struct libos_fd_handle));
             if (!fd_new) {
+                put_handle(hdl);
                 for (uint32_t j = 0; j < i; j++) {
+                    if (!new_map->map[j])
+                        continue;
                     put_handle(new_map->map[j]->handle);
                     free(new_map->map[j]);
                 }
                 rwlock_read_unlock(&old_map->lock);
                 *new = NULL;
-                free(new_map);
+                rwlock_destroy(&new_map->lock);
+                free_handle_map(new_map);
                 return -ENOMEM;
             }
 
@@ -645,6 +785,7 @@ int dup_handle_map(struct libos_handle_map** new, struct libos_handle_map* old_m
             fd_new->vfd     = fd_old->vfd;
             fd_new->handle  = hdl;
             fd_new->flags   = fd_old->flags;
+            fd_bitmap_set(new_map, i);
         }
     }
 
@@ -681,8 +822,7 @@ void put_handle_map(struct libos_handle_map* map) {
 
     done:
         rwlock_destroy(&map->lock);
-        free(map->map);
-        free(map);
+        free_handle_map(map);
     }
 }
 
@@ -807,6 +947,14 @@ BEGIN_CP_FUNC(handle) {
             INIT_LISTP(&epoll->waiters);
             INIT_LISTP(&epoll->items);
             epoll->items_count = 0;
+            epoll->event_set = NULL;
+            INIT_LISTP(&epoll->set_items);
+            epoll->set_items_count = 0;
+            INIT_LISTP(&epoll->set_dirty);
+            epoll->set_dirty_count = 0;
+            INIT_LISTP(&epoll->set_zombies);
+            epoll->set_waiters = 0;
+            epoll->set_busy = false;
             DO_CP(epoll_items_list, hdl, new_hdl);
         }
 
@@ -887,7 +1035,11 @@ BEGIN_RS_FUNC(handle) {
                 return -ENOMEM;
             }
             CP_REBASE(epoll->waiters);
-            /* `epoll->items` is rebased in epoll_items_list RS_FUNC. */
+            /* `epoll->items` is rebased in epoll_items_list RS_FUNC. Migrated items are all polled
+             * without the event set, only items added later are put into it. */
+            if (PalEventSetCreate(&epoll->event_set) < 0) {
+                epoll->event_set = NULL;
+            }
             break;
         default:
             break;
@@ -911,6 +1063,7 @@ BEGIN_CP_FUNC(fd_handle) {
     size_t off = ADD_CP_OFFSET(sizeof(struct libos_fd_handle));
     new_fdhdl = (struct libos_fd_handle*)(base + off);
     *new_fdhdl = *fdhdl;
+    new_fdhdl->readers = 0;
     DO_CP(handle, fdhdl->handle, &new_fdhdl->handle);
     ADD_CP_FUNC_ENTRY(off);
 
@@ -943,8 +1096,11 @@ BEGIN_CP_FUNC(handle_map) {
 
         ptr_array = (void*)new_handle_map + sizeof(struct libos_handle_map);
 
-        new_handle_map->fd_size = fd_size;
-        new_handle_map->map     = fd_size ? ptr_array : NULL;
+        new_handle_map->fd_size      = fd_size;
+        new_handle_map->map          = fd_size ? ptr_array : NULL;
+        new_handle_map->retired_maps = NULL;
+        new_handle_map->open_fds     = NULL;
+        new_handle_map->full_fds     = NULL;
 
         refcount_set(&new_handle_map->ref_count, 0);
         new_handle_map->lock = (struct libos_rwlock){0};
@@ -980,6 +1136,9 @@ BEGIN_RS_FUNC(handle_map) {
     if (!rwlock_create(&handle_map->lock)) {
         return -ENOMEM;
     }
+    if (alloc_fd_bitmaps(handle_map->fd_size, &handle_map->open_fds, &handle_map->full_fds) < 0) {
+        return -ENOMEM;
+    }
     rwlock_write_lock(&handle_map->lock);
 
     if (handle_map->fd_top != FD_NULL)
@@ -990,6 +1149,7 @@ BEGIN_RS_FUNC(handle_map) {
                 struct libos_handle* hdl = handle_map->map[i]->handle;
                 assert(hdl);
                 get_handle(hdl);
+                fd_bitmap_set(handle_map, i);
                 DEBUG_RS("[%d]%s", i, hdl->uri ?: hdl->fs_type);
             }
         }
@@ -51,7 +51,7 @@ int init_process(void) {
     /* default Linux umask */
     g_process.umask = 0022;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     /* Temporarily set `root` to `g_dentry_root`. It will be updated if necessary in
      * `init_mount_root`. */
     g_process.root = g_dentry_root;
@@ -59,7 +59,7 @@ int init_process(void) {
     /* Temporarily set `cwd` to `g_dentry_root`. It will be updated if necessary in `init_mount`. */
     g_process.cwd = g_dentry_root;
     get_dentry(g_process.cwd);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
 
     /* `g_process.exec` will be initialized later on (in `init_important_handles`). */
     g_process.exec = NULL;
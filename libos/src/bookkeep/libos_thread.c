@@ -618,6 +618,7 @@ BEGIN_CP_FUNC(thread) {
             new_tcb->self      = NULL;
             new_tcb->tp        = NULL;
             new_tcb->vma_cache = NULL;
+            new_tcb->slab_thread_cache = NULL;
 
             new_tcb->log_prefix[0] = '\0';
 
@@ -687,8 +688,11 @@ BEGIN_RS_FUNC(thread) {
     CP_REBASE(thread->libos_tcb->context.regs);
 
     libos_tcb_t* tcb = libos_get_tcb();
+    /* this thread may have already allocated its slab cache, keep it */
+    void* slab_thread_cache = tcb->slab_thread_cache;
     *tcb = *thread->libos_tcb;
     __libos_tcb_init(tcb);
+    tcb->slab_thread_cache = slab_thread_cache;
 
     assert(tcb->context.regs);
     set_tls(tcb->context.tls);
@@ -22,6 +22,7 @@
 #include "libos_utils.h"
 #include "libos_vma.h"
 #include "linux_abi/memory.h"
+#include "seqlock.h"
 #include "spinlock.h"
 
 /* The amount of total memory usage, all accesses must be protected by `vma_tree_lock`. */
@@ -47,13 +48,13 @@ struct libos_vma {
     int flags;
     struct libos_handle* file;
     uint64_t offset; // offset inside `file`, where `begin` starts
-    union {
-        /* If this `vma` is used, it is included in `vma_tree` using this node. */
-        struct avl_tree_node tree_node;
-        /* Otherwise it might be cached in per thread vma cache, or might be on a temporary list
-         * of to-be-freed vmas (used by _vma_bkeep_remove). Such lists use the field below. */
-        struct libos_vma* next_free;
-    };
+    /* If this `vma` is used, it is included in `vma_tree` using this node. */
+    struct avl_tree_node tree_node;
+    /* Otherwise it might be cached in per thread vma cache, on the global list of free vmas, or on
+     * a temporary list of to-be-freed vmas (used by _vma_bkeep_remove). Such lists use the field
+     * below. It is separate from `tree_node`, because lockless readers of `vma_tree` may still
+     * follow the tree links of a vma after it was freed (see the comment at `vma_tree_lock`). */
+    struct libos_vma* next_free;
     char comment[VMA_COMMENT_LEN];
 };
 
@@ -102,10 +103,28 @@ static bool cmp_addr_to_vma(void* addr, struct avl_tree_node* node) {
  * to be revisited as there might be some optimizations that would break due to it.
  */
 static struct avl_tree vma_tree = {.cmp = vma_tree_cmp};
-static spinlock_t vma_tree_lock = INIT_SPINLOCK_UNLOCKED;
+
+/*
+ * All modifications of `vma_tree` (including VMAs inserted in it) happen between `write_seqbegin()`
+ * and `write_seqend()`. Read-only accesses usually just take the spinlock (`vma_tree_lock.lock`),
+ * but the hot paths (`lookup_vma()` and `is_in_adjacent_user_vmas()`) first try to walk the tree
+ * speculatively, without any locking, and retry if a writer interfered. Unlike the general seqlock
+ * usage, these readers follow pointers, possibly to vmas that were already removed from the tree
+ * and freed. This is safe because vma memory is type-stable: freed vmas are kept on our own free
+ * lists and never given back to `vma_mgr` (which would overwrite or poison them) nor to the system
+ * (see `_vma_free()`), and their tree links are only ever overwritten with whole-pointer stores, so
+ * they always point to a vma or are NULL (see `reset_vma()`). The speculative walks are also
+ * bounded, so they terminate even on an inconsistent tree.
+ */
+static seqlock_t vma_tree_lock = INIT_SEQLOCK_UNLOCKED;
+
+/* Number of speculative attempts of lockless readers before falling back to the spinlock */
+#define VMA_TREE_READ_TRIES 4
+/* Bound on the steps of a speculative tree walk; way above the height of any real AVL tree */
+#define VMA_TREE_MAX_WALK_STEPS 128
 
 static void total_memory_size_add(size_t length) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
 
     g_total_memory_size += length;
 
@@ -117,7 +136,7 @@ static void total_memory_size_add(size_t length) {
 }
 
 static void total_memory_size_sub(size_t length) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
     assert(g_total_memory_size >= length);
 
     g_total_memory_size -= length;
@@ -131,29 +150,29 @@ static struct libos_vma* node2vma(struct avl_tree_node* node) {
 }
 
 static struct libos_vma* _get_next_vma(struct libos_vma* vma) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
     return node2vma(avl_tree_next(&vma->tree_node));
 }
 
 static struct libos_vma* _get_prev_vma(struct libos_vma* vma) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
     return node2vma(avl_tree_prev(&vma->tree_node));
 }
 
 static struct libos_vma* _get_last_vma(void) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
     return node2vma(avl_tree_last(&vma_tree));
 }
 
 static struct libos_vma* _get_first_vma(void) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
     return node2vma(avl_tree_first(&vma_tree));
 }
 
 /* Returns the vma that contains `addr`. If there is no such vma, returns the closest vma with
  * higher address. */
 static struct libos_vma* _lookup_vma(uintptr_t addr) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
 
     struct avl_tree_node* node = avl_tree_lower_bound_fn(&vma_tree, (void*)addr, cmp_addr_to_vma);
     if (!node) {
@@ -176,7 +195,7 @@ typedef bool (*traverse_visitor)(struct libos_vma* vma, void* visitor_arg);
 // TODO: Probably other VMA functions could make use of this helper.
 static bool _traverse_vmas_in_range(uintptr_t begin, uintptr_t end, traverse_visitor visitor,
                                     void* visitor_arg) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
     assert(begin <= end);
 
     if (begin == end)
@@ -228,7 +247,7 @@ static void split_vma(struct libos_vma* old_vma, struct libos_vma* new_vma, uint
  */
 static int _vma_bkeep_remove(uintptr_t begin, uintptr_t end, bool is_internal,
                              struct libos_vma** new_vma_ptr, struct libos_vma** vmas_to_free) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
     assert(!new_vma_ptr || *new_vma_ptr);
     assert(IS_ALLOC_ALIGNED_PTR(begin) && IS_ALLOC_ALIGNED_PTR(end));
 
@@ -325,11 +344,11 @@ static void* _vma_malloc(size_t size) {
     if (ret < 0) {
         struct libos_vma* vmas_to_free = NULL;
 
-        spinlock_lock(&vma_tree_lock);
+        write_seqbegin(&vma_tree_lock);
         /* Since we are freeing a range we just created, additional vma is not needed. */
         ret = _vma_bkeep_remove((uintptr_t)addr, (uintptr_t)addr + size, /*is_internal=*/true, NULL,
                                 &vmas_to_free);
-        spinlock_unlock(&vma_tree_lock);
+        write_seqend(&vma_tree_lock);
         if (ret < 0) {
             log_error("Removing a vma we just created failed: %s", unix_strerror(ret));
             BUG();
@@ -358,6 +377,9 @@ static void _vma_free(void* ptr, size_t size) {
 
 static struct libos_lock vma_mgr_lock;
 static MEM_MGR vma_mgr = NULL;
+/* Free vmas that did not fit in the per-thread caches, linked via `next_free`; protected by
+ * `vma_mgr_lock`. Vmas are never returned to `vma_mgr` (see the comment at `vma_tree_lock`). */
+static struct libos_vma* g_free_vmas = NULL;
 
 /*
  * We use a following per-thread caching mechanism of VMAs:
@@ -455,6 +477,23 @@ static void remove_from_thread_vma_cache(struct libos_vma* to_remove) {
     }
 }
 
+/* Clears all fields of `vma`. Lockless readers of `vma_tree` may be concurrently following the tree
+ * links of a freed vma, so these are cleared with whole-pointer stores rather than `memset()`. */
+static void reset_vma(struct libos_vma* vma) {
+    vma->begin     = 0;
+    vma->end       = 0;
+    vma->prot      = 0;
+    vma->flags     = 0;
+    vma->file      = NULL;
+    vma->offset    = 0;
+    vma->next_free = NULL;
+    __atomic_store_n(&vma->tree_node.left, NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&vma->tree_node.right, NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&vma->tree_node.parent, NULL, __ATOMIC_RELAXED);
+    vma->tree_node.balance = 0;
+    memset(vma->comment, 0, sizeof(vma->comment));
+}
+
 static struct libos_vma* alloc_vma(void) {
     struct libos_vma* vma = get_from_thread_vma_cache();
     if (vma) {
@@ -462,11 +501,20 @@ static struct libos_vma* alloc_vma(void) {
     }
 
     lock(&vma_mgr_lock);
+    if (g_free_vmas) {
+        vma = g_free_vmas;
+        g_free_vmas = vma->next_free;
+        goto out_unlock;
+    }
+
     vma = get_mem_obj_from_mgr(vma_mgr);
     if (!vma) {
         /* `enlarge_mem_mgr` below will call _vma_malloc, which uses at most 1 vma - so we
-         * temporarily provide it. */
-        struct libos_vma tmp_vma = {0};
+         * temporarily provide it. It is static (protected by `vma_mgr_lock`) rather than on the
+         * stack, because lockless readers of `vma_tree` may still access it after it is migrated
+         * (see the comment at `vma_tree_lock`). */
+        static struct libos_vma tmp_vma;
+        reset_vma(&tmp_vma);
         /* vma cache is empty, as we checked it before. */
         if (!add_to_thread_vma_cache(&tmp_vma)) {
             log_error("Failed to add tmp vma to cache!");
@@ -483,7 +531,7 @@ static struct libos_vma* alloc_vma(void) {
             BUG();
         }
 
-        spinlock_lock(&vma_tree_lock);
+        write_seqbegin(&vma_tree_lock);
         /* Currently `tmp_vma` is always used (added to `vma_tree`), but this assumption could
          * easily be changed (e.g. if we implement VMAs merging).*/
         struct avl_tree_node* node = &tmp_vma.tree_node;
@@ -493,10 +541,11 @@ static struct libos_vma* alloc_vma(void) {
             avl_tree_swap_node(&vma_tree, node, &vma_migrate->tree_node);
             vma_migrate = NULL;
         }
-        spinlock_unlock(&vma_tree_lock);
+        write_seqend(&vma_tree_lock);
 
         if (vma_migrate) {
-            free_mem_obj_to_mgr(vma_mgr, vma_migrate);
+            vma_migrate->next_free = g_free_vmas;
+            g_free_vmas = vma_migrate;
         }
         remove_from_thread_vma_cache(&tmp_vma);
 
@@ -507,7 +556,7 @@ out_unlock:
     unlock(&vma_mgr_lock);
 out:
     if (vma) {
-        memset(vma, 0, sizeof(*vma));
+        reset_vma(vma);
     }
     return vma;
 }
@@ -527,8 +576,14 @@ static void free_vma(struct libos_vma* vma) {
         return;
     }
 
+    if (memory_migrated(vma)) {
+        /* vmas from the checkpoint of the parent are not reused (as with `vma_mgr`) */
+        return;
+    }
+
     lock(&vma_mgr_lock);
-    free_mem_obj_to_mgr(vma_mgr, vma);
+    vma->next_free = g_free_vmas;
+    g_free_vmas = vma;
     unlock(&vma_mgr_lock);
 }
 
@@ -541,7 +596,7 @@ static void free_vmas_freelist(struct libos_vma* vma) {
 }
 
 static int _bkeep_initial_vma(struct libos_vma* new_vma) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
 
     struct libos_vma* tmp_vma = _lookup_vma(new_vma->begin);
     if (tmp_vma && tmp_vma->begin < new_vma->end) {
@@ -596,7 +651,7 @@ int init_vma(void) {
     }
     assert(1 + idx == ARRAY_SIZE(init_vmas));
 
-    spinlock_lock(&vma_tree_lock);
+    write_seqbegin(&vma_tree_lock);
     int ret = 0;
     /* First of init_vmas is reserved for later usage. */
     for (size_t i = 1; i < ARRAY_SIZE(init_vmas); i++) {
@@ -622,7 +677,7 @@ int init_vma(void) {
         log_debug("Initial VMA region 0x%lx-0x%lx (%s) bookkeeped", init_vmas[i].begin,
                   init_vmas[i].end, init_vmas[i].comment);
     }
-    spinlock_unlock(&vma_tree_lock);
+    write_seqend(&vma_tree_lock);
     /* From now on if we return with an error we might leave a structure local to this function in
      * vma_tree. We do not bother with removing them - this is initialization of VMA subsystem, if
      * it fails the whole application startup fails and we should never call any of functions in
@@ -680,7 +735,7 @@ int init_vma(void) {
         }
     }
 
-    spinlock_lock(&vma_tree_lock);
+    write_seqbegin(&vma_tree_lock);
     for (size_t i = 0; i < ARRAY_SIZE(init_vmas); i++) {
         /* Skip empty areas. */
         if (init_vmas[i].begin == init_vmas[i].end) {
@@ -690,7 +745,7 @@ int init_vma(void) {
         avl_tree_swap_node(&vma_tree, &init_vmas[i].tree_node, &vmas_to_migrate_to[i]->tree_node);
         vmas_to_migrate_to[i] = NULL;
     }
-    spinlock_unlock(&vma_tree_lock);
+    write_seqend(&vma_tree_lock);
 
     for (size_t i = 0; i < ARRAY_SIZE(vmas_to_migrate_to); i++) {
         if (vmas_to_migrate_to[i]) {
@@ -702,7 +757,7 @@ int init_vma(void) {
 }
 
 static void _add_unmapped_vma(uintptr_t begin, uintptr_t end, struct libos_vma* vma) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
 
     vma->begin  = begin;
     vma->end    = end;
@@ -733,7 +788,7 @@ int bkeep_munmap(void* addr, size_t length, bool is_internal, void** tmp_vma_ptr
 
     struct libos_vma* vmas_to_free = NULL;
 
-    spinlock_lock(&vma_tree_lock);
+    write_seqbegin(&vma_tree_lock);
     int ret = _vma_bkeep_remove((uintptr_t)addr, (uintptr_t)addr + length, is_internal,
                                 vma2 ? &vma2 : NULL, &vmas_to_free);
     if (ret >= 0) {
@@ -741,7 +796,7 @@ int bkeep_munmap(void* addr, size_t length, bool is_internal, void** tmp_vma_ptr
         *tmp_vma_ptr = (void*)vma1;
         vma1 = NULL;
     }
-    spinlock_unlock(&vma_tree_lock);
+    write_seqend(&vma_tree_lock);
 
     free_vmas_freelist(vmas_to_free);
     if (vma1) {
@@ -765,10 +820,10 @@ void bkeep_remove_tmp_vma(void* _vma) {
 
     assert(vma->flags == (VMA_INTERNAL | VMA_UNMAPPED));
 
-    spinlock_lock(&vma_tree_lock);
+    write_seqbegin(&vma_tree_lock);
     avl_tree_delete(&vma_tree, &vma->tree_node);
     total_memory_size_sub(vma->end - vma->begin);
-    spinlock_unlock(&vma_tree_lock);
+    write_seqend(&vma_tree_lock);
 
     free_vma(vma);
 }
@@ -776,10 +831,10 @@ void bkeep_remove_tmp_vma(void* _vma) {
 void bkeep_convert_tmp_vma_to_user(void* _vma) {
     struct libos_vma* vma = (struct libos_vma*)_vma;
 
-    spinlock_lock(&vma_tree_lock);
+    write_seqbegin(&vma_tree_lock);
     assert(vma->flags == (VMA_INTERNAL | VMA_UNMAPPED));
     vma->flags &= ~VMA_INTERNAL;
-    spinlock_unlock(&vma_tree_lock);
+    write_seqend(&vma_tree_lock);
 }
 
 static bool is_file_prot_matching(struct libos_handle* file_hdl, int prot) {
@@ -816,7 +871,7 @@ int bkeep_mmap_fixed(void* addr, size_t length, int prot, int flags, struct libo
 
     struct libos_vma* vmas_to_free = NULL;
 
-    spinlock_lock(&vma_tree_lock);
+    write_seqbegin(&vma_tree_lock);
     int ret = 0;
     if (flags & MAP_FIXED_NOREPLACE) {
         struct libos_vma* tmp_vma = _lookup_vma(new_vma->begin);
@@ -831,7 +886,7 @@ int bkeep_mmap_fixed(void* addr, size_t length, int prot, int flags, struct libo
         avl_tree_insert(&vma_tree, &new_vma->tree_node);
         total_memory_size_add(new_vma->end - new_vma->begin);
     }
-    spinlock_unlock(&vma_tree_lock);
+    write_seqend(&vma_tree_lock);
 
     free_vmas_freelist(vmas_to_free);
     if (vma1) {
@@ -853,7 +908,7 @@ static void vma_update_prot(struct libos_vma* vma, int prot) {
 
 static int _vma_bkeep_change(uintptr_t begin, uintptr_t end, int prot, bool is_internal,
                              struct libos_vma** new_vma_ptr1, struct libos_vma** new_vma_ptr2) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
     assert(IS_ALLOC_ALIGNED_PTR(begin) && IS_ALLOC_ALIGNED_PTR(end));
     assert(begin < end);
 
@@ -982,10 +1037,10 @@ int bkeep_mprotect(void* addr, size_t length, int prot, bool is_internal) {
         return -ENOMEM;
     }
 
-    spinlock_lock(&vma_tree_lock);
+    write_seqbegin(&vma_tree_lock);
     int ret = _vma_bkeep_change((uintptr_t)addr, (uintptr_t)addr + length, prot, is_internal, &vma1,
                                 &vma2);
-    spinlock_unlock(&vma_tree_lock);
+    write_seqend(&vma_tree_lock);
 
     if (vma1) {
         free_vma(vma1);
@@ -1065,7 +1120,7 @@ int bkeep_mmap_any_in_range(void* _bottom_addr, void* _top_addr, size_t length,
     new_vma->offset = file ? offset : 0;
     copy_comment(new_vma, comment ?: "");
 
-    spinlock_lock(&vma_tree_lock);
+    write_seqbegin(&vma_tree_lock);
 
     struct libos_vma* vma = _lookup_vma(top_addr);
     uintptr_t max_addr;
@@ -1104,7 +1159,7 @@ out_found:
     new_vma = NULL;
 
 out:
-    spinlock_unlock(&vma_tree_lock);
+    write_seqend(&vma_tree_lock);
     if (new_vma) {
         free_vma(new_vma);
     }
@@ -1170,11 +1225,68 @@ static void dump_vma(struct libos_vma_info* vma_info, struct libos_vma* vma) {
     memcpy(vma_info->comment, vma->comment, sizeof(vma_info->comment));
 }
 
+/*
+ * Speculative version of `_lookup_vma()`, to be called between `read_seqbegin()` and
+ * `read_seqretry()`. Returns false if the walk did not finish in a bounded number of steps, which
+ * can happen only if the tree is being modified concurrently.
+ */
+static bool _lookup_vma_lockless(uintptr_t addr, struct libos_vma** out_vma) {
+    struct libos_vma* found = NULL;
+    struct avl_tree_node* node = __atomic_load_n(&vma_tree.root, __ATOMIC_RELAXED);
+
+    for (size_t steps = 0; node; steps++) {
+        if (steps == VMA_TREE_MAX_WALK_STEPS)
+            return false;
+
+        struct libos_vma* vma = node2vma(node);
+        if (addr < __atomic_load_n(&vma->end, __ATOMIC_RELAXED)) {
+            found = vma;
+            node = __atomic_load_n(&node->left, __ATOMIC_RELAXED);
+        } else {
+            node = __atomic_load_n(&node->right, __ATOMIC_RELAXED);
+        }
+    }
+
+    *out_vma = found;
+    return true;
+}
+
 int lookup_vma(void* addr, struct libos_vma_info* vma_info) {
     assert(vma_info);
     int ret = 0;
 
-    spinlock_lock(&vma_tree_lock);
+    for (size_t i = 0; i < VMA_TREE_READ_TRIES; i++) {
+        uint32_t seq = read_seqbegin(&vma_tree_lock);
+
+        struct libos_vma* vma;
+        struct libos_vma_info info = { 0 };
+        bool done = _lookup_vma_lockless((uintptr_t)addr, &vma);
+        if (done && vma) {
+            info.addr        = (void*)__atomic_load_n(&vma->begin, __ATOMIC_RELAXED);
+            info.length      = __atomic_load_n(&vma->end, __ATOMIC_RELAXED) - (uintptr_t)info.addr;
+            info.prot        = __atomic_load_n(&vma->prot, __ATOMIC_RELAXED);
+            info.flags       = __atomic_load_n(&vma->flags, __ATOMIC_RELAXED);
+            info.file_offset = __atomic_load_n(&vma->offset, __ATOMIC_RELAXED);
+            info.file        = __atomic_load_n(&vma->file, __ATOMIC_RELAXED);
+            memcpy(info.comment, vma->comment, sizeof(info.comment));
+        }
+
+        if (read_seqretry(&vma_tree_lock, seq) || !done)
+            continue;
+
+        if (!vma || (uintptr_t)addr < (uintptr_t)info.addr)
+            return -ENOENT;
+        if (info.file) {
+            /* we need a reference to the file, which cannot be taken speculatively */
+            break;
+        }
+
+        info.comment[sizeof(info.comment) - 1] = '\0';
+        *vma_info = info;
+        return 0;
+    }
+
+    spinlock_lock(&vma_tree_lock.lock);
     struct libos_vma* vma = _lookup_vma((uintptr_t)addr);
     if (!vma || !is_addr_in_vma((uintptr_t)addr, vma)) {
         ret = -ENOENT;
@@ -1184,7 +1296,7 @@ int lookup_vma(void* addr, struct libos_vma_info* vma_info) {
     dump_vma(vma_info, vma);
 
 out:
-    spinlock_unlock(&vma_tree_lock);
+    spinlock_unlock(&vma_tree_lock.lock);
     return ret;
 }
 
@@ -1201,19 +1313,69 @@ static bool adj_visitor(struct libos_vma* vma, void* visitor_arg) {
     return is_ok;
 }
 
+/*
+ * Speculative version of `_traverse_vmas_in_range()` with `adj_visitor()`, to be called between
+ * `read_seqbegin()` and `read_seqretry()`. Returns false if the walk could not be finished, which
+ * can happen only if the tree is being modified concurrently.
+ */
+static bool _is_in_adjacent_user_vmas_lockless(uintptr_t begin, uintptr_t end, int prot,
+                                               bool* out_result) {
+    uintptr_t addr = begin;
+
+    while (addr < end) {
+        struct libos_vma* vma;
+        if (!_lookup_vma_lockless(addr, &vma))
+            return false;
+
+        if (!vma) {
+            *out_result = false;
+            return true;
+        }
+
+        uintptr_t vma_begin = __atomic_load_n(&vma->begin, __ATOMIC_RELAXED);
+        uintptr_t vma_end   = __atomic_load_n(&vma->end, __ATOMIC_RELAXED);
+        int vma_prot        = __atomic_load_n(&vma->prot, __ATOMIC_RELAXED);
+        int vma_flags       = __atomic_load_n(&vma->flags, __ATOMIC_RELAXED);
+
+        if (vma_end <= addr) {
+            /* inconsistent state, we raced with a writer */
+            return false;
+        }
+
+        if (addr < vma_begin || (vma_flags & (VMA_INTERNAL | VMA_UNMAPPED))
+                || (vma_prot & prot) != prot) {
+            *out_result = false;
+            return true;
+        }
+
+        addr = vma_end;
+    }
+
+    *out_result = true;
+    return true;
+}
+
 bool is_in_adjacent_user_vmas(const void* addr, size_t length, int prot) {
     uintptr_t begin = (uintptr_t)addr;
     uintptr_t end = begin + length;
     assert(begin <= end);
 
+    for (size_t i = 0; i < VMA_TREE_READ_TRIES; i++) {
+        uint32_t seq = read_seqbegin(&vma_tree_lock);
+        bool result;
+        bool done = _is_in_adjacent_user_vmas_lockless(begin, end, prot, &result);
+        if (!read_seqretry(&vma_tree_lock, seq) && done)
+            return result;
+    }
+
     struct adj_visitor_ctx ctx = {
         .prot = prot,
         .is_ok = true,
     };
 
-    spinlock_lock(&vma_tree_lock);
+    spinlock_lock(&vma_tree_lock.lock);
     bool is_continuous = _traverse_vmas_in_range(begin, end, adj_visitor, &ctx);
-    spinlock_unlock(&vma_tree_lock);
+    spinlock_unlock(&vma_tree_lock.lock);
 
     return is_continuous && ctx.is_ok;
 }
@@ -1224,7 +1386,7 @@ static size_t dump_vmas_with_buf(struct libos_vma_info* infos, size_t max_count,
     size_t size = 0;
     struct libos_vma_info* vma_info = infos;
 
-    spinlock_lock(&vma_tree_lock);
+    spinlock_lock(&vma_tree_lock.lock);
     struct libos_vma* vma;
 
     for (vma = _lookup_vma(begin); vma && vma->begin < end; vma = _get_next_vma(vma)) {
@@ -1237,7 +1399,7 @@ static size_t dump_vmas_with_buf(struct libos_vma_info* infos, size_t max_count,
         size++;
     }
 
-    spinlock_unlock(&vma_tree_lock);
+    spinlock_unlock(&vma_tree_lock.lock);
 
     return size;
 }
@@ -1266,14 +1428,14 @@ static int dump_vmas(struct libos_vma_info** out_infos, size_t* out_count,
 }
 
 static bool vma_filter_all(struct libos_vma* vma, void* arg) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
     __UNUSED(arg);
 
     return !(vma->flags & VMA_INTERNAL);
 }
 
 static bool vma_filter_exclude_unmapped(struct libos_vma* vma, void* arg) {
-    assert(spinlock_is_locked(&vma_tree_lock));
+    assert(spinlock_is_locked(&vma_tree_lock.lock));
     __UNUSED(arg);
 
     return !(vma->flags & (VMA_INTERNAL | VMA_UNMAPPED));
@@ -1344,9 +1506,9 @@ int madvise_dontneed_range(uintptr_t begin, uintptr_t end) {
         .error = 0,
     };
 
-    spinlock_lock(&vma_tree_lock);
+    spinlock_lock(&vma_tree_lock.lock);
     bool is_continuous = _traverse_vmas_in_range(begin, end, madvise_dontneed_visitor, &ctx);
-    spinlock_unlock(&vma_tree_lock);
+    spinlock_unlock(&vma_tree_lock.lock);
 
     if (!is_continuous)
         return -ENOMEM;
@@ -1683,7 +1845,7 @@ static void debug_print_vma(struct libos_vma* vma) {
 }
 
 void debug_print_all_vmas(void) {
-    spinlock_lock(&vma_tree_lock);
+    spinlock_lock(&vma_tree_lock.lock);
 
     struct libos_vma* vma = _get_first_vma();
     while (vma) {
@@ -1691,7 +1853,7 @@ void debug_print_all_vmas(void) {
         vma = _get_next_vma(vma);
     }
 
-    spinlock_unlock(&vma_tree_lock);
+    spinlock_unlock(&vma_tree_lock.lock);
 }
 
 size_t get_peak_memory_usage(void) {
@@ -1699,9 +1861,9 @@ size_t get_peak_memory_usage(void) {
 }
 
 size_t get_total_memory_usage(void) {
-    spinlock_lock(&vma_tree_lock);
+    spinlock_lock(&vma_tree_lock.lock);
     size_t total_memory_size = g_total_memory_size;
-    spinlock_unlock(&vma_tree_lock);
+    spinlock_unlock(&vma_tree_lock.lock);
     /* This memory accounting is just a simple heuristic, which does not account swap, reserved
      * memory, unmapped VMAs etc. */
     return MIN(total_memory_size, g_pal_public_state->mem_total);
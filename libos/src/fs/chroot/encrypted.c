@@ -98,7 +98,7 @@ static void chroot_encrypted_idrop(struct libos_inode* inode) {
 }
 
 static int chroot_encrypted_lookup(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     char* uri = NULL;
     struct libos_inode* inode = NULL;
@@ -177,7 +177,7 @@ out:
 }
 
 static int chroot_encrypted_open(struct libos_handle* hdl, struct libos_dentry* dent, int flags) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
     __UNUSED(flags);
 
@@ -202,7 +202,7 @@ static int chroot_encrypted_open(struct libos_handle* hdl, struct libos_dentry*
 
 static int chroot_encrypted_creat(struct libos_handle* hdl, struct libos_dentry* dent, int flags,
                                   mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
     __UNUSED(flags);
 
@@ -242,7 +242,7 @@ out:
 }
 
 static int chroot_encrypted_mkdir(struct libos_dentry* dent, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     struct libos_inode* inode = get_new_inode(dent->mount, S_IFDIR, perm);
@@ -280,7 +280,7 @@ out:
 /* NOTE: this function is different from generic `chroot_unlink` only to add PAL_OPTION_PASSTHROUGH.
  * Once that option is removed, we can safely go back to using `chroot_unlink`. */
 static int chroot_encrypted_unlink(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     char* uri;
@@ -309,7 +309,7 @@ out:
 }
 
 static int chroot_encrypted_rename(struct libos_dentry* old, struct libos_dentry* new) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(old->inode);
     assert(old->inode->type == S_IFREG);
 
@@ -337,7 +337,7 @@ out:
 }
 
 static int chroot_encrypted_chmod(struct libos_dentry* dent, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     char* uri = NULL;
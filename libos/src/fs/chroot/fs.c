@@ -116,7 +116,7 @@ out:
 
 static int chroot_setup_dentry(struct libos_dentry* dent, mode_t type, mode_t perm,
                                file_off_t size) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     struct libos_inode* inode = get_new_inode(dent->mount, type, perm);
@@ -128,7 +128,7 @@ static int chroot_setup_dentry(struct libos_dentry* dent, mode_t type, mode_t pe
 }
 
 static int chroot_lookup(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     int ret;
 
@@ -197,7 +197,7 @@ static int chroot_temp_open(struct libos_dentry* dent, mode_t type, PAL_HANDLE*
 /* Open a PAL handle, and associate it with a LibOS handle (if provided). */
 static int chroot_do_open(struct libos_handle* hdl, struct libos_dentry* dent, mode_t type,
                           int flags, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     int ret;
 
@@ -235,14 +235,14 @@ out:
 }
 
 static int chroot_open(struct libos_handle* hdl, struct libos_dentry* dent, int flags) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     return chroot_do_open(hdl, dent, dent->inode->type, flags, /*perm=*/0);
 }
 
 static int chroot_creat(struct libos_handle* hdl, struct libos_dentry* dent, int flags, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     int ret;
@@ -257,7 +257,7 @@ static int chroot_creat(struct libos_handle* hdl, struct libos_dentry* dent, int
 }
 
 static int chroot_mkdir(struct libos_dentry* dent, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     int ret;
@@ -293,18 +293,10 @@ static ssize_t chroot_read(struct libos_handle* hdl, void* buf, size_t count, fi
     return actual_count;
 }
 
-static ssize_t chroot_write(struct libos_handle* hdl, const void* buf, size_t count,
-                            file_off_t* pos) {
-    assert(hdl->type == TYPE_CHROOT);
-
-    size_t actual_count = count;
-    int ret = PalStreamWrite(hdl->pal_handle, *pos, &actual_count, (void*)buf);
-    if (ret < 0) {
-        return pal_to_unix_errno(ret);
-    }
-    assert(actual_count <= count);
+/* Updates the file position and size after writing `count` bytes to `hdl` at `*pos`. */
+static void chroot_finish_write(struct libos_handle* hdl, size_t count, file_off_t* pos) {
     if (hdl->inode->type == S_IFREG) {
-        *pos += actual_count;
+        *pos += count;
         /* Update file size if we just wrote past the end of file */
         lock(&hdl->inode->lock);
         if (hdl->inode->size < *pos)
@@ -314,13 +306,130 @@ static ssize_t chroot_write(struct libos_handle* hdl, const void* buf, size_t co
 
     /* If there are any MAP_SHARED mappings for the file, this will read data from `hdl`. */
     if (__atomic_load_n(&hdl->inode->num_mmapped, __ATOMIC_ACQUIRE) != 0) {
-        ret = reload_mmaped_from_file_handle(hdl);
+        int ret = reload_mmaped_from_file_handle(hdl);
         if (ret < 0) {
             log_error("reload mmapped regions of file failed: %s", unix_strerror(ret));
             BUG();
         }
     }
+}
+
+static ssize_t chroot_write(struct libos_handle* hdl, const void* buf, size_t count,
+                            file_off_t* pos) {
+    assert(hdl->type == TYPE_CHROOT);
+
+    size_t actual_count = count;
+    int ret = PalStreamWrite(hdl->pal_handle, *pos, &actual_count, (void*)buf);
+    if (ret < 0) {
+        return pal_to_unix_errno(ret);
+    }
+    assert(actual_count <= count);
+    chroot_finish_write(hdl, actual_count, pos);
+    return (ssize_t)actual_count;
+}
+
+/* max number of buffers passed to PAL in one `PalStreamBatch()` call */
+#define CHROOT_BATCH_MAX_OPS 64
+
+/* Reads into or writes from all buffers of `iov` with as few PAL calls as possible. Returns the
+ * number of bytes transferred; stops at the first short transfer (e.g. end of file). */
+static ssize_t chroot_rw_iov(struct libos_handle* hdl, struct iovec* iov, size_t iov_len,
+                             file_off_t* pos, enum pal_io_op_type type) {
+    struct pal_io_op ops[CHROOT_BATCH_MAX_OPS];
+    size_t total = 0;
+    size_t i = 0;
+
+    while (i < iov_len) {
+        size_t n = 0;
+        file_off_t offset = *pos + total;
+        for (; i < iov_len && n < CHROOT_BATCH_MAX_OPS; i++) {
+            if (!iov[i].iov_base || !iov[i].iov_len)
+                continue;
+            ops[n++] = (struct pal_io_op){
+                .handle = hdl->pal_handle,
+                .type   = type,
+                .offset = offset,
+                .buffer = iov[i].iov_base,
+                .size   = iov[i].iov_len,
+            };
+            offset += iov[i].iov_len;
+        }
+        if (!n)
+            break;
+
+        size_t done = n;
+        int ret = PalStreamBatch(ops, &done);
+        if (ret < 0) {
+            if (total)
+                break;
+            return pal_to_unix_errno(ret);
+        }
+
+        bool stop = done < n;
+        for (size_t j = 0; j < done; j++) {
+            if (ops[j].result < 0) {
+                if (!total)
+                    return pal_to_unix_errno(ops[j].result);
+                stop = true;
+                break;
+            }
+            assert((size_t)ops[j].result <= ops[j].size);
+            total += ops[j].result;
+            if ((size_t)ops[j].result < ops[j].size) {
+                stop = true;
+                break;
+            }
+        }
+        if (stop)
+            break;
+    }
+    return total;
+}
+
+static ssize_t chroot_readv(struct libos_handle* hdl, struct iovec* iov, size_t iov_len,
+                            file_off_t* pos) {
+    assert(hdl->type == TYPE_CHROOT);
+
+    ssize_t ret = chroot_rw_iov(hdl, iov, iov_len, pos, PAL_IO_READ);
+    if (ret > 0 && hdl->inode->type == S_IFREG)
+        *pos += ret;
+    return ret;
+}
+
+static ssize_t chroot_writev(struct libos_handle* hdl, struct iovec* iov, size_t iov_len,
+                             file_off_t* pos) {
+    assert(hdl->type == TYPE_CHROOT);
+
+    ssize_t ret = chroot_rw_iov(hdl, iov, iov_len, pos, PAL_IO_WRITE);
+    if (ret >= 0)
+        chroot_finish_write(hdl, ret, pos);
+    return ret;
+}
+
+PAL_HANDLE chroot_splice_source(struct libos_handle* hdl) {
+    if (hdl->type != TYPE_CHROOT || !hdl->inode || hdl->inode->type != S_IFREG)
+        return NULL;
+    return hdl->pal_handle;
+}
+
+static ssize_t chroot_splice_from(struct libos_handle* hdl, struct libos_handle* in_hdl,
+                                  size_t count, file_off_t* in_pos, file_off_t* pos) {
+    assert(hdl->type == TYPE_CHROOT);
+
+    PAL_HANDLE in_pal_handle = chroot_splice_source(in_hdl);
+    if (!in_pal_handle || hdl->inode->type != S_IFREG)
+        return -EOPNOTSUPP;
+
+    size_t actual_count = count;
+    int ret = PalStreamSplice(in_pal_handle, *in_pos, hdl->pal_handle, *pos, &actual_count);
+    if (ret == -PAL_ERROR_NOTSUPPORT)
+        return -EOPNOTSUPP;
+    if (ret < 0)
+        return pal_to_unix_errno(ret);
+    assert(actual_count <= count);
 
+    *in_pos += actual_count;
+    chroot_finish_write(hdl, actual_count, pos);
     return (ssize_t)actual_count;
 }
 
@@ -402,7 +511,7 @@ out:
 }
 
 int chroot_unlink(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     int ret;
@@ -421,7 +530,7 @@ int chroot_unlink(struct libos_dentry* dent) {
 }
 
 static int chroot_rename(struct libos_dentry* old, struct libos_dentry* new) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(old->inode);
 
     int ret;
@@ -450,7 +559,7 @@ out:
 }
 
 static int chroot_chmod(struct libos_dentry* dent, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     int ret;
@@ -483,19 +592,22 @@ static int chroot_fchmod(struct libos_handle* hdl, mode_t perm) {
 }
 
 struct libos_fs_ops chroot_fs_ops = {
-    .mount      = &chroot_mount,
-    .flush      = &chroot_flush,
-    .read       = &chroot_read,
-    .write      = &chroot_write,
-    .mmap       = &chroot_mmap,
+    .mount       = &chroot_mount,
+    .flush       = &chroot_flush,
+    .read        = &chroot_read,
+    .write       = &chroot_write,
+    .readv       = &chroot_readv,
+    .writev      = &chroot_writev,
+    .splice_from = &chroot_splice_from,
+    .mmap        = &chroot_mmap,
     /* TODO: this function emulates lseek() completely inside the LibOS, but some device files may
      * report size == 0 during fstat() and may provide device-specific lseek() logic; this emulation
      * breaks for such device-specific cases */
-    .seek       = &generic_inode_seek,
-    .hstat      = &generic_inode_hstat,
-    .truncate   = &generic_truncate,
-    .poll       = &generic_inode_poll,
-    .fchmod     = &chroot_fchmod,
+    .seek        = &generic_inode_seek,
+    .hstat       = &generic_inode_hstat,
+    .truncate    = &generic_truncate,
+    .poll        = &generic_inode_poll,
+    .fchmod      = &chroot_fchmod,
 };
 
 struct libos_d_ops chroot_d_ops = {
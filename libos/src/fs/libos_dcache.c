@@ -24,10 +24,14 @@ static struct libos_lock dcache_mgr_lock;
 
 #define DCACHE_MGR_ALLOC 64
 
+/* Initial number of buckets in `children_hash`, must be a power of two greater than
+ * DENTRY_HASH_MIN_CHILDREN */
+#define DENTRY_HASH_INIT_SIZE 64
+
 #define OBJ_TYPE struct libos_dentry
 #include "memmgr.h"
 
-struct libos_lock g_dcache_lock;
+struct libos_rwlock g_dcache_lock;
 
 static MEM_MGR dentry_mgr = NULL;
 
@@ -52,7 +56,7 @@ static struct libos_dentry* alloc_dentry(void) {
 static void free_dentry(struct libos_dentry* dentry);
 
 int init_dcache(void) {
-    if (!create_lock(&dcache_mgr_lock) || !create_lock(&g_dcache_lock)) {
+    if (!create_lock(&dcache_mgr_lock) || !rwlock_create(&g_dcache_lock)) {
         return -ENOMEM;
     }
 
@@ -121,6 +125,8 @@ static void free_dentry(struct libos_dentry* dent) {
     assert(LISTP_EMPTY(&dent->children));
     assert(LIST_EMPTY(dent, siblings));
 
+    free(dent->children_hash);
+
     if (dent->attached_mount) {
         put_mount(dent->attached_mount);
     }
@@ -144,8 +150,99 @@ void put_dentry(struct libos_dentry* dent) {
     }
 }
 
+/* FNV-1a */
+static uint64_t dentry_name_hash(const char* name, size_t name_len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < name_len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void children_hash_insert(struct libos_dentry* parent, struct libos_dentry* dent) {
+    size_t idx = dent->name_hash & (parent->children_hash_size - 1);
+    dent->hash_next = parent->children_hash[idx];
+    parent->children_hash[idx] = dent;
+}
+
+/* Rebuilds the hash table of `parent` children with `size` buckets. On allocation failure leaves
+ * the old table (if any) intact; lookups then just have longer chains to walk. */
+static bool children_hash_resize(struct libos_dentry* parent, size_t size) {
+    struct libos_dentry** table = calloc(size, sizeof(*table));
+    if (!table)
+        return false;
+
+    free(parent->children_hash);
+    parent->children_hash = table;
+    parent->children_hash_size = size;
+
+    struct libos_dentry* child;
+    LISTP_FOR_EACH_ENTRY(child, &parent->children, siblings) {
+        children_hash_insert(parent, child);
+    }
+    return true;
+}
+
+/* Adds `dent` (already on `parent->children`) to the hash table, creating or growing the table if
+ * the directory got too big. */
+static void children_hash_add(struct libos_dentry* parent, struct libos_dentry* dent) {
+    if (parent->nchildren > DENTRY_HASH_MIN_CHILDREN
+            && parent->nchildren > parent->children_hash_size) {
+        size_t size = parent->children_hash_size ? parent->children_hash_size * 2
+                                                 : DENTRY_HASH_INIT_SIZE;
+        /* the rebuilt table already contains `dent` */
+        if (children_hash_resize(parent, size))
+            return;
+    }
+
+    if (parent->children_hash)
+        children_hash_insert(parent, dent);
+}
+
+static void children_hash_del(struct libos_dentry* parent, struct libos_dentry* dent) {
+    if (!parent->children_hash)
+        return;
+
+    struct libos_dentry** link = &parent->children_hash[dent->name_hash
+                                                        & (parent->children_hash_size - 1)];
+    while (*link != dent) {
+        assert(*link);
+        link = &(*link)->hash_next;
+    }
+    *link = dent->hash_next;
+    dent->hash_next = NULL;
+}
+
+bool dentry_is_negative_cached(struct libos_dentry* dent) {
+    if (!dent->negative_until)
+        return false;
+    if (dent->negative_until == UINT64_MAX)
+        return true;
+
+    uint64_t now;
+    if (PalSystemTimeQuery(&now) < 0)
+        return false;
+    return now < dent->negative_until;
+}
+
+void dentry_set_negative_until(struct libos_dentry* dent, uint64_t negative_until) {
+    assert(rwlock_is_write_locked(&g_dcache_lock));
+
+    struct libos_dentry* parent = dent->parent;
+    if (parent && !dent->negative_until && negative_until) {
+        if (parent->nchildren_negative_cached >= DENTRY_MAX_NEGATIVE_CACHED)
+            return;
+        parent->nchildren_negative_cached++;
+    } else if (parent && dent->negative_until && !negative_until) {
+        assert(parent->nchildren_negative_cached > 0);
+        parent->nchildren_negative_cached--;
+    }
+    dent->negative_until = negative_until;
+}
+
 void dentry_gc(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->parent);
 
     if (refcount_get(&dent->ref_count) != 1)
@@ -154,6 +251,13 @@ void dentry_gc(struct libos_dentry* dent) {
     if (dent->inode)
         return;
 
+    /* Keep negative dentries that remember a failed lookup on an immutable mount, until the
+     * remembered result expires */
+    if (dentry_is_negative_cached(dent))
+        return;
+
+    dentry_set_negative_until(dent, 0);
+    children_hash_del(dent->parent, dent);
     LISTP_DEL_INIT(dent, &dent->parent->children, siblings);
     dent->parent->nchildren--;
     /* This should delete `dent` */
@@ -162,7 +266,7 @@ void dentry_gc(struct libos_dentry* dent) {
 
 struct libos_dentry* get_new_dentry(struct libos_mount* mount, struct libos_dentry* parent,
                                     const char* name, size_t name_len) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(mount);
 
     struct libos_dentry* dent = alloc_dentry();
@@ -176,6 +280,7 @@ struct libos_dentry* get_new_dentry(struct libos_mount* mount, struct libos_dent
         return NULL;
     }
     dent->name_len = name_len;
+    dent->name_hash = dentry_name_hash(name, name_len);
 
     if (parent && parent->nchildren >= DENTRY_MAX_CHILDREN) {
         log_warning("get_new_dentry: nchildren limit reached");
@@ -195,6 +300,7 @@ struct libos_dentry* get_new_dentry(struct libos_mount* mount, struct libos_dent
         get_dentry(dent);
         LISTP_ADD_TAIL(dent, &parent->children, siblings);
         parent->nchildren++;
+        children_hash_add(parent, dent);
     }
 
     return dent;
@@ -207,16 +313,37 @@ struct libos_dentry* dentry_up(struct libos_dentry* dent) {
     return dent->parent;
 }
 
+static bool dentry_name_eq(struct libos_dentry* dent, const char* name, size_t name_len) {
+    return dent->name_len == name_len && memcmp(dent->name, name, name_len) == 0;
+}
+
 struct libos_dentry* lookup_dcache(struct libos_dentry* parent, const char* name, size_t name_len) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     assert(parent);
     assert(name_len > 0);
 
     struct libos_dentry* tmp;
     struct libos_dentry* dent;
+
+    if (parent->children_hash) {
+        /* Garbage-collect only the unused dentries in the same bucket, the rest of the directory is
+         * not touched by this lookup. */
+        uint64_t hash = dentry_name_hash(name, name_len);
+        dent = parent->children_hash[hash & (parent->children_hash_size - 1)];
+        for (; dent; dent = tmp) {
+            tmp = dent->hash_next;
+            if (dent->name_hash == hash && dentry_name_eq(dent, name, name_len)) {
+                get_dentry(dent);
+                return dent;
+            }
+            dentry_gc(dent);
+        }
+        return NULL;
+    }
+
     LISTP_FOR_EACH_ENTRY_SAFE(dent, tmp, &parent->children, siblings) {
-        if (dent->name_len == name_len && memcmp(dent->name, name, dent->name_len) == 0) {
+        if (dentry_name_eq(dent, name, name_len)) {
             get_dentry(dent);
             return dent;
         }
@@ -226,6 +353,37 @@ struct libos_dentry* lookup_dcache(struct libos_dentry* parent, const char* name
     return NULL;
 }
 
+struct libos_dentry* lookup_dcache_cached(struct libos_dentry* parent, const char* name,
+                                          size_t name_len) {
+    assert(rwlock_is_read_locked(&g_dcache_lock) || rwlock_is_write_locked(&g_dcache_lock));
+
+    assert(parent);
+    assert(name_len > 0);
+
+    struct libos_dentry* dent;
+
+    if (parent->children_hash) {
+        uint64_t hash = dentry_name_hash(name, name_len);
+        dent = parent->children_hash[hash & (parent->children_hash_size - 1)];
+        for (; dent; dent = dent->hash_next) {
+            if (dent->name_hash == hash && dentry_name_eq(dent, name, name_len)) {
+                get_dentry(dent);
+                return dent;
+            }
+        }
+        return NULL;
+    }
+
+    LISTP_FOR_EACH_ENTRY(dent, &parent->children, siblings) {
+        if (dentry_name_eq(dent, name, name_len)) {
+            get_dentry(dent);
+            return dent;
+        }
+    }
+
+    return NULL;
+}
+
 bool dentry_is_ancestor(struct libos_dentry* anc, struct libos_dentry* dent) {
     assert(anc->mount == dent->mount);
 
@@ -426,7 +584,7 @@ static void dump_dentry_mode(struct print_buf* buf, mode_t type, mode_t perm) {
 }
 
 static void dump_dentry(struct libos_dentry* dent, unsigned int level) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     struct print_buf buf = INIT_PRINT_BUF(dump_dentry_write_all);
 
@@ -473,13 +631,13 @@ static void dump_dentry(struct libos_dentry* dent, unsigned int level) {
 }
 
 void dump_dcache(struct libos_dentry* dent) {
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
 
     if (!dent)
         dent = g_dentry_root;
 
     dump_dentry(dent, 0);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
 }
 
 BEGIN_CP_FUNC(dentry_root) {
@@ -515,7 +673,7 @@ BEGIN_CP_FUNC(dentry) {
     assert(size == sizeof(struct libos_dentry));
 
     /* We should be holding `g_dcache_lock` for the whole checkpointing process. */
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     struct libos_dentry* dent     = (struct libos_dentry*)obj;
     struct libos_dentry* new_dent = NULL;
@@ -530,6 +688,14 @@ BEGIN_CP_FUNC(dentry) {
         *new_dent = *dent;
         INIT_LISTP(&new_dent->children);
         INIT_LIST_HEAD(new_dent, siblings);
+        /* The children hash table is rebuilt in the new process, when a child is added. */
+        new_dent->children_hash = NULL;
+        new_dent->children_hash_size = 0;
+        new_dent->hash_next = NULL;
+        /* Failed lookups are not remembered in the new process, as not all children are
+         * checkpointed. */
+        new_dent->negative_until = 0;
+        new_dent->nchildren_negative_cached = 0;
         refcount_set(&new_dent->ref_count, 0);
 
         /* `file_locks` is used only by process leader. */
@@ -228,6 +228,23 @@ static int mount_one_nonroot(toml_table_t* mount, const char* prefix) {
         goto out;
     }
 
+    bool mount_immutable;
+    ret = toml_bool_in(mount, "immutable", /*defaultval=*/false, &mount_immutable);
+    if (ret < 0) {
+        log_error("Cannot parse '%s.immutable'", prefix);
+        ret = -EINVAL;
+        goto out;
+    }
+
+    int64_t mount_cache_ttl;
+    ret = toml_int_in(mount, "cache_ttl", /*defaultval=*/0, &mount_cache_ttl);
+    if (ret < 0 || mount_cache_ttl < 0 || (uint64_t)mount_cache_ttl > UINT64_MAX / TIME_US_IN_S) {
+        log_error("Cannot parse '%s.cache_ttl' (the value must be a non-negative number of "
+                  "seconds)", prefix);
+        ret = -EINVAL;
+        goto out;
+    }
+
     if (!mount_path) {
         log_error("No value provided for '%s.path'", prefix);
         ret = -EINVAL;
@@ -266,6 +283,16 @@ static int mount_one_nonroot(toml_table_t* mount, const char* prefix) {
                       "application. Gramine will continue application execution, but this "
                       "configuration is not recommended for use in production!", mount_uri);
         }
+    } else if (mount_immutable) {
+        log_error("'%s.immutable' is supported only for \"chroot\" mounts", prefix);
+        ret = -EINVAL;
+        goto out;
+    }
+
+    if (!mount_immutable && toml_key_exists(mount, "cache_ttl")) {
+        log_error("'%s.cache_ttl' is supported only for immutable mounts", prefix);
+        ret = -EINVAL;
+        goto out;
     }
 
     struct libos_mount_params params = {
@@ -273,6 +300,8 @@ static int mount_one_nonroot(toml_table_t* mount, const char* prefix) {
         .path = mount_path,
         .uri = mount_uri,
         .key_name = mount_key_name,
+        .immutable = mount_immutable,
+        .cache_ttl_us = (uint64_t)mount_cache_ttl * TIME_US_IN_S,
     };
     ret = mount_fs(&params);
 
@@ -328,9 +357,9 @@ int init_mount_root(void) {
         return ret;
 
     struct libos_dentry* dent = NULL;
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     ret = path_lookupat(/*start=*/NULL, "/", LOOKUP_FOLLOW | LOOKUP_DIRECTORY, &dent);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (ret < 0) {
         log_error("Could not set up dentry for \"/\", something is seriously broken.");
         return ret;
@@ -371,9 +400,9 @@ int init_mount(void) {
     if (fs_start_dir) {
         struct libos_dentry* dent = NULL;
 
-        lock(&g_dcache_lock);
+        rwlock_write_lock(&g_dcache_lock);
         ret = path_lookupat(/*start=*/NULL, fs_start_dir, LOOKUP_FOLLOW | LOOKUP_DIRECTORY, &dent);
-        unlock(&g_dcache_lock);
+        rwlock_write_unlock(&g_dcache_lock);
 
         free(fs_start_dir);
         if (ret < 0) {
@@ -403,7 +432,7 @@ struct libos_fs* find_fs(const char* name) {
 }
 
 static int mount_fs_at_dentry(struct libos_mount_params* params, struct libos_dentry* mount_point) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!mount_point->attached_mount);
 
     int ret;
@@ -445,6 +474,8 @@ static int mount_fs_at_dentry(struct libos_mount_params* params, struct libos_de
     }
     mount->fs = fs;
     mount->data = mount_data;
+    mount->immutable = params->immutable;
+    mount->cache_ttl_us = params->cache_ttl_us;
 
     /* Attach mount to mountpoint, and the other way around */
 
@@ -517,7 +548,7 @@ int mount_fs(struct libos_mount_params* params) {
 
     log_debug("mounting \"%s\" (%s) under %s", params->uri, params->type, params->path);
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
 
     if (!g_dentry_root->attached_mount && !strcmp(params->path, "/")) {
         /* `g_dentry_root` does not belong to any mounted filesystem, so lookup will fail. Use it
@@ -543,7 +574,7 @@ int mount_fs(struct libos_mount_params* params) {
 out:
     if (mount_point)
         put_dentry(mount_point);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
 
     return ret;
 }
@@ -584,6 +615,23 @@ int walk_mounts(int (*walk)(struct libos_mount* mount, void* arg), void* arg) {
     return ret < 0 ? ret : (nsrched ? 0 : -ESRCH);
 }
 
+void log_mount_cache_stats(void) {
+    struct libos_mount* mount;
+
+    lock(&g_mount_list_lock);
+    LISTP_FOR_EACH_ENTRY(mount, &g_mount_list, list) {
+        if (!mount->immutable)
+            continue;
+
+        uint64_t hits = __atomic_load_n(&mount->cache_hits, __ATOMIC_RELAXED);
+        uint64_t misses = __atomic_load_n(&mount->cache_misses, __ATOMIC_RELAXED);
+        uint64_t total = hits + misses;
+        log_debug("dentry cache of immutable mount %s: %lu hits, %lu misses (hit rate %lu%%)",
+                  mount->path, hits, misses, total ? hits * 100 / total : 0);
+    }
+    unlock(&g_mount_list_lock);
+}
+
 struct libos_mount* find_mount_from_uri(const char* uri) {
     struct libos_mount* mount;
     struct libos_mount* found = NULL;
@@ -693,9 +741,11 @@ BEGIN_CP_FUNC(mount) {
             new_mount->cpdata = (char*)base + cp_off;
         }
 
-        new_mount->data        = NULL;
-        new_mount->mount_point = NULL;
-        new_mount->root        = NULL;
+        new_mount->data         = NULL;
+        new_mount->mount_point  = NULL;
+        new_mount->root         = NULL;
+        new_mount->cache_hits   = 0;
+        new_mount->cache_misses = 0;
         INIT_LIST_HEAD(new_mount, list);
         refcount_set(&new_mount->ref_count, 0);
 
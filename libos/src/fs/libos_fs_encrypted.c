@@ -79,6 +79,64 @@ static pf_status_t cb_write(pf_handle_t handle, const void* buffer, uint64_t off
     return PF_STATUS_SUCCESS;
 }
 
+/* max number of buffers passed to PAL in one `PalStreamBatch()` call */
+#define ENCRYPTED_BATCH_MAX_OPS 32
+
+static pf_status_t cb_write_vectored(pf_handle_t handle, const pf_iovec_t* iov, size_t iov_count,
+                                     uint64_t offset) {
+    PAL_HANDLE pal_handle = (PAL_HANDLE)handle;
+    struct pal_io_op ops[ENCRYPTED_BATCH_MAX_OPS];
+
+    /* Write the buffers in place, with one PAL call (and thus one OCALL on SGX) per batch of
+     * buffers; a short or interrupted write is finished with `cb_write()` */
+    size_t i = 0;
+    while (i < iov_count) {
+        size_t n = MIN(iov_count - i, (size_t)ENCRYPTED_BATCH_MAX_OPS);
+        uint64_t op_offset = offset;
+        for (size_t j = 0; j < n; j++) {
+            ops[j] = (struct pal_io_op){
+                .handle = pal_handle,
+                .type   = PAL_IO_WRITE,
+                .offset = op_offset,
+                .buffer = (void*)iov[i + j].base,
+                .size   = iov[i + j].size,
+            };
+            op_offset += iov[i + j].size;
+        }
+
+        size_t done = n;
+        int ret = PalStreamBatch(ops, &done);
+        if (ret < 0) {
+            log_warning("PalStreamBatch failed: %s", pal_strerror(ret));
+            return PF_STATUS_CALLBACK_FAILED;
+        }
+        assert(done > 0);
+
+        for (size_t j = 0; j < done; j++) {
+            size_t written = ops[j].result > 0 ? ops[j].result : 0;
+            if (ops[j].result < 0 && ops[j].result != -PAL_ERROR_INTERRUPTED) {
+                log_warning("PalStreamBatch failed: %s", pal_strerror(ops[j].result));
+                return PF_STATUS_CALLBACK_FAILED;
+            }
+            assert(written <= ops[j].size);
+            if (written < ops[j].size) {
+                /* the batch stopped here; finish this buffer and continue with the next one */
+                pf_status_t status = cb_write(handle, (const char*)ops[j].buffer + written,
+                                              ops[j].offset + written, ops[j].size - written);
+                if (PF_FAILURE(status))
+                    return status;
+                done = j + 1;
+                break;
+            }
+        }
+
+        for (size_t j = 0; j < done; j++)
+            offset += iov[i + j].size;
+        i += done;
+    }
+    return PF_STATUS_SUCCESS;
+}
+
 static pf_status_t cb_truncate(pf_handle_t handle, uint64_t size) {
     PAL_HANDLE pal_handle = (PAL_HANDLE)handle;
 
@@ -275,9 +333,30 @@ int init_encrypted_files(void) {
     pf_set_callbacks(&cb_read, &cb_write, &cb_truncate,
                      &cb_aes_cmac, &cb_aes_gcm_encrypt, &cb_aes_gcm_decrypt,
                      &cb_random, cb_debug_ptr);
+    pf_set_batch_callbacks(&cb_write_vectored);
 
     int ret;
 
+    /* Parse `fs.encrypted_files.cache_size` and `fs.encrypted_files.shared_cache_size` */
+
+    size_t cache_size;
+    ret = toml_sizestring_in(g_manifest_root, "fs.encrypted_files.cache_size", /*defaultval=*/0,
+                             &cache_size);
+    if (ret < 0) {
+        log_error("Cannot parse 'fs.encrypted_files.cache_size'");
+        return -EINVAL;
+    }
+
+    size_t shared_cache_size;
+    ret = toml_sizestring_in(g_manifest_root, "fs.encrypted_files.shared_cache_size",
+                             /*defaultval=*/0, &shared_cache_size);
+    if (ret < 0) {
+        log_error("Cannot parse 'fs.encrypted_files.shared_cache_size'");
+        return -EINVAL;
+    }
+
+    pf_set_cache_limits(cache_size / PF_NODE_SIZE, shared_cache_size / PF_NODE_SIZE);
+
     /* Parse `fs.insecure__keys.*` */
 
     toml_table_t* manifest_fs = toml_table_in(g_manifest_root, "fs");
@@ -310,6 +389,16 @@ int init_encrypted_files(void) {
     return 0;
 }
 
+void log_encrypted_files_stats(void) {
+    pf_cache_stats_t stats;
+    pf_get_cache_stats(&stats);
+    if (!stats.hits && !stats.misses)
+        return;
+
+    log_debug("encrypted files cache: %lu hits, %lu misses, %lu evictions", stats.hits,
+              stats.misses, stats.evictions);
+}
+
 static struct libos_encrypted_files_key* get_key(const char* name) {
     assert(locked(&g_keys_lock));
 
@@ -631,9 +631,9 @@ int file_lock_set_from_ipc(const char* path, struct libos_file_lock* file_lock,
     struct libos_dentry* dent = NULL;
     struct file_lock_request* req = NULL;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     int ret = path_lookupat(g_dentry_root, path, LOOKUP_NO_FOLLOW, &dent);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (ret < 0) {
         log_warning("file_lock_set_from_ipc: error on dentry lookup for %s: %d", path, ret);
         goto out;
@@ -720,9 +720,9 @@ int file_lock_get_from_ipc(const char* path, struct libos_file_lock* file_lock,
     assert(!g_process_ipc_ids.leader_vmid);
 
     struct libos_dentry* dent = NULL;
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     int ret = path_lookupat(g_dentry_root, path, LOOKUP_NO_FOLLOW, &dent);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (ret < 0) {
         log_warning("file_lock_get_from_ipc: error on dentry lookup for %s: %s", path,
                     unix_strerror(ret));
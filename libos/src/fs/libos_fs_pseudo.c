@@ -37,7 +37,7 @@ static struct pseudo_node* pseudo_find_root(const char* name) {
 
 /* Find a `pseudo_node` for given dentry. */
 static struct pseudo_node* pseudo_find(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     if (!dent->parent) {
         /* This is the filesystem root */
@@ -107,7 +107,7 @@ static int pseudo_mount(struct libos_mount_params* params, void** mount_data) {
 }
 
 static int pseudo_open(struct libos_handle* hdl, struct libos_dentry* dent, int flags) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     struct pseudo_node* node = dent->inode->data;
@@ -159,7 +159,7 @@ static int pseudo_open(struct libos_handle* hdl, struct libos_dentry* dent, int
 }
 
 static int pseudo_lookup(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     struct pseudo_node* node = pseudo_find(dent);
@@ -256,7 +256,7 @@ static int pseudo_istat(struct libos_dentry* dent, struct libos_inode* inode, st
 }
 
 static int pseudo_stat(struct libos_dentry* dent, struct stat* buf) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_read_locked(&g_dcache_lock) || rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     return pseudo_istat(dent, dent->inode, buf);
@@ -272,7 +272,7 @@ static int pseudo_unlink(struct libos_dentry* dent) {
 }
 
 static int pseudo_follow_link(struct libos_dentry* dent, char** out_target) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     char* target;
@@ -299,7 +299,7 @@ static int pseudo_follow_link(struct libos_dentry* dent, char** out_target) {
 }
 
 static int pseudo_readdir(struct libos_dentry* dent, readdir_callback_t callback, void* arg) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     int ret;
@@ -19,7 +19,7 @@
 #include "libos_fs.h"
 
 int synthetic_setup_dentry(struct libos_dentry* dent, mode_t type, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     struct libos_inode* inode = get_new_inode(dent->mount, type, perm);
@@ -33,7 +33,7 @@ int synthetic_setup_dentry(struct libos_dentry* dent, mode_t type, mode_t perm)
 }
 
 static int synthetic_open(struct libos_handle* hdl, struct libos_dentry* dent, int flags) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
     __UNUSED(dent);
     __UNUSED(flags);
@@ -41,7 +41,7 @@ int generic_seek(file_off_t pos, file_off_t size, file_off_t offset, int origin,
 }
 
 int generic_readdir(struct libos_dentry* dent, readdir_callback_t callback, void* arg) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
     assert(dent->inode->type == S_IFDIR);
 
@@ -89,7 +89,7 @@ static int generic_istat(struct libos_inode* inode, struct stat* buf) {
 }
 
 int generic_inode_stat(struct libos_dentry* dent, struct stat* buf) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_read_locked(&g_dcache_lock) || rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     return generic_istat(dent->inode, buf);
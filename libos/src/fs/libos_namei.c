@@ -16,7 +16,7 @@
 #include "stat.h"
 
 int check_permissions(struct libos_dentry* dent, mode_t mask) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_read_locked(&g_dcache_lock) || rwlock_is_write_locked(&g_dcache_lock));
 
     if (!dent->inode)
         return -ENOENT;
@@ -36,7 +36,7 @@ int check_permissions(struct libos_dentry* dent, mode_t mask) {
  * negative one. */
 static struct libos_dentry* lookup_dcache_or_create(struct libos_dentry* parent, const char* name,
                                                     size_t name_len) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(parent);
 
     struct libos_dentry* dent = lookup_dcache(parent, name, name_len);
@@ -45,13 +45,51 @@ static struct libos_dentry* lookup_dcache_or_create(struct libos_dentry* parent,
     return dent;
 }
 
-/* Performs lookup operation in the underlying filesystem. Treats -ENOENT from lookup operation as
- * success (but leaves the dentry negative). */
-static int lookup_dentry(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+static void count_cache_lookup(struct libos_mount* mount, bool hit) {
+    if (!mount || !mount->immutable)
+        return;
+    __atomic_add_fetch(hit ? &mount->cache_hits : &mount->cache_misses, 1, __ATOMIC_RELAXED);
+}
+
+/* Remembers that the file for a negative dentry does not exist, if its mount allows that. */
+static void cache_negative(struct libos_dentry* dent) {
+    struct libos_mount* mount = dent->mount;
+    if (!mount->immutable)
+        return;
+
+    if (!mount->cache_ttl_us) {
+        dentry_set_negative_until(dent, UINT64_MAX);
+        return;
+    }
+
+    uint64_t now;
+    if (PalSystemTimeQuery(&now) < 0)
+        return;
+    uint64_t until;
+    if (__builtin_add_overflow(now, mount->cache_ttl_us, &until))
+        until = UINT64_MAX;
+    dentry_set_negative_until(dent, until);
+}
 
-    if (dent->inode)
+/*
+ * Performs lookup operation in the underlying filesystem. Treats -ENOENT from lookup operation as
+ * success (but leaves the dentry negative).
+ *
+ * The lookup is skipped if the dentry is already positive, or is negative and known not to exist.
+ * If `cached` is set, the function fails with -EAGAIN instead of performing the lookup; in that
+ * case holding `g_dcache_lock` for reading is enough.
+ */
+static int lookup_dentry(struct libos_dentry* dent, bool cached) {
+    if (dent->inode || dentry_is_negative_cached(dent)) {
+        count_cache_lookup(dent->mount, /*hit=*/true);
         return 0;
+    }
+
+    if (cached)
+        return -EAGAIN;
+
+    assert(rwlock_is_write_locked(&g_dcache_lock));
+    count_cache_lookup(dent->mount, /*hit=*/false);
 
     assert(dent->mount);
     assert(dent->mount->fs->d_ops);
@@ -60,14 +98,19 @@ static int lookup_dentry(struct libos_dentry* dent) {
     if (ret < 0) {
         assert(!dent->inode);
         /* Treat -ENOENT as successful lookup (but leave the dentry negative) */
-        return ret == -ENOENT ? 0 : ret;
+        if (ret == -ENOENT) {
+            cache_negative(dent);
+            return 0;
+        }
+        return ret;
     }
     assert(dent->inode);
+    dentry_set_negative_until(dent, 0);
     return 0;
 }
 
 static int do_path_lookupat(struct libos_dentry* start, const char* path, int flags,
-                            struct libos_dentry** found, unsigned int link_depth);
+                            struct libos_dentry** found, unsigned int link_depth, bool cached);
 
 /* Helper function that follows a symbolic link, performing a nested call to `do_path_lookupat`  */
 static int path_lookupat_follow(struct libos_dentry* link, int flags, struct libos_dentry** found,
@@ -75,7 +118,7 @@ static int path_lookupat_follow(struct libos_dentry* link, int flags, struct lib
     int ret;
     char* target = NULL;
 
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     assert(link->inode);
     struct libos_fs* fs = link->inode->fs;
@@ -88,7 +131,7 @@ static int path_lookupat_follow(struct libos_dentry* link, int flags, struct lib
     struct libos_dentry* up = dentry_up(link);
     if (!up)
         up = g_dentry_root;
-    ret = do_path_lookupat(up, target, flags, found, link_depth);
+    ret = do_path_lookupat(up, target, flags, found, link_depth, /*cached=*/false);
 
 out:
     free(target);
@@ -110,17 +153,20 @@ out:
  * function will decrease the reference count for the original dentry, and increase it for the new
  * one.
  *
- * The caller should hold `g_dcache_lock`.
+ * If `cached` is set, the lookup is not performed: the function fails with -EAGAIN if the last
+ * dentry is negative and not known to be missing. In that case holding `g_dcache_lock` for reading
+ * is enough, otherwise the caller should hold `g_dcache_lock`.
  */
-static int traverse_mount_and_lookup(struct libos_dentry** dent) {
-    assert(locked(&g_dcache_lock));
+static int traverse_mount_and_lookup(struct libos_dentry** dent, bool cached) {
+    assert(cached ? rwlock_is_read_locked(&g_dcache_lock)
+                  : rwlock_is_write_locked(&g_dcache_lock));
 
     struct libos_dentry* cur_dent = *dent;
     while (cur_dent->attached_mount) {
         cur_dent = cur_dent->attached_mount->root;
     }
 
-    int ret = lookup_dentry(cur_dent);
+    int ret = lookup_dentry(cur_dent, cached);
     if (ret < 0)
         return ret;
 
@@ -148,6 +194,9 @@ struct lookup {
 
     /* Depth of followed symbolic links, to avoid too deep recursion */
     unsigned int link_depth;
+
+    /* Use only cached dentries, fail with -EAGAIN otherwise (see `path_lookupat_cached`) */
+    bool cached;
 };
 
 /* Process a new dentry in the lookup: follow mounts and symbolic links, then check if the resulting
@@ -157,13 +206,17 @@ static int lookup_enter_dentry(struct lookup* lookup) {
     bool is_final = (*lookup->name == '\0');
     bool has_slash = lookup->has_slash;
 
-    if ((ret = traverse_mount_and_lookup(&lookup->dent)) < 0)
+    if ((ret = traverse_mount_and_lookup(&lookup->dent, lookup->cached)) < 0)
         return ret;
 
     if (lookup->dent->inode && lookup->dent->inode->type == S_IFLNK) {
         /* Traverse the symbolic link. This applies to all intermediate segments, final segments
          * ending with slash, and to all final segments if LOOKUP_FOLLOW is set. */
         if (!is_final || has_slash || (lookup->flags & LOOKUP_FOLLOW)) {
+            /* Reading the link target may need the filesystem, leave it to the slow path */
+            if (lookup->cached)
+                return -EAGAIN;
+
             if (lookup->link_depth >= MAX_LINK_DEPTH)
                 return -ELOOP;
 
@@ -243,6 +296,10 @@ static int lookup_advance(struct lookup* lookup) {
         if (!next_dent)
             next_dent = lookup->dent;
         get_dentry(next_dent);
+    } else if (lookup->cached) {
+        next_dent = lookup_dcache_cached(lookup->dent, name, name_len);
+        if (!next_dent)
+            return -EAGAIN;
     } else {
         next_dent = lookup_dcache_or_create(lookup->dent, name, name_len);
         if (!next_dent)
@@ -263,8 +320,9 @@ static int lookup_advance(struct lookup* lookup) {
  * link depth is limited to MAX_LINK_DEPTH).
  */
 static int do_path_lookupat(struct libos_dentry* start, const char* path, int flags,
-                            struct libos_dentry** found, unsigned int link_depth) {
-    assert(locked(&g_dcache_lock));
+                            struct libos_dentry** found, unsigned int link_depth, bool cached) {
+    assert(cached ? rwlock_is_read_locked(&g_dcache_lock)
+                  : rwlock_is_write_locked(&g_dcache_lock));
 
     struct libos_dentry* dent = NULL;
     int ret = 0;
@@ -307,6 +365,7 @@ static int do_path_lookupat(struct libos_dentry* start, const char* path, int fl
         .has_slash = has_slash,
         .dent = dent,
         .link_depth = link_depth,
+        .cached = cached,
     };
 
     /* Main part of the algorithm. Repeatedly call `lookup_enter_dentry`, then `lookup_advance`,
@@ -335,7 +394,13 @@ err:
 
 int path_lookupat(struct libos_dentry* start, const char* path, int flags,
                    struct libos_dentry** found) {
-    return do_path_lookupat(start, path, flags, found, /*link_depth=*/0);
+    return do_path_lookupat(start, path, flags, found, /*link_depth=*/0, /*cached=*/false);
+}
+
+int path_lookupat_cached(struct libos_dentry* start, const char* path, int flags,
+                         struct libos_dentry** found) {
+    assert(!(flags & (LOOKUP_CREATE | LOOKUP_MAKE_SYNTHETIC)));
+    return do_path_lookupat(start, path, flags, found, /*link_depth=*/0, /*cached=*/true);
 }
 
 static inline int open_flags_to_lookup_flags(int flags) {
@@ -364,7 +429,7 @@ static inline int open_flags_to_lookup_flags(int flags) {
 
 static void assoc_handle_with_dentry(struct libos_handle* hdl, struct libos_dentry* dent,
                                      int flags) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     hdl->dentry = dent;
@@ -379,7 +444,7 @@ static void assoc_handle_with_dentry(struct libos_handle* hdl, struct libos_dent
 }
 
 int dentry_open(struct libos_handle* hdl, struct libos_dentry* dent, int flags) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
     assert(!hdl->dentry);
 
@@ -433,7 +498,7 @@ int open_namei(struct libos_handle* hdl, struct libos_dentry* start, const char*
     if (hdl)
         assert(!hdl->dentry);
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
 
     ret = path_lookupat(start, path, lookup_flags, &dent);
     if (ret < 0)
@@ -547,7 +612,7 @@ out:
     if (dent)
         put_dentry(dent);
 
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     return ret;
 }
 
@@ -584,7 +649,7 @@ static int add_name(const char* name, void* arg) {
  * deadlock.
  */
 static int populate_directory(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     if (!dent->inode)
         return -ENOENT;
@@ -629,8 +694,10 @@ static int populate_directory(struct libos_dentry* dent) {
             ret = -ENOMEM;
             goto out;
         }
+        /* The file is listed by the filesystem, so forget any cached failed lookup */
+        dentry_set_negative_until(child, 0);
 
-        ret = traverse_mount_and_lookup(&child);
+        ret = traverse_mount_and_lookup(&child, /*cached=*/false);
         put_dentry(child);
         if (ret < 0 && ret != -EACCES) {
             /* Fail on underlying lookup errors, except -EACCES (for which we will just ignore the
@@ -654,7 +721,7 @@ int populate_directory_handle(struct libos_handle* hdl) {
     struct libos_dir_handle* dirhdl = &hdl->dir_info;
 
     assert(locked(&hdl->lock));
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(hdl->dentry);
 
     int ret;
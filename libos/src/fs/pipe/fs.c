@@ -60,7 +60,7 @@ static int fifo_irestore(struct libos_inode* inode, void* data) {
 }
 
 int fifo_setup_dentry(struct libos_dentry* dent, mode_t perm, int fd_read, int fd_write) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     struct libos_inode* inode = get_new_inode(dent->mount, S_IFIFO, perm);
@@ -198,7 +198,7 @@ out:
 }
 
 static int fifo_open(struct libos_handle* hdl, struct libos_dentry* dent, int flags) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     struct fifo_data* fifo_data = dent->inode->data;
@@ -54,7 +54,7 @@ static int shm_mmap(struct libos_handle* hdl, void* addr, size_t size, int prot,
 /* Open a PAL handle, and associate it with a LibOS handle. */
 static int shm_do_open(struct libos_handle* hdl, struct libos_dentry* dent, mode_t type,
                        int flags, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     char* uri;
     int ret = chroot_dentry_uri(dent, type, &uri);
@@ -86,7 +86,7 @@ out:
 
 static int shm_setup_dentry(struct libos_dentry* dent, mode_t type, mode_t perm,
                             file_off_t size) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     struct libos_inode* inode = get_new_inode(dent->mount, type, perm);
@@ -98,7 +98,7 @@ static int shm_setup_dentry(struct libos_dentry* dent, mode_t type, mode_t perm,
 }
 
 static int shm_lookup(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     char* uri = NULL;
     /*
@@ -147,14 +147,14 @@ out:
 }
 
 static int shm_open(struct libos_handle* hdl, struct libos_dentry* dent, int flags) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     return shm_do_open(hdl, dent, dent->inode->type, flags, /*perm=*/0);
 }
 
 static int shm_creat(struct libos_handle* hdl, struct libos_dentry* dent, int flags, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     mode_t type = S_IFCHR;
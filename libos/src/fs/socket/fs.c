@@ -49,6 +49,16 @@ static ssize_t write(struct libos_handle* handle, const void* buf, size_t size,
                       /*addr=*/NULL, /*addrlen=*/0, /*flags=*/0);
 }
 
+static ssize_t splice_from(struct libos_handle* handle, struct libos_handle* in_hdl, size_t count,
+                           file_off_t* in_pos, file_off_t* pos) {
+    __UNUSED(pos);
+    PAL_HANDLE in_pal_handle = chroot_splice_source(in_hdl);
+    if (!in_pal_handle) {
+        return -EOPNOTSUPP;
+    }
+    return do_sendfile(handle, in_pal_handle, in_pos, count);
+}
+
 static ssize_t readv(struct libos_handle* handle, struct iovec* iov, size_t iov_len,
                      file_off_t* pos) {
     __UNUSED(pos);
@@ -223,16 +233,17 @@ static int checkin(struct libos_handle* handle) {
 }
 
 static struct libos_fs_ops socket_fs_ops = {
-    .close    = close,
-    .read     = read,
-    .write    = write,
-    .readv    = readv,
-    .writev   = writev,
-    .hstat    = hstat,
-    .setflags = setflags,
-    .ioctl    = ioctl,
-    .checkout = checkout,
-    .checkin  = checkin,
+    .close       = close,
+    .read        = read,
+    .write       = write,
+    .readv       = readv,
+    .writev      = writev,
+    .splice_from = splice_from,
+    .hstat       = hstat,
+    .setflags    = setflags,
+    .ioctl       = ioctl,
+    .checkout    = checkout,
+    .checkin     = checkin,
 };
 
 struct libos_fs socket_builtin_fs = {
@@ -25,7 +25,7 @@
 #define USEC_IN_SEC 1000000
 
 static int tmpfs_setup_dentry(struct libos_dentry* dent, mode_t type, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     struct libos_inode* inode = get_new_inode(dent->mount, type, perm);
@@ -117,7 +117,7 @@ static int tmpfs_flush(struct libos_handle* hdl) {
 }
 
 static int tmpfs_lookup(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     if (!dent->parent) {
@@ -130,7 +130,7 @@ static int tmpfs_lookup(struct libos_dentry* dent) {
 }
 
 static void tmpfs_do_open(struct libos_handle* hdl, struct libos_dentry* dent, int flags) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
     __UNUSED(dent);
     __UNUSED(flags);
@@ -140,7 +140,7 @@ static void tmpfs_do_open(struct libos_handle* hdl, struct libos_dentry* dent, i
 }
 
 static int tmpfs_open(struct libos_handle* hdl, struct libos_dentry* dent, int flags) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     tmpfs_do_open(hdl, dent, flags);
@@ -149,7 +149,7 @@ static int tmpfs_open(struct libos_handle* hdl, struct libos_dentry* dent, int f
 
 static int tmpfs_creat(struct libos_handle* hdl, struct libos_dentry* dent, int flags,
                        mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     int ret = tmpfs_setup_dentry(dent, S_IFREG, perm);
@@ -161,14 +161,14 @@ static int tmpfs_creat(struct libos_handle* hdl, struct libos_dentry* dent, int
 }
 
 static int tmpfs_mkdir(struct libos_dentry* dent, mode_t perm) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(!dent->inode);
 
     return tmpfs_setup_dentry(dent, S_IFDIR, perm);
 }
 
 static int tmpfs_unlink(struct libos_dentry* dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     if (dent->inode->type == S_IFDIR) {
@@ -187,7 +187,7 @@ static int tmpfs_unlink(struct libos_dentry* dent) {
 }
 
 static int tmpfs_rename(struct libos_dentry* old, struct libos_dentry* new) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(old->inode);
     __UNUSED(new);
 
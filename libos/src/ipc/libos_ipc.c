@@ -29,6 +29,8 @@ struct libos_ipc_connection {
     int seen_error;
     refcount_t ref_count;
     PAL_HANDLE handle;
+    /* If not NULL, messages are sent through this ring instead of `handle`. */
+    struct libos_ipc_ring* ring;
     /* This lock guards concurrent accesses to `handle` and `seen_error`. If you need both this lock
      * and `g_ipc_connections_lock`, take the latter first. */
     struct libos_lock lock;
@@ -71,6 +73,11 @@ int init_ipc(void) {
         return -ENOMEM;
     }
 
+    int ret = init_ipc_ring();
+    if (ret < 0) {
+        return ret;
+    }
+
     return init_ipc_ids();
 }
 
@@ -82,6 +89,9 @@ static void put_ipc_connection(struct libos_ipc_connection* conn) {
     refcount_t ref_count = refcount_dec(&conn->ref_count);
 
     if (!ref_count) {
+        if (conn->ring) {
+            ipc_ring_destroy(conn->ring);
+        }
         PalObjectDestroy(conn->handle);
         destroy_lock(&conn->lock);
         free(conn);
@@ -140,6 +150,10 @@ static int ipc_connect(IDTYPE dest, struct libos_ipc_connection** conn_ptr) {
         if (ret < 0) {
             goto out;
         }
+        ret = ipc_ring_connect(dest, conn->handle, &conn->ring);
+        if (ret < 0) {
+            goto out;
+        }
 
         conn->vmid = dest;
         refcount_set(&conn->ref_count, 1);
@@ -207,6 +221,35 @@ void remove_outgoing_ipc_connection(IDTYPE dest) {
     unlock(&g_msg_waiters_tree_lock);
 }
 
+void ipc_fail_response_waiters(char* msgs, size_t size) {
+    lock(&g_msg_waiters_tree_lock);
+    while (size > 0) {
+        struct libos_ipc_msg* msg = (struct libos_ipc_msg*)msgs;
+        size_t msg_size = GET_UNALIGNED(msg->header.size);
+        assert(sizeof(msg->header) <= msg_size && msg_size <= size);
+
+        uint64_t seq = GET_UNALIGNED(msg->header.seq);
+        if (seq && GET_UNALIGNED(msg->header.code) != IPC_MSG_RESP) {
+            struct ipc_msg_waiter dummy = {
+                .seq = seq,
+            };
+            struct avl_tree_node* node = avl_tree_find(&g_msg_waiters_tree, &dummy.node);
+            if (node) {
+                struct ipc_msg_waiter* waiter = container_of(node, struct ipc_msg_waiter, node);
+                /* the response might have already arrived, if the message was written after all */
+                if (!waiter->response_data) {
+                    PalEventSet(waiter->event);
+                    log_debug("Woke up a thread waiting for a response to a lost message");
+                }
+            }
+        }
+
+        msgs += msg_size;
+        size -= msg_size;
+    }
+    unlock(&g_msg_waiters_tree_lock);
+}
+
 void init_ipc_msg(struct libos_ipc_msg* msg, unsigned char code, size_t size) {
     SET_UNALIGNED(msg->header.size, size);
     SET_UNALIGNED(msg->header.seq, 0ul);
@@ -221,6 +264,11 @@ void init_ipc_response(struct libos_ipc_msg* msg, uint64_t seq, size_t size) {
 static int ipc_send_message_to_conn(struct libos_ipc_connection* conn, struct libos_ipc_msg* msg) {
     log_debug("Sending ipc message to %u", conn->vmid);
 
+    if (conn->ring) {
+        /* The ring has its own locking, which lets concurrent messages be batched. */
+        return ipc_ring_send(conn->ring, msg);
+    }
+
     int ret = 0;
     lock(&conn->lock);
     if (conn->seen_error) {
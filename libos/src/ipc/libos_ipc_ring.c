@@ -0,0 +1,1006 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Shared-memory rings: an optional transport for IPC messages, enabled with `libos.ipc_ring_dir`.
+ *
+ * An outgoing IPC connection gets a ring: a file in the shared memory directory (untrusted memory
+ * on SGX), created and mapped by the sender, whose name is sent to the receiver over the IPC pipe
+ * as the first message. From then on, all messages on this connection go through the ring; the pipe
+ * is still used to detect the disconnect of the sender. Data in a ring is split into records, each
+ * encrypted with AES-GCM using a per-ring key (derived from a key shared by all processes of this
+ * Gramine instance and a random salt) and the sequence number of the record as the nonce, so the
+ * host can neither read nor modify, reorder or replay them. Only the positions in the ring and the
+ * futex words are not protected; they are validated before use, and a corrupted ring terminates
+ * the receiving process.
+ *
+ * Each process has a doorbell: a page in the shared memory directory with a futex word, which
+ * senders bump after writing to any ring of this process. Several ring workers wait on the
+ * doorbell; each of them claims one ring at a time, so that the messages from one sender are still
+ * handled in order. A sender that finds another thread writing to the ring only appends its message
+ * to the pending buffer of the ring, and that thread writes it out together with its own message,
+ * so that concurrent messages are batched into one record and one wake-up.
+ */
+
+#include <stdnoreturn.h>
+
+#include "api.h"
+#include "assert.h"
+#include "cpu.h"
+#include "crypto.h"
+#include "libos_checkpoint.h"
+#include "libos_internal.h"
+#include "libos_ipc.h"
+#include "libos_lock.h"
+#include "libos_thread.h"
+#include "libos_types.h"
+#include "libos_utils.h"
+#include "libos_vma.h"
+#include "list.h"
+#include "pal.h"
+#include "perm.h"
+#include "toml_utils.h"
+
+#define LOG_PREFIX "IPC ring: "
+
+#define IPC_RING_KEY_SIZE   16
+#define IPC_RING_SALT_SIZE  32
+#define IPC_RING_TAG_SIZE   16
+#define IPC_RING_NONCE_SIZE 12
+#define IPC_RING_URI_SIZE   256
+
+/* Size of the data area of a ring, must be a power of two. */
+#define IPC_RING_CAPACITY     (256 * 1024)
+/* Offset of the data area in the ring file, after `struct ipc_ring_shared`. */
+#define IPC_RING_DATA_OFFSET  4096
+/* Maximal size of data in one record, must be a multiple of 8. */
+#define IPC_RING_MAX_RECORD   (16 * 1024)
+/* A ring worker releases a ring after this many records, so that other rings are not starved. */
+#define IPC_RING_RECORDS_PER_CLAIM 64
+/* A sender waiting for free space in a ring checks this often whether the receiver disconnected. */
+#define IPC_RING_SPACE_WAIT_US 10000
+
+#define IPC_RING_DEFAULT_WORKERS 2
+#define IPC_RING_MAX_WORKERS     64
+
+#define IPC_RING_MAP_SIZE     ALLOC_ALIGN_UP(IPC_RING_DATA_OFFSET + IPC_RING_CAPACITY)
+#define IPC_DOORBELL_MAP_SIZE ALLOC_ALIGN_UP(sizeof(struct ipc_ring_doorbell))
+
+/*
+ * Structures in shared (untrusted) memory. All fields are 8-byte words, written as a whole (see the
+ * mitigation of CVE-2022-21166 in the SGX PAL); futex words are their lower halves.
+ */
+struct ipc_ring_shared {
+    /* Number of bytes written to the ring so far, written by the sender. */
+    uint64_t tail;
+    uint8_t pad0[56];
+    /* Number of bytes consumed from the ring so far, written by the receiver. A sender waiting for
+     * free space sleeps on it. */
+    uint64_t head;
+    /* Set by a sender before it sleeps on `head`. */
+    uint64_t sender_waiting;
+    uint8_t pad1[48];
+};
+
+static_assert(sizeof(struct ipc_ring_shared) <= IPC_RING_DATA_OFFSET, "ring header is too big");
+static_assert((IPC_RING_CAPACITY & (IPC_RING_CAPACITY - 1)) == 0,
+              "ring capacity must be a power of two");
+static_assert(IPC_RING_MAX_RECORD % 8 == 0 && IPC_RING_MAX_RECORD < IPC_RING_CAPACITY,
+              "wrong maximal record size");
+
+struct ipc_ring_doorbell {
+    /* Bumped by senders after writing to any ring of this process. */
+    uint64_t seq;
+    /* Number of ring workers sleeping on `seq`. */
+    uint64_t waiters;
+};
+
+/* Header of a record in a ring, followed by the encrypted data padded to 8 bytes. */
+struct ipc_ring_record {
+    /* size of the data (not padded), authenticated as additional data */
+    uint32_t size;
+    uint32_t reserved;
+    uint8_t tag[IPC_RING_TAG_SIZE];
+};
+
+/* Body of `IPC_MSG_RING_SETUP`, sent over the IPC pipe. */
+struct ipc_ring_setup {
+    uint8_t salt[IPC_RING_SALT_SIZE];
+    char uri[IPC_RING_URI_SIZE]; /* null-terminated */
+};
+
+struct ipc_ring_buf {
+    char* data;
+    size_t size;
+    size_t capacity;
+};
+
+/* Sending end of a ring. */
+DEFINE_LIST(libos_ipc_ring);
+DEFINE_LISTP(libos_ipc_ring);
+struct libos_ipc_ring {
+    LIST_TYPE(libos_ipc_ring) list;
+    IDTYPE dest;
+    PAL_HANDLE handle;
+    struct ipc_ring_shared* shared;
+    char* data;
+    struct ipc_ring_doorbell* doorbell;
+    uint8_t key[IPC_RING_KEY_SIZE];
+    /* Set (atomically) when the receiver disconnected, to stop waiting for free space. */
+    bool closed;
+
+    /* Used only by the thread that has set `writing`. */
+    uint64_t seq;
+    uint64_t tail;
+    uint8_t* record;
+
+    /* This lock guards the fields below. */
+    struct libos_lock lock;
+    int seen_error;
+    bool writing;
+    struct ipc_ring_buf pending;
+    struct ipc_ring_buf spare;
+};
+
+/* Receiving end of a ring. */
+DEFINE_LIST(ipc_ring_rx);
+DEFINE_LISTP(ipc_ring_rx);
+struct ipc_ring_rx {
+    LIST_TYPE(ipc_ring_rx) list;
+    IDTYPE src;
+    struct ipc_ring_shared* shared;
+    char* data;
+    uint8_t key[IPC_RING_KEY_SIZE];
+    /* Set when a thread handles the messages in this ring, guarded by `g_rings_lock`. */
+    bool busy;
+
+    /* Used only by the thread that has set `busy`. */
+    uint64_t seq;
+    uint64_t head;
+    uint8_t* record;
+    /* decrypted data not yet handled, i.e. the beginning of a message */
+    struct ipc_ring_buf msgs;
+};
+
+/* Key shared by all processes of this Gramine instance: generated by the first one and migrated to
+ * children on checkpoints. */
+static uint8_t g_ipc_ring_key[IPC_RING_KEY_SIZE] __attribute_migratable;
+
+/* URI of the shared memory directory, ending with a slash; NULL if rings are disabled. */
+static char* g_ipc_ring_dir = NULL;
+
+/* Lists of sending and receiving ends of rings, to be accessed only with `g_rings_lock` taken. */
+static LISTP_TYPE(libos_ipc_ring) g_tx_rings;
+static LISTP_TYPE(ipc_ring_rx) g_rx_rings;
+static struct libos_lock g_rings_lock;
+
+/* Doorbell of this process; NULL if this process does not receive messages through rings. */
+static PAL_HANDLE g_doorbell_handle = NULL;
+static struct ipc_ring_doorbell* g_doorbell = NULL;
+
+static size_t g_workers_cnt = IPC_RING_DEFAULT_WORKERS;
+static struct libos_thread* g_workers[IPC_RING_MAX_WORKERS];
+/* Used by `PalThreadExit` to indicate that the worker really exited, see `g_clear_on_worker_exit`
+ * in `libos_ipc_worker.c`. */
+static int g_clear_on_workers_exit[IPC_RING_MAX_WORKERS];
+static bool g_workers_exiting = false;
+
+int init_ipc_ring(void) {
+    char* dir = NULL;
+    int ret = toml_string_in(g_manifest_root, "libos.ipc_ring_dir", &dir);
+    if (ret < 0) {
+        log_error("Cannot parse 'libos.ipc_ring_dir'");
+        return -EINVAL;
+    }
+    if (!dir) {
+        return 0;
+    }
+    if (!strstartswith(dir, URI_PREFIX_DEV)) {
+        log_error("'libos.ipc_ring_dir' (%s) must start with '%s'", dir, URI_PREFIX_DEV);
+        free(dir);
+        return -EINVAL;
+    }
+
+    int64_t workers;
+    ret = toml_int_in(g_manifest_root, "libos.ipc_ring_workers", IPC_RING_DEFAULT_WORKERS,
+                      &workers);
+    if (ret < 0 || workers < 1 || workers > IPC_RING_MAX_WORKERS) {
+        log_error("Cannot parse 'libos.ipc_ring_workers' (the value must be between 1 and %d)",
+                  IPC_RING_MAX_WORKERS);
+        free(dir);
+        return -EINVAL;
+    }
+    g_workers_cnt = workers;
+
+    size_t len = strlen(dir);
+    if (dir[len - 1] != '/') {
+        char* tmp = alloc_concat(dir, len, "/", 1);
+        free(dir);
+        if (!tmp) {
+            return -ENOMEM;
+        }
+        dir = tmp;
+    }
+
+    if (!create_lock(&g_rings_lock)) {
+        free(dir);
+        return -ENOMEM;
+    }
+
+    if (!g_pal_public_state->parent_process) {
+        ret = PalRandomBitsRead(g_ipc_ring_key, sizeof(g_ipc_ring_key));
+        if (ret < 0) {
+            free(dir);
+            return pal_to_unix_errno(ret);
+        }
+    }
+
+    g_ipc_ring_dir = dir;
+    return 0;
+}
+
+static int doorbell_uri(IDTYPE vmid, char* uri, size_t uri_size) {
+    int ret = snprintf(uri, uri_size, "%sgramine_ipc_%lu_%u", g_ipc_ring_dir,
+                       g_pal_public_state->instance_id, vmid);
+    if (ret < 0 || (size_t)ret >= uri_size) {
+        return -ERANGE;
+    }
+    return 0;
+}
+
+/* Opens (or creates) a file in the shared memory directory and maps it in the shared memory
+ * range. */
+static int map_shared_file(const char* uri, bool create, size_t size, PAL_HANDLE* out_handle,
+                           void** out_addr) {
+    PAL_HANDLE handle = NULL;
+    int ret = PalStreamOpen(uri, PAL_ACCESS_RDWR, PERM_rw_______,
+                            create ? PAL_CREATE_ALWAYS : PAL_CREATE_NEVER, /*options=*/0, &handle);
+    if (ret < 0) {
+        return pal_to_unix_errno(ret);
+    }
+
+    if (create) {
+        ret = PalStreamSetLength(handle, size);
+        if (ret < 0) {
+            ret = pal_to_unix_errno(ret);
+            goto out;
+        }
+    }
+
+    void* addr;
+    ret = bkeep_mmap_any_in_range(g_pal_public_state->shared_address_start,
+                                  g_pal_public_state->shared_address_end, size,
+                                  PROT_READ | PROT_WRITE, MAP_SHARED | VMA_INTERNAL,
+                                  /*file=*/NULL, /*offset=*/0, "ipc_ring", &addr);
+    if (ret < 0) {
+        goto out;
+    }
+
+    ret = PalStreamMap(handle, addr, PAL_PROT_READ | PAL_PROT_WRITE, /*offset=*/0, size);
+    if (ret < 0) {
+        ret = pal_to_unix_errno(ret);
+        void* tmp_vma = NULL;
+        if (bkeep_munmap(addr, size, /*is_internal=*/true, &tmp_vma) < 0) {
+            BUG();
+        }
+        bkeep_remove_tmp_vma(tmp_vma);
+        goto out;
+    }
+
+    *out_handle = handle;
+    *out_addr = addr;
+    handle = NULL;
+    ret = 0;
+
+out:
+    if (handle) {
+        if (create) {
+            (void)PalStreamDelete(handle, PAL_DELETE_ALL);
+        }
+        PalObjectDestroy(handle);
+    }
+    return ret;
+}
+
+static void unmap_shared_file(void* addr, size_t size) {
+    void* tmp_vma = NULL;
+    if (bkeep_munmap(addr, size, /*is_internal=*/true, &tmp_vma) < 0) {
+        BUG();
+    }
+    if (PalVirtualMemoryFree(addr, size) < 0) {
+        BUG();
+    }
+    bkeep_remove_tmp_vma(tmp_vma);
+}
+
+static int derive_ring_key(const uint8_t* salt, IDTYPE src, IDTYPE dest, uint8_t* key) {
+    struct {
+        char label[16];
+        IDTYPE src;
+        IDTYPE dest;
+    } __attribute__((packed)) info = {
+        .label = "gramine-ipc-ring",
+        .src = src,
+        .dest = dest,
+    };
+    int ret = lib_HKDF_SHA256(g_ipc_ring_key, sizeof(g_ipc_ring_key), salt, IPC_RING_SALT_SIZE,
+                              (const uint8_t*)&info, sizeof(info), key, IPC_RING_KEY_SIZE);
+    if (ret < 0) {
+        log_error(LOG_PREFIX "deriving a ring key failed: %d", ret);
+        return -EACCES;
+    }
+    return 0;
+}
+
+static void record_nonce(uint64_t seq, uint8_t* nonce) {
+    memset(nonce, 0, IPC_RING_NONCE_SIZE);
+    memcpy(nonce + IPC_RING_NONCE_SIZE - sizeof(seq), &seq, sizeof(seq));
+}
+
+static size_t record_size(size_t data_size) {
+    return sizeof(struct ipc_ring_record) + ALIGN_UP(data_size, 8);
+}
+
+static void ring_copy_to(char* data, uint64_t pos, const void* src, size_t size) {
+    size_t off = pos & (IPC_RING_CAPACITY - 1);
+    size_t first = MIN(size, IPC_RING_CAPACITY - off);
+    memcpy(data + off, src, first);
+    memcpy(data, (const char*)src + first, size - first);
+}
+
+static void ring_copy_from(const char* data, uint64_t pos, void* dst, size_t size) {
+    size_t off = pos & (IPC_RING_CAPACITY - 1);
+    size_t first = MIN(size, IPC_RING_CAPACITY - off);
+    memcpy(dst, data + off, first);
+    memcpy((char*)dst + first, data, size - first);
+}
+
+static int buf_reserve(struct ipc_ring_buf* buf, size_t size) {
+    if (buf->capacity - buf->size >= size) {
+        return 0;
+    }
+    size_t new_capacity = MAX(MAX(buf->capacity * 2, buf->size + size), (size_t)4096);
+    char* new_data = malloc(new_capacity);
+    if (!new_data) {
+        return -ENOMEM;
+    }
+    if (buf->size) {
+        memcpy(new_data, buf->data, buf->size);
+    }
+    free(buf->data);
+    buf->data = new_data;
+    buf->capacity = new_capacity;
+    return 0;
+}
+
+static void ring_doorbell(struct ipc_ring_doorbell* doorbell) {
+    /* Sequentially consistent with bumping `waiters` and re-checking the rings in a worker, see
+     * `ring_worker_main()`. */
+    __atomic_add_fetch(&doorbell->seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&doorbell->waiters, __ATOMIC_SEQ_CST)) {
+        (void)PalSharedFutexWake((uint32_t*)&doorbell->seq, 1);
+    }
+}
+
+static int wait_for_space(struct libos_ipc_ring* ring, size_t size) {
+    while (true) {
+        /* `head` is untrusted, but a wrong value can only make us overwrite records not read yet,
+         * which the receiver detects. */
+        uint64_t head = __atomic_load_n(&ring->shared->head, __ATOMIC_SEQ_CST);
+        if (ring->tail - head <= IPC_RING_CAPACITY - size) {
+            return 0;
+        }
+        if (__atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE)
+                || __atomic_load_n(&g_workers_exiting, __ATOMIC_ACQUIRE)) {
+            return -EPIPE;
+        }
+
+        /* Make sure that the receiver is awake, and ask it to wake us up. */
+        ring_doorbell(ring->doorbell);
+        __atomic_store_n(&ring->shared->sender_waiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->shared->head, __ATOMIC_SEQ_CST) != head) {
+            continue;
+        }
+        uint64_t timeout_us = IPC_RING_SPACE_WAIT_US;
+        int ret = PalSharedFutexWait((uint32_t*)&ring->shared->head, (uint32_t)head, &timeout_us);
+        if (ret < 0 && ret != -PAL_ERROR_TRYAGAIN && ret != -PAL_ERROR_INTERRUPTED) {
+            return pal_to_unix_errno(ret);
+        }
+    }
+}
+
+/* Writes `size` bytes as records to the ring; must be called only by the thread that has set
+ * `ring->writing`. */
+static int ring_write(struct libos_ipc_ring* ring, const char* buf, size_t size) {
+    while (size > 0) {
+        size_t data_size = MIN(size, (size_t)IPC_RING_MAX_RECORD);
+        int ret = wait_for_space(ring, record_size(data_size));
+        if (ret < 0) {
+            return ret;
+        }
+
+        struct ipc_ring_record record = { .size = data_size };
+        uint8_t nonce[IPC_RING_NONCE_SIZE];
+        record_nonce(ring->seq, nonce);
+        ret = lib_AESGCMEncrypt(ring->key, sizeof(ring->key), nonce, (const uint8_t*)buf,
+                                data_size, (const uint8_t*)&record.size, sizeof(record.size),
+                                ring->record, record.tag, sizeof(record.tag));
+        if (ret != 0) {
+            log_error(LOG_PREFIX "encrypting a record failed: %d", ret);
+            return -EACCES;
+        }
+        memset(ring->record + data_size, 0, ALIGN_UP(data_size, 8) - data_size);
+
+        ring_copy_to(ring->data, ring->tail, &record, sizeof(record));
+        ring_copy_to(ring->data, ring->tail + sizeof(record), ring->record,
+                     ALIGN_UP(data_size, 8));
+        ring->tail += record_size(data_size);
+        ring->seq++;
+        __atomic_store_n(&ring->shared->tail, ring->tail, __ATOMIC_SEQ_CST);
+
+        buf += data_size;
+        size -= data_size;
+    }
+
+    ring_doorbell(ring->doorbell);
+    return 0;
+}
+
+int ipc_ring_send(struct libos_ipc_ring* ring, struct libos_ipc_msg* msg) {
+    size_t size = GET_UNALIGNED(msg->header.size);
+
+    lock(&ring->lock);
+    int ret = ring->seen_error;
+    if (ret < 0) {
+        log_debug(LOG_PREFIX "returning previously seen error: %s", unix_strerror(ret));
+        goto out;
+    }
+
+    ret = buf_reserve(&ring->pending, size);
+    if (ret < 0) {
+        goto out;
+    }
+    memcpy(ring->pending.data + ring->pending.size, msg, size);
+    ring->pending.size += size;
+
+    if (ring->writing) {
+        /* The thread writing to the ring will write out our message too. */
+        goto out;
+    }
+
+    ring->writing = true;
+    while (ring->pending.size > 0) {
+        struct ipc_ring_buf batch = ring->pending;
+        ring->pending = ring->spare;
+        ring->pending.size = 0;
+        unlock(&ring->lock);
+
+        ret = ring_write(ring, batch.data, batch.size);
+
+        lock(&ring->lock);
+        ring->spare = batch;
+        if (ret < 0) {
+            log_error(LOG_PREFIX "failed to send IPC msg to %u: %s", ring->dest,
+                      unix_strerror(ret));
+            ring->seen_error = ret;
+            /* The other threads that queued messages in this batch, or while it was being written,
+             * already got 0. Their messages are lost, so at least do not let them wait for
+             * responses forever. */
+            ipc_fail_response_waiters(batch.data, batch.size);
+            ipc_fail_response_waiters(ring->pending.data, ring->pending.size);
+            ring->pending.size = 0;
+            break;
+        }
+    }
+    ring->writing = false;
+
+out:
+    unlock(&ring->lock);
+    return ret;
+}
+
+static void free_tx_ring(struct libos_ipc_ring* ring) {
+    if (ring->shared) {
+        unmap_shared_file(ring->shared, IPC_RING_MAP_SIZE);
+    }
+    if (ring->doorbell) {
+        unmap_shared_file(ring->doorbell, IPC_DOORBELL_MAP_SIZE);
+    }
+    if (ring->handle) {
+        /* Normally the receiver has already deleted the file. */
+        (void)PalStreamDelete(ring->handle, PAL_DELETE_ALL);
+        PalObjectDestroy(ring->handle);
+    }
+    if (lock_created(&ring->lock)) {
+        destroy_lock(&ring->lock);
+    }
+    free(ring->pending.data);
+    free(ring->spare.data);
+    free(ring->record);
+    free(ring);
+}
+
+static int send_ring_setup(PAL_HANDLE pipe, const struct ipc_ring_setup* setup) {
+    size_t msg_size = get_ipc_msg_size(sizeof(*setup));
+    struct libos_ipc_msg* msg = malloc(msg_size);
+    if (!msg) {
+        return -ENOMEM;
+    }
+    init_ipc_msg(msg, IPC_MSG_RING_SETUP, msg_size);
+    memcpy(&msg->data, setup, sizeof(*setup));
+
+    int ret = write_exact(pipe, msg, msg_size);
+    free(msg);
+    return ret;
+}
+
+int ipc_ring_connect(IDTYPE dest, PAL_HANDLE pipe, struct libos_ipc_ring** out_ring) {
+    *out_ring = NULL;
+    if (!g_ipc_ring_dir) {
+        return 0;
+    }
+
+    struct ipc_ring_setup setup = { 0 };
+    struct libos_ipc_ring* ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+        log_warning(LOG_PREFIX "cannot set up a ring to %u, using the pipe: %s", dest,
+                    unix_strerror(-ENOMEM));
+        return 0;
+    }
+    ring->dest = dest;
+
+    int ret;
+    bool pipe_broken = false;
+    if (!create_lock(&ring->lock)) {
+        ret = -ENOMEM;
+        goto out;
+    }
+    ring->record = malloc(IPC_RING_MAX_RECORD);
+    if (!ring->record) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    /* Without the doorbell (e.g. if the destination could not create it), use the pipe. */
+    char uri[IPC_RING_URI_SIZE];
+    ret = doorbell_uri(dest, uri, sizeof(uri));
+    if (ret < 0) {
+        goto out;
+    }
+    PAL_HANDLE doorbell_handle;
+    ret = map_shared_file(uri, /*create=*/false, IPC_DOORBELL_MAP_SIZE, &doorbell_handle,
+                          (void**)&ring->doorbell);
+    if (ret < 0) {
+        goto out;
+    }
+    /* The mapping stays valid after closing the file. */
+    PalObjectDestroy(doorbell_handle);
+
+    uint64_t suffix;
+    ret = PalRandomBitsRead(&suffix, sizeof(suffix));
+    if (ret < 0) {
+        ret = pal_to_unix_errno(ret);
+        goto out;
+    }
+    ret = PalRandomBitsRead(setup.salt, sizeof(setup.salt));
+    if (ret < 0) {
+        ret = pal_to_unix_errno(ret);
+        goto out;
+    }
+    ret = snprintf(setup.uri, sizeof(setup.uri), "%sgramine_ipc_%lu_%u_%u_%016lx",
+                   g_ipc_ring_dir, g_pal_public_state->instance_id,
+                   g_process_ipc_ids.self_vmid, dest, suffix);
+    if (ret < 0 || (size_t)ret >= sizeof(setup.uri)) {
+        ret = -ERANGE;
+        goto out;
+    }
+    void* addr;
+    ret = map_shared_file(setup.uri, /*create=*/true, IPC_RING_MAP_SIZE, &ring->handle, &addr);
+    if (ret < 0) {
+        goto out;
+    }
+    ring->shared = addr;
+    ring->data = (char*)addr + IPC_RING_DATA_OFFSET;
+
+    ret = derive_ring_key(setup.salt, g_process_ipc_ids.self_vmid, dest, ring->key);
+    if (ret < 0) {
+        goto out;
+    }
+
+    ret = send_ring_setup(pipe, &setup);
+    if (ret < 0) {
+        /* The pipe is broken, so the connection cannot be used at all. */
+        pipe_broken = true;
+        goto out;
+    }
+
+    lock(&g_rings_lock);
+    LISTP_ADD_TAIL(ring, &g_tx_rings, list);
+    unlock(&g_rings_lock);
+
+    log_debug(LOG_PREFIX "sending IPC messages to %u through %s", dest, setup.uri);
+    *out_ring = ring;
+    ring = NULL;
+
+out:
+    if (ring) {
+        free_tx_ring(ring);
+        if (!pipe_broken) {
+            log_warning(LOG_PREFIX "cannot set up a ring to %u, using the pipe: %s", dest,
+                        unix_strerror(ret));
+            ret = 0;
+        }
+    }
+    return ret;
+}
+
+void ipc_ring_destroy(struct libos_ipc_ring* ring) {
+    lock(&g_rings_lock);
+    LISTP_DEL(ring, &g_tx_rings, list);
+    unlock(&g_rings_lock);
+
+    free_tx_ring(ring);
+}
+
+static noreturn void ring_corrupted(struct ipc_ring_rx* ring) {
+    log_error(LOG_PREFIX "ring from %u is corrupted (possibly by the host)", ring->src);
+    PalProcessExit(1);
+}
+
+static void free_rx_ring(struct ipc_ring_rx* ring) {
+    unmap_shared_file(ring->shared, IPC_RING_MAP_SIZE);
+    free(ring->msgs.data);
+    free(ring->record);
+    free(ring);
+}
+
+/* Handles the complete messages among the decrypted data. */
+static void handle_ring_messages(struct ipc_ring_rx* ring) {
+    size_t off = 0;
+    while (ring->msgs.size - off >= sizeof(struct ipc_msg_header)) {
+        struct ipc_msg_header* header = (struct ipc_msg_header*)(ring->msgs.data + off);
+        size_t msg_size = GET_UNALIGNED(header->size);
+        if (msg_size < sizeof(*header)) {
+            ring_corrupted(ring);
+        }
+        if (ring->msgs.size - off < msg_size) {
+            break;
+        }
+
+        size_t data_size = msg_size - sizeof(*header);
+        void* msg_data = malloc(data_size);
+        if (!msg_data) {
+            log_error(LOG_PREFIX "allocating a message from %u failed", ring->src);
+            PalProcessExit(1);
+        }
+        memcpy(msg_data, (char*)header + sizeof(*header), data_size);
+
+        unsigned char msg_code = GET_UNALIGNED(header->code);
+        unsigned long msg_seq = GET_UNALIGNED(header->seq);
+        log_debug(LOG_PREFIX "received IPC message from %u: code=%d size=%lu seq=%lu", ring->src,
+                  msg_code, msg_size, msg_seq);
+        ipc_run_callback(ring->src, msg_code, msg_data, msg_seq);
+
+        off += msg_size;
+    }
+
+    memmove(ring->msgs.data, ring->msgs.data + off, ring->msgs.size - off);
+    ring->msgs.size -= off;
+}
+
+/* Handles at most `max_records` records from the ring, which must be claimed by the calling thread
+ * (or removed from `g_rx_rings`). Returns the number of handled records. */
+static size_t ring_receive(struct ipc_ring_rx* ring, size_t max_records) {
+    size_t records = 0;
+    while (records < max_records) {
+        uint64_t tail = __atomic_load_n(&ring->shared->tail, __ATOMIC_SEQ_CST);
+        if (tail == ring->head) {
+            break;
+        }
+
+        /* `tail` and the record header are untrusted; the header is copied before validation */
+        struct ipc_ring_record record;
+        uint64_t avail = tail - ring->head;
+        if (avail > IPC_RING_CAPACITY || avail < sizeof(record)) {
+            ring_corrupted(ring);
+        }
+        ring_copy_from(ring->data, ring->head, &record, sizeof(record));
+        if (record.size == 0 || record.size > IPC_RING_MAX_RECORD
+                || record_size(record.size) > avail) {
+            ring_corrupted(ring);
+        }
+        ring_copy_from(ring->data, ring->head + sizeof(record), ring->record, record.size);
+
+        if (buf_reserve(&ring->msgs, record.size) < 0) {
+            log_error(LOG_PREFIX "allocating a message from %u failed", ring->src);
+            PalProcessExit(1);
+        }
+        uint8_t* plaintext = (uint8_t*)ring->msgs.data + ring->msgs.size;
+        uint8_t nonce[IPC_RING_NONCE_SIZE];
+        record_nonce(ring->seq, nonce);
+        int ret = lib_AESGCMDecrypt(ring->key, sizeof(ring->key), nonce, ring->record,
+                                    record.size, (const uint8_t*)&record.size,
+                                    sizeof(record.size), plaintext, record.tag,
+                                    sizeof(record.tag));
+        if (ret != 0) {
+            ring_corrupted(ring);
+        }
+        ring->msgs.size += record.size;
+        ring->seq++;
+
+        /* The record is already copied out, so the sender can reuse its space. */
+        ring->head += record_size(record.size);
+        __atomic_store_n(&ring->shared->head, ring->head, __ATOMIC_SEQ_CST);
+        if (__atomic_exchange_n(&ring->shared->sender_waiting, 0, __ATOMIC_SEQ_CST)) {
+            (void)PalSharedFutexWake((uint32_t*)&ring->shared->head, 1);
+        }
+
+        handle_ring_messages(ring);
+        records++;
+    }
+    return records;
+}
+
+int ipc_ring_setup_callback(IDTYPE src, void* data, uint64_t seq) {
+    __UNUSED(seq);
+    struct ipc_ring_setup* setup = data;
+
+    if (!g_doorbell) {
+        log_error(LOG_PREFIX "got a ring from %u, but rings are not enabled", src);
+        return -EINVAL;
+    }
+    if (strnlen(setup->uri, sizeof(setup->uri)) == sizeof(setup->uri)
+            || !strstartswith(setup->uri, g_ipc_ring_dir)) {
+        log_error(LOG_PREFIX "got an invalid ring URI from %u", src);
+        return -EINVAL;
+    }
+
+    struct ipc_ring_rx* ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+        return -ENOMEM;
+    }
+    ring->src = src;
+    ring->record = malloc(IPC_RING_MAX_RECORD);
+    if (!ring->record) {
+        free(ring);
+        return -ENOMEM;
+    }
+
+    int ret = derive_ring_key(setup->salt, src, g_process_ipc_ids.self_vmid, ring->key);
+    if (ret < 0) {
+        goto fail;
+    }
+
+    PAL_HANDLE handle;
+    void* addr;
+    ret = map_shared_file(setup->uri, /*create=*/false, IPC_RING_MAP_SIZE, &handle, &addr);
+    if (ret < 0) {
+        log_error(LOG_PREFIX "cannot map the ring from %u (%s): %s", src, setup->uri,
+                  unix_strerror(ret));
+        goto fail;
+    }
+    /* Nobody else needs the file, and the mapping stays valid after it is deleted. */
+    (void)PalStreamDelete(handle, PAL_DELETE_ALL);
+    PalObjectDestroy(handle);
+    ring->shared = addr;
+    ring->data = (char*)addr + IPC_RING_DATA_OFFSET;
+
+    lock(&g_rings_lock);
+    LISTP_ADD_TAIL(ring, &g_rx_rings, list);
+    unlock(&g_rings_lock);
+
+    log_debug(LOG_PREFIX "receiving IPC messages from %u through %s", src, setup->uri);
+
+    /* The sender may have written to the ring already. */
+    ring_doorbell(g_doorbell);
+    return 0;
+
+fail:
+    free(ring->record);
+    free(ring);
+    return ret;
+}
+
+void ipc_ring_disconnect(IDTYPE src) {
+    if (!g_ipc_ring_dir) {
+        return;
+    }
+
+    lock(&g_rings_lock);
+    /* A worker handling messages from `src` may wait for free space in a ring to `src`. */
+    struct libos_ipc_ring* tx_ring;
+    LISTP_FOR_EACH_ENTRY(tx_ring, &g_tx_rings, list) {
+        if (tx_ring->dest == src) {
+            __atomic_store_n(&tx_ring->closed, true, __ATOMIC_RELEASE);
+        }
+    }
+    unlock(&g_rings_lock);
+
+    /* Messages left in the rings from `src` must be handled before the disconnect callbacks (e.g.
+     * the exit status of a child), so wait for the workers to release the rings and drain them. */
+    while (true) {
+        struct ipc_ring_rx* ring = NULL;
+        struct ipc_ring_rx* tmp;
+        bool busy = false;
+
+        lock(&g_rings_lock);
+        LISTP_FOR_EACH_ENTRY(tmp, &g_rx_rings, list) {
+            if (tmp->src != src) {
+                continue;
+            }
+            if (tmp->busy) {
+                busy = true;
+                continue;
+            }
+            ring = tmp;
+            LISTP_DEL(ring, &g_rx_rings, list);
+            break;
+        }
+        unlock(&g_rings_lock);
+
+        if (ring) {
+            ring_receive(ring, SIZE_MAX);
+            free_rx_ring(ring);
+        } else if (busy) {
+            PalThreadYieldExecution();
+        } else {
+            break;
+        }
+    }
+}
+
+/* Claims a ring with unhandled records, if any. If there are more such rings, wakes up another
+ * worker to handle them in parallel (senders wake up only one worker). */
+static struct ipc_ring_rx* claim_ring(void) {
+    struct ipc_ring_rx* ring;
+    struct ipc_ring_rx* found = NULL;
+    bool more = false;
+
+    lock(&g_rings_lock);
+    LISTP_FOR_EACH_ENTRY(ring, &g_rx_rings, list) {
+        if (!ring->busy && __atomic_load_n(&ring->shared->tail, __ATOMIC_SEQ_CST) != ring->head) {
+            if (found) {
+                more = true;
+                break;
+            }
+            found = ring;
+        }
+    }
+    if (found) {
+        found->busy = true;
+        /* Move the ring to the end of the list, so that rings are handled round-robin. */
+        LISTP_DEL(found, &g_rx_rings, list);
+        LISTP_ADD_TAIL(found, &g_rx_rings, list);
+    }
+    unlock(&g_rings_lock);
+
+    if (more && __atomic_load_n(&g_doorbell->waiters, __ATOMIC_SEQ_CST)) {
+        ring_doorbell(g_doorbell);
+    }
+    return found;
+}
+
+static void release_ring(struct ipc_ring_rx* ring) {
+    lock(&g_rings_lock);
+    ring->busy = false;
+    unlock(&g_rings_lock);
+}
+
+static noreturn void ring_worker_main(size_t idx) {
+    while (!__atomic_load_n(&g_workers_exiting, __ATOMIC_ACQUIRE)) {
+        struct ipc_ring_rx* ring = claim_ring();
+        if (!ring) {
+            /* Announce that we are going to sleep before the last check of the rings, so that
+             * a sender writing after this check sees us and bumps `seq` (see `ring_doorbell()`). */
+            __atomic_add_fetch(&g_doorbell->waiters, 1, __ATOMIC_SEQ_CST);
+            uint64_t seq = __atomic_load_n(&g_doorbell->seq, __ATOMIC_SEQ_CST);
+            ring = claim_ring();
+            if (!ring && !__atomic_load_n(&g_workers_exiting, __ATOMIC_ACQUIRE)) {
+                int ret = PalSharedFutexWait((uint32_t*)&g_doorbell->seq, (uint32_t)seq,
+                                             /*timeout_us=*/NULL);
+                if (ret < 0 && ret != -PAL_ERROR_INTERRUPTED) {
+                    log_error(LOG_PREFIX "waiting on the doorbell failed: %s", pal_strerror(ret));
+                    PalProcessExit(1);
+                }
+            }
+            __atomic_sub_fetch(&g_doorbell->waiters, 1, __ATOMIC_SEQ_CST);
+            if (!ring) {
+                continue;
+            }
+        }
+
+        ring_receive(ring, IPC_RING_RECORDS_PER_CLAIM);
+        release_ring(ring);
+    }
+
+    log_debug(LOG_PREFIX "exiting worker thread");
+
+    struct libos_thread* cur_thread = get_cur_thread();
+    assert(g_workers[idx] == cur_thread);
+    assert(cur_thread->libos_tcb->tp == cur_thread);
+    cur_thread->libos_tcb->tp = NULL;
+    put_thread(cur_thread);
+
+    destroy_slab_thread_cache();
+    PalThreadExit(&g_clear_on_workers_exit[idx]);
+    /* Unreachable. */
+}
+
+static int ring_worker_wrapper(void* arg) {
+    size_t idx = (size_t)arg;
+    assert(g_workers[idx]);
+
+    libos_tcb_init();
+    set_cur_thread(g_workers[idx]);
+
+    log_setprefix(libos_get_tcb());
+
+    log_debug("IPC ring worker %lu started", idx);
+    ring_worker_main(idx);
+    /* Unreachable. */
+}
+
+int init_ipc_ring_workers(void) {
+    if (!g_ipc_ring_dir) {
+        return 0;
+    }
+
+    char uri[IPC_RING_URI_SIZE];
+    int ret = doorbell_uri(g_process_ipc_ids.self_vmid, uri, sizeof(uri));
+    if (ret < 0) {
+        return ret;
+    }
+    void* addr;
+    ret = map_shared_file(uri, /*create=*/true, IPC_DOORBELL_MAP_SIZE, &g_doorbell_handle, &addr);
+    if (ret < 0) {
+        /* Other processes will fall back to pipes when sending messages to this one. */
+        log_warning(LOG_PREFIX "cannot create the doorbell %s, receiving IPC messages through "
+                    "pipes: %s", uri, unix_strerror(ret));
+        return 0;
+    }
+    g_doorbell = addr;
+
+    for (size_t i = 0; i < g_workers_cnt; i++) {
+        g_workers[i] = get_new_internal_thread();
+        if (!g_workers[i]) {
+            return -ENOMEM;
+        }
+
+        g_clear_on_workers_exit[i] = 1;
+        PAL_HANDLE handle = NULL;
+        ret = PalThreadCreate(ring_worker_wrapper, (void*)i, &handle);
+        if (ret < 0) {
+            put_thread(g_workers[i]);
+            g_workers[i] = NULL;
+            return pal_to_unix_errno(ret);
+        }
+        g_workers[i]->pal_handle = handle;
+    }
+    return 0;
+}
+
+void terminate_ipc_ring_workers(void) {
+    if (!g_doorbell) {
+        return;
+    }
+
+    __atomic_store_n(&g_workers_exiting, true, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&g_doorbell->seq, 1, __ATOMIC_SEQ_CST);
+
+    for (size_t i = 0; i < g_workers_cnt; i++) {
+        if (!g_workers[i]) {
+            break;
+        }
+        while (__atomic_load_n(&g_clear_on_workers_exit[i], __ATOMIC_ACQUIRE)) {
+            /* A worker might have started to sleep after the wake-up. */
+            (void)PalSharedFutexWake((uint32_t*)&g_doorbell->seq, UINT32_MAX);
+            CPU_RELAX();
+        }
+        put_thread(g_workers[i]);
+        g_workers[i] = NULL;
+    }
+
+    (void)PalStreamDelete(g_doorbell_handle, PAL_DELETE_ALL);
+    PalObjectDestroy(g_doorbell_handle);
+    g_doorbell_handle = NULL;
+}
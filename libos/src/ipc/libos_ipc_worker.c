@@ -63,8 +63,26 @@ static ipc_callback ipc_callbacks[] = {
     [IPC_MSG_FILE_LOCK_SET]       = ipc_file_lock_set_callback,
     [IPC_MSG_FILE_LOCK_GET]       = ipc_file_lock_get_callback,
     [IPC_MSG_FILE_LOCK_CLEAR_PID] = ipc_file_lock_clear_pid_callback,
+
+    [IPC_MSG_RING_SETUP] = ipc_ring_setup_callback,
 };
 
+void ipc_run_callback(IDTYPE src, unsigned char code, void* data, uint64_t seq) {
+    if (code < ARRAY_SIZE(ipc_callbacks) && ipc_callbacks[code]) {
+        int ret = ipc_callbacks[code](src, data, seq);
+        if (ret < 0) {
+            log_error(LOG_PREFIX "error running IPC callback %u: %s", code, unix_strerror(ret));
+            PalProcessExit(1);
+        }
+    } else {
+        log_error(LOG_PREFIX "received unknown IPC msg type: %u", code);
+    }
+
+    if (code != IPC_MSG_RESP) {
+        free(data);
+    }
+}
+
 static void ipc_leader_died_callback(void) {
     /* This might happen legitimately e.g. if IPC leader is also our parent and does `wait` + `exit`
      * If this is an erroneous disconnect it will be noticed when trying to communicate with
@@ -73,6 +91,9 @@ static void ipc_leader_died_callback(void) {
 }
 
 static void disconnect_callbacks(struct libos_ipc_connection* conn) {
+    /* Messages which the process left in shared-memory rings must be handled first. */
+    ipc_ring_disconnect(conn->vmid);
+
     if (g_process_ipc_ids.leader_vmid == conn->vmid) {
         ipc_leader_died_callback();
     }
@@ -193,21 +214,7 @@ static int receive_ipc_messages(struct libos_ipc_connection* conn) {
         log_debug(LOG_PREFIX "received IPC message from %u: code=%d size=%lu seq=%lu", conn->vmid,
                   msg_code, msg_size, msg_seq);
 
-        int ret = 0;
-        if (msg_code < ARRAY_SIZE(ipc_callbacks) && ipc_callbacks[msg_code]) {
-            ret = ipc_callbacks[msg_code](conn->vmid, msg_data, msg_seq);
-            if (ret < 0) {
-                log_error(LOG_PREFIX "error running IPC callback %u: %s", msg_code,
-                          unix_strerror(ret));
-                PalProcessExit(1);
-            }
-        } else {
-            log_error(LOG_PREFIX "received unknown IPC msg type: %u", msg_code);
-        }
-
-        if (msg_code != IPC_MSG_RESP) {
-            free(msg_data);
-        }
+        ipc_run_callback(conn->vmid, msg_code, msg_data, msg_seq);
     } while (size > 0);
 
     return 0;
@@ -295,6 +302,7 @@ static noreturn void ipc_worker_main(void) {
             cur_thread->libos_tcb->tp = NULL;
             put_thread(cur_thread);
 
+            destroy_slab_thread_cache();
             PalThreadExit(&g_clear_on_worker_exit);
             /* Unreachable. */
         }
@@ -405,6 +413,11 @@ static int create_ipc_worker(void) {
 }
 
 int init_ipc_worker(void) {
+    /* Ring workers (and the doorbell) must be ready before the IPC worker accepts connections. */
+    int ret = init_ipc_ring_workers();
+    if (ret < 0) {
+        return ret;
+    }
     return create_ipc_worker();
 }
 
@@ -419,4 +432,6 @@ void terminate_ipc_worker(void) {
     g_worker_thread = NULL;
     PalObjectDestroy(g_self_ipc_handle);
     g_self_ipc_handle = NULL;
+
+    terminate_ipc_ring_workers();
 }
@@ -149,6 +149,7 @@ static int libos_async_worker(void* arg) {
 
     if (notme) {
         put_thread(self);
+        destroy_slab_thread_cache();
         PalThreadExit(/*clear_child_tid=*/NULL);
         /* UNREACHABLE */
     }
@@ -355,6 +356,7 @@ static int libos_async_worker(void* arg) {
     free(pals);
     free(pal_events);
 
+    destroy_slab_thread_cache();
     PalThreadExit(/*clear_child_tid=*/NULL);
     /* UNREACHABLE */
 
@@ -24,6 +24,17 @@
 #define CP_MAP_ENTRY_NUM 64
 #define CP_HASH_SIZE     256
 
+/*
+ * Memory of the checkpoint is sent in chunks of up to CP_MEM_CHUNK_PAGES pages. Each chunk starts
+ * with a bitmap of its pages that are not all zeroes, followed by the contents of only these pages
+ * (the bitmap and the runs of consecutive pages are passed to PAL in one `PalStreamBatch()` call,
+ * which gathers them in one host write where possible). Zero pages are not sent at all: the child
+ * allocates memory with `PalVirtualMemoryAlloc()`, which returns zeroed memory.
+ */
+#define CP_MEM_CHUNK_PAGES 64
+typedef uint64_t cp_mem_bitmap_t;
+static_assert(CP_MEM_CHUNK_PAGES == sizeof(cp_mem_bitmap_t) * 8, "wrong size of the page bitmap");
+
 DEFINE_LIST(cp_map_entry);
 struct cp_map_entry {
     LIST_TYPE(cp_map_entry) hlist;
@@ -209,8 +220,99 @@ BEGIN_CP_FUNC(str) {
 }
 END_CP_FUNC_NO_RS(str)
 
+static bool is_zero_mem(const void* addr, size_t size) {
+    const unsigned long* words = addr;
+    size_t words_cnt = size / sizeof(*words);
+    size_t i = 0;
+    /* OR several words at once, so that scanning zero memory (the common case) is cheap */
+    for (; i + 8 <= words_cnt; i += 8) {
+        if (words[i] | words[i + 1] | words[i + 2] | words[i + 3] | words[i + 4] | words[i + 5]
+                | words[i + 6] | words[i + 7])
+            return false;
+    }
+    for (i *= sizeof(*words); i < size; i++) {
+        if (((const char*)addr)[i])
+            return false;
+    }
+    return true;
+}
+
+/* Returns the number of consecutive set bits in `bitmap`, starting from bit `first`. */
+static size_t bitmap_run_len(cp_mem_bitmap_t bitmap, size_t first) {
+    cp_mem_bitmap_t rest = ~(bitmap >> first);
+    return rest ? (size_t)__builtin_ctzl(rest) : CP_MEM_CHUNK_PAGES - first;
+}
+
+static int send_mem_chunk(PAL_HANDLE stream, char* addr, size_t size, size_t* out_sent) {
+    size_t page_size = ALLOC_ALIGNMENT;
+    size_t pages_cnt = UDIV_ROUND_UP(size, page_size);
+    assert(pages_cnt <= CP_MEM_CHUNK_PAGES);
+
+    cp_mem_bitmap_t bitmap = 0;
+    for (size_t i = 0; i < pages_cnt; i++) {
+        if (!is_zero_mem(addr + i * page_size, MIN(page_size, size - i * page_size)))
+            bitmap |= (cp_mem_bitmap_t)1 << i;
+    }
+
+    /* the bitmap and at most one run per two pages */
+    struct pal_io_op ops[1 + CP_MEM_CHUNK_PAGES / 2];
+    size_t ops_cnt = 0;
+    ops[ops_cnt++] = (struct pal_io_op){
+        .handle = stream,
+        .type   = PAL_IO_WRITE,
+        .buffer = &bitmap,
+        .size   = sizeof(bitmap),
+    };
+
+    size_t first = 0;
+    while (first < pages_cnt) {
+        if (!(bitmap & ((cp_mem_bitmap_t)1 << first))) {
+            first++;
+            continue;
+        }
+        size_t run = bitmap_run_len(bitmap, first);
+        size_t run_size = MIN(run * page_size, size - first * page_size);
+        assert(ops_cnt < ARRAY_SIZE(ops));
+        ops[ops_cnt++] = (struct pal_io_op){
+            .handle = stream,
+            .type   = PAL_IO_WRITE,
+            .buffer = addr + first * page_size,
+            .size   = run_size,
+        };
+        *out_sent += run_size;
+        first += run;
+    }
+
+    size_t i = 0;
+    while (i < ops_cnt) {
+        size_t done = ops_cnt - i;
+        int ret = PalStreamBatch(&ops[i], &done);
+        if (ret < 0)
+            return pal_to_unix_errno(ret);
+        assert(done > 0);
+
+        /* the batch stops at the first failed or short write; finish it with `write_exact()`, which
+         * also retries interrupted writes */
+        struct pal_io_op* last = &ops[i + done - 1];
+        if (last->result < 0 && last->result != -PAL_ERROR_INTERRUPTED
+                && last->result != -PAL_ERROR_TRYAGAIN)
+            return pal_to_unix_errno(last->result);
+        size_t written = last->result > 0 ? last->result : 0;
+        if (written < last->size) {
+            ret = write_exact(stream, (char*)last->buffer + written, last->size - written);
+            if (ret < 0)
+                return ret;
+        }
+        i += done;
+    }
+    return 0;
+}
+
 static int send_memory_on_stream(PAL_HANDLE stream, struct libos_cp_store* store) {
     int ret = 0;
+    size_t total_size = 0;
+    size_t sent_size = 0;
+    size_t chunk_size = CP_MEM_CHUNK_PAGES * ALLOC_ALIGNMENT;
 
     struct libos_mem_entry* entry = store->first_mem_entry;
     while (entry) {
@@ -231,7 +333,14 @@ static int send_memory_on_stream(PAL_HANDLE stream, struct libos_cp_store* store
             }
         }
 
-        ret = write_exact(stream, mem_addr, mem_size);
+        /* the child restores each chunk as soon as it arrives, while we scan the next one */
+        for (size_t off = 0; off < mem_size; off += chunk_size) {
+            ret = send_mem_chunk(stream, (char*)mem_addr + off, MIN(chunk_size, mem_size - off),
+                                 &sent_size);
+            if (ret < 0)
+                break;
+        }
+        total_size += mem_size;
 
         if (!(mem_prot & PAL_PROT_READ) && mem_size > 0) {
             /* the area was made readable above; revert to original permissions */
@@ -248,6 +357,8 @@ static int send_memory_on_stream(PAL_HANDLE stream, struct libos_cp_store* store
         entry = entry->next;
     }
 
+    log_debug("sent %lu bytes of checkpointed memory (%lu bytes of zero pages skipped)", sent_size,
+              total_size - sent_size);
     return 0;
 }
 
@@ -297,6 +408,42 @@ out:
     return ret;
 }
 
+/* Receives memory sent by `send_mem_chunk()` into zeroed memory at `addr`. */
+static int receive_mem_chunks(PAL_HANDLE handle, char* addr, size_t size) {
+    size_t page_size = ALLOC_ALIGNMENT;
+    size_t chunk_size = CP_MEM_CHUNK_PAGES * page_size;
+
+    for (size_t off = 0; off < size; off += chunk_size) {
+        char* chunk = addr + off;
+        size_t size_left = MIN(chunk_size, size - off);
+        size_t pages_cnt = UDIV_ROUND_UP(size_left, page_size);
+
+        cp_mem_bitmap_t bitmap;
+        int ret = read_exact(handle, &bitmap, sizeof(bitmap));
+        if (ret < 0)
+            return ret;
+        if (pages_cnt < CP_MEM_CHUNK_PAGES && (bitmap >> pages_cnt)) {
+            log_error("invalid page bitmap of checkpointed memory at %p", chunk);
+            return -EINVAL;
+        }
+
+        size_t first = 0;
+        while (first < pages_cnt) {
+            if (!(bitmap & ((cp_mem_bitmap_t)1 << first))) {
+                first++;
+                continue;
+            }
+            size_t run = bitmap_run_len(bitmap, first);
+            ret = read_exact(handle, chunk + first * page_size,
+                             MIN(run * page_size, size_left - first * page_size));
+            if (ret < 0)
+                return ret;
+            first += run;
+        }
+    }
+    return 0;
+}
+
 static int receive_memory_on_stream(PAL_HANDLE handle, struct checkpoint_hdr* hdr, uintptr_t base) {
     int ret;
     ssize_t rebase = base - (uintptr_t)hdr->addr;
@@ -333,7 +480,7 @@ static int receive_memory_on_stream(PAL_HANDLE handle, struct checkpoint_hdr* hd
                 return pal_to_unix_errno(ret);
             }
 
-            ret = read_exact(handle, entry->addr, entry->size);
+            ret = receive_mem_chunks(handle, entry->addr, entry->size);
             if (ret < 0) {
                 return ret;
             }
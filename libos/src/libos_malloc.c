@@ -6,16 +6,20 @@
  * allocator is in common/include/slabmgr.h.
  *
  * When existing slabs are not sufficient, or a large (4k or greater) allocation is requested, it
- * ends up here (__system_alloc and __system_free).
+ * ends up here (__system_malloc and __system_free), which serve it from an arena of big memory
+ * regions and cache freed memory for reuse.
  */
 
 #include "asan.h"
+#include "libos_checkpoint.h"
 #include "libos_internal.h"
 #include "libos_lock.h"
+#include "libos_tcb.h"
 #include "libos_utils.h"
 #include "libos_vma.h"
 #include "linux_abi/memory.h"
 #include "pal.h"
+#include "toml_utils.h"
 
 static struct libos_lock slab_mgr_lock;
 
@@ -26,56 +30,228 @@ static struct libos_lock slab_mgr_lock;
 #define SLAB_CANARY
 #define STARTUP_SIZE 16
 
+/* LibOS TCB may be not yet initialized, in this case allocations go to the global lists */
+#define SLAB_THREAD_CACHE() \
+    (libos_get_tcb() ? &libos_get_tcb()->slab_thread_cache : NULL)
+
 #include "slabmgr.h"
 
 static SLAB_MGR slab_mgr = NULL;
 
-/* Returns NULL on failure */
-void* __system_malloc(size_t size) {
-    size_t alloc_size = ALLOC_ALIGN_UP(size);
+static void* mem_alloc_direct(size_t size) {
     void* addr = NULL;
 
-    int ret = bkeep_mmap_any(alloc_size, PROT_READ | PROT_WRITE,
+    int ret = bkeep_mmap_any(size, PROT_READ | PROT_WRITE,
                              MAP_PRIVATE | MAP_ANONYMOUS | VMA_INTERNAL, NULL, 0, "slab", &addr);
     if (ret < 0) {
         return NULL;
     }
 
-    ret = PalVirtualMemoryAlloc(addr, alloc_size, PAL_PROT_WRITE | PAL_PROT_READ);
+    ret = PalVirtualMemoryAlloc(addr, size, PAL_PROT_WRITE | PAL_PROT_READ);
     if (ret < 0) {
         log_error("failed to allocate memory: %s", pal_strerror(ret));
         void* tmp_vma = NULL;
-        if (bkeep_munmap(addr, alloc_size, /*is_internal=*/true, &tmp_vma) < 0) {
+        if (bkeep_munmap(addr, size, /*is_internal=*/true, &tmp_vma) < 0) {
             BUG();
         }
         bkeep_remove_tmp_vma(tmp_vma);
         return NULL;
     }
 
-#ifdef ASAN
-    asan_poison_region((uintptr_t)addr, alloc_size, ASAN_POISON_HEAP_LEFT_REDZONE);
-#endif
     return addr;
 }
 
-void __system_free(void* addr, size_t size) {
+static void mem_free_direct(void* addr, size_t size) {
     void* tmp_vma = NULL;
-    if (bkeep_munmap(addr, ALLOC_ALIGN_UP(size), /*is_internal=*/true, &tmp_vma) < 0) {
+    if (bkeep_munmap(addr, size, /*is_internal=*/true, &tmp_vma) < 0) {
         BUG();
     }
-    if (PalVirtualMemoryFree(addr, ALLOC_ALIGN_UP(size)) < 0) {
+    if (PalVirtualMemoryFree(addr, size) < 0) {
         BUG();
     }
+    bkeep_remove_tmp_vma(tmp_vma);
+}
+
+/*
+ * Arena for memory requested by the slab allocator (slab areas and objects too big for any slab
+ * level). Allocating each such chunk directly would take `vma_tree_lock` in `bkeep_mmap_any()` and
+ * call `PalVirtualMemoryAlloc()` (which under SGX EDMM accepts each page), and freeing it would do
+ * the same in reverse. Instead, the arena books big regions of address space once, carves chunks
+ * out of them (committing only the carved memory) and keeps freed chunks committed on free lists
+ * indexed by size, so that later allocations of a similar size can reuse them. Freed chunks are
+ * returned to the host only when the cached memory would exceed `g_arena_cache_max_size`
+ * (`libos.internal_memory_cache_size` in the manifest).
+ *
+ * Chunks on free lists are never coalesced; a request that cannot be served from its own list
+ * splits the smallest bigger free chunk. Chunks bigger than ARENA_MAX_CHUNK_UNITS allocation units
+ * are always allocated and freed directly.
+ */
+#define ARENA_REGION_SIZE             (4 * 1024 * 1024)
+#define ARENA_MAX_CHUNK_UNITS         256
+#define DEFAULT_ARENA_CACHE_MAX_SIZE  (8 * 1024 * 1024)
+
+struct arena_chunk {
+    struct arena_chunk* next;
+};
+
+static struct libos_lock g_arena_lock;
+/* `g_arena_free_chunks[i]` holds free (but committed) chunks of `i` allocation units */
+static struct arena_chunk* g_arena_free_chunks[ARENA_MAX_CHUNK_UNITS + 1];
+static size_t g_arena_cached_size = 0;
+static size_t g_arena_cache_max_size = 0;
+/* not yet used part of the current region (booked, but not committed) */
+static char* g_arena_region_cur = NULL;
+static char* g_arena_region_end = NULL;
+
+static size_t size_to_arena_units(size_t size) {
+    size_t units = size / ALLOC_ALIGNMENT;
+    return units <= ARENA_MAX_CHUNK_UNITS ? units : 0;
+}
+
+__attribute_no_sanitize_address
+static void arena_push_chunk(void* addr, size_t size) {
+    assert(locked(&g_arena_lock));
+    struct arena_chunk* chunk = addr;
+    size_t units = size_to_arena_units(size);
+    assert(units);
+
+    chunk->next = g_arena_free_chunks[units];
+    g_arena_free_chunks[units] = chunk;
+    g_arena_cached_size += size;
+}
+
+__attribute_no_sanitize_address
+static void* arena_pop_chunk(size_t units) {
+    assert(locked(&g_arena_lock));
+    struct arena_chunk* chunk = g_arena_free_chunks[units];
+    if (chunk) {
+        g_arena_free_chunks[units] = chunk->next;
+        g_arena_cached_size -= units * ALLOC_ALIGNMENT;
+    }
+    return chunk;
+}
+
+/* Carves a chunk out of the current region, booking a new region if needed. */
+static void* arena_carve_chunk(size_t size) {
+    assert(locked(&g_arena_lock));
+
+    if ((size_t)(g_arena_region_end - g_arena_region_cur) < size) {
+        /* Early LibOS init code can allocate only from a small address range (see
+         * `bkeep_mmap_any()`), don't waste it on a whole region. */
+        if (!g_received_user_memory)
+            return NULL;
+
+        void* region = NULL;
+        int ret = bkeep_mmap_any(ARENA_REGION_SIZE, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | VMA_INTERNAL, NULL, 0, "slab",
+                                 &region);
+        if (ret < 0)
+            return NULL;
+
+        /* the rest of the old region was never committed, so only drop its bookkeeping */
+        if (g_arena_region_cur != g_arena_region_end) {
+            void* tmp_vma = NULL;
+            if (bkeep_munmap(g_arena_region_cur, g_arena_region_end - g_arena_region_cur,
+                             /*is_internal=*/true, &tmp_vma) < 0) {
+                BUG();
+            }
+            bkeep_remove_tmp_vma(tmp_vma);
+        }
+        g_arena_region_cur = region;
+        g_arena_region_end = (char*)region + ARENA_REGION_SIZE;
+    }
+
+    void* addr = g_arena_region_cur;
+    int ret = PalVirtualMemoryAlloc(addr, size, PAL_PROT_WRITE | PAL_PROT_READ);
+    if (ret < 0) {
+        log_error("failed to allocate memory: %s", pal_strerror(ret));
+        return NULL;
+    }
+    g_arena_region_cur += size;
+    return addr;
+}
+
+/* Returns NULL if the chunk should be allocated directly. */
+static void* arena_alloc(size_t size) {
+    size_t units = size_to_arena_units(size);
+    if (!units)
+        return NULL;
+
+    lock(&g_arena_lock);
+    void* addr = arena_pop_chunk(units);
+    if (!addr) {
+        for (size_t i = units + 1; i <= ARENA_MAX_CHUNK_UNITS; i++) {
+            addr = arena_pop_chunk(i);
+            if (addr) {
+                arena_push_chunk((char*)addr + size, (i - units) * ALLOC_ALIGNMENT);
+                break;
+            }
+        }
+    }
+    if (!addr)
+        addr = arena_carve_chunk(size);
+    unlock(&g_arena_lock);
+    return addr;
+}
+
+/* Returns false if the chunk must be freed directly. */
+static bool arena_free(void* addr, size_t size) {
+    if (!size_to_arena_units(size))
+        return false;
+
+    lock(&g_arena_lock);
+    bool cached = g_arena_cached_size + size <= g_arena_cache_max_size;
+    if (cached)
+        arena_push_chunk(addr, size);
+    unlock(&g_arena_lock);
+    return cached;
+}
+
+/* Returns NULL on failure */
+void* __system_malloc(size_t size) {
+    size_t alloc_size = ALLOC_ALIGN_UP(size);
+
+    void* addr = arena_alloc(alloc_size);
+    if (!addr) {
+        addr = mem_alloc_direct(alloc_size);
+        if (!addr)
+            return NULL;
+    }
+
 #ifdef ASAN
-    asan_unpoison_region((uintptr_t)addr, ALLOC_ALIGN_UP(size));
+    asan_poison_region((uintptr_t)addr, alloc_size, ASAN_POISON_HEAP_LEFT_REDZONE);
 #endif
-    bkeep_remove_tmp_vma(tmp_vma);
+    return addr;
+}
+
+void __system_free(void* addr, size_t size) {
+    size_t alloc_size = ALLOC_ALIGN_UP(size);
+
+#ifdef ASAN
+    /* poison before putting the chunk on a free list, where another thread may grab it */
+    asan_poison_region((uintptr_t)addr, alloc_size, ASAN_POISON_HEAP_LEFT_REDZONE);
+#endif
+    if (arena_free(addr, alloc_size))
+        return;
+
+#ifdef ASAN
+    asan_unpoison_region((uintptr_t)addr, alloc_size);
+#endif
+    mem_free_direct(addr, alloc_size);
 }
 
 int init_slab(void) {
-    if (!create_lock(&slab_mgr_lock)) {
+    if (!create_lock(&slab_mgr_lock) || !create_lock(&g_arena_lock)) {
         return -ENOMEM;
     }
+
+    assert(g_manifest_root);
+    int ret = toml_sizestring_in(g_manifest_root, "libos.internal_memory_cache_size",
+                                 DEFAULT_ARENA_CACHE_MAX_SIZE, &g_arena_cache_max_size);
+    if (ret < 0) {
+        log_error("Cannot parse 'libos.internal_memory_cache_size'");
+        return -EINVAL;
+    }
     slab_mgr = create_slab_mgr();
     if (!slab_mgr) {
         return -ENOMEM;
@@ -83,6 +259,10 @@ int init_slab(void) {
     return 0;
 }
 
+void destroy_slab_thread_cache(void) {
+    slab_thread_cache_destroy(slab_mgr);
+}
+
 void* malloc(size_t size) {
     void* mem = slab_alloc(slab_mgr, size);
 
@@ -872,7 +872,7 @@ static bool need_interp(struct link_map* exec_map) {
 extern const char** g_library_paths;
 
 static int find_interp(const char* interp_name, struct libos_dentry** out_dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     size_t interp_name_len = strlen(interp_name);
     const char* filename = interp_name;
@@ -910,7 +910,7 @@ static int find_interp(const char* interp_name, struct libos_dentry** out_dent)
 }
 
 static int find_and_open_interp(const char* interp_name, struct libos_handle* hdl) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
 
     struct libos_dentry* dent;
     int ret = find_interp(interp_name, &dent);
@@ -929,9 +929,9 @@ static int load_interp_object(struct link_map* exec_map) {
     if (!hdl)
         return -ENOMEM;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     int ret = find_and_open_interp(exec_map->l_interp_libname, hdl);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (ret < 0)
         goto out;
 
@@ -974,29 +974,52 @@ static int vdso_map_init(void) {
      * In host child process, LibOS may or may not be loaded at the same address.
      * When LibOS is loaded at different address, it may overlap with the old vDSO
      * area.
+     *
+     * The vDSO image is preceded by the time page (see `struct libos_vdso_time`), which the vDSO
+     * reads at a fixed offset from its own code. LibOS writes to the time page, so it is an
+     * internal VMA which the app cannot unmap or remap.
      */
-    void* addr = NULL;
-    int ret = bkeep_mmap_any_aslr(ALLOC_ALIGN_UP(vdso_so_size), PROT_READ | PROT_EXEC,
+    size_t time_size = ALLOC_ALIGN_UP(VDSO_TIME_PAGE_OFFSET);
+    size_t vdso_size = ALLOC_ALIGN_UP(vdso_so_size);
+
+    void* time_addr = NULL;
+    int ret = bkeep_mmap_any_aslr(time_size + vdso_size, PROT_READ | PROT_EXEC,
                                   MAP_PRIVATE | MAP_ANONYMOUS, NULL, 0, LINUX_VDSO_FILENAME,
-                                  &addr);
+                                  &time_addr);
+    if (ret < 0) {
+        return ret;
+    }
+    void* addr = time_addr + time_size;
+
+    void* tmp_vma = NULL;
+    ret = bkeep_munmap(time_addr, time_size, /*is_internal=*/false, &tmp_vma);
     if (ret < 0) {
         return ret;
     }
+    ret = bkeep_mmap_fixed(time_addr, time_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | VMA_INTERNAL, NULL, 0,
+                           "[vvar]");
+    if (ret < 0) {
+        bkeep_remove_tmp_vma(tmp_vma);
+        return ret;
+    }
 
-    ret = PalVirtualMemoryAlloc(addr, ALLOC_ALIGN_UP(vdso_so_size), PAL_PROT_READ | PAL_PROT_WRITE);
+    ret = PalVirtualMemoryAlloc(time_addr, time_size + vdso_size,
+                                PAL_PROT_READ | PAL_PROT_WRITE);
     if (ret < 0) {
         return pal_to_unix_errno(ret);
     }
 
     memcpy(addr, &vdso_so, vdso_so_size);
-    memset(addr + vdso_so_size, 0, ALLOC_ALIGN_UP(vdso_so_size) - vdso_so_size);
+    memset(addr + vdso_so_size, 0, vdso_size - vdso_so_size);
 
-    ret = PalVirtualMemoryProtect(addr, ALLOC_ALIGN_UP(vdso_so_size),
-                                  PAL_PROT_READ | PAL_PROT_EXEC);
+    ret = PalVirtualMemoryProtect(addr, vdso_size, PAL_PROT_READ | PAL_PROT_EXEC);
     if (ret < 0) {
         return pal_to_unix_errno(ret);
     }
 
+    init_vdso_time(addr - VDSO_TIME_PAGE_OFFSET);
+
     append_r_debug("file:[vdso_libos]", addr);
     g_vdso_addr = addr;
     return 0;
@@ -27,17 +27,23 @@ long libos_syscall_faccessat(int dfd, const char* filename, mode_t mode) {
     if (*filename != '/' && (ret = get_dirfd_dentry(dfd, &dir)) < 0)
         return ret;
 
-    lock(&g_dcache_lock);
-
-    ret = path_lookupat(dir, filename, LOOKUP_FOLLOW, &dent);
-    if (ret < 0)
+    /* Most paths are already in the dentry cache: first try to resolve them with `g_dcache_lock`
+     * held only for reading, so that concurrent calls do not serialize. */
+    rwlock_read_lock(&g_dcache_lock);
+    ret = path_lookupat_cached(dir, filename, LOOKUP_FOLLOW, &dent);
+    if (ret == 0)
+        ret = check_permissions(dent, mode);
+    rwlock_read_unlock(&g_dcache_lock);
+    if (dent || ret != -EAGAIN)
         goto out;
 
-    ret = check_permissions(dent, mode);
+    rwlock_write_lock(&g_dcache_lock);
+    ret = path_lookupat(dir, filename, LOOKUP_FOLLOW, &dent);
+    if (ret == 0)
+        ret = check_permissions(dent, mode);
+    rwlock_write_unlock(&g_dcache_lock);
 
 out:
-    unlock(&g_dcache_lock);
-
     if (dir)
         put_dentry(dir);
     if (dent) {
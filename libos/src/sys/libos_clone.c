@@ -98,6 +98,7 @@ static BEGIN_MIGRATION_DEF(fork, struct libos_process* process_description,
     DEFINE_MIGRATE(dentry_root, NULL, 0);
     DEFINE_MIGRATE(all_mounts, NULL, 0);
     DEFINE_MIGRATE(all_vmas, NULL, 0);
+    DEFINE_MIGRATE(vdso_time, NULL, 0);
     DEFINE_MIGRATE(process_description, process_description, sizeof(*process_description));
     DEFINE_MIGRATE(thread, thread_description, sizeof(*thread_description));
     DEFINE_MIGRATE(migratable, NULL, 0);
@@ -118,9 +119,9 @@ static int migrate_fork(struct libos_cp_store* store, struct libos_process* proc
     /* Take `g_dcache_lock` for the whole checkpointing operation, so that we can access data from
      * dentries. We recursively checkpoint various connected structures, so it's not practical to
      * take the lock just for some part of this operation. */
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     int ret = START_MIGRATE(store, fork, process_description, thread_description, process_ipc_ids);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     return ret;
 }
 
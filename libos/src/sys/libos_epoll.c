@@ -38,6 +38,9 @@
 /* This bit is currently unoccupied in epoll events mask. */
 #define EPOLL_NEEDS_REARM ((uint32_t)(1u << 24))
 
+/* Maximal number of events taken from the PAL event set by one wait. */
+#define EPOLL_SET_MAX_EVENTS 64
+
 /*
  * The following diagram could help you understand relationships between different structs used in
  * this code.
@@ -69,10 +72,25 @@
                                          +--------------------+    +----------------------------+
 */
 
+/*
+ * Event set: polling all items of an epoll instance on each `epoll_wait` is O(n), which is a problem
+ * for apps with many idle connections. Therefore level-triggered items of IP sockets are kept in
+ * a PAL event set instead (a host epoll in practice), which is waited on in O(ready), and only the
+ * remaining items (eventfds, pipes, UNIX sockets, `EPOLLET` and `EPOLLONESHOT` items, and items that
+ * would duplicate a handle already in the set) are polled with `PalStreamsWaitEvents()` as before.
+ *
+ * Changes of set items are not sent to PAL right away, but queued in `set_dirty` (in order, at most
+ * once per item) and passed to the next `PalEventSetWait()` call together with the wait. To keep
+ * the updates ordered, at most one call carrying updates is in flight (`set_busy`); removals are
+ * flushed eagerly, so that closed sockets do not linger. The cookie of a set item is the item
+ * pointer itself: removed items which were ever in the set are moved to `set_zombies` and freed
+ * only once no `PalEventSetWait()` call is in flight (`set_waiters`), so that a stale event never
+ * points to freed memory. `in_set` tells whether events reported by the set are still relevant.
+ */
 DEFINE_LIST(libos_epoll_item);
 struct libos_epoll_item {
     /* Guarded by `epoll_handle->info.epoll.lock`. */
-    LIST_TYPE(libos_epoll_item) epoll_list; // epoll_handle->items
+    LIST_TYPE(libos_epoll_item) epoll_list; // epoll_handle->items or epoll_handle->set_items
     /* Guarded by `handle->lock`. */
     LIST_TYPE(libos_epoll_item) handle_list; // handle->epoll_items
     /* `epoll_handle`, `handle` and `fd` are constant and thus require no locking. */
@@ -82,6 +100,12 @@ struct libos_epoll_item {
     /* `events` and `data` are guarded by `epoll_handle->info.epoll.lock`. */
     uint32_t events;
     uint64_t data;
+    /* Event set state, guarded by `epoll_handle->info.epoll.lock`. */
+    LIST_TYPE(libos_epoll_item) set_list; // epoll_handle->set_dirty or epoll_handle->set_zombies
+    bool in_set;      /* item is on `set_items` */
+    bool set_applied; /* item's handle is registered in the event set (maybe by an in-flight call) */
+    bool set_queued;  /* item is on `set_dirty` */
+    bool set_seen;    /* item's handle was ever registered in the event set */
     refcount_t ref_count;
 };
 
@@ -113,6 +137,171 @@ static void put_epoll_items_array(struct libos_epoll_item** items, size_t items_
     }
 }
 
+static PAL_HANDLE epoll_item_pal_handle(struct libos_epoll_item* item) {
+    PAL_HANDLE pal_handle = item->handle->pal_handle;
+    if (item->handle->type == TYPE_SOCK) {
+        pal_handle = __atomic_load_n(&item->handle->info.sock.pal_handle, __ATOMIC_ACQUIRE);
+    }
+    return pal_handle;
+}
+
+static pal_wait_flags_t epoll_to_pal_wait_flags(uint32_t events) {
+    pal_wait_flags_t pal_events = 0;
+    if (events & (EPOLLIN | EPOLLRDNORM)) {
+        pal_events |= PAL_WAIT_READ;
+    }
+    if (events & (EPOLLOUT | EPOLLWRNORM)) {
+        pal_events |= PAL_WAIT_WRITE;
+    }
+    return pal_events;
+}
+
+/* Translates events detected by PAL on `item` into epoll events requested for this item. */
+static uint32_t epoll_item_ready_events(struct libos_epoll_item* item,
+                                        pal_wait_flags_t pal_events) {
+    uint32_t events = 0;
+    if (pal_events & PAL_WAIT_ERROR) {
+        events |= EPOLLERR;
+    }
+    if (pal_events & PAL_WAIT_HANG_UP) {
+        events |= EPOLLHUP;
+        /* add RDHUP event only if user requested for it to be reported */
+        events |= item->events & EPOLLRDHUP;
+    }
+    if (pal_events & PAL_WAIT_READ) {
+        events |= item->events & (EPOLLIN | EPOLLRDNORM);
+    }
+    if (pal_events & PAL_WAIT_WRITE) {
+        events |= item->events & (EPOLLOUT | EPOLLWRNORM);
+    }
+
+    if (item->handle->type == TYPE_SOCK && (pal_events & (PAL_WAIT_READ | PAL_WAIT_WRITE))) {
+        bool error_event = !!(pal_events & (PAL_WAIT_ERROR | PAL_WAIT_HANG_UP));
+        check_connect_inprogress_on_poll(item->handle, error_event);
+    }
+    return events;
+}
+
+static bool _epoll_item_fits_set(struct libos_epoll_handle* epoll, struct libos_epoll_item* item) {
+    assert(locked(&epoll->lock));
+
+    if (!epoll->event_set || (item->events & (EPOLLET | EPOLLONESHOT))) {
+        return false;
+    }
+    struct libos_handle* handle = item->handle;
+    if (handle->type != TYPE_SOCK
+            || (handle->info.sock.domain != AF_INET && handle->info.sock.domain != AF_INET6)) {
+        return false;
+    }
+    /* IP sockets get their PAL handle on creation, but be defensive. */
+    return __atomic_load_n(&handle->info.sock.pal_handle, __ATOMIC_ACQUIRE) != NULL;
+}
+
+static void _queue_set_update(struct libos_epoll_handle* epoll, struct libos_epoll_item* item) {
+    assert(locked(&epoll->lock));
+
+    if (!item->set_queued) {
+        get_epoll_item(item);
+        LISTP_ADD_TAIL(item, &epoll->set_dirty, set_list);
+        epoll->set_dirty_count++;
+        item->set_queued = true;
+    }
+}
+
+/* Takes all queued event set updates. The caller must pass them to `PalEventSetWait()` before any
+ * other updates are taken, i.e. either with `epoll->lock` held or with `epoll->set_busy` set. */
+static int _take_set_updates(struct libos_epoll_handle* epoll,
+                             struct pal_event_set_update** out_updates, size_t* out_count) {
+    assert(locked(&epoll->lock));
+    assert(!epoll->set_busy);
+
+    struct pal_event_set_update* updates = malloc(epoll->set_dirty_count * sizeof(*updates));
+    if (!updates) {
+        return -ENOMEM;
+    }
+
+    size_t count = 0;
+    struct libos_epoll_item* item;
+    struct libos_epoll_item* tmp;
+    LISTP_FOR_EACH_ENTRY_SAFE(item, tmp, &epoll->set_dirty, set_list) {
+        LISTP_DEL_INIT(item, &epoll->set_dirty, set_list);
+        item->set_queued = false;
+
+        /* Since we have a reference to `item` (either on `epoll->items` or on `set_zombies`), its
+         * PAL handle stays valid until the update is applied. */
+        if (item->in_set) {
+            updates[count++] = (struct pal_event_set_update){
+                .op = item->set_applied ? PAL_EVENT_SET_MODIFY : PAL_EVENT_SET_ADD,
+                .handle = epoll_item_pal_handle(item),
+                .events = epoll_to_pal_wait_flags(item->events),
+                .cookie = (uint64_t)item,
+            };
+            item->set_applied = true;
+            item->set_seen = true;
+        } else if (item->set_applied) {
+            updates[count++] = (struct pal_event_set_update){
+                .op = PAL_EVENT_SET_DELETE,
+                .handle = epoll_item_pal_handle(item),
+            };
+            item->set_applied = false;
+        }
+
+        if (LIST_EMPTY(item, epoll_list)) {
+            /* Removed from this epoll: keep it until no wait can report it. */
+            LISTP_ADD_TAIL(item, &epoll->set_zombies, set_list);
+        } else {
+            put_epoll_item(item);
+        }
+    }
+    epoll->set_dirty_count = 0;
+
+    *out_updates = updates;
+    *out_count = count;
+    return 0;
+}
+
+static void _release_set_zombies(struct libos_epoll_handle* epoll) {
+    assert(locked(&epoll->lock));
+
+    if (epoll->set_waiters) {
+        return;
+    }
+
+    struct libos_epoll_item* item;
+    struct libos_epoll_item* tmp;
+    LISTP_FOR_EACH_ENTRY_SAFE(item, tmp, &epoll->set_zombies, set_list) {
+        LISTP_DEL_INIT(item, &epoll->set_zombies, set_list);
+        put_epoll_item(item);
+    }
+}
+
+/* Applies queued event set updates right away, unless another call carrying updates is in flight
+ * (then they are picked up by the next wait). */
+static void _flush_set_updates(struct libos_epoll_handle* epoll) {
+    assert(locked(&epoll->lock));
+
+    if (!epoll->set_busy && !LISTP_EMPTY(&epoll->set_dirty)) {
+        struct pal_event_set_update* updates;
+        size_t count;
+        if (_take_set_updates(epoll, &updates, &count) == 0) {
+            if (count) {
+                size_t set_events_count = 0;
+                int ret = PalEventSetWait(epoll->event_set, updates, count, /*count=*/0,
+                                          /*handle_array=*/NULL, /*events=*/NULL,
+                                          /*ret_events=*/NULL, /*set_events=*/NULL,
+                                          &set_events_count, /*timeout_us=*/NULL);
+                if (ret < 0) {
+                    log_warning("epoll: updating the event set failed: %s", pal_strerror(ret));
+                }
+            }
+            free(updates);
+        }
+        /* On failure the updates stay queued and are retried later. */
+    }
+
+    _release_set_zombies(epoll);
+}
+
 static void _interrupt_epoll_waiters(struct libos_epoll_handle* epoll) {
     assert(locked(&epoll->lock));
 
@@ -222,12 +411,43 @@ static void _unlink_epoll_item(struct libos_epoll_item* item) {
     unlock(&handle->lock);
 
     if (!LIST_EMPTY(item, epoll_list)) {
-        LISTP_DEL_INIT(item, &epoll->items, epoll_list);
-        epoll->items_count--;
+        if (item->in_set) {
+            LISTP_DEL_INIT(item, &epoll->set_items, epoll_list);
+            epoll->set_items_count--;
+            item->in_set = false;
+        } else {
+            LISTP_DEL_INIT(item, &epoll->items, epoll_list);
+            epoll->items_count--;
+        }
+        if (item->set_seen || item->set_queued) {
+            /* Remove it from the event set eagerly, so that its handle is not kept open. */
+            _queue_set_update(epoll, item);
+            _flush_set_updates(epoll);
+        }
         put_epoll_item(item);
     }
 }
 
+/* Returns a borrowed reference, valid as long as `epoll_handle->info.epoll.lock` is held. */
+static struct libos_epoll_item* _find_epoll_item(struct libos_handle* epoll_handle,
+                                                 struct libos_handle* handle, int fd) {
+    assert(locked(&epoll_handle->info.epoll.lock));
+
+    /* Look the item up through the handle, which is rarely part of more than one or two epolls
+     * (unlike the epoll, which can have thousands of items). */
+    struct libos_epoll_item* ret = NULL;
+    lock(&handle->lock);
+    struct libos_epoll_item* item;
+    LISTP_FOR_EACH_ENTRY(item, &handle->epoll_items, handle_list) {
+        if (item->epoll_handle == epoll_handle && item->fd == fd) {
+            ret = item;
+            break;
+        }
+    }
+    unlock(&handle->lock);
+    return ret;
+}
+
 void delete_epoll_items_for_fd(int fd, struct libos_handle* handle) {
     /* This looks scary, but in practice shouldn't be that bad - `fd` is rarely registered on
      * multiple epolls and even if it is, there shouldn't be many of them. */
@@ -276,10 +496,21 @@ long libos_syscall_epoll_create1(int flags) {
     INIT_LISTP(&epoll->items);
     epoll->items_count = 0;
     epoll->last_returned_index = -1;
+    INIT_LISTP(&epoll->set_items);
+    epoll->set_items_count = 0;
+    INIT_LISTP(&epoll->set_dirty);
+    epoll->set_dirty_count = 0;
+    INIT_LISTP(&epoll->set_zombies);
+    epoll->set_waiters = 0;
+    epoll->set_busy = false;
     if (!create_lock(&epoll->lock)) {
         put_handle(handle);
         return -ENOMEM;
     }
+    /* Not all PALs support event sets, all items are then polled with `PalStreamsWaitEvents()`. */
+    if (PalEventSetCreate(&epoll->event_set) < 0) {
+        epoll->event_set = NULL;
+    }
 
     int ret = set_new_fd_handle(handle, (flags & EPOLL_CLOEXEC) ? FD_CLOEXEC : 0,
                                 /*handle_map=*/NULL);
@@ -327,6 +558,11 @@ static int do_epoll_add(struct libos_handle* epoll_handle, struct libos_handle*
     get_handle(epoll_handle);
     new_item->data = event->data;
     new_item->events = event->events & ~EPOLL_NEEDS_REARM;
+    INIT_LIST_HEAD(new_item, set_list);
+    new_item->in_set = false;
+    new_item->set_applied = false;
+    new_item->set_queued = false;
+    new_item->set_seen = false;
     refcount_set(&new_item->ref_count, 1);
 
     if (!(handle->acc_mode & MAY_READ)) {
@@ -340,24 +576,39 @@ static int do_epoll_add(struct libos_handle* epoll_handle, struct libos_handle*
 
     lock(&epoll->lock);
 
+    /* See `_find_epoll_item()`. Additionally check whether the handle is already in the event set
+     * (via a duplicated fd): the host can monitor it only once. */
+    bool handle_in_set = false;
+    lock(&handle->lock);
     struct libos_epoll_item* item;
-    LISTP_FOR_EACH_ENTRY(item, &epoll->items, epoll_list) {
-        if (item->fd == fd && item->handle == handle) {
+    LISTP_FOR_EACH_ENTRY(item, &handle->epoll_items, handle_list) {
+        if (item->epoll_handle != epoll_handle) {
+            continue;
+        }
+        if (item->fd == fd) {
+            unlock(&handle->lock);
             ret = -EEXIST;
             goto out_unlock;
         }
+        handle_in_set |= item->in_set;
     }
 
-    LISTP_ADD_TAIL(new_item, &epoll->items, epoll_list);
-    get_epoll_item(new_item);
-    epoll->items_count++;
-
-    lock(&handle->lock);
     LISTP_ADD_TAIL(new_item, &handle->epoll_items, handle_list);
     get_epoll_item(new_item);
     handle->epoll_items_count++;
     unlock(&handle->lock);
 
+    if (!handle_in_set && _epoll_item_fits_set(epoll, new_item)) {
+        LISTP_ADD_TAIL(new_item, &epoll->set_items, epoll_list);
+        epoll->set_items_count++;
+        new_item->in_set = true;
+        _queue_set_update(epoll, new_item);
+    } else {
+        LISTP_ADD_TAIL(new_item, &epoll->items, epoll_list);
+        epoll->items_count++;
+    }
+    get_epoll_item(new_item);
+
     if (new_item->events & EPOLLET) {
         __atomic_store_n(&handle->needs_et_poll_in, true, __ATOMIC_RELEASE);
         __atomic_store_n(&handle->needs_et_poll_out, true, __ATOMIC_RELEASE);
@@ -385,29 +636,39 @@ static int do_epoll_mod(struct libos_handle* epoll_handle, struct libos_handle*
 
     lock(&epoll->lock);
 
-    struct libos_epoll_item* item;
-    LISTP_FOR_EACH_ENTRY(item, &epoll->items, epoll_list) {
-        if (item->fd == fd && item->handle == handle) {
-            if (item->events & EPOLLEXCLUSIVE) {
-                ret = -EINVAL;
-                goto out_unlock;
-            }
+    struct libos_epoll_item* item = _find_epoll_item(epoll_handle, handle, fd);
+    if (!item) {
+        goto out_unlock;
+    }
+    if (item->events & EPOLLEXCLUSIVE) {
+        ret = -EINVAL;
+        goto out_unlock;
+    }
 
-            item->events = event->events & ~EPOLL_NEEDS_REARM;
-            item->data = event->data;
+    item->events = event->events & ~EPOLL_NEEDS_REARM;
+    item->data = event->data;
+
+    if (item->in_set) {
+        if (!_epoll_item_fits_set(epoll, item)) {
+            /* E.g. changed to `EPOLLET`, which the event set does not emulate. */
+            LISTP_DEL_INIT(item, &epoll->set_items, epoll_list);
+            epoll->set_items_count--;
+            LISTP_ADD_TAIL(item, &epoll->items, epoll_list);
+            epoll->items_count++;
+            item->in_set = false;
+        }
+        _queue_set_update(epoll, item);
+    }
 
-            if (item->events & EPOLLET) {
-                __atomic_store_n(&handle->needs_et_poll_in, true, __ATOMIC_RELEASE);
-                __atomic_store_n(&handle->needs_et_poll_out, true, __ATOMIC_RELEASE);
-            }
+    if (item->events & EPOLLET) {
+        __atomic_store_n(&handle->needs_et_poll_in, true, __ATOMIC_RELEASE);
+        __atomic_store_n(&handle->needs_et_poll_out, true, __ATOMIC_RELEASE);
+    }
 
-            _interrupt_epoll_waiters(epoll);
+    _interrupt_epoll_waiters(epoll);
 
-            log_debug("epoll: modified %d (%p) on epoll handle %p", fd, handle, epoll_handle);
-            ret = 0;
-            break;
-        }
-    }
+    log_debug("epoll: modified %d (%p) on epoll handle %p", fd, handle, epoll_handle);
+    ret = 0;
 
 out_unlock:
     unlock(&epoll->lock);
@@ -420,20 +681,17 @@ static int do_epoll_del(struct libos_handle* epoll_handle, struct libos_handle*
 
     lock(&epoll->lock);
 
-    struct libos_epoll_item* item;
-    LISTP_FOR_EACH_ENTRY(item, &epoll->items, epoll_list) {
-        if (item->fd == fd && item->handle == handle) {
-            get_epoll_item(item);
-            _unlink_epoll_item(item);
+    struct libos_epoll_item* item = _find_epoll_item(epoll_handle, handle, fd);
+    if (item) {
+        get_epoll_item(item);
+        _unlink_epoll_item(item);
 
-            _interrupt_epoll_waiters(epoll);
+        _interrupt_epoll_waiters(epoll);
 
-            put_epoll_item(item);
+        put_epoll_item(item);
 
-            log_debug("epoll: deleted %d (%p) from epoll handle %p", fd, handle, epoll_handle);
-            ret = 0;
-            break;
-        }
+        log_debug("epoll: deleted %d (%p) from epoll handle %p", fd, handle, epoll_handle);
+        ret = 0;
     }
 
     unlock(&epoll->lock);
@@ -535,6 +793,10 @@ static int do_epoll_wait(int epfd, struct epoll_event* events, int maxevents, in
         return -ENOMEM;
     }
 
+    /* `epoll->event_set` is set on creation and never changes. */
+    PAL_HANDLE event_set = epoll->event_set;
+    struct pal_event_set_event set_events[EPOLL_SET_MAX_EVENTS];
+
     lock(&epoll->lock);
 
     while (1) {
@@ -560,10 +822,7 @@ static int do_epoll_wait(int epfd, struct epoll_event* events, int maxevents, in
         struct libos_epoll_item* item;
         size_t items_count = 0;
         LISTP_FOR_EACH_ENTRY(item, &epoll->items, epoll_list) {
-            PAL_HANDLE pal_handle = item->handle->pal_handle;
-            if (item->handle->type == TYPE_SOCK) {
-                pal_handle = __atomic_load_n(&item->handle->info.sock.pal_handle, __ATOMIC_ACQUIRE);
-            }
+            PAL_HANDLE pal_handle = epoll_item_pal_handle(item);
             if (!pal_handle) {
                 /* UNIX sockets that are still not connected have no `pal_handle`. */
                 continue;
@@ -581,13 +840,7 @@ static int do_epoll_wait(int epfd, struct epoll_event* events, int maxevents, in
              * PAL handle, even after releasing `epoll->lock`. */
             pal_handles[items_count] = pal_handle;
 
-            pal_events[items_count] = 0;
-            if (item->events & (EPOLLIN | EPOLLRDNORM)) {
-                pal_events[items_count] |= PAL_WAIT_READ;
-            }
-            if (item->events & (EPOLLOUT | EPOLLWRNORM)) {
-                pal_events[items_count] |= PAL_WAIT_WRITE;
-            }
+            pal_events[items_count] = epoll_to_pal_wait_flags(item->events);
             if (item->events & EPOLLET) {
                 if (!__atomic_load_n(&item->handle->needs_et_poll_in, __ATOMIC_ACQUIRE)) {
                     pal_events[items_count] &= ~PAL_WAIT_READ;
@@ -606,22 +859,71 @@ static int do_epoll_wait(int epfd, struct epoll_event* events, int maxevents, in
         pal_events[items_count] = PAL_WAIT_READ;
         pal_ret_events[items_count] = 0;
 
+        /* Updates of the event set are passed to the host together with the wait, which saves
+         * a separate host call per `epoll_ctl()`. Only one call may carry updates at a time, so
+         * that the host applies them in order. */
+        struct pal_event_set_update* set_updates = NULL;
+        size_t set_updates_count = 0;
+        size_t set_events_count = 0;
+        bool took_set_updates = false;
+        if (event_set) {
+            if (!epoll->set_busy && !LISTP_EMPTY(&epoll->set_dirty)) {
+                ret = _take_set_updates(epoll, &set_updates, &set_updates_count);
+                if (ret < 0) {
+                    put_epoll_items_array(items, items_count);
+                    goto out_unlock;
+                }
+                epoll->set_busy = true;
+                took_set_updates = true;
+            }
+            epoll->set_waiters++;
+            set_events_count = MIN((size_t)maxevents, ARRAY_SIZE(set_events));
+        }
+
         LISTP_ADD_TAIL(&waiter, &epoll->waiters, list);
 
         unlock(&epoll->lock);
 
         if (!have_pending_signals()) {
-            ret = PalStreamsWaitEvents(items_count + 1, pal_handles, pal_events, pal_ret_events,
-                                       timeout_ms == -1 ? NULL : &timeout_us);
+            if (event_set) {
+                ret = PalEventSetWait(event_set, set_updates, set_updates_count, items_count + 1,
+                                      pal_handles, pal_events, pal_ret_events, set_events,
+                                      &set_events_count, timeout_ms == -1 ? NULL : &timeout_us);
+            } else {
+                ret = PalStreamsWaitEvents(items_count + 1, pal_handles, pal_events,
+                                           pal_ret_events, timeout_ms == -1 ? NULL : &timeout_us);
+            }
             ret = pal_to_unix_errno(ret);
         } else {
+            if (set_updates_count) {
+                /* The updates were already taken, apply them without waiting. */
+                size_t no_events_count = 0;
+                int tmp_ret = PalEventSetWait(event_set, set_updates, set_updates_count,
+                                              /*count=*/0, /*handle_array=*/NULL, /*events=*/NULL,
+                                              /*ret_events=*/NULL, /*set_events=*/NULL,
+                                              &no_events_count, /*timeout_us=*/NULL);
+                if (tmp_ret < 0) {
+                    log_warning("epoll: updating the event set failed: %s",
+                                pal_strerror(tmp_ret));
+                }
+            }
+            set_events_count = 0;
             ret = -EINTR;
         }
+        free(set_updates);
 
         lock(&epoll->lock);
         if (!LIST_EMPTY(&waiter, list)) {
             LISTP_DEL(&waiter, &epoll->waiters, list);
         }
+        if (event_set) {
+            /* Items removed meanwhile stay on `epoll->set_zombies` until `set_events` (which may
+             * refer to them) are processed below. */
+            epoll->set_waiters--;
+            if (took_set_updates) {
+                epoll->set_busy = false;
+            }
+        }
 
         if (ret < 0) {
             if (ret == -EAGAIN) {
@@ -658,28 +960,7 @@ static int do_epoll_wait(int epfd, struct epoll_event* events, int maxevents, in
                 continue;
             }
 
-            uint32_t this_item_events = 0;
-            if (pal_ret_events[i] & PAL_WAIT_ERROR) {
-                this_item_events |= EPOLLERR;
-            }
-            if (pal_ret_events[i] & PAL_WAIT_HANG_UP) {
-                this_item_events |= EPOLLHUP;
-                /* add RDHUP event only if user requested for it to be reported */
-                this_item_events |= items[i]->events & EPOLLRDHUP;
-            }
-            if (pal_ret_events[i] & PAL_WAIT_READ) {
-                this_item_events |= items[i]->events & (EPOLLIN | EPOLLRDNORM);
-            }
-            if (pal_ret_events[i] & PAL_WAIT_WRITE) {
-                this_item_events |= items[i]->events & (EPOLLOUT | EPOLLWRNORM);
-            }
-
-            if (items[i]->handle->type == TYPE_SOCK &&
-                    (pal_ret_events[i] & (PAL_WAIT_READ | PAL_WAIT_WRITE))) {
-                bool error_event = !!(pal_ret_events[i] & (PAL_WAIT_ERROR | PAL_WAIT_HANG_UP));
-                check_connect_inprogress_on_poll(items[i]->handle, error_event);
-            }
-
+            uint32_t this_item_events = epoll_item_ready_events(items[i], pal_ret_events[i]);
             if (!this_item_events) {
                 /* This handle is not interested in events that were detected - epoll item was
                  * probably updated asynchronously. */
@@ -710,12 +991,35 @@ static int do_epoll_wait(int epfd, struct epoll_event* events, int maxevents, in
 
         put_epoll_items_array(items, items_count);
 
+        size_t slow_events_count = ret_events_count;
+        /* The host already spreads events of the event set fairly, no need for round robin. */
+        for (size_t i = 0; i < set_events_count && ret_events_count < (size_t)maxevents; i++) {
+            struct libos_epoll_item* set_item = (struct libos_epoll_item*)set_events[i].cookie;
+            if (!set_item->in_set) {
+                /* Item was removed (or moved to polled items) concurrently; it is still alive on
+                 * `epoll->set_zombies` or `epoll->items`. */
+                continue;
+            }
+
+            uint32_t this_item_events = epoll_item_ready_events(set_item, set_events[i].events);
+            if (!this_item_events) {
+                continue;
+            }
+
+            events[ret_events_count].events = this_item_events;
+            events[ret_events_count].data = set_item->data;
+            ret_events_count++;
+        }
+
         if (ret_events_count) {
-            if (counter == items_count) {
-                /* All items were returned to user app. */
-                epoll->last_returned_index = -1;
-            } else {
-                epoll->last_returned_index = (start_index + counter) % items_count;
+            /* Keep the round robin position if nothing was returned from polled items. */
+            if (slow_events_count) {
+                if (counter == items_count) {
+                    /* All items were returned to user app. */
+                    epoll->last_returned_index = -1;
+                } else {
+                    epoll->last_returned_index = (start_index + counter) % items_count;
+                }
             }
             ret = ret_events_count;
             break;
@@ -724,6 +1028,9 @@ static int do_epoll_wait(int epfd, struct epoll_event* events, int maxevents, in
     }
 
 out_unlock:
+    if (event_set) {
+        _flush_set_updates(epoll);
+    }
     unlock(&epoll->lock);
 
     free(items);
@@ -762,7 +1069,16 @@ static int epoll_close(struct libos_handle* epoll_handle) {
     assert(LISTP_EMPTY(&epoll->waiters));
     assert(LISTP_EMPTY(&epoll->items));
     assert(epoll->items_count == 0);
-
+    assert(LISTP_EMPTY(&epoll->set_items));
+    assert(epoll->set_items_count == 0);
+    /* Queued updates and zombies hold references to their items, which hold references to this
+     * epoll. */
+    assert(LISTP_EMPTY(&epoll->set_dirty));
+    assert(LISTP_EMPTY(&epoll->set_zombies));
+
+    if (epoll->event_set) {
+        PalObjectDestroy(epoll->event_set);
+    }
     destroy_lock(&epoll->lock);
     return 0;
 }
@@ -787,24 +1103,36 @@ BEGIN_CP_FUNC(epoll_items_list) {
     assert(old_handle->type == TYPE_EPOLL && new_handle->type == TYPE_EPOLL);
 
     lock(&old_handle->info.epoll.lock);
-    struct libos_epoll_item* item;
-    LISTP_FOR_EACH_ENTRY(item, &old_handle->info.epoll.items, epoll_list) {
-        size_t off = ADD_CP_OFFSET(sizeof(struct libos_epoll_item));
-        struct libos_epoll_item* new_item = (struct libos_epoll_item*)(base + off);
-
-        new_item->epoll_handle = new_handle;
-        new_item->fd = item->fd;
-        new_item->events = item->events;
-        new_item->data = item->data;
-        refcount_set(&new_item->ref_count, 0);
-
-        LISTP_ADD(new_item, &new_handle->info.epoll.items, epoll_list);
-        new_handle->info.epoll.items_count++;
-
-        DO_CP(handle, item->handle, &new_item->handle);
-
-        LISTP_ADD(new_item, &new_item->handle->epoll_items, handle_list);
-        new_item->handle->epoll_items_count++;
+    /* The child has its own (empty) event set, so all items are polled there. */
+    LISTP_TYPE(libos_epoll_item)* lists[] = {
+        &old_handle->info.epoll.items,
+        &old_handle->info.epoll.set_items,
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(lists); i++) {
+        struct libos_epoll_item* item;
+        LISTP_FOR_EACH_ENTRY(item, lists[i], epoll_list) {
+            size_t off = ADD_CP_OFFSET(sizeof(struct libos_epoll_item));
+            struct libos_epoll_item* new_item = (struct libos_epoll_item*)(base + off);
+
+            new_item->epoll_handle = new_handle;
+            new_item->fd = item->fd;
+            new_item->events = item->events;
+            new_item->data = item->data;
+            INIT_LIST_HEAD(new_item, set_list);
+            new_item->in_set = false;
+            new_item->set_applied = false;
+            new_item->set_queued = false;
+            new_item->set_seen = false;
+            refcount_set(&new_item->ref_count, 0);
+
+            LISTP_ADD(new_item, &new_handle->info.epoll.items, epoll_list);
+            new_handle->info.epoll.items_count++;
+
+            DO_CP(handle, item->handle, &new_item->handle);
+
+            LISTP_ADD(new_item, &new_item->handle->epoll_items, handle_list);
+            new_item->handle->epoll_items_count++;
+        }
     }
     unlock(&old_handle->info.epoll.lock);
 
@@ -6,6 +6,8 @@
  *                    Borys Popławski <borysp@invisiblethingslab.com>
  */
 
+#include "libos_fs.h"
+#include "libos_fs_encrypted.h"
 #include "libos_fs_lock.h"
 #include "libos_handle.h"
 #include "libos_ipc.h"
@@ -55,6 +57,8 @@ static noreturn void libos_clean_and_exit(int exit_code) {
 
     terminate_ipc_worker();
 
+    log_encrypted_files_stats();
+    log_mount_cache_stats();
     log_debug("process %u exited with status %d", g_process_ipc_ids.self_vmid, exit_code);
 
     /* TODO: We exit whole libos, but there are some objects that might need cleanup - we should do
@@ -123,10 +127,12 @@ noreturn void thread_exit(int error_code, int term_signal) {
             /* `cleanup_thread` did not get this reference, clean it. We have to be careful, as
              * this is most likely the last reference and will free this `cur_thread`. */
             put_thread(cur_thread);
+            destroy_slab_thread_cache();
             PalThreadExit(NULL);
             /* UNREACHABLE */
         }
 
+        destroy_slab_thread_cache();
         PalThreadExit(&cur_thread->clear_child_tid_pal);
         /* UNREACHABLE */
     }
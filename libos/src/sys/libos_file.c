@@ -3,7 +3,7 @@
 
 /*
  * Implementation of system calls "unlink", "unlinkat", "mkdir", "mkdirat", "rmdir", "umask",
- * "chmod", "fchmod", "fchmodat", "rename", "renameat" and "sendfile".
+ * "chmod", "fchmod", "fchmodat", "rename", "renameat", "sendfile", "splice" and "copy_file_range".
  */
 
 #include "libos_fs.h"
@@ -18,11 +18,12 @@
 #include "stat.h"
 
 /*
- * Read/write in 64KB chunks in the sendfile() syscall. This syscall also has an optimization of
- * using a statically allocated buffer instead of allocating on the heap (as our internal malloc()
- * has subpar performance). To prevent data races of multiple threads executing sendfile() at the
- * same time and thus potentially corrupting a single static buffer, we optimize for a common case:
- * only the first thread uses the static buffer whereas other threads fall back to a slower heap
+ * Read/write in 64KB chunks in the sendfile() syscall (and in splice() and copy_file_range()) if the
+ * handles cannot be connected directly on the host. This also has an optimization of using
+ * a statically allocated buffer instead of allocating on the heap (as our internal malloc() has
+ * subpar performance). To prevent data races of multiple threads executing sendfile() at the same
+ * time and thus potentially corrupting a single static buffer, we optimize for a common case: only
+ * the first thread uses the static buffer whereas other threads fall back to a slower heap
  * allocation.
  */
 #define BUF_SIZE (64 * 1024)
@@ -49,7 +50,7 @@ long libos_syscall_unlinkat(int dfd, const char* pathname, int flag) {
     if (*pathname != '/' && (ret = get_dirfd_dentry(dfd, &dir)) < 0)
         return ret;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     ret = path_lookupat(dir, pathname, LOOKUP_NO_FOLLOW, &dent);
     if (ret < 0)
         goto out;
@@ -83,7 +84,7 @@ long libos_syscall_unlinkat(int dfd, const char* pathname, int flag) {
     dent->inode = NULL;
     ret = 0;
 out:
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (dir)
         put_dentry(dir);
     if (dent)
@@ -128,7 +129,7 @@ long libos_syscall_rmdir(const char* pathname) {
     if (!is_user_string_readable(pathname))
         return -EFAULT;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     ret = path_lookupat(/*start=*/NULL, pathname, LOOKUP_NO_FOLLOW | LOOKUP_DIRECTORY, &dent);
     if (ret < 0) {
         goto out;
@@ -158,7 +159,7 @@ long libos_syscall_rmdir(const char* pathname) {
     dent->inode = NULL;
     ret = 0;
 out:
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (dent)
         put_dentry(dent);
     return ret;
@@ -190,7 +191,7 @@ long libos_syscall_fchmodat(int dfd, const char* filename, mode_t mode) {
     if (*filename != '/' && (ret = get_dirfd_dentry(dfd, &dir)) < 0)
         return ret;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     ret = path_lookupat(dir, filename, LOOKUP_FOLLOW, &dent);
     if (ret < 0)
         goto out;
@@ -208,7 +209,7 @@ long libos_syscall_fchmodat(int dfd, const char* filename, mode_t mode) {
 out_dent:
     put_dentry(dent);
 out:
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (dir)
         put_dentry(dir);
     return ret;
@@ -263,7 +264,7 @@ long libos_syscall_fchownat(int dfd, const char* filename, uid_t uid, gid_t gid,
     if (*filename != '/' && (ret = get_dirfd_dentry(dfd, &dir)) < 0)
         return ret;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     ret = path_lookupat(dir, filename, LOOKUP_FOLLOW, &dent);
     if (ret < 0)
         goto out;
@@ -275,7 +276,7 @@ long libos_syscall_fchownat(int dfd, const char* filename, uid_t uid, gid_t gid,
 
     put_dentry(dent);
 out:
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (dir)
         put_dentry(dir);
     return ret;
@@ -292,7 +293,7 @@ long libos_syscall_fchown(int fd, uid_t uid, gid_t gid) {
     int ret;
     struct libos_dentry* dent = hdl->dentry;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     if (!dent || !dent->inode) {
         ret = -ENOENT;
         goto out;
@@ -305,13 +306,13 @@ long libos_syscall_fchown(int fd, uid_t uid, gid_t gid) {
 
     ret = 0;
 out:
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     put_handle(hdl);
     return ret;
 }
 
 static int do_rename(struct libos_dentry* old_dent, struct libos_dentry* new_dent) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_write_locked(&g_dcache_lock));
     assert(old_dent->inode);
 
     if ((old_dent->inode->type != S_IFREG) || (new_dent->inode &&
@@ -375,7 +376,7 @@ long libos_syscall_renameat(int olddirfd, const char* oldpath, int newdirfd, con
         return -EFAULT;
     }
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
 
     if (strcmp(oldpath, newpath) == 0) {
         goto out;
@@ -410,7 +411,7 @@ long libos_syscall_renameat(int olddirfd, const char* oldpath, int newdirfd, con
     ret = do_rename(old_dent, new_dent);
 
 out:
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (old_dir_dent)
         put_dentry(old_dir_dent);
     if (old_dent)
@@ -422,15 +423,124 @@ out:
     return ret;
 }
 
-long libos_syscall_sendfile(int out_fd, int in_fd, off_t* offset, size_t count) {
-    long ret;
-    char* buf = NULL;
+/*
+ * Copies up to `count` bytes from `in_hdl` at `*pos_in` to `out_hdl` at `*pos_out` (or at the
+ * position of `out_hdl` if `pos_out` is NULL) and updates the positions. First tries to let the host
+ * copy the data directly (see `splice_from` in `struct libos_fs_ops`), otherwise reads and writes in
+ * BUF_SIZE chunks. Stops at the end of input and after a short write. Returns the number of bytes
+ * copied, or a negative error code if nothing was copied.
+ */
+static ssize_t copy_between_handles(struct libos_handle* in_hdl, file_off_t* pos_in,
+                                    struct libos_handle* out_hdl, file_off_t* pos_out,
+                                    size_t count) {
+    ssize_t ret;
+
+    if (out_hdl->fs->fs_ops->splice_from) {
+        if (!pos_out)
+            lock(&out_hdl->pos_lock);
+        ret = out_hdl->fs->fs_ops->splice_from(out_hdl, in_hdl, count, pos_in,
+                                               pos_out ?: &out_hdl->pos);
+        if (!pos_out)
+            unlock(&out_hdl->pos_lock);
+        if (ret != -EOPNOTSUPP)
+            return ret;
+    }
+
+    if (!in_hdl->fs->fs_ops->read || !out_hdl->fs->fs_ops->write)
+        return -EINVAL;
 
-    /* "unused" to silence newer Clang; we keep this variable as it may be helpful once we improve
-     * the `sendfile()` implementation, see one of the TODOs below */
-    __attribute__((unused)) size_t read_from_in = 0;
+    char* buf = NULL;
+    bool buf_in_use = __atomic_exchange_n(&g_sendfile_buf_in_use, true, __ATOMIC_ACQUIRE);
+    if (!buf_in_use) {
+        /* no other thread was using the static buffer */
+        buf = g_sendfile_buf;
+    } else {
+        buf = malloc(BUF_SIZE);
+        if (!buf) {
+            return -ENOMEM;
+        }
+    }
 
+    ret = 0;
     size_t copied_to_out = 0;
+    while (copied_to_out < count) {
+        size_t to_copy = count - copied_to_out > BUF_SIZE ? BUF_SIZE : count - copied_to_out;
+
+        ssize_t x = in_hdl->fs->fs_ops->read(in_hdl, buf, to_copy, pos_in);
+        if (x < 0) {
+            ret = x;
+            break;
+        }
+        assert(x <= (ssize_t)to_copy);
+
+        if (x == 0) {
+            /* no more data in input FD, let's return however many bytes copied_to_out up until now */
+            break;
+        }
+
+        if (!pos_out)
+            lock(&out_hdl->pos_lock);
+        ssize_t y = out_hdl->fs->fs_ops->write(out_hdl, buf, x, pos_out ?: &out_hdl->pos);
+        if (!pos_out)
+            unlock(&out_hdl->pos_lock);
+        if (y < 0) {
+            ret = y;
+            break;
+        }
+        assert(y <= x);
+
+        copied_to_out += y;
+
+        if (y < x) {
+            /* written less bytes to output fd than read from input fd -> out of sync now; don't try
+             * to be smart and simply return however many bytes we copied_to_out up until now */
+            /* TODO: need to revert in_fd's file position to (read_from_in - x + y) from original
+             *       offset and maybe continue this loop */
+            break;
+        }
+
+        if (x < (ssize_t)to_copy) {
+            /* short read, e.g. from a pipe: don't block waiting for more data */
+            break;
+        }
+    }
+
+    if (buf == g_sendfile_buf)
+        __atomic_store_n(&g_sendfile_buf_in_use, 0, __ATOMIC_RELEASE);
+    else
+        free(buf);
+    return copied_to_out ? (ssize_t)copied_to_out : ret;
+}
+
+/* Reads the starting position for a copy either from `*user_offset` (if not NULL) or from `hdl`. */
+static int get_copy_pos(struct libos_handle* hdl, off_t* user_offset, file_off_t* out_pos) {
+    if (user_offset) {
+        if (!hdl->fs->fs_ops->seek)
+            return -ESPIPE;
+        if (*user_offset < 0)
+            return -EINVAL;
+        *out_pos = *user_offset;
+    } else {
+        lock(&hdl->pos_lock);
+        *out_pos = hdl->pos;
+        unlock(&hdl->pos_lock);
+    }
+    return 0;
+}
+
+/* Stores the position after a copy either to `*user_offset` (if not NULL) or to `hdl`. */
+static void set_copy_pos(struct libos_handle* hdl, off_t* user_offset, file_off_t pos) {
+    if (user_offset) {
+        *user_offset = pos;
+    } else {
+        lock(&hdl->pos_lock);
+        hdl->pos = pos;
+        unlock(&hdl->pos_lock);
+    }
+}
+
+long libos_syscall_sendfile(int out_fd, int in_fd, off_t* offset, size_t count) {
+    long ret;
 
     if (offset && !is_user_memory_writable(offset, sizeof(*offset)))
         return -EFAULT;
@@ -456,22 +566,6 @@ long libos_syscall_sendfile(int out_fd, int in_fd, off_t* offset, size_t count)
         goto out;
     }
 
-    /* FIXME: This sendfile() emulation is very simple and not particularly efficient: it reads from
-     *        input FD in BUF_SIZE chunks and writes into output FD. Mmap-based emulation may be
-     *        more efficient but adds complexity (not all handle types provide mmap callback). */
-
-    bool buf_in_use = __atomic_exchange_n(&g_sendfile_buf_in_use, true, __ATOMIC_ACQUIRE);
-    if (!buf_in_use) {
-        /* no other thread was using the static buffer */
-        buf = g_sendfile_buf;
-    } else {
-        buf = malloc(BUF_SIZE);
-        if (!buf) {
-            ret = -ENOMEM;
-            goto out;
-        }
-    }
-
     if (!count) {
         ret = 0;
         goto out;
@@ -484,86 +578,186 @@ long libos_syscall_sendfile(int out_fd, int in_fd, off_t* offset, size_t count)
      * If `offset` is NULL, we use the offset in input handle, and update it afterwards.
      */
     file_off_t pos_in = 0;
-    if (offset) {
-        if (!in_hdl->fs->fs_ops->seek) {
-            ret = -ESPIPE;
-            goto out;
-        }
-        pos_in = *offset;
-        if (pos_in < 0) {
-            ret = -EINVAL;
-            goto out;
-        }
-    } else {
-        lock(&in_hdl->pos_lock);
-        pos_in = in_hdl->pos;
-        unlock(&in_hdl->pos_lock);
+    ret = get_copy_pos(in_hdl, offset, &pos_in);
+    if (ret < 0)
+        goto out;
+
+    if (!(in_hdl->acc_mode & MAY_READ) || !(out_hdl->acc_mode & MAY_WRITE)) {
+        /* Linux errors out if input fd isn't readable or output fd isn't writable */
+        ret = -EBADF;
+        goto out;
+    }
+
+    ret = copy_between_handles(in_hdl, &pos_in, out_hdl, /*pos_out=*/NULL, count);
+
+    /* Update either `*offset` or the offset in input file (see the comment above `pos_in`
+     * declaration). Note that we do it even if the copy failed. */
+    set_copy_pos(in_hdl, offset, pos_in);
+
+out:
+    put_handle(in_hdl);
+    put_handle(out_hdl);
+    return ret;
+}
+
+long libos_syscall_splice(int fd_in, off_t* off_in, int fd_out, off_t* off_out, size_t len,
+                          unsigned int flags) {
+    long ret;
+
+    if (flags & ~(SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | SPLICE_F_GIFT))
+        return -EINVAL;
+    if (off_in && !is_user_memory_writable(off_in, sizeof(*off_in)))
+        return -EFAULT;
+    if (off_out && !is_user_memory_writable(off_out, sizeof(*off_out)))
+        return -EFAULT;
+
+    struct libos_handle* in_hdl = get_fd_handle(fd_in, NULL, NULL);
+    if (!in_hdl)
+        return -EBADF;
+
+    struct libos_handle* out_hdl = get_fd_handle(fd_out, NULL, NULL);
+    if (!out_hdl) {
+        put_handle(in_hdl);
+        return -EBADF;
     }
 
-    if (!(out_hdl->acc_mode & MAY_WRITE)) {
-        /* Linux errors out if output fd isn't writable */
+    if (!in_hdl->fs || !in_hdl->fs->fs_ops || !out_hdl->fs || !out_hdl->fs->fs_ops) {
+        ret = -EINVAL;
+        goto out;
+    }
+
+    if (!(in_hdl->acc_mode & MAY_READ) || !(out_hdl->acc_mode & MAY_WRITE)) {
         ret = -EBADF;
         goto out;
     }
 
-    while (copied_to_out < count) {
-        size_t to_copy = count - copied_to_out > BUF_SIZE ? BUF_SIZE : count - copied_to_out;
+    /* One of the ends must be a pipe, and pipes have no offsets. As an extension, we also allow
+     * splicing to a socket from any other file, like sendfile() does: the data can then be sent
+     * by the host directly (see `splice_from` in `struct libos_fs_ops`), whereas on SGX a pipe
+     * in the middle would force it to go through the enclave. */
+    if (in_hdl->type != TYPE_PIPE && out_hdl->type != TYPE_PIPE && out_hdl->type != TYPE_SOCK) {
+        ret = -EINVAL;
+        goto out;
+    }
+    if ((in_hdl->type == TYPE_PIPE && off_in) || (out_hdl->type == TYPE_PIPE && off_out)) {
+        ret = -ESPIPE;
+        goto out;
+    }
 
-        ssize_t x = in_hdl->fs->fs_ops->read(in_hdl, buf, to_copy, &pos_in);
-        if (x < 0) {
-            ret = x;
-            goto out_update;
-        }
-        assert(x <= (ssize_t)to_copy);
+    if (out_hdl->flags & O_APPEND) {
+        ret = -EINVAL;
+        goto out;
+    }
 
-        read_from_in += x;
+    if (flags & SPLICE_F_NONBLOCK) {
+        if (FIRST_TIME())
+            log_debug("splice: SPLICE_F_NONBLOCK is ignored");
+    }
 
-        if (x == 0) {
-            /* no more data in input FD, let's return however many bytes copied_to_out up until now */
-            break;
-        }
+    if (!len) {
+        ret = 0;
+        goto out;
+    }
 
-        lock(&out_hdl->pos_lock);
-        ssize_t y = out_hdl->fs->fs_ops->write(out_hdl, buf, x, &out_hdl->pos);
-        unlock(&out_hdl->pos_lock);
-        if (y < 0) {
-            ret = y;
-            goto out_update;
-        }
-        assert(y <= x);
+    file_off_t pos_in = 0;
+    ret = get_copy_pos(in_hdl, off_in, &pos_in);
+    if (ret < 0)
+        goto out;
 
-        copied_to_out += y;
+    file_off_t pos_out = 0;
+    if (off_out) {
+        ret = get_copy_pos(out_hdl, off_out, &pos_out);
+        if (ret < 0)
+            goto out;
+    }
 
-        if (y < x) {
-            /* written less bytes to output fd than read from input fd -> out of sync now; don't try
-             * to be smart and simply return however many bytes we copied_to_out up until now */
-            /* TODO: need to revert in_fd's file position to (read_from_in - x + y) from original
-             *       offset and maybe continue this loop */
-            break;
-        }
+    ret = copy_between_handles(in_hdl, &pos_in, out_hdl, off_out ? &pos_out : NULL, len);
+
+    set_copy_pos(in_hdl, off_in, pos_in);
+    if (off_out)
+        *off_out = pos_out;
+
+out:
+    put_handle(in_hdl);
+    put_handle(out_hdl);
+    if (ret == -EINTR)
+        ret = -ERESTARTSYS;
+    return ret;
+}
+
+long libos_syscall_copy_file_range(int fd_in, off_t* off_in, int fd_out, off_t* off_out,
+                                   size_t len, unsigned int flags) {
+    long ret;
+
+    if (flags)
+        return -EINVAL;
+    if (off_in && !is_user_memory_writable(off_in, sizeof(*off_in)))
+        return -EFAULT;
+    if (off_out && !is_user_memory_writable(off_out, sizeof(*off_out)))
+        return -EFAULT;
+
+    struct libos_handle* in_hdl = get_fd_handle(fd_in, NULL, NULL);
+    if (!in_hdl)
+        return -EBADF;
+
+    struct libos_handle* out_hdl = get_fd_handle(fd_out, NULL, NULL);
+    if (!out_hdl) {
+        put_handle(in_hdl);
+        return -EBADF;
     }
 
-    ret = 0;
+    if (!(in_hdl->acc_mode & MAY_READ) || !(out_hdl->acc_mode & MAY_WRITE)
+            || (out_hdl->flags & O_APPEND)) {
+        ret = -EBADF;
+        goto out;
+    }
 
-out_update:
-    /* Update either `*offset` or the offset in input file (see the comment above `pos_in`
-     * declaration). Note that we do it even if one of the read/write operations failed. */
-    if (offset) {
-        *offset = pos_in;
-    } else {
-        lock(&in_hdl->pos_lock);
-        in_hdl->pos = pos_in;
-        unlock(&in_hdl->pos_lock);
+    if (in_hdl->is_dir || out_hdl->is_dir) {
+        ret = -EISDIR;
+        goto out;
     }
 
+    /* Only regular files are supported, like in Linux. */
+    if (!in_hdl->inode || in_hdl->inode->type != S_IFREG || !out_hdl->inode
+            || out_hdl->inode->type != S_IFREG || !in_hdl->fs || !in_hdl->fs->fs_ops
+            || !out_hdl->fs || !out_hdl->fs->fs_ops) {
+        ret = -EINVAL;
+        goto out;
+    }
+
+    file_off_t pos_in = 0;
+    ret = get_copy_pos(in_hdl, off_in, &pos_in);
+    if (ret < 0)
+        goto out;
+
+    file_off_t pos_out = 0;
+    ret = get_copy_pos(out_hdl, off_out, &pos_out);
+    if (ret < 0)
+        goto out;
+
+    if (in_hdl->inode == out_hdl->inode && pos_in < pos_out + (file_off_t)len
+            && pos_out < pos_in + (file_off_t)len) {
+        /* overlapping ranges in the same file */
+        ret = -EINVAL;
+        goto out;
+    }
+
+    if (!len) {
+        ret = 0;
+        goto out;
+    }
+
+    ret = copy_between_handles(in_hdl, &pos_in, out_hdl, &pos_out, len);
+
+    set_copy_pos(in_hdl, off_in, pos_in);
+    set_copy_pos(out_hdl, off_out, pos_out);
+
 out:
-    if (buf == g_sendfile_buf)
-        __atomic_store_n(&g_sendfile_buf_in_use, 0, __ATOMIC_RELEASE);
-    else
-        free(buf);
     put_handle(in_hdl);
     put_handle(out_hdl);
-    return copied_to_out ? (long)copied_to_out : ret;
+    if (ret == -EINTR)
+        ret = -ERESTARTSYS;
+    return ret;
 }
 
 long libos_syscall_chroot(const char* filename) {
@@ -572,9 +766,9 @@ long libos_syscall_chroot(const char* filename) {
 
     int ret = 0;
     struct libos_dentry* dent = NULL;
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     ret = path_lookupat(/*start=*/NULL, filename, LOOKUP_FOLLOW | LOOKUP_DIRECTORY, &dent);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (ret < 0)
         goto out;
 
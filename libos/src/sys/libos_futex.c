@@ -13,6 +13,11 @@
  * Current implementation is limited to one process i.e. threads calling futex syscall on the same
  * futex word must reside in the same process.
  * As a result we can distinguish futexes by their virtual address.
+ *
+ * Similarly to the Linux kernel, futexes are kept in a fixed-size hash table indexed by a hash of
+ * the futex address. Each bucket has its own lock and AVL tree, so threads operating on unrelated
+ * futexes do not contend on a single global lock. Operations on two futexes (wake-op, requeue)
+ * take both bucket locks in ascending address order.
  */
 
 #include <stdbool.h>
@@ -42,23 +47,36 @@ struct futex_waiter {
     struct libos_thread* thread;
     uint32_t bitset;
     LIST_TYPE(futex_waiter) list;
-    /* futex field is guarded by g_futex_tree_lock, do not use it without taking that lock first.
-     * This is needed to ensure that a waiter knows what futex they were sleeping on, after they
-     * wake-up (because they could have been requeued to another futex).*/
+    /* futex and bucket fields are guarded by the lock of `bucket`, do not use them without taking
+     * that lock first. This is needed to ensure that a waiter knows what futex they were sleeping
+     * on, after they wake-up (because they could have been requeued to another futex, possibly in
+     * another bucket). Both fields only change with the old and the new bucket locked. */
     struct libos_futex* futex;
+    struct futex_bucket* bucket;
 };
 
 struct libos_futex {
     uint32_t* uaddr;
+    /* Bucket this futex belongs to (determined by `uaddr`), never changes. */
+    struct futex_bucket* bucket;
     LISTP_TYPE(futex_waiter) waiters;
     struct avl_tree_node tree_node;
     bool in_tree;
     /* This lock guards every access to *uaddr (futex word value) and waiters (above).
-     * Always take g_futex_tree_lock before taking this lock. */
+     * Always take `bucket->lock` before taking this lock. */
     spinlock_t lock;
     refcount_t _ref_count;
 };
 
+#define FUTEX_HASH_BITS 8
+#define FUTEX_HASH_SIZE (1UL << FUTEX_HASH_BITS)
+
+struct futex_bucket {
+    /* Guards `tree` and the `in_tree` field of all futexes in it. */
+    spinlock_t lock;
+    struct avl_tree tree;
+} __attribute__((aligned(64)));
+
 static bool futex_tree_cmp(struct avl_tree_node* node_a, struct avl_tree_node* node_b) {
     struct libos_futex* a = container_of(node_a, struct libos_futex, tree_node);
     struct libos_futex* b = container_of(node_b, struct libos_futex, tree_node);
@@ -66,9 +84,47 @@ static bool futex_tree_cmp(struct avl_tree_node* node_a, struct avl_tree_node* n
     return (uintptr_t)a->uaddr <= (uintptr_t)b->uaddr;
 }
 
-static struct avl_tree g_futex_tree = { .cmp = futex_tree_cmp };
+static struct futex_bucket g_futex_buckets[FUTEX_HASH_SIZE] = {
+    [0 ... FUTEX_HASH_SIZE - 1] = {
+        .lock = INIT_SPINLOCK_UNLOCKED,
+        .tree = { .cmp = futex_tree_cmp },
+    },
+};
+
+static struct futex_bucket* futex_bucket_of(uint32_t* uaddr) {
+    return &g_futex_buckets[hash64((uintptr_t)uaddr) & (FUTEX_HASH_SIZE - 1)];
+}
+
+/*
+ * Locks two buckets in ascending order of their addresses. If both are the same, takes just one
+ * lock. A bucket may be NULL, it is then skipped.
+ */
+static void lock_two_buckets(struct futex_bucket* bucket1, struct futex_bucket* bucket2) {
+    if (bucket1 == bucket2 || !bucket2) {
+        if (bucket1)
+            spinlock_lock(&bucket1->lock);
+        return;
+    }
+    if (!bucket1) {
+        spinlock_lock(&bucket2->lock);
+        return;
+    }
+
+    if ((uintptr_t)bucket1 < (uintptr_t)bucket2) {
+        spinlock_lock(&bucket1->lock);
+        spinlock_lock(&bucket2->lock);
+    } else {
+        spinlock_lock(&bucket2->lock);
+        spinlock_lock(&bucket1->lock);
+    }
+}
 
-static spinlock_t g_futex_tree_lock = INIT_SPINLOCK_UNLOCKED;
+static void unlock_two_buckets(struct futex_bucket* bucket1, struct futex_bucket* bucket2) {
+    if (bucket1)
+        spinlock_unlock(&bucket1->lock);
+    if (bucket2 && bucket2 != bucket1)
+        spinlock_unlock(&bucket2->lock);
+}
 
 static void get_futex(struct libos_futex* futex) {
     refcount_inc(&futex->_ref_count);
@@ -148,21 +204,21 @@ static void unlock_two_futexes(struct libos_futex* futex1, struct libos_futex* f
 }
 
 /*
- * Adds `futex` to `g_futex_tree`.
+ * Adds `futex` to the tree of its bucket.
  *
- * `g_futex_tree_lock` should be held while calling this function and you must ensure that nobody
+ * `futex->bucket->lock` should be held while calling this function and you must ensure that nobody
  * is using `futex` (e.g. you have just created it).
  */
 static void enqueue_futex(struct libos_futex* futex) {
-    assert(spinlock_is_locked(&g_futex_tree_lock));
+    assert(spinlock_is_locked(&futex->bucket->lock));
 
     get_futex(futex);
-    avl_tree_insert(&g_futex_tree, &futex->tree_node);
+    avl_tree_insert(&futex->bucket->tree, &futex->tree_node);
     futex->in_tree = true;
 }
 
 /*
- * Checks whether `futex` has no waiters and is on `g_futex_tree`.
+ * Checks whether `futex` has no waiters and is on its bucket tree.
  *
  * This requires only `futex->lock` to be held.
  */
@@ -174,10 +230,10 @@ static bool check_dequeue_futex(struct libos_futex* futex) {
 
 static void _maybe_dequeue_futex(struct libos_futex* futex) {
     assert(spinlock_is_locked(&futex->lock));
-    assert(spinlock_is_locked(&g_futex_tree_lock));
+    assert(spinlock_is_locked(&futex->bucket->lock));
 
     if (check_dequeue_futex(futex)) {
-        avl_tree_delete(&g_futex_tree, &futex->tree_node);
+        avl_tree_delete(&futex->bucket->tree, &futex->tree_node);
         futex->in_tree = false;
         /* We still hold this futex reference (in the caller), so this won't call free. */
         put_futex(futex);
@@ -185,24 +241,27 @@ static void _maybe_dequeue_futex(struct libos_futex* futex) {
 }
 
 /*
- * If `futex` has no waiters and is on `g_futex_tree`, takes it off that tree.
+ * If `futex` has no waiters and is on its bucket tree, takes it off that tree.
  *
- * Neither `g_futex_tree_lock` nor `futex->lock` should be held while calling this,
+ * Neither `futex->bucket->lock` nor `futex->lock` should be held while calling this,
  * it acquires these locks itself.
  */
 static void maybe_dequeue_futex(struct libos_futex* futex) {
-    spinlock_lock(&g_futex_tree_lock);
+    spinlock_lock(&futex->bucket->lock);
     spinlock_lock(&futex->lock);
     _maybe_dequeue_futex(futex);
     spinlock_unlock(&futex->lock);
-    spinlock_unlock(&g_futex_tree_lock);
+    spinlock_unlock(&futex->bucket->lock);
 }
 
 /*
  * Same as `maybe_dequeue_futex`, but works for two futexes, any of which might be NULL.
  */
 static void maybe_dequeue_two_futexes(struct libos_futex* futex1, struct libos_futex* futex2) {
-    spinlock_lock(&g_futex_tree_lock);
+    struct futex_bucket* bucket1 = futex1 ? futex1->bucket : NULL;
+    struct futex_bucket* bucket2 = futex2 ? futex2->bucket : NULL;
+
+    lock_two_buckets(bucket1, bucket2);
     lock_two_futexes(futex1, futex2);
     if (futex1) {
         _maybe_dequeue_futex(futex1);
@@ -211,12 +270,12 @@ static void maybe_dequeue_two_futexes(struct libos_futex* futex1, struct libos_f
         _maybe_dequeue_futex(futex2);
     }
     unlock_two_futexes(futex1, futex2);
-    spinlock_unlock(&g_futex_tree_lock);
+    unlock_two_buckets(bucket1, bucket2);
 }
 
 /*
  * Adds `waiter` to `futex` waiters list.
- * You need to make sure that this futex is still on `g_futex_tree`, but in most cases it follows
+ * You need to make sure that this futex is still on its bucket tree, but in most cases it follows
  * from the program control flow.
  *
  * `futex->lock` needs to be held.
@@ -232,6 +291,7 @@ static void add_futex_waiter(struct futex_waiter* waiter, struct libos_futex* fu
     waiter->bitset = bitset;
     get_futex(futex);
     waiter->futex = futex;
+    waiter->bucket = futex->bucket;
     LISTP_ADD_TAIL(waiter, &futex->waiters, list);
 }
 
@@ -251,13 +311,14 @@ static struct libos_thread* remove_futex_waiter(struct futex_waiter* waiter,
 
 /*
  * Moves waiter from `futex1` to `futex2`.
- * As in `add_futex_waiter`, `futex2` needs to be on `g_futex_tree`.
+ * As in `add_futex_waiter`, `futex2` needs to be on its bucket tree.
  *
- * `futex1->lock` and `futex2->lock` need to be held.
+ * Locks of both futexes and of both their buckets need to be held.
  */
 static void move_futex_waiter(struct futex_waiter* waiter, struct libos_futex* futex1,
                               struct libos_futex* futex2) {
-    assert(spinlock_is_locked(&g_futex_tree_lock));
+    assert(spinlock_is_locked(&futex1->bucket->lock));
+    assert(spinlock_is_locked(&futex2->bucket->lock));
     assert(spinlock_is_locked(&futex1->lock));
     assert(spinlock_is_locked(&futex2->lock));
 
@@ -265,6 +326,8 @@ static void move_futex_waiter(struct futex_waiter* waiter, struct libos_futex* f
     get_futex(futex2);
     put_futex(waiter->futex);
     waiter->futex = futex2;
+    /* Read without the lock by a woken-up waiter in `futex_wait`, which then re-checks it. */
+    __atomic_store_n(&waiter->bucket, futex2->bucket, __ATOMIC_RELAXED);
     LISTP_ADD_TAIL(waiter, &futex2->waiters, list);
 }
 
@@ -283,6 +346,7 @@ static struct libos_futex* create_new_futex(uint32_t* uaddr) {
     refcount_set(&futex->_ref_count, 1);
 
     futex->uaddr = uaddr;
+    futex->bucket = futex_bucket_of(uaddr);
     futex->in_tree = false;
     INIT_LISTP(&futex->waiters);
     spinlock_init(&futex->lock);
@@ -291,17 +355,18 @@ static struct libos_futex* create_new_futex(uint32_t* uaddr) {
 }
 
 /*
- * Finds a futex in `g_futex_tree`.
- * Must be called with `g_futex_tree_lock` held.
+ * Finds a futex in `bucket`, which must be the bucket of `uaddr`.
+ * Must be called with `bucket->lock` held.
  * Increases refcount of futex by 1.
  */
-static struct libos_futex* find_futex(uint32_t* uaddr) {
-    assert(spinlock_is_locked(&g_futex_tree_lock));
+static struct libos_futex* find_futex(struct futex_bucket* bucket, uint32_t* uaddr) {
+    assert(spinlock_is_locked(&bucket->lock));
+    assert(bucket == futex_bucket_of(uaddr));
     struct libos_futex* futex = NULL;
     struct libos_futex cmp_arg = {
         .uaddr = uaddr
     };
-    struct avl_tree_node* node = avl_tree_find(&g_futex_tree, &cmp_arg.tree_node);
+    struct avl_tree_node* node = avl_tree_find(&bucket->tree, &cmp_arg.tree_node);
     if (!node) {
         return NULL;
     }
@@ -316,17 +381,18 @@ static int futex_wait(uint32_t* uaddr, uint32_t val, uint64_t* timeout, uint32_t
     struct libos_futex* futex = NULL;
     struct libos_thread* thread = NULL;
     struct libos_futex* tmp = NULL;
+    struct futex_bucket* bucket = futex_bucket_of(uaddr);
 
-    spinlock_lock(&g_futex_tree_lock);
-    futex = find_futex(uaddr);
+    spinlock_lock(&bucket->lock);
+    futex = find_futex(bucket, uaddr);
     if (!futex) {
-        spinlock_unlock(&g_futex_tree_lock);
+        spinlock_unlock(&bucket->lock);
         tmp = create_new_futex(uaddr);
         if (!tmp) {
             return -ENOMEM;
         }
-        spinlock_lock(&g_futex_tree_lock);
-        futex = find_futex(uaddr);
+        spinlock_lock(&bucket->lock);
+        futex = find_futex(bucket, uaddr);
         if (!futex) {
             enqueue_futex(tmp);
             futex = tmp;
@@ -334,7 +400,7 @@ static int futex_wait(uint32_t* uaddr, uint32_t val, uint64_t* timeout, uint32_t
         }
     }
     spinlock_lock(&futex->lock);
-    spinlock_unlock(&g_futex_tree_lock);
+    spinlock_unlock(&bucket->lock);
 
     if (__atomic_load_n(uaddr, __ATOMIC_RELAXED) != val) {
         ret = -EAGAIN;
@@ -355,13 +421,23 @@ static int futex_wait(uint32_t* uaddr, uint32_t val, uint64_t* timeout, uint32_t
 
     ret = thread_wait(timeout, /*ignore_pending_signals=*/false);
 
-    spinlock_lock(&g_futex_tree_lock);
-    /* We might have been requeued. Grab the (possibly new) futex reference. */
+    /* We might have been requeued, possibly to a futex in another bucket. `waiter.bucket` changes
+     * only with both the old and the new bucket locked, so once we hold the lock of the bucket it
+     * points to, it is stable. */
+    while (true) {
+        bucket = __atomic_load_n(&waiter.bucket, __ATOMIC_RELAXED);
+        spinlock_lock(&bucket->lock);
+        if (bucket == waiter.bucket) {
+            break;
+        }
+        spinlock_unlock(&bucket->lock);
+    }
+    /* Grab the (possibly new) futex reference. */
     futex = waiter.futex;
     assert(futex);
     get_futex(futex);
     spinlock_lock(&futex->lock);
-    spinlock_unlock(&g_futex_tree_lock);
+    spinlock_unlock(&bucket->lock);
 
     if (!LIST_EMPTY(&waiter, list)) {
         /* If we woke up due to time out or a signal, we were not removed from the waiters list
@@ -382,7 +458,7 @@ static int futex_wait(uint32_t* uaddr, uint32_t val, uint64_t* timeout, uint32_t
     put_futex(waiter.futex);
 
 out_with_futex_lock:; // C is awesome!
-    /* Because dequeuing a futex requires `g_futex_tree_lock` which we do not hold at this moment,
+    /* Because dequeuing a futex requires its bucket lock which we do not hold at this moment,
      * we check if we actually need to do it now (locks acquisition and dequeuing). */
     bool needs_dequeue = check_dequeue_futex(futex);
 
@@ -449,14 +525,15 @@ static int futex_wake(uint32_t* uaddr, int to_wake, uint32_t bitset) {
         return -EINVAL;
     }
 
-    spinlock_lock(&g_futex_tree_lock);
-    futex = find_futex(uaddr);
+    struct futex_bucket* bucket = futex_bucket_of(uaddr);
+    spinlock_lock(&bucket->lock);
+    futex = find_futex(bucket, uaddr);
     if (!futex) {
-        spinlock_unlock(&g_futex_tree_lock);
+        spinlock_unlock(&bucket->lock);
         return 0;
     }
     spinlock_lock(&futex->lock);
-    spinlock_unlock(&g_futex_tree_lock);
+    spinlock_unlock(&bucket->lock);
 
     woken = move_to_wake_queue(futex, bitset, to_wake, &queue);
 
@@ -493,13 +570,15 @@ static int futex_wake_op(uint32_t* uaddr1, uint32_t* uaddr2, int to_wake1, int t
     int ret = 0;
     bool needs_dequeue1 = false;
     bool needs_dequeue2 = false;
+    struct futex_bucket* bucket1 = futex_bucket_of(uaddr1);
+    struct futex_bucket* bucket2 = futex_bucket_of(uaddr2);
 
-    spinlock_lock(&g_futex_tree_lock);
-    futex1 = find_futex(uaddr1);
-    futex2 = find_futex(uaddr2);
+    lock_two_buckets(bucket1, bucket2);
+    futex1 = find_futex(bucket1, uaddr1);
+    futex2 = find_futex(bucket2, uaddr2);
 
     lock_two_futexes(futex1, futex2);
-    spinlock_unlock(&g_futex_tree_lock);
+    unlock_two_buckets(bucket1, bucket2);
 
     unsigned int op = (val3 >> 28) & 0x7; // highest bit is for FUTEX_OP_OPARG_SHIFT
     unsigned int cmp = (val3 >> 24) & 0xf;
@@ -615,25 +694,30 @@ static int futex_requeue(uint32_t* uaddr1, uint32_t* uaddr2, int to_wake, int to
         return -EINVAL;
     }
 
-    spinlock_lock(&g_futex_tree_lock);
-    futex2 = find_futex(uaddr2);
+    /* Both buckets stay locked until the waiters are moved, so that woken-up waiters see a
+     * consistent `waiter->bucket` (see `futex_wait`). */
+    struct futex_bucket* bucket1 = futex_bucket_of(uaddr1);
+    struct futex_bucket* bucket2 = futex_bucket_of(uaddr2);
+
+    lock_two_buckets(bucket1, bucket2);
+    futex2 = find_futex(bucket2, uaddr2);
     if (!futex2) {
-        spinlock_unlock(&g_futex_tree_lock);
+        unlock_two_buckets(bucket1, bucket2);
         tmp = create_new_futex(uaddr2);
         if (!tmp) {
             return -ENOMEM;
         }
         needs_dequeue2 = true;
 
-        spinlock_lock(&g_futex_tree_lock);
-        futex2 = find_futex(uaddr2);
+        lock_two_buckets(bucket1, bucket2);
+        futex2 = find_futex(bucket2, uaddr2);
         if (!futex2) {
             enqueue_futex(tmp);
             futex2 = tmp;
             tmp = NULL;
         }
     }
-    futex1 = find_futex(uaddr1);
+    futex1 = find_futex(bucket1, uaddr1);
 
     lock_two_futexes(futex1, futex2);
 
@@ -670,7 +754,7 @@ static int futex_requeue(uint32_t* uaddr1, uint32_t* uaddr2, int to_wake, int to
 
 out_unlock:
     unlock_two_futexes(futex1, futex2);
-    spinlock_unlock(&g_futex_tree_lock);
+    unlock_two_buckets(bucket1, bucket2);
 
     if (needs_dequeue1 || needs_dequeue2) {
         maybe_dequeue_two_futexes(futex1, futex2);
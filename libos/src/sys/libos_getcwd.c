@@ -60,9 +60,9 @@ long libos_syscall_chdir(const char* filename) {
     if (strnlen(filename, PATH_MAX + 1) == PATH_MAX + 1)
         return -ENAMETOOLONG;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     ret = path_lookupat(/*start=*/NULL, filename, LOOKUP_FOLLOW | LOOKUP_DIRECTORY, &dent);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (ret < 0)
         return ret;
 
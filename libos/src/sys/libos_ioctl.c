@@ -41,10 +41,10 @@ long libos_syscall_ioctl(unsigned int fd, unsigned int cmd, unsigned long arg) {
     if (!hdl)
         return -EBADF;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     bool is_host_dev = hdl->type == TYPE_CHROOT && hdl->dentry->inode &&
         hdl->dentry->inode->type == S_IFCHR;
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
 
     if (is_host_dev) {
         int cmd_ret;
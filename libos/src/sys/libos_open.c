@@ -178,7 +178,7 @@ long libos_syscall_close(int fd) {
 static file_off_t do_lseek_dir(struct libos_handle* hdl, off_t offset, int origin) {
     assert(hdl->is_dir);
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     lock(&hdl->pos_lock);
     lock(&hdl->lock);
 
@@ -201,7 +201,7 @@ static file_off_t do_lseek_dir(struct libos_handle* hdl, off_t offset, int origi
 out:
     unlock(&hdl->lock);
     unlock(&hdl->pos_lock);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     return ret;
 }
 
@@ -359,7 +359,7 @@ static ssize_t do_getdents(int fd, uint8_t* buf, size_t buf_size, bool is_getden
         goto out_no_unlock;
     }
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     lock(&hdl->pos_lock);
     lock(&hdl->lock);
 
@@ -448,7 +448,7 @@ static ssize_t do_getdents(int fd, uint8_t* buf, size_t buf_size, bool is_getden
 out:
     unlock(&hdl->lock);
     unlock(&hdl->pos_lock);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
 out_no_unlock:
     put_handle(hdl);
     return ret;
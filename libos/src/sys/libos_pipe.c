@@ -218,7 +218,7 @@ long libos_syscall_mknodat(int dirfd, const char* pathname, mode_t mode, dev_t d
     if (*pathname != '/' && (ret = get_dirfd_dentry(dirfd, &dir)) < 0)
         return ret;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     ret = path_lookupat(dir, pathname, LOOKUP_NO_FOLLOW | LOOKUP_CREATE, &dent);
     if (ret < 0) {
         goto out;
@@ -289,7 +289,7 @@ long libos_syscall_mknodat(int dirfd, const char* pathname, mode_t mode, dev_t d
 
     ret = 0;
 out:
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (ret < 0) {
         undo_set_fd_handle(vfd1);
         undo_set_fd_handle(vfd2);
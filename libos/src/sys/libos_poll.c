@@ -83,8 +83,6 @@ static long do_poll(struct pollfd* fds, size_t fds_len, uint64_t* timeout_us) {
     size_t ret_events_count = 0;
     struct libos_handle_map* map = get_cur_thread()->handle_map;
 
-    rwlock_read_lock(&map->lock);
-
     /*
      * After each iteration of this loop either:
      * - `fds[i].revents` is set to its final value (possibly 0)
@@ -97,7 +95,7 @@ static long do_poll(struct pollfd* fds, size_t fds_len, uint64_t* timeout_us) {
             continue;
         }
 
-        struct libos_handle* handle = __get_fd_handle(fds[i].fd, NULL, map);
+        struct libos_handle* handle = get_fd_handle(fds[i].fd, NULL, map);
         if (!handle) {
             fds[i].revents = POLLNVAL;
             ret_events_count++;
@@ -132,7 +130,7 @@ static long do_poll(struct pollfd* fds, size_t fds_len, uint64_t* timeout_us) {
             if (ret < 0 && ret != -ENOSYS) {
                 /* ENOSYS implies that no handle-specific poll was found; other errors imply that
                  * there was a handle-specific poll, but its invocation failed for other reasons */
-                rwlock_read_unlock(&map->lock);
+                put_handle(handle);
                 goto out;
             }
             if (ret != -ENOSYS)
@@ -140,6 +138,7 @@ static long do_poll(struct pollfd* fds, size_t fds_len, uint64_t* timeout_us) {
         }
 
         if (handle_specific_poll_invoked) {
+            put_handle(handle);
             fds[i].revents = events;
             if (events) {
                 ret_events_count++;
@@ -153,6 +152,7 @@ static long do_poll(struct pollfd* fds, size_t fds_len, uint64_t* timeout_us) {
             pal_handle = __atomic_load_n(&handle->info.sock.pal_handle, __ATOMIC_ACQUIRE);
             if (!pal_handle) {
                 /* UNIX sockets that are still not connected have no `pal_handle`. */
+                put_handle(handle);
                 fds[i].revents = POLLHUP;
                 ret_events_count++;
                 continue;
@@ -160,6 +160,7 @@ static long do_poll(struct pollfd* fds, size_t fds_len, uint64_t* timeout_us) {
         } else {
             pal_handle = handle->pal_handle;
             if (!pal_handle) {
+                put_handle(handle);
                 fds[i].revents = POLLNVAL;
                 ret_events_count++;
                 continue;
@@ -171,13 +172,11 @@ static long do_poll(struct pollfd* fds, size_t fds_len, uint64_t* timeout_us) {
         if (events & (POLLOUT | POLLWRNORM))
             pal_events[i] |= PAL_WAIT_WRITE;
 
+        /* the reference taken by `get_fd_handle()` is released at the end */
         libos_handles[i] = handle;
-        get_handle(handle);
         pal_handles[i] = pal_handle;
     }
 
-    rwlock_read_unlock(&map->lock);
-
     uint64_t tmp_timeout_us = 0;
     if (ret_events_count) {
         /* If we already have events to return, we should not sleep below. */
@@ -664,6 +664,51 @@ static int check_msghdr(struct msghdr* user_msg, bool is_recv) {
     return 0;
 }
 
+/* Checks (and clears) a pending error and whether `sock` can be written to. */
+static int check_send_state(struct libos_sock_handle* sock, bool* out_has_sendtimeout_set) {
+    lock(&sock->lock);
+    if (sock->state == SOCK_CONNECTING) {
+        unlock(&sock->lock);
+        return -EAGAIN;
+    }
+
+    *out_has_sendtimeout_set = !!sock->sendtimeout_us;
+
+    int ret = -((int)sock->last_error);
+    sock->last_error = 0;
+
+    if (!ret && !sock->can_be_written) {
+        ret = -EPIPE;
+    }
+
+    unlock(&sock->lock);
+    return ret;
+}
+
+/* Delivers SIGPIPE and adjusts `ret` for syscall restarting, as the kernel does after a send. */
+static ssize_t finish_send(ssize_t ret, unsigned int flags, bool has_sendtimeout_set) {
+    if (ret == -EPIPE && !(flags & MSG_NOSIGNAL)) {
+        siginfo_t info = {
+            .si_signo = SIGPIPE,
+            .si_pid = g_process.pid,
+            .si_code = SI_USER,
+        };
+        if (kill_current_proc(&info) < 0) {
+            log_error("failed to deliver a signal");
+        }
+    }
+    if (ret == -EINTR) {
+        /* Timeout could have been changed in the meantime, but it should not matter - this is
+         * a peculiar corner case that nothing should really care about. */
+        if (has_sendtimeout_set) {
+            ret = -ERESTARTNOHAND;
+        } else {
+            ret = -ERESTARTSYS;
+        }
+    }
+    return ret;
+}
+
 /* We return the size directly (contrary to the usual out argument) for simplicity - this function
  * is called directly from syscall handlers, which return values in such a way. */
 ssize_t do_sendmsg(struct libos_handle* handle, struct iovec* iov, size_t iov_len,
@@ -691,23 +736,8 @@ ssize_t do_sendmsg(struct libos_handle* handle, struct iovec* iov, size_t iov_le
             log_debug("MSG_MORE on TCP sockets is ignored");
     }
 
-    lock(&sock->lock);
-    if (sock->state == SOCK_CONNECTING) {
-        unlock(&sock->lock);
-        return -EAGAIN;
-    }
-
-    bool has_sendtimeout_set = !!sock->sendtimeout_us;
-
-    ret = -((ssize_t)sock->last_error);
-    sock->last_error = 0;
-
-    if (!ret && !sock->can_be_written) {
-        ret = -EPIPE;
-    }
-
-    unlock(&sock->lock);
-
+    bool has_sendtimeout_set = false;
+    ret = check_send_state(sock, &has_sendtimeout_set);
     if (ret < 0) {
         goto out;
     }
@@ -726,26 +756,44 @@ ssize_t do_sendmsg(struct libos_handle* handle, struct iovec* iov, size_t iov_le
     }
 
 out:
-    if (ret == -EPIPE && !(flags & MSG_NOSIGNAL)) {
-        siginfo_t info = {
-            .si_signo = SIGPIPE,
-            .si_pid = g_process.pid,
-            .si_code = SI_USER,
-        };
-        if (kill_current_proc(&info) < 0) {
-            log_error("failed to deliver a signal");
-        }
+    return finish_send(ret, flags, has_sendtimeout_set);
+}
+
+ssize_t do_sendfile(struct libos_handle* handle, PAL_HANDLE in_pal_handle, file_off_t* in_pos,
+                    size_t count) {
+    if (handle->type != TYPE_SOCK) {
+        return -ENOTSOCK;
     }
-    if (ret == -EINTR) {
-        /* Timeout could have been changed in the meantime, but it should not matter - this is
-         * a peculiar corner case that nothing should really care about. */
-        if (has_sendtimeout_set) {
-            ret = -ERESTARTNOHAND;
-        } else {
-            ret = -ERESTARTSYS;
-        }
+
+    struct libos_sock_handle* sock = &handle->info.sock;
+    if ((sock->domain != AF_INET && sock->domain != AF_INET6) || sock->type != SOCK_STREAM) {
+        return -EOPNOTSUPP;
     }
-    return ret;
+
+    bool has_sendtimeout_set = false;
+    ssize_t ret = check_send_state(sock, &has_sendtimeout_set);
+    if (ret < 0) {
+        goto out;
+    }
+
+    /* A pending error was consumed above only if we return it, so falling back to `do_sendmsg()`
+     * on -EOPNOTSUPP below is fine. */
+    PAL_HANDLE pal_handle = __atomic_load_n(&sock->pal_handle, __ATOMIC_ACQUIRE);
+    size_t size = count;
+    ret = PalStreamSplice(in_pal_handle, *in_pos, pal_handle, /*out_offset=*/0, &size);
+    if (ret == -PAL_ERROR_NOTSUPPORT) {
+        return -EOPNOTSUPP;
+    }
+    ret = pal_to_unix_errno(ret);
+    maybe_epoll_et_trigger(handle, ret, /*in=*/false, !ret ? size < count : false);
+    if (!ret) {
+        *in_pos += size;
+        ret = size;
+    }
+
+out:
+    /* Like sendfile() in Linux, never suppress SIGPIPE. */
+    return finish_send(ret, /*flags=*/0, has_sendtimeout_set);
 }
 
 long libos_syscall_sendto(int fd, void* buf, size_t len, unsigned int flags, void* addr,
@@ -16,7 +16,7 @@
 #include "stat.h"
 
 static int do_stat(struct libos_dentry* dent, struct stat* stat) {
-    assert(locked(&g_dcache_lock));
+    assert(rwlock_is_read_locked(&g_dcache_lock) || rwlock_is_write_locked(&g_dcache_lock));
     assert(dent->inode);
 
     struct libos_fs* fs = dent->inode->fs;
@@ -33,6 +33,34 @@ static int do_stat(struct libos_dentry* dent, struct stat* stat) {
     return 0;
 }
 
+/*
+ * Looks up `path` and retrieves its attributes. Paths passed to stat() are usually already in the
+ * dentry cache, so first try to resolve them with `g_dcache_lock` held only for reading (so that
+ * concurrent calls do not serialize), and fall back to a full lookup if that is not enough.
+ */
+static int do_path_stat(struct libos_dentry* dir, const char* path, int lookup_flags,
+                        struct stat* stat) {
+    struct libos_dentry* dent = NULL;
+
+    rwlock_read_lock(&g_dcache_lock);
+    int ret = path_lookupat_cached(dir, path, lookup_flags, &dent);
+    if (ret == 0)
+        ret = do_stat(dent, stat);
+    rwlock_read_unlock(&g_dcache_lock);
+    if (dent || ret != -EAGAIN)
+        goto out;
+
+    rwlock_write_lock(&g_dcache_lock);
+    ret = path_lookupat(dir, path, lookup_flags, &dent);
+    if (ret == 0)
+        ret = do_stat(dent, stat);
+    rwlock_write_unlock(&g_dcache_lock);
+out:
+    if (dent)
+        put_dentry(dent);
+    return ret;
+}
+
 static int do_hstat(struct libos_handle* hdl, struct stat* stat) {
     struct libos_fs* fs = hdl->fs;
 
@@ -57,20 +85,7 @@ long libos_syscall_stat(const char* file, struct stat* stat) {
     if (!is_user_memory_writable(stat, sizeof(*stat)))
         return -EFAULT;
 
-    int ret;
-    struct libos_dentry* dent = NULL;
-
-    lock(&g_dcache_lock);
-    ret = path_lookupat(/*start=*/NULL, file, LOOKUP_FOLLOW, &dent);
-    if (ret < 0)
-        goto out;
-
-    ret = do_stat(dent, stat);
-out:
-    unlock(&g_dcache_lock);
-    if (dent)
-        put_dentry(dent);
-    return ret;
+    return do_path_stat(/*dir=*/NULL, file, LOOKUP_FOLLOW, stat);
 }
 
 long libos_syscall_lstat(const char* file, struct stat* stat) {
@@ -80,20 +95,7 @@ long libos_syscall_lstat(const char* file, struct stat* stat) {
     if (!is_user_memory_writable(stat, sizeof(*stat)))
         return -EFAULT;
 
-    int ret;
-    struct libos_dentry* dent = NULL;
-
-    lock(&g_dcache_lock);
-    ret = path_lookupat(/*start=*/NULL, file, LOOKUP_NO_FOLLOW, &dent);
-    if (ret < 0)
-        goto out;
-
-    ret = do_stat(dent, stat);
-out:
-    unlock(&g_dcache_lock);
-    if (dent)
-        put_dentry(dent);
-    return ret;
+    return do_path_stat(/*dir=*/NULL, file, LOOKUP_NO_FOLLOW, stat);
 }
 
 long libos_syscall_fstat(int fd, struct stat* stat) {
@@ -128,7 +130,7 @@ long libos_syscall_readlinkat(int dirfd, const char* file, char* buf, int bufsiz
     if (*file != '/' && (ret = get_dirfd_dentry(dirfd, &dir)) < 0)
         goto out;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     ret = path_lookupat(dir, file, LOOKUP_NO_FOLLOW, &dent);
     if (ret < 0)
         goto out;
@@ -155,7 +157,7 @@ long libos_syscall_readlinkat(int dirfd, const char* file, char* buf, int bufsiz
 
     memcpy(buf, target, ret);
 out:
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (dent) {
         put_dentry(dent);
     }
@@ -194,9 +196,9 @@ long libos_syscall_statfs(const char* path, struct statfs* buf) {
     int ret;
     struct libos_dentry* dent = NULL;
 
-    lock(&g_dcache_lock);
+    rwlock_write_lock(&g_dcache_lock);
     ret = path_lookupat(/*start=*/NULL, path, LOOKUP_FOLLOW, &dent);
-    unlock(&g_dcache_lock);
+    rwlock_write_unlock(&g_dcache_lock);
     if (ret < 0)
         return ret;
 
@@ -228,7 +230,7 @@ static int do_fstatat_empty_path(int dirfd, struct stat* statbuf) {
     get_dentry(dent);
     unlock(&g_process.fs_lock);
 
-    lock(&g_dcache_lock);
+    rwlock_read_lock(&g_dcache_lock);
 
     int ret;
 
@@ -239,7 +241,7 @@ static int do_fstatat_empty_path(int dirfd, struct stat* statbuf) {
 
     ret = do_stat(dent, statbuf);
 out:
-    unlock(&g_dcache_lock);
+    rwlock_read_unlock(&g_dcache_lock);
     put_dentry(dent);
     return ret;
 }
@@ -276,18 +278,7 @@ long libos_syscall_newfstatat(int dirfd, const char* pathname, struct stat* stat
             return ret;
     }
 
-    lock(&g_dcache_lock);
-
-    struct libos_dentry* dent = NULL;
-    ret = path_lookupat(dir, pathname, lookup_flags, &dent);
-    if (ret < 0)
-        goto out;
-
-    ret = do_stat(dent, statbuf);
-out:
-    unlock(&g_dcache_lock);
-    if (dent)
-        put_dentry(dent);
+    ret = do_path_stat(dir, pathname, lookup_flags, statbuf);
     if (dir)
         put_dentry(dir);
     return ret;
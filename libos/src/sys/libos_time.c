@@ -5,10 +5,200 @@
  * Implementation of system calls "gettimeofday", "time" and "clock_gettime".
  */
 
+#include "libos_checkpoint.h"
 #include "libos_internal.h"
 #include "libos_table.h"
+#include "libos_vdso.h"
+#include "libos_vma.h"
 #include "linux_abi/errors.h"
 #include "pal.h"
+#include "spinlock.h"
+
+/* Drift between the TSC and the host time is contained by refreshing the baseline this often (the
+ * same period as in the SGX PAL), expressed as a fraction of a second. */
+#define VDSO_TIME_REFRESH_DIV 20
+
+/* Time page mapped before the vDSO. It is an internal VMA, so the app cannot unmap or remap it;
+ * it is migrated to the child explicitly (see `BEGIN_CP_FUNC(vdso_time)` below). */
+static struct libos_vdso_time* g_vdso_time __attribute_migratable = NULL;
+/* LibOS copy of the baseline published in the time page; the page is writable by the app, so LibOS
+ * computes the time only from this copy */
+static struct libos_vdso_time g_vdso_time_copy __attribute_migratable;
+/* `mult` matching the TSC frequency; a published baseline may use a smaller one, see
+ * `refresh_vdso_time()` */
+static uint64_t g_vdso_time_mult __attribute_migratable = 0;
+/* serializes the baseline updates; the vDSO only reads the page */
+static spinlock_t g_vdso_time_lock = INIT_SPINLOCK_UNLOCKED;
+/* Last time returned by LibOS. This guards against time rewinding when the baseline is refreshed
+ * from a host time that drifted backwards compared to the TSC-extrapolated time. */
+static uint64_t g_last_ns = 0;
+
+static void free_vdso_time_page(struct libos_vdso_time* time_page) {
+    void* addr = ALLOC_ALIGN_DOWN_PTR(time_page);
+    size_t size = ALLOC_ALIGN_UP(VDSO_TIME_PAGE_OFFSET);
+
+    void* tmp_vma = NULL;
+    if (bkeep_munmap(addr, size, /*is_internal=*/true, &tmp_vma) < 0)
+        BUG();
+    if (PalVirtualMemoryFree(addr, size) < 0)
+        BUG();
+    bkeep_remove_tmp_vma(tmp_vma);
+}
+
+void init_vdso_time(struct libos_vdso_time* time_page) {
+    uint64_t tsc_hz = g_pal_public_state->tsc_hz;
+    spinlock_lock(&g_vdso_time_lock);
+    if (tsc_hz) {
+        time_page->mult       = (1000000000UL << VDSO_TIME_SHIFT) / tsc_hz;
+        time_page->max_cycles = tsc_hz / VDSO_TIME_REFRESH_DIV;
+    }
+    /* otherwise the fields stay zeroed and the vDSO always falls back to the syscalls */
+    g_vdso_time_mult = time_page->mult;
+    g_vdso_time_copy = (struct libos_vdso_time){
+        .mult       = time_page->mult,
+        .max_cycles = time_page->max_cycles,
+    };
+    struct libos_vdso_time* old_time_page = g_vdso_time;
+    g_vdso_time = time_page;
+    spinlock_unlock(&g_vdso_time_lock);
+
+    /* execve() keeps internal VMAs, so the page of the previous executable is still mapped */
+    if (old_time_page && old_time_page != time_page)
+        free_vdso_time_page(old_time_page);
+}
+
+/* Makes the readers of `page` fall back to the syscalls until `end_vdso_time_update()`. */
+static uint32_t begin_vdso_time_update(struct libos_vdso_time* page) {
+    /* the sequence may be left odd by a parent process that forked in the middle of an update */
+    uint32_t seq = __atomic_load_n(&page->seq, __ATOMIC_RELAXED) | 1;
+    __atomic_store_n(&page->seq, seq, __ATOMIC_RELAXED);
+    /* full barrier: the TSC for the new baseline must be read after the readers see `seq` odd */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return seq;
+}
+
+static void end_vdso_time_update(struct libos_vdso_time* page, uint32_t seq, uint64_t tsc,
+                                 uint64_t ns, uint64_t mult) {
+    __atomic_store_n(&page->mult, mult, __ATOMIC_RELAXED);
+    __atomic_store_n(&page->base_tsc, tsc, __ATOMIC_RELAXED);
+    __atomic_store_n(&page->base_ns, ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&page->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Matches a fresh time from PAL with the TSC value in the middle of the query and publishes the
+ * pair as the new baseline, both in the time page and in its LibOS copy.
+ *
+ * The host time is truncated to microseconds and drifts against the TSC, so it may be behind the
+ * time that the previous baseline already handed out. The new baseline thus starts no earlier than
+ * the latest time that the readers of the previous one (and the syscalls) could have returned, and
+ * runs slower than the TSC until it catches up with the host time by the end of its validity. The
+ * slowdown is at most a half, so that the error does not build up over the refreshes.
+ */
+static int refresh_vdso_time(uint64_t* out_ns) {
+    uint64_t tsc1 = get_tsc();
+    uint64_t usec = 0;
+    int ret = PalSystemTimeQuery(&usec);
+    if (ret < 0)
+        return pal_to_unix_errno(ret);
+    uint64_t tsc2 = get_tsc();
+
+    uint64_t host_tsc = tsc1 + (tsc2 - tsc1) / 2;
+    uint64_t host_ns = usec * 1000;
+
+    spinlock_lock(&g_vdso_time_lock);
+    uint32_t copy_seq = begin_vdso_time_update(&g_vdso_time_copy);
+    uint32_t page_seq = begin_vdso_time_update(g_vdso_time);
+
+    uint64_t tsc = get_tsc();
+    uint64_t mult = g_vdso_time_mult;
+    uint64_t max_cycles = g_vdso_time_copy.max_cycles;
+
+    /* a query delayed by more than the baseline validity is only used if nothing newer is known */
+    bool host_stale = tsc - host_tsc >= max_cycles;
+    uint64_t ns = host_ns;
+    if (!host_stale)
+        ns += ((tsc - host_tsc) * mult) >> VDSO_TIME_SHIFT;
+
+    uint64_t floor_ns = __atomic_load_n(&g_last_ns, __ATOMIC_RELAXED);
+    if (g_vdso_time_copy.base_ns) {
+        /* the readers never extrapolate the baseline further than `max_cycles`, nor into the past
+         * (a baseline from another CPU may be slightly ahead of this one's TSC) */
+        uint64_t diff = 0;
+        if (tsc > g_vdso_time_copy.base_tsc)
+            diff = MIN(tsc - g_vdso_time_copy.base_tsc, max_cycles);
+        uint64_t old_ns = g_vdso_time_copy.base_ns
+                          + ((diff * g_vdso_time_copy.mult) >> VDSO_TIME_SHIFT);
+        floor_ns = MAX(floor_ns, old_ns);
+    }
+
+    if (ns < floor_ns) {
+        if (!host_stale) {
+            /* lose `floor_ns - ns` over `max_cycles`; the shift below cannot overflow */
+            uint64_t lag = floor_ns - ns;
+            uint64_t slowdown = mult / 2;
+            if (lag < (1UL << (63 - VDSO_TIME_SHIFT)))
+                slowdown = MIN(slowdown, (lag << VDSO_TIME_SHIFT) / max_cycles);
+            mult -= slowdown;
+        }
+        ns = floor_ns;
+    }
+
+    end_vdso_time_update(g_vdso_time, page_seq, tsc, ns, mult);
+    end_vdso_time_update(&g_vdso_time_copy, copy_seq, tsc, ns, mult);
+    spinlock_unlock(&g_vdso_time_lock);
+
+    *out_ns = ns;
+    return 0;
+}
+
+/* Internal VMAs are not migrated with the rest of the memory, but the vDSO in the child reads the
+ * time page at the same address. */
+BEGIN_CP_FUNC(vdso_time) {
+    __UNUSED(obj);
+    __UNUSED(size);
+    __UNUSED(objp);
+
+    if (!g_vdso_time)
+        return 0;
+
+    struct libos_vma_info vma_info;
+    if (lookup_vma(g_vdso_time, &vma_info) < 0)
+        BUG();
+    assert(vma_info.flags & VMA_INTERNAL);
+    DO_CP(vma, &vma_info, NULL);
+}
+END_CP_FUNC_NO_RS(vdso_time)
+
+/* Returns the time since the Epoch, consistent with the one returned by the vDSO. */
+static int get_time_ns(uint64_t* out_ns) {
+    uint64_t ns;
+    if (g_vdso_time && g_vdso_time_copy.mult) {
+        if (!vdso_time_read(&g_vdso_time_copy, &ns)) {
+            int ret = refresh_vdso_time(&ns);
+            if (ret < 0)
+                return ret;
+        }
+    } else {
+        uint64_t usec = 0;
+        int ret = PalSystemTimeQuery(&usec);
+        if (ret < 0)
+            return pal_to_unix_errno(ret);
+        ns = usec * 1000;
+    }
+
+    /* It's simply `g_last_ns = max(g_last_ns, ns)`, but executed atomically. */
+    uint64_t last_ns = __atomic_load_n(&g_last_ns, __ATOMIC_RELAXED);
+    while (last_ns < ns) {
+        if (__atomic_compare_exchange_n(&g_last_ns, &last_ns, ns, /*weak=*/true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    *out_ns = MAX(ns, last_ns);
+    return 0;
+}
 
 long libos_syscall_gettimeofday(struct __kernel_timeval* tv, struct __kernel_timezone* tz) {
     if (tv) {
@@ -16,13 +206,13 @@ long libos_syscall_gettimeofday(struct __kernel_timeval* tv, struct __kernel_tim
             return -EFAULT;
 
         uint64_t time = 0;
-        int ret = PalSystemTimeQuery(&time);
+        int ret = get_time_ns(&time);
         if (ret < 0) {
-            return pal_to_unix_errno(ret);
+            return ret;
         }
 
-        tv->tv_sec  = time / 1000000;
-        tv->tv_usec = time % 1000000;
+        tv->tv_sec  = time / 1000000000;
+        tv->tv_usec = time % 1000000000 / 1000;
     }
 
     if (tz) {
@@ -42,12 +232,12 @@ long libos_syscall_time(time_t* tloc) {
         return -EFAULT;
 
     uint64_t time = 0;
-    int ret = PalSystemTimeQuery(&time);
+    int ret = get_time_ns(&time);
     if (ret < 0) {
-        return pal_to_unix_errno(ret);
+        return ret;
     }
 
-    time_t t = time / 1000000;
+    time_t t = time / 1000000000;
 
     if (tloc)
         *tloc = t;
@@ -71,13 +261,13 @@ long libos_syscall_clock_gettime(clockid_t which_clock, struct timespec* tp) {
     }
 
     uint64_t time = 0;
-    int ret = PalSystemTimeQuery(&time);
+    int ret = get_time_ns(&time);
     if (ret < 0) {
-        return pal_to_unix_errno(ret);
+        return ret;
     }
 
-    tp->tv_sec  = time / 1000000;
-    tp->tv_nsec = (time % 1000000) * 1000;
+    tp->tv_sec  = time / 1000000000;
+    tp->tv_nsec = time % 1000000000;
     return 0;
 }
 
@@ -97,8 +287,9 @@ long libos_syscall_clock_getres(clockid_t which_clock, struct timespec* tp) {
         if (!is_user_memory_writable(tp, sizeof(*tp)))
             return -EFAULT;
 
+        /* time is extrapolated with RDTSC if possible, otherwise PAL returns microseconds */
         tp->tv_sec  = 0;
-        tp->tv_nsec = 1000;
+        tp->tv_nsec = g_pal_public_state->tsc_hz ? 1 : 1000;
     }
     return 0;
 }
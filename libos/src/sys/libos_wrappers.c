@@ -2,7 +2,7 @@
 /* Copyright (C) 2014 Stony Brook University */
 
 /*
- * Implementation of system calls "readv" and "writev".
+ * Implementation of system calls "readv", "writev", "preadv" and "pwritev".
  */
 
 #include "libos_fs.h"
@@ -15,7 +15,7 @@
  * provide `.readv` and `.writev` callbacks and does not use file position (`hdl->pos`). This most
  * notably affects pipes. */
 
-long libos_syscall_readv(unsigned long fd, struct iovec* vec, unsigned long vlen) {
+static int check_iovec(struct iovec* vec, unsigned long vlen, bool is_write) {
     size_t arr_size;
     if (__builtin_mul_overflow(sizeof(*vec), vlen, &arr_size))
         return -EINVAL;
@@ -26,10 +26,61 @@ long libos_syscall_readv(unsigned long fd, struct iovec* vec, unsigned long vlen
         if (vec[i].iov_base) {
             if (!access_ok(vec[i].iov_base, vec[i].iov_len))
                 return -EINVAL;
-            if (!is_user_memory_writable(vec[i].iov_base, vec[i].iov_len))
+            if (is_write ? !is_user_memory_readable(vec[i].iov_base, vec[i].iov_len)
+                         : !is_user_memory_writable(vec[i].iov_base, vec[i].iov_len))
                 return -EFAULT;
         }
     }
+    return 0;
+}
+
+static ssize_t do_readv(struct libos_handle* hdl, struct iovec* vec, size_t vlen, file_off_t* pos) {
+    if (hdl->fs->fs_ops->readv)
+        return hdl->fs->fs_ops->readv(hdl, vec, vlen, pos);
+
+    if (!hdl->fs->fs_ops->read)
+        return -EACCES;
+
+    ssize_t bytes = 0;
+    for (size_t i = 0; i < vlen; i++) {
+        if (!vec[i].iov_base)
+            continue;
+
+        ssize_t b_vec = hdl->fs->fs_ops->read(hdl, vec[i].iov_base, vec[i].iov_len, pos);
+        if (b_vec < 0)
+            return bytes ?: b_vec;
+
+        bytes += b_vec;
+    }
+    return bytes;
+}
+
+static ssize_t do_writev(struct libos_handle* hdl, struct iovec* vec, size_t vlen,
+                         file_off_t* pos) {
+    if (hdl->fs->fs_ops->writev)
+        return hdl->fs->fs_ops->writev(hdl, vec, vlen, pos);
+
+    if (!hdl->fs->fs_ops->write)
+        return -EACCES;
+
+    ssize_t bytes = 0;
+    for (size_t i = 0; i < vlen; i++) {
+        if (!vec[i].iov_base)
+            continue;
+
+        ssize_t b_vec = hdl->fs->fs_ops->write(hdl, vec[i].iov_base, vec[i].iov_len, pos);
+        if (b_vec < 0)
+            return bytes ?: b_vec;
+
+        bytes += b_vec;
+    }
+    return bytes;
+}
+
+long libos_syscall_readv(unsigned long fd, struct iovec* vec, unsigned long vlen) {
+    int ret = check_iovec(vec, vlen, /*is_write=*/false);
+    if (ret < 0)
+        return ret;
 
     struct libos_handle* hdl = get_fd_handle(fd, NULL, NULL);
     if (!hdl)
@@ -37,8 +88,6 @@ long libos_syscall_readv(unsigned long fd, struct iovec* vec, unsigned long vlen
 
     lock(&hdl->pos_lock);
 
-    int ret = 0;
-
     if (hdl->is_dir) {
         ret = -EISDIR;
         goto out;
@@ -49,31 +98,38 @@ long libos_syscall_readv(unsigned long fd, struct iovec* vec, unsigned long vlen
         goto out;
     }
 
-    if (hdl->fs->fs_ops->readv) {
-        ret = hdl->fs->fs_ops->readv(hdl, vec, vlen, &hdl->pos);
-        goto out;
+    ret = do_readv(hdl, vec, vlen, &hdl->pos);
+out:
+    unlock(&hdl->pos_lock);
+    put_handle(hdl);
+    if (ret == -EINTR) {
+        ret = -ERESTARTSYS;
     }
+    return ret;
+}
 
-    if (!hdl->fs->fs_ops->read) {
-        ret = -EACCES;
-        goto out;
-    }
+long libos_syscall_writev(unsigned long fd, struct iovec* vec, unsigned long vlen) {
+    int ret = check_iovec(vec, vlen, /*is_write=*/true);
+    if (ret < 0)
+        return ret;
 
-    ssize_t bytes = 0;
-    for (size_t i = 0; i < vlen; i++) {
-        if (!vec[i].iov_base)
-            continue;
+    struct libos_handle* hdl = get_fd_handle(fd, NULL, NULL);
+    if (!hdl)
+        return -EBADF;
 
-        ssize_t b_vec = hdl->fs->fs_ops->read(hdl, vec[i].iov_base, vec[i].iov_len, &hdl->pos);
-        if (b_vec < 0) {
-            ret = bytes ?: b_vec;
-            goto out;
-        }
+    lock(&hdl->pos_lock);
 
-        bytes += b_vec;
+    if (hdl->is_dir) {
+        ret = -EISDIR;
+        goto out;
     }
 
-    ret = bytes;
+    if (!(hdl->acc_mode & MAY_WRITE) || !hdl->fs || !hdl->fs->fs_ops) {
+        ret = -EACCES;
+        goto out;
+    }
+
+    ret = do_writev(hdl, vec, vlen, &hdl->pos);
 out:
     unlock(&hdl->pos_lock);
     put_handle(hdl);
@@ -83,67 +139,93 @@ out:
     return ret;
 }
 
-long libos_syscall_writev(unsigned long fd, struct iovec* vec, unsigned long vlen) {
-    size_t arr_size;
-    if (__builtin_mul_overflow(sizeof(*vec), vlen, &arr_size))
-        return -EINVAL;
-    if (!is_user_memory_readable(vec, arr_size))
+/* On 64-bit architectures the offset is passed whole in `pos_l`; `pos_h` is ignored like in Linux.
+ * As with `pread64`/`pwrite64`, the file position is neither used nor updated. */
+long libos_syscall_preadv(unsigned long fd, struct iovec* vec, unsigned long vlen,
+                          unsigned long pos_l, unsigned long pos_h) {
+    __UNUSED(pos_h);
+    file_off_t pos = (file_off_t)pos_l;
+    if (pos < 0)
         return -EINVAL;
 
-    for (size_t i = 0; i < vlen; i++) {
-        if (vec[i].iov_base) {
-            if (!access_ok(vec[i].iov_base, vec[i].iov_len))
-                return -EINVAL;
-            if (!is_user_memory_readable(vec[i].iov_base, vec[i].iov_len))
-                return -EFAULT;
-        }
-    }
+    ssize_t ret = check_iovec(vec, vlen, /*is_write=*/false);
+    if (ret < 0)
+        return ret;
 
     struct libos_handle* hdl = get_fd_handle(fd, NULL, NULL);
     if (!hdl)
         return -EBADF;
 
-    lock(&hdl->pos_lock);
+    struct libos_fs* fs = hdl->fs;
+
+    if (!(hdl->acc_mode & MAY_READ)) {
+        ret = -EBADF;
+        goto out;
+    }
+
+    if (!fs || !fs->fs_ops) {
+        ret = -EACCES;
+        goto out;
+    }
 
-    int ret = 0;
+    if (!fs->fs_ops->seek) {
+        ret = -ESPIPE;
+        goto out;
+    }
 
     if (hdl->is_dir) {
         ret = -EISDIR;
         goto out;
     }
 
-    if (!(hdl->acc_mode & MAY_WRITE) || !hdl->fs || !hdl->fs->fs_ops) {
-        ret = -EACCES;
-        goto out;
+    ret = do_readv(hdl, vec, vlen, &pos);
+out:
+    put_handle(hdl);
+    if (ret == -EINTR) {
+        ret = -ERESTARTSYS;
     }
+    return ret;
+}
+
+long libos_syscall_pwritev(unsigned long fd, struct iovec* vec, unsigned long vlen,
+                           unsigned long pos_l, unsigned long pos_h) {
+    __UNUSED(pos_h);
+    file_off_t pos = (file_off_t)pos_l;
+    if (pos < 0)
+        return -EINVAL;
+
+    ssize_t ret = check_iovec(vec, vlen, /*is_write=*/true);
+    if (ret < 0)
+        return ret;
+
+    struct libos_handle* hdl = get_fd_handle(fd, NULL, NULL);
+    if (!hdl)
+        return -EBADF;
+
+    struct libos_fs* fs = hdl->fs;
 
-    if (hdl->fs->fs_ops->writev) {
-        ret = hdl->fs->fs_ops->writev(hdl, vec, vlen, &hdl->pos);
+    if (!(hdl->acc_mode & MAY_WRITE)) {
+        ret = -EBADF;
         goto out;
     }
 
-    if (!hdl->fs->fs_ops->write) {
+    if (!fs || !fs->fs_ops) {
         ret = -EACCES;
         goto out;
     }
 
-    ssize_t bytes = 0;
-    for (size_t i = 0; i < vlen; i++) {
-        if (!vec[i].iov_base)
-            continue;
-
-        ssize_t b_vec = hdl->fs->fs_ops->write(hdl, vec[i].iov_base, vec[i].iov_len, &hdl->pos);
-        if (b_vec < 0) {
-            ret = bytes ?: b_vec;
-            goto out;
-        }
+    if (!fs->fs_ops->seek) {
+        ret = -ESPIPE;
+        goto out;
+    }
 
-        bytes += b_vec;
+    if (hdl->is_dir) {
+        ret = -EISDIR;
+        goto out;
     }
 
-    ret = bytes;
+    ret = do_writev(hdl, vec, vlen, &pos);
 out:
-    unlock(&hdl->pos_lock);
     put_handle(hdl);
     if (ret == -EINTR) {
         ret = -ERESTARTSYS;
@@ -6,6 +6,7 @@
  *                    Borys Popławski <borysp@invisiblethingslab.com>
  */
 
+#include "libos_vdso.h"
 #include "linux_abi/time.h"
 #include "linux_abi/syscalls_nr_arch.h"
 #include "vdso.h"
@@ -24,17 +25,52 @@
 #define EXPORT_WEAK_SYMBOL(name) \
     __typeof__(__vdso_##name) name __attribute__((weak, alias("__vdso_" #name)))
 
+/* Populated by LibOS; placed right before the vDSO image by the linker script. Hidden, so that it is
+ * accessed RIP-relative, without relocations. */
+extern const struct libos_vdso_time vdso_time_page __attribute__((visibility("hidden")));
+
 int __vdso_clock_gettime(clockid_t clock, struct timespec* t) {
+    uint64_t ns;
+    switch (clock) {
+        /* LibOS does not distinguish these clocks, see `libos_syscall_clock_gettime()` */
+        case CLOCK_REALTIME:
+        case CLOCK_MONOTONIC:
+        case CLOCK_MONOTONIC_RAW:
+        case CLOCK_REALTIME_COARSE:
+        case CLOCK_MONOTONIC_COARSE:
+        case CLOCK_BOOTTIME:
+            if (vdso_time_read(&vdso_time_page, &ns)) {
+                t->tv_sec  = ns / 1000000000;
+                t->tv_nsec = ns % 1000000000;
+                return 0;
+            }
+            break;
+        default:
+            break;
+    }
     return vdso_arch_syscall(__NR_clock_gettime, (long)clock, (long)t);
 }
 EXPORT_WEAK_SYMBOL(clock_gettime);
 
 int __vdso_gettimeofday(struct timeval* tv, struct timezone* tz) {
+    uint64_t ns;
+    if (!tz && tv && vdso_time_read(&vdso_time_page, &ns)) {
+        tv->tv_sec  = ns / 1000000000;
+        tv->tv_usec = ns % 1000000000 / 1000;
+        return 0;
+    }
     return vdso_arch_syscall(__NR_gettimeofday, (long)tv, (long)tz);
 }
 EXPORT_WEAK_SYMBOL(gettimeofday);
 
 time_t __vdso_time(time_t* t) {
+    uint64_t ns;
+    if (vdso_time_read(&vdso_time_page, &ns)) {
+        time_t sec = ns / 1000000000;
+        if (t)
+            *t = sec;
+        return sec;
+    }
     return vdso_arch_syscall(__NR_time, (long)t, 0);
 }
 EXPORT_WEAK_SYMBOL(time);
@@ -92,6 +92,174 @@ void sendfile_fd(const char* input_path, const char* output_path, int fi, int fo
     }
 }
 
+void copy_file_range_fd(const char* input_path, const char* output_path, int fi, int fo,
+                        size_t size) {
+    while (size > 0) {
+        ssize_t ret = copy_file_range(fi, /*off_in=*/NULL, fo, /*off_out=*/NULL, size, /*flags=*/0);
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            fatal_error("Failed to copy_file_range from %s to %s: %s\n", input_path, output_path,
+                        strerror(errno));
+        }
+        if (ret == 0)
+            fatal_error("Unexpected end of file %s\n", input_path);
+        size -= ret;
+    }
+}
+
+/* Connects two TCP sockets over loopback; the sending one is non-blocking. */
+static void open_socket_pair(int* out_send_fd, int* out_recv_fd) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    socklen_t addrlen = sizeof(addr);
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+        fatal_error("Failed to create a socket: %s\n", strerror(errno));
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+            || listen(listen_fd, 1) < 0
+            || getsockname(listen_fd, (struct sockaddr*)&addr, &addrlen) < 0)
+        fatal_error("Failed to set up a listening socket: %s\n", strerror(errno));
+
+    int send_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (send_fd < 0)
+        fatal_error("Failed to create a socket: %s\n", strerror(errno));
+    if (connect(send_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS)
+        fatal_error("Failed to connect: %s\n", strerror(errno));
+
+    int recv_fd = accept(listen_fd, NULL, NULL);
+    if (recv_fd < 0)
+        fatal_error("Failed to accept: %s\n", strerror(errno));
+    close_fd("listening socket", listen_fd);
+
+    struct pollfd pfd = { .fd = send_fd, .events = POLLOUT };
+    if (poll(&pfd, 1, /*timeout=*/-1) < 0)
+        fatal_error("Failed to poll: %s\n", strerror(errno));
+
+    *out_send_fd = send_fd;
+    *out_recv_fd = recv_fd;
+}
+
+/* Writes everything that can be received from `recv_fd` without blocking (or, if `until_eof`,
+ * everything until the peer closes the connection) to `fo`. */
+static void drain_socket(const char* output_path, int recv_fd, int fo, bool until_eof) {
+    static char buf[64 * 1024];
+    while (true) {
+        ssize_t ret = recv(recv_fd, buf, sizeof(buf), until_eof ? 0 : MSG_DONTWAIT);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN && !until_eof)
+                return;
+            fatal_error("Failed to recv data for %s: %s\n", output_path, strerror(errno));
+        }
+        if (ret == 0)
+            return;
+        write_fd(output_path, fo, buf, ret);
+    }
+}
+
+/* Waits until the sending socket is writable, receiving the data that fills the connection. */
+static void wait_for_socket_space(const char* output_path, int send_fd, int recv_fd, int fo) {
+    while (true) {
+        drain_socket(output_path, recv_fd, fo, /*until_eof=*/false);
+        struct pollfd pfd = { .fd = send_fd, .events = POLLOUT };
+        int ret = poll(&pfd, 1, /*timeout=*/10);
+        if (ret < 0 && errno != EINTR)
+            fatal_error("Failed to poll: %s\n", strerror(errno));
+        if (ret > 0)
+            return;
+    }
+}
+
+/* Splices up to `size` bytes from `fi` to `send_fd` through a pipe, for hosts where one end of
+ * splice() must be a pipe. Returns the number of bytes moved to `send_fd`. */
+static size_t splice_through_pipe(const char* input_path, const char* output_path, int fi,
+                                  int send_fd, int recv_fd, int fo, size_t size) {
+    int pipefd[2];
+    if (pipe(pipefd) < 0)
+        fatal_error("Failed to create a pipe: %s\n", strerror(errno));
+
+    ssize_t in_pipe = splice(fi, /*off_in=*/NULL, pipefd[1], /*off_out=*/NULL, size, /*flags=*/0);
+    if (in_pipe <= 0)
+        fatal_error("Failed to splice from %s to a pipe: %s\n", input_path,
+                    in_pipe < 0 ? strerror(errno) : "EOF");
+
+    for (ssize_t done = 0; done < in_pipe;) {
+        ssize_t ret = splice(pipefd[0], /*off_in=*/NULL, send_fd, /*off_out=*/NULL,
+                             in_pipe - done, /*flags=*/0);
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                wait_for_socket_space(output_path, send_fd, recv_fd, fo);
+                continue;
+            }
+            fatal_error("Failed to splice from a pipe to a socket for %s: %s\n", output_path,
+                        strerror(errno));
+        }
+        done += ret;
+    }
+
+    close_fd("pipe", pipefd[0]);
+    close_fd("pipe", pipefd[1]);
+    return in_pipe;
+}
+
+/* Sends `fi` over a TCP connection with sendfile() or splice() and writes the received data to
+ * `fo`, in a single thread (the sending socket is non-blocking). */
+static void copy_through_socket(const char* input_path, const char* output_path, int fi, int fo,
+                                size_t size, bool use_splice) {
+    int send_fd;
+    int recv_fd;
+    open_socket_pair(&send_fd, &recv_fd);
+
+    bool splice_needs_pipe = false;
+    while (size > 0) {
+        ssize_t ret;
+        if (!use_splice) {
+            ret = sendfile(send_fd, fi, /*offset=*/NULL, size);
+        } else if (!splice_needs_pipe) {
+            ret = splice(fi, /*off_in=*/NULL, send_fd, /*off_out=*/NULL, size, /*flags=*/0);
+            if (ret < 0 && errno == EINVAL) {
+                /* Linux requires a pipe at one end of splice(), Gramine does not */
+                splice_needs_pipe = true;
+                continue;
+            }
+        } else {
+            ret = splice_through_pipe(input_path, output_path, fi, send_fd, recv_fd, fo, size);
+        }
+
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                wait_for_socket_space(output_path, send_fd, recv_fd, fo);
+                continue;
+            }
+            fatal_error("Failed to %s from %s to a socket: %s\n",
+                        use_splice ? "splice" : "sendfile", input_path, strerror(errno));
+        }
+        if (ret == 0)
+            fatal_error("Unexpected end of file %s\n", input_path);
+        size -= ret;
+    }
+
+    close_fd("sending socket", send_fd);
+    drain_socket(output_path, recv_fd, fo, /*until_eof=*/true);
+    close_fd("receiving socket", recv_fd);
+}
+
+void sendfile_socket_fd(const char* input_path, const char* output_path, int fi, int fo,
+                        size_t size) {
+    copy_through_socket(input_path, output_path, fi, fo, size, /*use_splice=*/false);
+}
+
+void splice_socket_fd(const char* input_path, const char* output_path, int fi, int fo,
+                      size_t size) {
+    copy_through_socket(input_path, output_path, fi, fo, size, /*use_splice=*/true);
+}
+
 void close_fd(const char* path, int fd) {
     if (fd >= 0 && close(fd) != 0)
         fatal_error("Failed to close file %s: %s\n", path, strerror(errno));
@@ -7,6 +7,8 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <netinet/in.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -16,6 +18,7 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/sendfile.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
@@ -40,6 +43,12 @@ off_t tell_fd(const char* path, int fd);
 int open_output_fd(const char* path, bool rdwr);
 void write_fd(const char* path, int fd, const void* buffer, size_t size);
 void sendfile_fd(const char* input_path, const char* output_path, int fi, int fo, size_t size);
+void copy_file_range_fd(const char* input_path, const char* output_path, int fi, int fo,
+                        size_t size);
+void sendfile_socket_fd(const char* input_path, const char* output_path, int fi, int fo,
+                        size_t size);
+void splice_socket_fd(const char* input_path, const char* output_path, int fi, int fo,
+                      size_t size);
 void close_fd(const char* path, int fd);
 void* mmap_fd(const char* path, int fd, int protection, size_t offset, size_t size);
 void munmap_fd(const char* path, void* address, size_t size);
@@ -285,6 +285,12 @@ class TC_00_FileSystem(RegressionTestCase):
                 self.assertIn('write_fd(' + size + ') output OK', stdout)
             if executable == 'copy_sendfile':
                 self.assertIn('sendfile_fd(' + size + ') OK', stdout)
+            if executable == 'copy_copy_file_range':
+                self.assertIn('copy_file_range_fd(' + size + ') OK', stdout)
+            if executable == 'copy_sendfile_socket':
+                self.assertIn('sendfile_socket_fd(' + size + ') OK', stdout)
+            if executable == 'copy_splice_socket':
+                self.assertIn('splice_socket_fd(' + size + ') OK', stdout)
             if size != '0':
                 if 'copy_mmap' in executable:
                     self.assertIn('mmap_fd(' + size + ') input OK', stdout)
@@ -317,6 +323,15 @@ class TC_00_FileSystem(RegressionTestCase):
     def test_203_copy_dir_sendfile(self):
         self.do_copy_test('copy_sendfile', 60)
 
+    def test_207_copy_dir_copy_file_range(self):
+        self.do_copy_test('copy_copy_file_range', 60)
+
+    def test_208_copy_dir_sendfile_socket(self):
+        self.do_copy_test('copy_sendfile_socket', 60)
+
+    def test_209_copy_dir_splice_socket(self):
+        self.do_copy_test('copy_splice_socket', 60)
+
     # Gramine's implementation of file_map doesn't currently support shared memory-mapped
     # files with write permission in PAL/Linux-SGX (like mmap(PROT_WRITE, MAP_SHARED, fd)).
     # These tests require it, so skip them. We decided not to implement it as we don't
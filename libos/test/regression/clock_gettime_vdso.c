@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Micro-benchmark for `clock_gettime()` through the vDSO: several threads read the clock in a loop
+ * and the average time per call is reported (it should be far below the cost of a syscall when
+ * RDTSC is usable). Also checks that the clock never goes backwards in a thread, that it advances
+ * over `nanosleep()`, that `gettimeofday()` and `time()` agree with it, and that the app cannot
+ * unmap or protect the time page that precedes the vDSO image.
+ */
+
+#define _GNU_SOURCE
+#include <err.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/auxv.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_THREADS    4
+#define DEFAULT_ITERATIONS 1000000
+
+static unsigned long g_iterations;
+
+static uint64_t time_ns(clockid_t clock) {
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) < 0)
+        err(1, "clock_gettime");
+    if (ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000)
+        errx(1, "clock_gettime returned invalid nanoseconds: %ld", ts.tv_nsec);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void* clock_thread(void* arg) {
+    clockid_t clock = (clockid_t)(long)arg;
+    uint64_t prev = time_ns(clock);
+    for (unsigned long i = 0; i < g_iterations; i++) {
+        uint64_t now = time_ns(clock);
+        if (now < prev)
+            errx(1, "clock %d went backwards: %lu ns after %lu ns", clock, now, prev);
+        prev = now;
+    }
+    return NULL;
+}
+
+static void check_other_calls(void) {
+    uint64_t before = time_ns(CLOCK_REALTIME);
+    struct timeval tv;
+    if (gettimeofday(&tv, NULL) < 0)
+        err(1, "gettimeofday");
+    time_t t = time(NULL);
+    if (t == (time_t)-1)
+        err(1, "time");
+    uint64_t after = time_ns(CLOCK_REALTIME);
+
+    uint64_t tv_ns = tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+    /* gettimeofday() truncates to microseconds, time() to seconds */
+    if (tv_ns + 1000 < before || tv_ns > after)
+        errx(1, "gettimeofday returned %lu ns, outside of [%lu, %lu] ns", tv_ns, before, after);
+    if ((uint64_t)t < before / 1000000000 || (uint64_t)t > after / 1000000000)
+        errx(1, "time returned %ld s, outside of [%lu, %lu] ns", (long)t, before, after);
+}
+
+static void check_sleep(void) {
+    struct timespec req = {.tv_sec = 0, .tv_nsec = 100 * 1000 * 1000};
+    uint64_t start = time_ns(CLOCK_MONOTONIC);
+    if (nanosleep(&req, NULL) < 0)
+        err(1, "nanosleep");
+    uint64_t slept = time_ns(CLOCK_MONOTONIC) - start;
+    /* allow for the microsecond granularity of the time from the host */
+    if (slept + 1000 < (uint64_t)req.tv_nsec)
+        errx(1, "slept for %lu ns, expected at least %ld ns", slept, req.tv_nsec);
+}
+
+static void check_time_page(void) {
+    char* vdso = (char*)getauxval(AT_SYSINFO_EHDR);
+    if (!vdso)
+        errx(1, "no vDSO");
+    long page_size = sysconf(_SC_PAGESIZE);
+    char* time_page = vdso - page_size;
+
+    /* LibOS keeps the page, so the vDSO must still work after these calls (which either fail or do
+     * nothing) */
+    if (mprotect(time_page, page_size, PROT_NONE) == 0)
+        errx(1, "mprotect on the vDSO time page succeeded");
+    if (munmap(time_page, page_size) < 0)
+        err(1, "munmap");
+    for (int i = 0; i < 100; i++)
+        check_other_calls();
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads_cnt = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_THREADS;
+    g_iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_ITERATIONS;
+    if (!threads_cnt || !g_iterations)
+        errx(1, "number of threads and iterations must be positive");
+
+    pthread_t* threads = calloc(threads_cnt, sizeof(*threads));
+    if (!threads)
+        err(1, "calloc");
+
+    static const clockid_t clocks[] = {CLOCK_REALTIME, CLOCK_MONOTONIC, CLOCK_MONOTONIC_COARSE};
+    uint64_t start = time_ns(CLOCK_MONOTONIC);
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        clockid_t clock = clocks[i % (sizeof(clocks) / sizeof(clocks[0]))];
+        int ret = pthread_create(&threads[i], NULL, clock_thread, (void*)(long)clock);
+        if (ret)
+            errx(1, "pthread_create: %d", ret);
+    }
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        int ret = pthread_join(threads[i], NULL);
+        if (ret)
+            errx(1, "pthread_join: %d", ret);
+    }
+    uint64_t total_ns = time_ns(CLOCK_MONOTONIC) - start;
+    free(threads);
+
+    for (int i = 0; i < 100; i++)
+        check_other_calls();
+    check_sleep();
+    check_time_page();
+
+    printf("%lu threads: %lu ns per clock_gettime() call\n", threads_cnt,
+           total_ns / g_iterations);
+    puts("TEST OK");
+    return 0;
+}
@@ -8,6 +8,8 @@
 
 #include <assert.h>
 #include <err.h>
+#include <stdint.h>
+#include <time.h>
 
 #define OVERFLOWS(type, val)                        \
     ({                                              \
@@ -30,3 +32,11 @@
     static_assert(IS_STATIC_ARRAY(arr), "not a static array");  \
     sizeof(arr) / sizeof(arr[0]);                               \
 })
+
+/* Returns the time of CLOCK_MONOTONIC in nanoseconds, for tests that also report their timings. */
+static inline uint64_t time_ns(void) {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0)
+        err(1, "clock_gettime");
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -0,0 +1,263 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Test for epoll with many idle connections: registers both ends of many TCP loopback connections
+ * with one epoll instance, then repeatedly sends a byte over a single "active" connection and waits
+ * for it with `epoll_wait()`. The time per iteration (which is reported) should not grow with the
+ * number of idle connections. Checks that:
+ *
+ * - only the active socket is reported, and it is reported again until its data is read (epoll is
+ *   level-triggered),
+ * - when many sockets become ready at once, each of them is reported exactly once per read, also
+ *   across several `epoll_wait()` calls,
+ * - `EPOLL_CTL_MOD` changes the reported events,
+ * - a duplicated fd of a registered socket can be registered too, and both fds are reported,
+ * - `EPOLL_CTL_ADD` of a registered fd fails with EEXIST, `EPOLL_CTL_MOD` and `EPOLL_CTL_DEL` of
+ *   an unregistered fd fail with ENOENT,
+ * - removed (and closed) sockets are not reported anymore, and a removed socket can be added back.
+ */
+
+#include <arpa/inet.h>
+#include <err.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "common.h"
+
+#define DEFAULT_CONNECTIONS 5000
+#define DEFAULT_ITERATIONS  10000
+#define MAX_READY           100
+
+static void raise_fd_limit(unsigned long needed) {
+    struct rlimit rlim;
+    if (getrlimit(RLIMIT_NOFILE, &rlim) < 0)
+        err(1, "getrlimit");
+    if (rlim.rlim_cur >= needed)
+        return;
+    if (rlim.rlim_max < needed)
+        errx(1, "need %lu fds, but the hard limit is %lu", needed, (unsigned long)rlim.rlim_max);
+    rlim.rlim_cur = needed;
+    if (setrlimit(RLIMIT_NOFILE, &rlim) < 0)
+        err(1, "setrlimit");
+}
+
+static void epoll_ctl_fd(int epfd, int op, int fd, uint32_t events) {
+    struct epoll_event event = {
+        .events = events,
+        .data.fd = fd,
+    };
+    CHECK(epoll_ctl(epfd, op, fd, &event));
+}
+
+static void epoll_add(int epfd, int fd) {
+    epoll_ctl_fd(epfd, EPOLL_CTL_ADD, fd, EPOLLIN);
+}
+
+static void expect_ctl_error(int epfd, int op, int fd, int expected_errno, const char* desc) {
+    struct epoll_event event = {
+        .events = EPOLLIN,
+        .data.fd = fd,
+    };
+    int ret = epoll_ctl(epfd, op, fd, &event);
+    if (ret != -1 || errno != expected_errno)
+        errx(1, "%s did not fail with %s (returned %d)", desc, strerror(expected_errno), ret);
+}
+
+static int poll_events(int epfd, struct epoll_event* events, int max_events, int timeout) {
+    return CHECK(epoll_wait(epfd, events, max_events, timeout));
+}
+
+static void send_byte(int fd) {
+    char c = 'a';
+    if (CHECK(write(fd, &c, 1)) != 1)
+        errx(1, "short write");
+}
+
+static void recv_byte(int fd) {
+    char c;
+    if (CHECK(read(fd, &c, 1)) != 1)
+        errx(1, "short read");
+}
+
+static void expect_one_event(int epfd, int fd, uint32_t events, int timeout, const char* desc) {
+    struct epoll_event ev[16];
+    int ret = poll_events(epfd, ev, 16, timeout);
+    if (ret != 1 || ev[0].data.fd != fd || (ev[0].events & events) != events)
+        errx(1, "%s: epoll_wait returned unexpected events (%d)", desc, ret);
+}
+
+static void expect_no_events(int epfd, const char* desc) {
+    struct epoll_event ev[16];
+    int ret = poll_events(epfd, ev, 16, 0);
+    if (ret != 0)
+        errx(1, "%s: epoll_wait returned %d", desc, ret);
+}
+
+static void test_level_triggered(int epfd, int client, int server) {
+    send_byte(client);
+    expect_one_event(epfd, server, EPOLLIN, -1, "level-triggered (first wait)");
+    expect_one_event(epfd, server, EPOLLIN, 0, "level-triggered (second wait)");
+    recv_byte(server);
+    expect_no_events(epfd, "level-triggered (after read)");
+}
+
+/* Makes the first `count` connections ready at once; `fds` is laid out as in main() */
+static void test_many_ready(int epfd, int* fds, unsigned long count) {
+    bool seen[MAX_READY] = { false };
+    for (unsigned long i = 0; i < count; i++)
+        send_byte(fds[2 * i]);
+
+    unsigned long seen_cnt = 0;
+    while (seen_cnt < count) {
+        struct epoll_event ev[16];
+        int ret = poll_events(epfd, ev, 16, -1);
+        for (int j = 0; j < ret; j++) {
+            unsigned long i = 0;
+            while (i < count && fds[2 * i + 1] != ev[j].data.fd)
+                i++;
+            if (i == count)
+                errx(1, "many ready: epoll_wait reported fd %d, which is not ready", ev[j].data.fd);
+            if (seen[i])
+                errx(1, "many ready: epoll_wait reported fd %d twice", ev[j].data.fd);
+            seen[i] = true;
+            seen_cnt++;
+            recv_byte(ev[j].data.fd);
+        }
+    }
+    expect_no_events(epfd, "many ready (after reads)");
+}
+
+static void test_mod(int epfd, int server) {
+    epoll_ctl_fd(epfd, EPOLL_CTL_MOD, server, EPOLLOUT);
+    expect_one_event(epfd, server, EPOLLOUT, 0, "EPOLL_CTL_MOD to EPOLLOUT");
+    epoll_ctl_fd(epfd, EPOLL_CTL_MOD, server, EPOLLIN);
+    expect_no_events(epfd, "EPOLL_CTL_MOD back to EPOLLIN");
+}
+
+static void test_dup(int epfd, int client, int server) {
+    int dup_fd = CHECK(dup(server));
+    epoll_add(epfd, dup_fd);
+    expect_no_events(epfd, "duplicated fd (idle)");
+
+    send_byte(client);
+    struct epoll_event ev[16];
+    poll_events(epfd, ev, 16, -1);
+    int ret = poll_events(epfd, ev, 16, 0);
+    if (ret != 2 || ev[0].data.fd == ev[1].data.fd
+            || (ev[0].data.fd != server && ev[0].data.fd != dup_fd)
+            || (ev[1].data.fd != server && ev[1].data.fd != dup_fd))
+        errx(1, "duplicated fd: epoll_wait returned unexpected events (%d)", ret);
+    recv_byte(server);
+
+    epoll_ctl_fd(epfd, EPOLL_CTL_DEL, dup_fd, 0);
+    CHECK(close(dup_fd));
+    expect_no_events(epfd, "duplicated fd (after read)");
+}
+
+int main(int argc, char** argv) {
+    unsigned long connections = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_CONNECTIONS;
+    unsigned long iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_ITERATIONS;
+    if (!connections)
+        errx(1, "number of connections must be positive");
+    if (!iterations)
+        errx(1, "number of iterations must be positive");
+
+    /* two fds per connection, plus stdio, listening socket and epoll */
+    raise_fd_limit(2 * connections + 16);
+
+    int* fds = malloc(2 * connections * sizeof(*fds));
+    if (!fds)
+        err(1, "malloc");
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+        err(1, "socket");
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+        .sin_port = 0,
+    };
+    socklen_t addrlen = sizeof(addr);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        err(1, "bind");
+    if (getsockname(listen_fd, (struct sockaddr*)&addr, &addrlen) < 0)
+        err(1, "getsockname");
+    if (listen(listen_fd, 128) < 0)
+        err(1, "listen");
+
+    for (unsigned long i = 0; i < connections; i++) {
+        int client = socket(AF_INET, SOCK_STREAM, 0);
+        if (client < 0)
+            err(1, "socket");
+        if (connect(client, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+            err(1, "connect");
+        int server = accept(listen_fd, NULL, NULL);
+        if (server < 0)
+            err(1, "accept");
+        fds[2 * i] = client;
+        fds[2 * i + 1] = server;
+    }
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0)
+        err(1, "epoll_create1");
+
+    uint64_t start = time_ns();
+    for (unsigned long i = 0; i < 2 * connections; i++)
+        epoll_add(epfd, fds[i]);
+    uint64_t add_ns = time_ns() - start;
+
+    expect_no_events(epfd, "idle sockets");
+
+    /* the active connection is the one registered last */
+    int active_client = fds[2 * connections - 2];
+    int active_server = fds[2 * connections - 1];
+
+    start = time_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        send_byte(active_client);
+        expect_one_event(epfd, active_server, EPOLLIN, -1, "active connection");
+        recv_byte(active_server);
+    }
+    uint64_t wait_ns = time_ns() - start;
+
+    test_level_triggered(epfd, active_client, active_server);
+    test_many_ready(epfd, fds, connections < MAX_READY ? connections : MAX_READY);
+    test_mod(epfd, fds[1]);
+    test_dup(epfd, active_client, active_server);
+
+    expect_ctl_error(epfd, EPOLL_CTL_ADD, active_server, EEXIST,
+                     "EPOLL_CTL_ADD of a registered fd");
+    expect_ctl_error(epfd, EPOLL_CTL_MOD, listen_fd, ENOENT, "EPOLL_CTL_MOD of an unregistered fd");
+    expect_ctl_error(epfd, EPOLL_CTL_DEL, listen_fd, ENOENT, "EPOLL_CTL_DEL of an unregistered fd");
+
+    /* removed and closed sockets must not be reported anymore */
+    epoll_ctl_fd(epfd, EPOLL_CTL_DEL, active_server, 0);
+    send_byte(active_client);
+    expect_no_events(epfd, "after EPOLL_CTL_DEL");
+    epoll_add(epfd, active_server);
+    expect_one_event(epfd, active_server, EPOLLIN, -1, "added back after EPOLL_CTL_DEL");
+
+    for (unsigned long i = 0; i < 2 * connections; i++)
+        CHECK(close(fds[i]));
+    expect_no_events(epfd, "after close");
+
+    if (close(epfd) < 0 || close(listen_fd) < 0)
+        err(1, "close");
+    free(fds);
+
+    printf("%lu idle connections: registered in %lu us, %lu ns per write/epoll_wait/read\n",
+           connections, add_ns / 1000, wait_ns / iterations);
+    puts("TEST OK");
+    return 0;
+}
@@ -0,0 +1,240 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Test for the file descriptor table: several threads `read()` and `write()` in a loop, each on its
+ * own fds (`/dev/zero` and `/dev/null`), so that the time is dominated by fd lookups. Threads use
+ * distinct fds, so the time per call (which is reported) should not grow with the number of
+ * threads. Checks that:
+ *
+ * - with many open fds, new fds still get the lowest free number, also while other threads look
+ *   up their fds (and the table is enlarged under them),
+ * - a thread using an fd which another thread closes and re-creates gets either the old or the new
+ *   file, or EBADF, but never anything else,
+ * - closed fds fail with EBADF, fds above the limit cannot be created (EBADF for `dup2()`, EMFILE
+ *   for `dup()`).
+ */
+
+#define _GNU_SOURCE
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "common.h"
+
+#define DEFAULT_THREADS    4
+#define DEFAULT_ITERATIONS 100000
+#define DEFAULT_FDS        10000
+#define CHURN_ROUNDS       10000
+#define EMFILE_SPARE_FDS   8
+
+struct rw_fds {
+    int zero_fd;
+    int null_fd;
+};
+
+static unsigned long g_iterations;
+
+static void read_zero_byte(int fd) {
+    char c = 'a';
+    if (CHECK(read(fd, &c, 1)) != 1)
+        errx(1, "short read");
+    if (c != 0)
+        errx(1, "read from /dev/zero returned a non-zero byte");
+}
+
+static void* rw_thread(void* arg) {
+    struct rw_fds* fds = arg;
+
+    for (unsigned long i = 0; i < g_iterations; i++) {
+        read_zero_byte(fds->zero_fd);
+        char c = 0;
+        if (CHECK(write(fds->null_fd, &c, 1)) != 1)
+            errx(1, "short write");
+    }
+    return NULL;
+}
+
+static void run_threads(void* (*func)(void*), void* args, size_t arg_size, pthread_t* threads,
+                        unsigned long threads_cnt) {
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        int ret = pthread_create(&threads[i], NULL, func, (char*)args + i * arg_size);
+        if (ret)
+            errx(1, "pthread_create: %d", ret);
+    }
+}
+
+static void join_threads(pthread_t* threads, unsigned long threads_cnt) {
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        int ret = pthread_join(threads[i], NULL);
+        if (ret)
+            errx(1, "pthread_join: %d", ret);
+    }
+}
+
+static void set_fd_limit(unsigned long limit) {
+    struct rlimit rlim;
+    CHECK(getrlimit(RLIMIT_NOFILE, &rlim));
+    if (rlim.rlim_max < limit)
+        errx(1, "need %lu fds, but the hard limit is %lu", limit, (unsigned long)rlim.rlim_max);
+    rlim.rlim_cur = limit;
+    CHECK(setrlimit(RLIMIT_NOFILE, &rlim));
+}
+
+/* Opens `fds_cnt` fds, closes some of them and checks that `dup()` reuses the lowest ones. */
+static void check_lowest_free_fd(unsigned long fds_cnt) {
+    int* fds = malloc(fds_cnt * sizeof(*fds));
+    if (!fds)
+        err(1, "malloc");
+
+    for (unsigned long i = 0; i < fds_cnt; i++) {
+        fds[i] = CHECK(dup(STDOUT_FILENO));
+        if (i > 0 && fds[i] != fds[i - 1] + 1)
+            errx(1, "dup returned %d after %d", fds[i], fds[i - 1]);
+    }
+
+    /* close every 100th fd, starting from the highest one, then check that they are reused */
+    unsigned long last = (fds_cnt - 1) / 100 * 100;
+    for (unsigned long i = last; i > 0; i -= 100)
+        CHECK(close(fds[i]));
+    for (unsigned long i = 100; i <= last; i += 100) {
+        int fd = dup(STDOUT_FILENO);
+        if (fd != fds[i])
+            errx(1, "dup returned %d, expected the lowest free fd %d", fd, fds[i]);
+    }
+
+    /* the table is full up to the last fd now */
+    int fd = dup(STDOUT_FILENO);
+    if (fd != fds[fds_cnt - 1] + 1)
+        errx(1, "dup returned %d, expected %d", fd, fds[fds_cnt - 1] + 1);
+    CHECK(close(fd));
+
+    for (unsigned long i = 0; i < fds_cnt; i++)
+        CHECK(close(fds[i]));
+    free(fds);
+}
+
+static int g_churn_fd;
+static bool g_churn_done;
+
+static void* churn_reader_thread(__attribute__((unused)) void* arg) {
+    unsigned long reads = 0;
+    while (!__atomic_load_n(&g_churn_done, __ATOMIC_ACQUIRE)) {
+        char c = 'a';
+        ssize_t ret = read(g_churn_fd, &c, 1);
+        if (ret < 0 && errno == EBADF)
+            continue;
+        if (ret != 1 || c != 0)
+            errx(1, "read from a re-created fd returned %zd (byte %d)", ret, c);
+        reads++;
+    }
+    return (void*)reads;
+}
+
+/* Closes and re-creates `g_churn_fd` while another thread reads from it. */
+static void check_churn(int zero_fd) {
+    g_churn_fd = CHECK(dup(zero_fd));
+
+    pthread_t thread;
+    int ret = pthread_create(&thread, NULL, churn_reader_thread, NULL);
+    if (ret)
+        errx(1, "pthread_create: %d", ret);
+
+    for (unsigned long i = 0; i < CHURN_ROUNDS; i++) {
+        CHECK(close(g_churn_fd));
+        if (CHECK(dup2(zero_fd, g_churn_fd)) != g_churn_fd)
+            errx(1, "dup2 returned a wrong fd");
+    }
+
+    __atomic_store_n(&g_churn_done, true, __ATOMIC_RELEASE);
+    ret = pthread_join(thread, NULL);
+    if (ret)
+        errx(1, "pthread_join: %d", ret);
+
+    read_zero_byte(g_churn_fd);
+    CHECK(close(g_churn_fd));
+}
+
+static void check_errors(int closed_fd) {
+    char c;
+    if (read(closed_fd, &c, 1) != -1 || errno != EBADF)
+        errx(1, "read from a closed fd did not fail with EBADF");
+    if (close(closed_fd) != -1 || errno != EBADF)
+        errx(1, "close of a closed fd did not fail with EBADF");
+
+    struct rlimit rlim;
+    CHECK(getrlimit(RLIMIT_NOFILE, &rlim));
+    if (dup2(STDOUT_FILENO, rlim.rlim_cur) != -1 || errno != EBADF)
+        errx(1, "dup2 to an fd above the limit did not fail with EBADF");
+
+    /* leave only a few free fds under the limit */
+    int lowest_fd = CHECK(dup(STDOUT_FILENO));
+    CHECK(close(lowest_fd));
+    struct rlimit old_rlim = rlim;
+    set_fd_limit(lowest_fd + EMFILE_SPARE_FDS);
+
+    int fds[EMFILE_SPARE_FDS];
+    for (int i = 0; i < EMFILE_SPARE_FDS; i++)
+        fds[i] = CHECK(dup(STDOUT_FILENO));
+    if (dup(STDOUT_FILENO) != -1 || errno != EMFILE)
+        errx(1, "dup with all fds under the limit used did not fail with EMFILE");
+    for (int i = 0; i < EMFILE_SPARE_FDS; i++)
+        CHECK(close(fds[i]));
+
+    CHECK(setrlimit(RLIMIT_NOFILE, &old_rlim));
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads_cnt = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_THREADS;
+    g_iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_ITERATIONS;
+    unsigned long fds_cnt = argc > 3 ? strtoul(argv[3], NULL, 10) : DEFAULT_FDS;
+    if (!threads_cnt || !g_iterations || !fds_cnt)
+        errx(1, "number of threads, iterations and fds must be positive");
+
+    /* fds of the threads, `fds_cnt` fds of the check, plus stdio and a few spare */
+    set_fd_limit(2 * threads_cnt + fds_cnt + 16);
+
+    pthread_t* threads = calloc(threads_cnt, sizeof(*threads));
+    struct rw_fds* fds = calloc(threads_cnt, sizeof(*fds));
+    if (!threads || !fds)
+        err(1, "calloc");
+    /* opened here, so that the threads do not allocate fds while the check below runs */
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        fds[i].zero_fd = CHECK(open("/dev/zero", O_RDONLY));
+        fds[i].null_fd = CHECK(open("/dev/null", O_WRONLY));
+    }
+
+    uint64_t start = time_ns();
+    run_threads(rw_thread, fds, sizeof(*fds), threads, threads_cnt);
+    join_threads(threads, threads_cnt);
+    uint64_t rw_ns = time_ns() - start;
+
+    /* the threads look up their fds while the table is enlarged */
+    run_threads(rw_thread, fds, sizeof(*fds), threads, threads_cnt);
+    start = time_ns();
+    check_lowest_free_fd(fds_cnt);
+    uint64_t fds_ns = time_ns() - start;
+    join_threads(threads, threads_cnt);
+
+    check_churn(fds[0].zero_fd);
+
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        CHECK(close(fds[i].zero_fd));
+        CHECK(close(fds[i].null_fd));
+    }
+    check_errors(fds[0].zero_fd);
+    free(fds);
+    free(threads);
+
+    printf("%lu threads: %lu ns per read/write pair; %lu fds opened and closed in %lu us\n",
+           threads_cnt, rw_ns / g_iterations, fds_cnt, fds_ns / 1000);
+    puts("TEST OK");
+    return 0;
+}
@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Test for `fork()` of processes with large memory: for resident set sizes doubling from `min_mb`
+ * to `max_mb`, allocates and touches that much memory, then reports the time from `fork()` until
+ * the child exits. About half of the pages are zeroes, the rest are full of data or zero except for
+ * a single byte (at the end of the page or elsewhere); some 64-page chunks are all zeroes or all
+ * data, the others mix the kinds page by page. Checks that:
+ *
+ * - the child sees the contents of every page (zero pages entirely, other pages at the bytes that
+ *   distinguish them), so that the time includes restoring the memory in the child,
+ * - writes of the child to the memory are not visible to the parent.
+ */
+
+#define _GNU_SOURCE
+#include <err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "common.h"
+
+#define DEFAULT_MIN_MB 64
+/* the RSS must fit in `sgx.enclave_size` of the manifest, together with the LibOS memory */
+#define DEFAULT_MAX_MB 1024
+
+/* exit codes of the child */
+#define CHILD_BAD_ZERO_PAGE 2
+#define CHILD_BAD_DATA_PAGE 3
+
+enum page_kind {
+    PAGE_ZERO,
+    PAGE_DATA,      /* all bytes are `page_byte()` */
+    PAGE_LAST_BYTE, /* zero except for the last byte */
+    PAGE_ONE_BYTE,  /* zero except for the byte at `page_offset()` */
+};
+
+static uint64_t mix(uint64_t x) {
+    /* finalizer of MurmurHash3 */
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static enum page_kind page_kind(size_t page) {
+    uint64_t chunk = mix(page / 64);
+    if (chunk % 4 == 0)
+        return PAGE_ZERO;
+    if (chunk % 4 == 1)
+        return PAGE_DATA;
+
+    uint64_t x = mix(page) % 4;
+    if (x < 2)
+        return PAGE_ZERO;
+    if (x == 2)
+        return PAGE_DATA;
+    return page % 2 ? PAGE_LAST_BYTE : PAGE_ONE_BYTE;
+}
+
+static unsigned char page_byte(size_t page) {
+    return (unsigned char)(page % 255 + 1);
+}
+
+static size_t page_offset(size_t page, size_t page_size) {
+    return page * 131 % page_size;
+}
+
+static void fill_page(unsigned char* p, size_t page, size_t page_size) {
+    switch (page_kind(page)) {
+        case PAGE_ZERO:
+            memset(p, 0, page_size);
+            break;
+        case PAGE_DATA:
+            memset(p, page_byte(page), page_size);
+            break;
+        case PAGE_LAST_BYTE:
+            memset(p, 0, page_size);
+            p[page_size - 1] = page_byte(page);
+            break;
+        case PAGE_ONE_BYTE:
+            memset(p, 0, page_size);
+            p[page_offset(page, page_size)] = page_byte(page);
+            break;
+    }
+}
+
+static bool is_zero(const unsigned char* p, size_t size) {
+    const uint64_t* words = (const uint64_t*)p;
+    uint64_t acc = 0;
+    for (size_t i = 0; i < size / sizeof(*words); i++)
+        acc |= words[i];
+    return acc == 0;
+}
+
+static void check_pages(unsigned char* mem, size_t pages_cnt, size_t page_size) {
+    for (size_t page = 0; page < pages_cnt; page++) {
+        unsigned char* p = mem + page * page_size;
+        unsigned char b = page_byte(page);
+        size_t offset;
+        switch (page_kind(page)) {
+            case PAGE_ZERO:
+                if (!is_zero(p, page_size))
+                    _exit(CHILD_BAD_ZERO_PAGE);
+                break;
+            case PAGE_DATA:
+                offset = page_offset(page, page_size);
+                if (p[0] != b || p[offset] != b || p[page_size - 1] != b)
+                    _exit(CHILD_BAD_DATA_PAGE);
+                break;
+            case PAGE_LAST_BYTE:
+            case PAGE_ONE_BYTE:
+                offset = page_kind(page) == PAGE_LAST_BYTE ? page_size - 1
+                                                           : page_offset(page, page_size);
+                if (p[offset] != b)
+                    _exit(CHILD_BAD_DATA_PAGE);
+                p[offset] = 0;
+                if (!is_zero(p, page_size))
+                    _exit(CHILD_BAD_DATA_PAGE);
+                break;
+        }
+    }
+    /* the parent checks that it does not see this */
+    memset(mem, 0xff, page_size);
+}
+
+static uint64_t fork_ns(size_t size) {
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t pages_cnt = size / page_size;
+
+    unsigned char* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                              -1, 0);
+    if (mem == MAP_FAILED)
+        err(1, "mmap of %zu bytes", size);
+    for (size_t page = 0; page < pages_cnt; page++)
+        fill_page(mem + page * page_size, page, page_size);
+
+    uint64_t start = time_ns();
+    pid_t pid = fork();
+    if (pid < 0)
+        err(1, "fork");
+    if (pid == 0) {
+        check_pages(mem, pages_cnt, page_size);
+        _exit(0);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0)
+        err(1, "waitpid");
+    uint64_t ns = time_ns() - start;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        errx(1, "child found wrong memory contents (status %d)", status);
+
+    unsigned char* expected = malloc(page_size);
+    if (!expected)
+        err(1, "malloc");
+    fill_page(expected, /*page=*/0, page_size);
+    if (memcmp(mem, expected, page_size))
+        errx(1, "writes of the child are visible in the parent");
+    free(expected);
+
+    if (munmap(mem, size) < 0)
+        err(1, "munmap");
+    return ns;
+}
+
+int main(int argc, char** argv) {
+    unsigned long min_mb = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_MIN_MB;
+    unsigned long max_mb = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_MAX_MB;
+    if (!min_mb || max_mb < min_mb)
+        errx(1, "usage: %s [min_mb] [max_mb]", argv[0]);
+
+    for (unsigned long mb = min_mb; mb <= max_mb; mb *= 2) {
+        uint64_t ns = fork_ns(mb * 1024 * 1024);
+        printf("%lu MB: fork and child exit in %lu ms\n", mb, ns / 1000000);
+    }
+    puts("TEST OK");
+    return 0;
+}
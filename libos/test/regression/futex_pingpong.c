@@ -0,0 +1,204 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Test for futexes used in parallel (which are kept in a hash table of buckets, each with its own
+ * lock): runs several independent pairs of threads, each pair passing a "token" back and forth
+ * through its own futex word with `FUTEX_WAIT` and `FUTEX_WAKE` (like a mutex handed over between
+ * two threads). Pairs use unrelated futexes, so the round-trip time (which is reported) should not
+ * grow much with the number of pairs. Checks that:
+ *
+ * - every pair did the expected number of round trips, and no wake-up woke more than one thread,
+ * - waiters of different futex words (likely in different buckets) can all be requeued to one word
+ *   and are then woken up together from it, and none are left behind on the original words,
+ * - `FUTEX_WAIT` with a stale value fails with EAGAIN, with a timeout fails with ETIMEDOUT (for
+ *   many different words), and `FUTEX_CMP_REQUEUE` with a stale value fails with EAGAIN.
+ */
+
+#define _GNU_SOURCE
+#include <err.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "futex.h"
+
+#define DEFAULT_PAIRS      4
+#define DEFAULT_ITERATIONS 10000
+#define TIMEOUT_WORDS      1024
+
+struct pair {
+    /* 0 - token is on the "ping" side, 1 - token is on the "pong" side */
+    int word;
+    unsigned long pings;
+    unsigned long pongs;
+} __attribute__((aligned(64)));
+
+static unsigned long g_iterations;
+
+static long futex(int* uaddr, int op, int val, const struct timespec* timeout, int* uaddr2,
+                  int val3) {
+    return syscall(SYS_futex, uaddr, op | FUTEX_PRIVATE_FLAG, val, timeout, uaddr2, val3);
+}
+
+static void futex_wait(int* uaddr, int val) {
+    long ret = futex(uaddr, FUTEX_WAIT, val, NULL, NULL, 0);
+    if (ret < 0 && errno != EAGAIN && errno != EINTR)
+        err(1, "futex(FUTEX_WAIT)");
+}
+
+static long futex_wake(int* uaddr, int count) {
+    return CHECK(futex(uaddr, FUTEX_WAKE, count, NULL, NULL, 0));
+}
+
+static void expect_futex_error(long ret, int expected_errno, const char* desc) {
+    if (ret != -1 || errno != expected_errno)
+        errx(1, "%s did not fail with %s (returned %ld)", desc, strerror(expected_errno), ret);
+}
+
+/* Waits until the token is on our side (`mine`), then passes it to the other side. */
+static void pass_token(int* word, int mine) {
+    while (__atomic_load_n(word, __ATOMIC_ACQUIRE) != mine)
+        futex_wait(word, !mine);
+    __atomic_store_n(word, !mine, __ATOMIC_RELEASE);
+    /* only the other thread of the pair can wait on this word */
+    if (futex_wake(word, 1) > 1)
+        errx(1, "FUTEX_WAKE woke more than one thread");
+}
+
+static void* ping_thread(void* arg) {
+    struct pair* pair = arg;
+    for (unsigned long i = 0; i < g_iterations; i++) {
+        pass_token(&pair->word, 0);
+        pair->pings++;
+    }
+    return NULL;
+}
+
+static void* pong_thread(void* arg) {
+    struct pair* pair = arg;
+    for (unsigned long i = 0; i < g_iterations; i++) {
+        pass_token(&pair->word, 1);
+        pair->pongs++;
+    }
+    return NULL;
+}
+
+static void test_errors(void) {
+    static int words[TIMEOUT_WORDS];
+    struct timespec timeout = { .tv_nsec = 1000 };
+
+    expect_futex_error(futex(&words[0], FUTEX_WAIT, 1, NULL, NULL, 0), EAGAIN,
+                       "FUTEX_WAIT with a stale value");
+    expect_futex_error(futex(&words[0], FUTEX_CMP_REQUEUE, 0, (struct timespec*)1, &words[1], 1),
+                       EAGAIN, "FUTEX_CMP_REQUEUE with a stale value");
+
+    for (size_t i = 0; i < TIMEOUT_WORDS; i++) {
+        expect_futex_error(futex(&words[i], FUTEX_WAIT, 0, &timeout, NULL, 0), ETIMEDOUT,
+                           "FUTEX_WAIT with a timeout");
+    }
+    /* timed-out waiters must be gone */
+    for (size_t i = 0; i < TIMEOUT_WORDS; i++) {
+        if (futex_wake(&words[i], INT_MAX) != 0)
+            errx(1, "FUTEX_WAKE woke a waiter which timed out");
+    }
+}
+
+static void* requeue_waiter_thread(void* arg) {
+    struct pair* pair = arg;
+    long ret = futex(&pair->word, FUTEX_WAIT, 0, NULL, NULL, 0);
+    return (void*)ret;
+}
+
+/* Requeues waiters of all pairs' words to the first pair's word, then wakes them all at once. */
+static void test_requeue(struct pair* pairs, unsigned long pairs_cnt, pthread_t* threads) {
+    for (unsigned long i = 0; i < pairs_cnt; i++) {
+        int ret = pthread_create(&threads[i], NULL, requeue_waiter_thread, &pairs[i]);
+        if (ret)
+            errx(1, "pthread_create: %d", ret);
+    }
+
+    for (unsigned long i = 1; i < pairs_cnt; i++) {
+        /* retry until the waiter is asleep */
+        while (CHECK(futex(&pairs[i].word, FUTEX_CMP_REQUEUE, 0, (struct timespec*)1,
+                           &pairs[0].word, 0)) == 0)
+            usleep(1000);
+    }
+
+    unsigned long woken = 0;
+    while (woken < pairs_cnt) {
+        woken += futex_wake(&pairs[0].word, INT_MAX);
+        if (woken < pairs_cnt)
+            usleep(1000);
+    }
+    if (woken != pairs_cnt)
+        errx(1, "FUTEX_WAKE after requeue woke %lu threads, expected %lu", woken, pairs_cnt);
+
+    for (unsigned long i = 0; i < pairs_cnt; i++) {
+        void* retval;
+        int ret = pthread_join(threads[i], &retval);
+        if (ret)
+            errx(1, "pthread_join: %d", ret);
+        if (retval != NULL)
+            errx(1, "requeued waiter %lu failed", i);
+        if (futex_wake(&pairs[i].word, INT_MAX) != 0)
+            errx(1, "a waiter was left behind on word %lu after requeue", i);
+    }
+}
+
+int main(int argc, char** argv) {
+    unsigned long pairs_cnt = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_PAIRS;
+    g_iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_ITERATIONS;
+    if (!pairs_cnt)
+        errx(1, "number of pairs must be positive");
+    if (!g_iterations)
+        errx(1, "number of iterations must be positive");
+
+    struct pair* pairs = calloc(pairs_cnt, sizeof(*pairs));
+    pthread_t* threads = calloc(2 * pairs_cnt, sizeof(*threads));
+    if (!pairs || !threads)
+        err(1, "calloc");
+
+    uint64_t start = time_ns();
+    for (unsigned long i = 0; i < pairs_cnt; i++) {
+        int ret = pthread_create(&threads[2 * i], NULL, ping_thread, &pairs[i]);
+        if (ret)
+            errx(1, "pthread_create: %d", ret);
+        ret = pthread_create(&threads[2 * i + 1], NULL, pong_thread, &pairs[i]);
+        if (ret)
+            errx(1, "pthread_create: %d", ret);
+    }
+    for (unsigned long i = 0; i < 2 * pairs_cnt; i++) {
+        int ret = pthread_join(threads[i], NULL);
+        if (ret)
+            errx(1, "pthread_join: %d", ret);
+    }
+    uint64_t total_ns = time_ns() - start;
+
+    for (unsigned long i = 0; i < pairs_cnt; i++) {
+        if (pairs[i].pings != g_iterations || pairs[i].pongs != g_iterations)
+            errx(1, "pair %lu did %lu pings and %lu pongs, expected %lu", i, pairs[i].pings,
+                 pairs[i].pongs, g_iterations);
+        if (pairs[i].word != 0)
+            errx(1, "pair %lu ended with the token on the wrong side", i);
+    }
+
+    test_requeue(pairs, pairs_cnt, threads);
+    test_errors();
+
+    free(threads);
+    free(pairs);
+
+    printf("%lu pairs: %lu round trips each in %lu us, %lu ns per round trip\n", pairs_cnt,
+           g_iterations, total_ns / 1000, total_ns / g_iterations);
+    puts("TEST OK");
+    return 0;
+}
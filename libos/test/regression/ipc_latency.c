@@ -0,0 +1,162 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Test for IPC round trips between a child process and the IPC leader: the child queries POSIX
+ * locks with `fcntl(F_GETLK)` in a loop, from several threads, and the time per round trip is
+ * reported. In Gramine, lock requests of a child process are sent to the leader (here, the parent)
+ * and wait for its response. Run with and without `libos.ipc_ring_dir` to compare the pipe and the
+ * shared-memory ring transports of IPC. The parent holds a lock on a different byte for each
+ * thread, so that the test checks that:
+ *
+ * - every thread gets the response to its own request (the lock on its byte, or no lock on the
+ *   byte next to it),
+ * - a conflicting `F_SETLK` fails with EAGAIN,
+ * - a blocking `F_SETLKW` gets its (delayed) response once the parent releases the lock.
+ */
+
+#define _GNU_SOURCE
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "common.h"
+
+#define TEST_FILE "tmp/ipc_latency_file"
+
+#define DEFAULT_THREADS    4
+#define DEFAULT_ITERATIONS 10000
+
+/* thread `i` checks the lock on byte `i * LOCK_STRIDE` and the free byte after it */
+#define LOCK_STRIDE 2
+
+static unsigned long g_iterations;
+static int g_fd;
+static pid_t g_parent_pid;
+
+static int set_lock(int cmd, short type, off_t start) {
+    struct flock fl = {
+        .l_type = type,
+        .l_whence = SEEK_SET,
+        .l_start = start,
+        .l_len = 1,
+    };
+    return fcntl(g_fd, cmd, &fl);
+}
+
+static void* getlk_thread(void* arg) {
+    off_t locked = (unsigned long)arg * LOCK_STRIDE;
+
+    for (unsigned long i = 0; i < g_iterations; i++) {
+        off_t start = i % 2 ? locked + 1 : locked;
+        struct flock fl = {
+            .l_type = F_WRLCK,
+            .l_whence = SEEK_SET,
+            .l_start = start,
+            .l_len = 1,
+        };
+        CHECK(fcntl(g_fd, F_GETLK, &fl));
+        if (start != locked) {
+            if (fl.l_type != F_UNLCK)
+                errx(1, "F_GETLK reported a lock on byte %ld that nobody locked", (long)start);
+        } else if (fl.l_type != F_WRLCK || fl.l_start != locked || fl.l_len != 1
+                       || fl.l_pid != g_parent_pid) {
+            errx(1, "F_GETLK did not report the parent's lock on byte %ld", (long)locked);
+        }
+    }
+    return NULL;
+}
+
+/* Runs in the child; returns the time of all round trips. */
+static uint64_t run_threads(unsigned long threads_cnt) {
+    pthread_t* threads = calloc(threads_cnt, sizeof(*threads));
+    if (!threads)
+        err(1, "calloc");
+
+    uint64_t start = time_ns();
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        int ret = pthread_create(&threads[i], NULL, getlk_thread, (void*)i);
+        if (ret)
+            errx(1, "pthread_create: %d", ret);
+    }
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        int ret = pthread_join(threads[i], NULL);
+        if (ret)
+            errx(1, "pthread_join: %d", ret);
+    }
+    uint64_t ns = time_ns() - start;
+    free(threads);
+    return ns;
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads_cnt = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_THREADS;
+    g_iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_ITERATIONS;
+    if (!threads_cnt || !g_iterations)
+        errx(1, "number of threads and iterations must be positive");
+
+    g_fd = open(TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (g_fd < 0)
+        err(1, "open");
+
+    for (unsigned long i = 0; i < threads_cnt; i++)
+        CHECK(set_lock(F_SETLK, F_WRLCK, i * LOCK_STRIDE));
+
+    int sync_fds[2];
+    CHECK(pipe(sync_fds));
+    g_parent_pid = getpid();
+
+    pid_t pid = CHECK(fork());
+    if (pid == 0) {
+        /* the first request also sets up the connection to the leader, don't count it */
+        unsigned long iterations = g_iterations;
+        g_iterations = 1;
+        getlk_thread(NULL);
+        g_iterations = iterations;
+
+        uint64_t ns = run_threads(threads_cnt);
+        uint64_t round_trips = threads_cnt * g_iterations;
+        printf("%lu threads: %lu round trips in %lu ms, %lu ns per round trip, "
+               "%lu round trips/s\n", threads_cnt, round_trips, ns / 1000000,
+               ns * threads_cnt / round_trips, round_trips * 1000000000 / ns);
+        fflush(stdout);
+
+        if (set_lock(F_SETLK, F_WRLCK, 0) != -1 || errno != EAGAIN)
+            errx(1, "F_SETLK of a lock held by the parent did not fail with EAGAIN");
+
+        char c = 0;
+        if (CHECK(write(sync_fds[1], &c, 1)) != 1)
+            errx(1, "short write");
+        /* blocks until the parent releases its lock */
+        CHECK(set_lock(F_SETLKW, F_WRLCK, 0));
+        exit(0);
+    }
+
+    char c;
+    if (CHECK(read(sync_fds[0], &c, 1)) != 1)
+        errx(1, "child exited before requesting the lock");
+    /* give the child time to block on the lock */
+    usleep(100 * 1000);
+    CHECK(set_lock(F_SETLK, F_UNLCK, 0));
+
+    int status;
+    CHECK(waitpid(pid, &status, 0));
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        errx(1, "child died with status: %#x", status);
+
+    CHECK(close(sync_fds[0]));
+    CHECK(close(sync_fds[1]));
+    if (close(g_fd) < 0)
+        err(1, "close");
+    if (unlink(TEST_FILE) < 0)
+        err(1, "unlink");
+
+    puts("TEST OK");
+    return 0;
+}
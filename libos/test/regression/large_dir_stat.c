@@ -0,0 +1,193 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Test for path lookup in a large directory: creates many files in one directory, then `stat()`s
+ * all of them from several threads at once. The time per `stat()` (which is reported) should not
+ * grow with the number of files in the directory, and threads looking up different files should
+ * not serialize. Each file has its index as its size, so that the test checks that:
+ *
+ * - every lookup finds the right file,
+ * - lookups that cannot be served from the cache alone (symlinks, paths relative to a directory
+ *   fd, paths through a regular file, renamed files) and `lstat()` return the right results,
+ * - files which were never created or were removed are not found (ENOENT), and `access()` agrees.
+ */
+
+#define _GNU_SOURCE
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.h"
+
+#define DEFAULT_FILES   5000
+#define DEFAULT_THREADS 4
+#define ROUNDS          4
+
+static const char* g_dir;
+static unsigned long g_files_cnt;
+
+static void file_path(char* buf, size_t size, const char* prefix, unsigned long i) {
+    int ret = snprintf(buf, size, "%s/%s%lu", g_dir, prefix, i);
+    if (ret < 0 || (size_t)ret >= size)
+        errx(1, "path too long");
+}
+
+static void* stat_thread(void* arg) {
+    unsigned long start = (unsigned long)arg;
+    char path[256];
+    struct stat st;
+
+    for (unsigned long round = 0; round < ROUNDS; round++) {
+        for (unsigned long j = 0; j < g_files_cnt; j++) {
+            /* each thread starts at a different file, so that threads look up different paths */
+            unsigned long i = (start + j) % g_files_cnt;
+            file_path(path, sizeof(path), "file", i);
+            if (stat(path, &st) < 0)
+                err(1, "stat(%s)", path);
+            if (!S_ISREG(st.st_mode) || st.st_size != (off_t)i)
+                errx(1, "stat(%s) returned a wrong file", path);
+        }
+    }
+    return NULL;
+}
+
+static void expect_enoent(int ret, const char* desc, const char* path) {
+    if (ret == 0 || errno != ENOENT)
+        errx(1, "%s(%s) did not fail with ENOENT", desc, path);
+}
+
+static void expect_size(const struct stat* st, unsigned long i, const char* desc,
+                        const char* path) {
+    if (!S_ISREG(st->st_mode) || st->st_size != (off_t)i)
+        errx(1, "%s(%s) returned a wrong file", desc, path);
+}
+
+/* Lookups of file `i` which take the slow path (or update the directory) */
+static void test_slow_lookups(unsigned long i) {
+    char path[256];
+    char new_path[256];
+    char target[64];
+    struct stat st;
+
+    snprintf(target, sizeof(target), "file%lu", i);
+    file_path(path, sizeof(path), "file", i);
+    CHECK(lstat(path, &st));
+    expect_size(&st, i, "lstat", path);
+
+    /* LibOS supports symlinks only in pseudo filesystems */
+    CHECK(stat("/proc/self", &st));
+    if (!S_ISDIR(st.st_mode))
+        errx(1, "stat(/proc/self) did not follow the symlink");
+    CHECK(lstat("/proc/self", &st));
+    if (!S_ISLNK(st.st_mode))
+        errx(1, "lstat(/proc/self) did not return a symlink");
+
+    int dir_fd = CHECK(open(g_dir, O_RDONLY | O_DIRECTORY));
+    CHECK(fstatat(dir_fd, target, &st, 0));
+    expect_size(&st, i, "fstatat", target);
+    CHECK(close(dir_fd));
+
+    CHECK(access(path, R_OK));
+    snprintf(new_path, sizeof(new_path), "%s/%s/x", g_dir, target);
+    if (stat(new_path, &st) == 0 || errno != ENOTDIR)
+        errx(1, "stat(%s) did not fail with ENOTDIR", new_path);
+
+    file_path(new_path, sizeof(new_path), "renamed", i);
+    CHECK(rename(path, new_path));
+    expect_enoent(stat(path, &st), "stat of a renamed file", path);
+    CHECK(stat(new_path, &st));
+    expect_size(&st, i, "stat", new_path);
+    CHECK(rename(new_path, path));
+    CHECK(stat(path, &st));
+    expect_size(&st, i, "stat", path);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2)
+        errx(1, "usage: %s <dir> [files] [threads]", argv[0]);
+    g_dir = argv[1];
+    g_files_cnt = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_FILES;
+    unsigned long threads_cnt = argc > 3 ? strtoul(argv[3], NULL, 10) : DEFAULT_THREADS;
+    if (!g_files_cnt || !threads_cnt)
+        errx(1, "number of files and threads must be positive");
+
+    if (mkdir(g_dir, 0700) < 0 && errno != EEXIST)
+        err(1, "mkdir(%s)", g_dir);
+
+    char path[256];
+    for (unsigned long i = 0; i < g_files_cnt; i++) {
+        file_path(path, sizeof(path), "file", i);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0)
+            err(1, "open(%s)", path);
+        CHECK(ftruncate(fd, i));
+        CHECK(close(fd));
+    }
+
+    pthread_t* threads = calloc(threads_cnt, sizeof(*threads));
+    if (!threads)
+        err(1, "calloc");
+
+    uint64_t start = time_ns();
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        int ret = pthread_create(&threads[i], NULL, stat_thread,
+                                 (void*)(i * g_files_cnt / threads_cnt));
+        if (ret)
+            errx(1, "pthread_create: %d", ret);
+    }
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        int ret = pthread_join(threads[i], NULL);
+        if (ret)
+            errx(1, "pthread_join: %d", ret);
+    }
+    uint64_t stat_ns = time_ns() - start;
+    free(threads);
+
+    struct stat st;
+    for (unsigned long i = 0; i < g_files_cnt; i += 7) {
+        file_path(path, sizeof(path), "missing", i);
+        expect_enoent(stat(path, &st), "stat", path);
+        expect_enoent(access(path, F_OK), "access", path);
+    }
+
+    test_slow_lookups(g_files_cnt - 1);
+
+    /* remove every other file, the rest must still be found */
+    for (unsigned long i = 0; i < g_files_cnt; i += 2) {
+        file_path(path, sizeof(path), "file", i);
+        if (unlink(path) < 0)
+            err(1, "unlink(%s)", path);
+    }
+    for (unsigned long i = 0; i < g_files_cnt; i++) {
+        file_path(path, sizeof(path), "file", i);
+        int ret = stat(path, &st);
+        if (i % 2 == 0) {
+            expect_enoent(ret, "stat of a removed file", path);
+        } else {
+            if (ret < 0)
+                err(1, "stat(%s)", path);
+            expect_size(&st, i, "stat", path);
+        }
+    }
+
+    for (unsigned long i = 1; i < g_files_cnt; i += 2) {
+        file_path(path, sizeof(path), "file", i);
+        if (unlink(path) < 0)
+            err(1, "unlink(%s)", path);
+    }
+    if (rmdir(g_dir) < 0)
+        err(1, "rmdir(%s)", g_dir);
+
+    unsigned long stats_cnt = threads_cnt * ROUNDS * g_files_cnt;
+    printf("%lu files, %lu threads: %lu stat() calls in %lu us, %lu ns per call\n", g_files_cnt,
+           threads_cnt, stats_cnt, stat_ns / 1000, stat_ns / stats_cnt);
+    puts("TEST OK");
+    return 0;
+}
@@ -0,0 +1,125 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Test for failed lookups remembered on immutable mounts. The manifest mounts the same host
+ * directory three times: as immutable (failed lookups are remembered forever), as immutable with
+ * `cache_ttl`, and as a normal mount through which the test creates files behind the dentry cache
+ * of the immutable mounts. Checks that:
+ *
+ * - a created file stays invisible on the immutable mount with `cache_ttl` until the TTL expires,
+ * - only a bounded number of failed lookups is remembered in a directory,
+ * - listing a directory forgets the failed lookups of the files that it contains.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define IMMUTABLE_DIR     "/mnt/immutable"
+#define IMMUTABLE_TTL_DIR "/mnt/immutable_ttl"
+#define MUTABLE_DIR       "/mnt/mutable"
+
+/* must match `cache_ttl` in the manifest */
+#define CACHE_TTL_S 2
+
+/* must match DENTRY_MAX_NEGATIVE_CACHED in LibOS */
+#define MAX_NEGATIVE_CACHED 4096
+
+static bool file_exists(const char* dir, const char* name) {
+    char path[256];
+    int ret = snprintf(path, sizeof(path), "%s/%s", dir, name);
+    if (ret < 0 || (size_t)ret >= sizeof(path))
+        errx(1, "path too long");
+
+    struct stat st;
+    if (stat(path, &st) == 0)
+        return true;
+    if (errno != ENOENT)
+        err(1, "stat(%s)", path);
+    return false;
+}
+
+static void create_file(const char* name) {
+    char path[256];
+    int ret = snprintf(path, sizeof(path), "%s/%s", MUTABLE_DIR, name);
+    if (ret < 0 || (size_t)ret >= sizeof(path))
+        errx(1, "path too long");
+
+    int fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0644);
+    if (fd < 0)
+        err(1, "open(%s)", path);
+    if (close(fd) < 0)
+        err(1, "close");
+}
+
+static void test_cache_ttl(void) {
+    const char* name = "ttl_file";
+
+    if (file_exists(IMMUTABLE_TTL_DIR, name))
+        errx(1, "%s exists before it was created", name);
+    create_file(name);
+    if (!file_exists(MUTABLE_DIR, name))
+        errx(1, "%s does not exist on the mutable mount after it was created", name);
+
+    for (int i = 0; i < 10; i++) {
+        if (file_exists(IMMUTABLE_TTL_DIR, name))
+            errx(1, "failed lookup of %s was not remembered", name);
+    }
+
+    sleep(CACHE_TTL_S + 1);
+    if (!file_exists(IMMUTABLE_TTL_DIR, name))
+        errx(1, "failed lookup of %s was remembered after the TTL expired", name);
+}
+
+static void test_negative_limit(void) {
+    char name[64];
+    unsigned long names_cnt = MAX_NEGATIVE_CACHED + 100;
+
+    for (unsigned long i = 0; i < names_cnt; i++) {
+        snprintf(name, sizeof(name), "missing_%lu", i);
+        if (file_exists(IMMUTABLE_DIR, name))
+            errx(1, "%s exists before it was created", name);
+    }
+
+    const char* first = "missing_0";
+    snprintf(name, sizeof(name), "missing_%lu", names_cnt - 1);
+    create_file(first);
+    create_file(name);
+
+    if (file_exists(IMMUTABLE_DIR, first))
+        errx(1, "failed lookup of %s was not remembered", first);
+    if (!file_exists(IMMUTABLE_DIR, name))
+        errx(1, "failed lookup of %s was remembered beyond the limit", name);
+
+    /* the files listed by the host are not considered missing anymore */
+    DIR* dir = opendir(IMMUTABLE_DIR);
+    if (!dir)
+        err(1, "opendir(%s)", IMMUTABLE_DIR);
+    bool found = false;
+    struct dirent* dent;
+    while ((dent = readdir(dir))) {
+        if (!strcmp(dent->d_name, first))
+            found = true;
+    }
+    if (closedir(dir) < 0)
+        err(1, "closedir");
+    if (!found)
+        errx(1, "%s not listed in %s", first, IMMUTABLE_DIR);
+    if (!file_exists(IMMUTABLE_DIR, first))
+        errx(1, "failed lookup of %s was remembered after listing the directory", first);
+}
+
+int main(void) {
+    test_cache_ttl();
+    test_negative_limit();
+    puts("TEST OK");
+    return 0;
+}
@@ -0,0 +1,181 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Test for pipe throughput between two processes, like `dd bs=<block> | cat`: the child writes the
+ * given number of MiB to a pipe in blocks of the given size, the parent reads them with buffers of
+ * varying sizes (smaller and larger than the records of the pipe transport) and checks their
+ * contents; the throughput is reported. Run with different `sgx.pipe_transport` values to compare
+ * the TLS and the lean AES-GCM transports of pipes. Also checks that:
+ *
+ * - data which a process has received but not read yet (the rest of a partially read record) is
+ *   read by its child, which inherits the read end,
+ * - writing to a pipe without readers fails with EPIPE.
+ */
+
+#define _GNU_SOURCE
+#include <err.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "common.h"
+
+#define DEFAULT_MIB        64
+#define DEFAULT_BLOCK_SIZE 4096
+#define MAX_READ_SIZE      (3 * 64 * 1024 + 5)
+/* size of the block written in the partial read check, one record with AES-GCM */
+#define PARTIAL_BLOCK_SIZE (64 * 1024)
+#define PARTIAL_READ_SIZE  100
+
+/* sizes of reads, cycled through: around and across records (up to 64KB with AES-GCM) */
+static const size_t g_read_sizes[] = { 64 * 1024, 1, 4097, MAX_READ_SIZE, 100 };
+
+static unsigned char pattern(uint64_t pos) {
+    return (unsigned char)(pos * 7 + pos / 4096);
+}
+
+static void write_all(int fd, uint64_t total, size_t block_size) {
+    unsigned char* buf = malloc(block_size);
+    if (!buf)
+        err(1, "malloc");
+
+    for (uint64_t pos = 0; pos < total;) {
+        size_t size = total - pos < block_size ? total - pos : block_size;
+        for (size_t i = 0; i < size; i++)
+            buf[i] = pattern(pos + i);
+        for (size_t done = 0; done < size;) {
+            ssize_t ret = write(fd, buf + done, size - done);
+            if (ret < 0)
+                err(1, "write");
+            done += ret;
+        }
+        pos += size;
+    }
+    free(buf);
+}
+
+/* Reads until EOF, checking the contents from `pos` on; returns the position at EOF */
+static uint64_t read_all(int fd, uint64_t pos) {
+    static unsigned char buf[MAX_READ_SIZE];
+    size_t reads = 0;
+
+    while (1) {
+        size_t size = g_read_sizes[reads++ % (sizeof(g_read_sizes) / sizeof(*g_read_sizes))];
+        ssize_t ret = CHECK(read(fd, buf, size));
+        if (ret == 0)
+            break;
+        for (ssize_t i = 0; i < ret; i++)
+            if (buf[i] != pattern(pos + i))
+                errx(1, "wrong byte read at offset %lu", pos + i);
+        pos += ret;
+    }
+    return pos;
+}
+
+static void wait_child(pid_t pid) {
+    int status;
+    CHECK(waitpid(pid, &status, 0));
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        errx(1, "child died with status: %#x", status);
+}
+
+/* Reads a part of a record, then lets a child read the rest. */
+static void check_partial_read_inherited(void) {
+    int fds[2];
+    CHECK(pipe(fds));
+
+    pid_t writer = CHECK(fork());
+    if (writer == 0) {
+        CHECK(close(fds[0]));
+        write_all(fds[1], PARTIAL_BLOCK_SIZE, PARTIAL_BLOCK_SIZE);
+        CHECK(close(fds[1]));
+        exit(0);
+    }
+    CHECK(close(fds[1]));
+
+    unsigned char buf[PARTIAL_READ_SIZE];
+    for (size_t done = 0; done < sizeof(buf);) {
+        ssize_t ret = CHECK(read(fds[0], buf + done, sizeof(buf) - done));
+        if (ret == 0)
+            errx(1, "unexpected EOF");
+        done += ret;
+    }
+    for (size_t i = 0; i < sizeof(buf); i++)
+        if (buf[i] != pattern(i))
+            errx(1, "wrong byte read at offset %zu", i);
+
+    pid_t reader = CHECK(fork());
+    if (reader == 0) {
+        uint64_t end = read_all(fds[0], PARTIAL_READ_SIZE);
+        if (end != PARTIAL_BLOCK_SIZE)
+            errx(1, "child read until offset %lu, expected %d", end, PARTIAL_BLOCK_SIZE);
+        exit(0);
+    }
+    CHECK(close(fds[0]));
+
+    wait_child(writer);
+    wait_child(reader);
+}
+
+static void check_epipe(void) {
+    if (signal(SIGPIPE, SIG_IGN) == SIG_ERR)
+        err(1, "signal");
+
+    int fds[2];
+    CHECK(pipe(fds));
+    CHECK(close(fds[0]));
+    char c = 0;
+    if (write(fds[1], &c, 1) != -1 || errno != EPIPE)
+        errx(1, "write to a pipe without readers did not fail with EPIPE");
+    CHECK(close(fds[1]));
+}
+
+int main(int argc, char** argv) {
+    unsigned long mib = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_MIB;
+    unsigned long block_size = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_BLOCK_SIZE;
+    if (!mib || !block_size)
+        errx(1, "size and block size must be positive");
+    uint64_t total = (uint64_t)mib * 1024 * 1024;
+
+    int fds[2];
+    if (pipe(fds) < 0)
+        err(1, "pipe");
+
+    uint64_t start = time_ns();
+    pid_t pid = fork();
+    if (pid < 0)
+        err(1, "fork");
+
+    if (pid == 0) {
+        if (close(fds[0]) < 0)
+            err(1, "close");
+        write_all(fds[1], total, block_size);
+        if (close(fds[1]) < 0)
+            err(1, "close");
+        exit(0);
+    }
+
+    if (close(fds[1]) < 0)
+        err(1, "close");
+    uint64_t read_size = read_all(fds[0], /*pos=*/0);
+    uint64_t pipe_ns = time_ns() - start;
+    if (close(fds[0]) < 0)
+        err(1, "close");
+
+    wait_child(pid);
+    if (read_size != total)
+        errx(1, "read %lu bytes, expected %lu", read_size, total);
+
+    check_partial_read_inherited();
+    check_epipe();
+
+    printf("%lu MiB in blocks of %lu bytes: %lu ms (including fork), %lu MiB/s\n", mib,
+           block_size, pipe_ns / 1000000, (uint64_t)mib * 1000000000 / pipe_ns);
+    puts("TEST OK");
+    return 0;
+}
@@ -0,0 +1,120 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Tests `readv()`, `writev()`, `preadv()` and `pwritev()` on a regular file: data is scattered over
+ * and gathered from several buffers, the file position is updated only by `readv()`/`writev()`, and
+ * reading past the end of file returns a short count.
+ */
+
+#define _GNU_SOURCE
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define TEST_FILE "tmp/readv_writev"
+
+static void check_pos(int fd, off_t expected) {
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    if (pos < 0)
+        err(1, "lseek");
+    if (pos != expected)
+        errx(1, "file position is %ld, expected %ld", (long)pos, (long)expected);
+}
+
+int main(void) {
+    int fd = open(TEST_FILE, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        err(1, "open");
+
+    char a[] = "hello, ";
+    char b[] = "vectored ";
+    char c[] = "world";
+    struct iovec wiov[] = {
+        { .iov_base = a, .iov_len = strlen(a) },
+        { .iov_base = NULL, .iov_len = 0 },
+        { .iov_base = b, .iov_len = strlen(b) },
+        { .iov_base = c, .iov_len = strlen(c) },
+    };
+    const char* expected = "hello, vectored world";
+    size_t expected_len = strlen(expected);
+
+    ssize_t ret = writev(fd, wiov, 4);
+    if (ret < 0)
+        err(1, "writev");
+    if ((size_t)ret != expected_len)
+        errx(1, "writev returned %zd", ret);
+    check_pos(fd, expected_len);
+
+    /* overwrite "vectored" with "VECTORED" at an offset, file position must not change */
+    char up1[] = "VECT";
+    char up2[] = "ORED";
+    struct iovec piov[] = {
+        { .iov_base = up1, .iov_len = 4 },
+        { .iov_base = up2, .iov_len = 4 },
+    };
+    ret = pwritev(fd, piov, 2, strlen(a));
+    if (ret != 8)
+        errx(1, "pwritev returned %zd", ret);
+    check_pos(fd, expected_len);
+
+    char r1[7];
+    char r2[9];
+    char r3[16];
+    struct iovec riov[] = {
+        { .iov_base = r1, .iov_len = sizeof(r1) },
+        { .iov_base = r2, .iov_len = sizeof(r2) },
+        { .iov_base = r3, .iov_len = sizeof(r3) },
+    };
+    ret = preadv(fd, riov, 3, 0);
+    if (ret < 0)
+        err(1, "preadv");
+    /* the last buffer is only partially filled because of the end of file */
+    if ((size_t)ret != expected_len)
+        errx(1, "preadv returned %zd", ret);
+    if (memcmp(r1, "hello, ", 7) || memcmp(r2, "VECTORED ", 9) || memcmp(r3, "world", 5))
+        errx(1, "preadv returned wrong data");
+    check_pos(fd, expected_len);
+
+    if (lseek(fd, 7, SEEK_SET) != 7)
+        err(1, "lseek");
+    memset(r2, 0, sizeof(r2));
+    memset(r3, 0, sizeof(r3));
+    ret = readv(fd, &riov[1], 2);
+    if (ret < 0)
+        err(1, "readv");
+    if ((size_t)ret != expected_len - 7)
+        errx(1, "readv returned %zd", ret);
+    if (memcmp(r2, "VECTORED ", 9) || memcmp(r3, "world", 5))
+        errx(1, "readv returned wrong data");
+    check_pos(fd, expected_len);
+
+    ret = readv(fd, riov, 3);
+    if (ret != 0)
+        errx(1, "readv at end of file returned %zd", ret);
+
+    ret = preadv(fd, riov, 3, -1);
+    if (ret != -1 || errno != EINVAL)
+        errx(1, "preadv with negative offset returned %zd", ret);
+
+    if (close(fd) < 0)
+        err(1, "close");
+    if (unlink(TEST_FILE) < 0)
+        err(1, "unlink");
+
+    int pipefds[2];
+    if (pipe(pipefds) < 0)
+        err(1, "pipe");
+    ret = preadv(pipefds[0], riov, 3, 0);
+    if (ret != -1 || errno != ESPIPE)
+        errx(1, "preadv on a pipe returned %zd", ret);
+    if (close(pipefds[0]) < 0 || close(pipefds[1]) < 0)
+        err(1, "close");
+
+    puts("TEST OK");
+    return 0;
+}
@@ -1,3 +1,4 @@
+import errno
 import os
 import re
 import shutil
@@ -259,6 +260,25 @@ class TC_01_Bootstrap(RegressionTestCase):
         self.assertIn('TEST OK', stdout)
         self.assertNotIn('grandchild', stderr)
 
+    def test_207_fork_latency(self):
+        stdout, _ = self.run_binary(['fork_latency', '64', '512'], timeout=120)
+        self.assertIn('TEST OK', stdout)
+        self.assertIn('512 MB: fork and child exit', stdout)
+
+    @unittest.skipUnless(HAS_SGX, 'Zygote processes are specific to SGX PAL')
+    def test_208_fork_latency_zygote(self):
+        stdout, _ = self.run_binary(['fork_latency_zygote', '64', '256'], timeout=120)
+        self.assertIn('TEST OK', stdout)
+        self.assertIn('256 MB: fork and child exit', stdout)
+
+    # the parent and the child each hold up to 8 GB of memory
+    @unittest.skipUnless(os.sysconf('SC_PAGE_SIZE') * os.sysconf('SC_PHYS_PAGES') >= 32 * 2**30,
+                         'Needs at least 32 GB of RAM')
+    def test_209_fork_latency_8g(self):
+        stdout, _ = self.run_binary(['fork_latency_8g', '64', '8192'], timeout=1200)
+        self.assertIn('TEST OK', stdout)
+        self.assertIn('8192 MB: fork and child exit', stdout)
+
     def test_210_exec_invalid_args(self):
         stdout, _ = self.run_binary(['exec_invalid_args'])
 
@@ -422,6 +442,12 @@ class TC_01_Bootstrap(RegressionTestCase):
         self.assertIn('FE_TOWARDZERO  child: 42.5 = 42.0, -42.5 = -42.0', stdout)
         self.assertIn('FE_TOWARDZERO parent: 42.5 = 42.0, -42.5 = -42.0', stdout)
 
+    def test_603_slab_threads(self):
+        # LibOS/PAL internal allocators under contention, with cross-thread frees
+        stdout, _ = self.run_binary(['slab_threads', '/slab_threads', '8', '500'])
+        self.assertIn('8 threads did 16000 open/close pairs', stdout)
+        self.assertIn('TEST OK', stdout)
+
     def test_700_debug_log_inline(self):
         _, stderr = self.run_binary(['debug_log_inline'])
         self._verify_debug_log(stderr)
@@ -680,6 +706,31 @@ class TC_30_Syscall(RegressionTestCase):
         stdout, _ = self.run_binary(['host_root_fs'])
         self.assertIn('Test was successful', stdout)
 
+    def test_025_large_dir_stat(self):
+        # concurrent path lookups in a large directory, plus lookups off the cached fast path
+        if os.path.exists("tmp/large_dir_stat"):
+            shutil.rmtree("tmp/large_dir_stat")
+        stdout, _ = self.run_binary(['large_dir_stat', 'tmp/large_dir_stat', '3000', '4'])
+        self.assertIn('3000 files, 4 threads: 48000 stat() calls', stdout)
+        self.assertIn('TEST OK', stdout)
+        self.assertFalse(os.path.exists('tmp/large_dir_stat'))
+
+    def test_026_missing_file_lookup(self):
+        # the manifest mounts this directory three times, see `missing_file_lookup.c`
+        if os.path.exists('tmp/missing_file_lookup'):
+            shutil.rmtree('tmp/missing_file_lookup')
+        os.makedirs('tmp/missing_file_lookup')
+        stdout, _ = self.run_binary(['missing_file_lookup'], timeout=60)
+        self.assertIn('TEST OK', stdout)
+
+    def test_027_missing_file_lookup_no_immutable(self):
+        try:
+            self.run_binary(['missing_file_lookup_no_immutable'])
+            self.fail('expected to return nonzero')
+        except subprocess.CalledProcessError as e:
+            self.assertIn("'fs.mounts[2].cache_ttl' is supported only for immutable mounts",
+                          e.stderr.decode())
+
     def test_030_fopen(self):
         if os.path.exists("tmp/filecreatedbygramine"):
             os.remove("tmp/filecreatedbygramine")
@@ -746,6 +797,10 @@ class TC_30_Syscall(RegressionTestCase):
         stdout, _ = self.run_binary(['rename_unlink', file1, file2])
         self.assertIn('TEST OK', stdout)
 
+    def test_037_readv_writev(self):
+        stdout, _ = self.run_binary(['readv_writev'])
+        self.assertIn('TEST OK', stdout)
+
     def test_040_futex_bitset(self):
         stdout, _ = self.run_binary(['futex_bitset'])
 
@@ -768,6 +823,12 @@ class TC_30_Syscall(RegressionTestCase):
 
         self.assertIn('Test successful!', stdout)
 
+    def test_044_futex_pingpong(self):
+        # independent futexes used in parallel, requeue across futex words, error paths
+        stdout, _ = self.run_binary(['futex_pingpong', '4', '1000'])
+        self.assertIn('4 pairs: 1000 round trips each', stdout)
+        self.assertIn('TEST OK', stdout)
+
     def test_050_mmap(self):
         stdout, _ = self.run_binary(['mmap_file'], timeout=60)
 
@@ -865,6 +926,12 @@ class TC_30_Syscall(RegressionTestCase):
         stdout, _ = self.run_binary(['munmap'])
         self.assertIn('TEST OK', stdout)
 
+    def test_05B_vma_stress(self):
+        # user-pointer checks (VMA lookups) racing with concurrent mmap/mprotect/munmap
+        stdout, _ = self.run_binary(['vma_stress', '8', '1000'])
+        self.assertIn('8 threads did 8000 mmap/mprotect/munmap rounds', stdout)
+        self.assertIn('TEST OK', stdout)
+
     @unittest.skip('sigaltstack isn\'t correctly implemented')
     def test_060_sigaltstack(self):
         stdout, _ = self.run_binary(['sigaltstack'])
@@ -953,6 +1020,10 @@ class TC_30_Syscall(RegressionTestCase):
         stdout, _ = self.run_binary(['gettimeofday'])
         self.assertIn('TEST OK', stdout)
 
+    def test_104_clock_gettime_vdso(self):
+        stdout, _ = self.run_binary(['clock_gettime_vdso', '4', '1000000'])
+        self.assertIn('TEST OK', stdout)
+
     def test_110_fcntl_lock(self):
         try:
             stdout, _ = self.run_binary(['fcntl_lock'])
@@ -969,6 +1040,24 @@ class TC_30_Syscall(RegressionTestCase):
                 os.remove('tmp_enc/lock_file')
         self.assertIn('TEST OK', stdout)
 
+    def test_112_ipc_latency(self):
+        stdout, _ = self.run_binary(['ipc_latency', '4', '10000'], timeout=120)
+        self.assertIn('4 threads: 40000 round trips', stdout)
+        self.assertIn('TEST OK', stdout)
+
+    def test_113_ipc_latency_ring(self):
+        # fewer iterations, as every IPC message is logged
+        stdout, stderr = self.run_binary(['ipc_latency_ring', '4', '1000'], timeout=120)
+        self.assertIn('4 threads: 4000 round trips', stdout)
+        self.assertIn('TEST OK', stdout)
+        # both the child and the parent (IPC leader, VMID 1) send messages through rings, not the
+        # pipes
+        dests = re.findall(r'IPC ring: sending IPC messages to (\d+) through '
+                           r'dev:/dev/shm/gramine_ipc_', stderr)
+        self.assertIn('1', dests)
+        self.assertTrue(any(dest != '1' for dest in dests))
+        self.assertNotIn('cannot set up a ring', stderr)
+
     def test_120_gethostname_default(self):
         # The generic manifest (manifest.template) doesn't use extra runtime conf.
         stdout, _ = self.run_binary(['hostname', 'localhost'])
@@ -1139,6 +1228,13 @@ class TC_40_FileSystem(RegressionTestCase):
         stdout, _ = self.run_binary(['fdleak'], timeout=40, open_fds_limit=50)
         self.assertIn("TEST OK", stdout)
 
+    def test_031_fd_table_threads(self):
+        # fd lookups from several threads, racing with table growth, close and re-creation of fds
+        stdout, _ = self.run_binary(['fd_table_threads', '4', '100000', '10000'])
+        self.assertIn('4 threads:', stdout)
+        self.assertIn('10000 fds opened and closed', stdout)
+        self.assertIn('TEST OK', stdout)
+
     def get_cache_levels_cnt(self):
         cpu0 = '/sys/devices/system/cpu/cpu0/'
         self.assertTrue(os.path.exists(f'{cpu0}/cache/'))
@@ -1253,6 +1349,37 @@ class TC_40_FileSystem(RegressionTestCase):
         stdout, _ = self.run_binary(['shm'])
         self.assertIn("TEST OK", stdout)
 
+    def test_080_trusted_files_lookup(self):
+        # manifest lists 50k dummy trusted files; only SGX checks the files on open
+        for name in ['allowed', 'unlisted']:
+            with open(f'tmp/trusted_files_lookup_{name}', 'w') as f:
+                f.write(name)
+        unlisted_errno = errno.EACCES if HAS_SGX else 0
+        stdout, _ = self.run_binary(['trusted_files_lookup', '/trusted_files_lookup',
+                                     'tmp/trusted_files_lookup_allowed',
+                                     'tmp/trusted_files_lookup_unlisted', str(unlisted_errno),
+                                     '10000'])
+        self.assertIn('TEST OK', stdout)
+        self.assertIn("opened '/trusted_files_lookup' 10000 times", stdout)
+
+    @unittest.skipUnless(HAS_SGX, 'Trusted files cache is specific to SGX PAL')
+    def test_081_trusted_files_cache(self):
+        def cache_counters(reads):
+            stdout, stderr = self.run_binary(['trusted_files_cache', '/trusted_files_cache',
+                                              str(reads)])
+            self.assertIn('TEST OK', stdout)
+            self.assertIn('Trusted files cache stats', stderr)
+            hits = int(re.search(r'# of hits: +(\d+)', stderr).group(1))
+            misses = int(re.search(r'# of misses: +(\d+)', stderr).group(1))
+            return hits, misses
+
+        hits1, misses1 = cache_counters(1)
+        hits3, misses3 = cache_counters(3)
+        # the first read of the binary verifies its chunks, and the other reads hit the cache
+        self.assertGreater(misses1, 0)
+        self.assertGreater(misses3, 0)
+        self.assertGreaterEqual(hits3, hits1 + 2)
+
 class TC_50_GDB(RegressionTestCase):
     def setUp(self):
         if not self.has_debug():
@@ -1334,6 +1461,12 @@ class TC_80_Socket(RegressionTestCase):
         stdout, _ = self.run_binary(['epoll_epollet'])
         self.assertIn('TEST OK', stdout)
 
+    def test_012_epoll_idle_sockets(self):
+        # epoll_wait with many idle connections, plus ready sets, EPOLL_CTL_* and their errors
+        stdout, _ = self.run_binary(['epoll_idle_sockets', '200', '1000'])
+        self.assertIn('200 idle connections: registered in', stdout)
+        self.assertIn('TEST OK', stdout)
+
     def test_020_poll(self):
         try:
             stdout, _ = self.run_binary(['poll'])
@@ -1352,6 +1485,22 @@ class TC_80_Socket(RegressionTestCase):
         self.assertIn('read on pipe: Hello from write end of pipe!', stdout)
         self.assertIn('the peer closed its end of the pipe', stdout)
 
+    @unittest.skipUnless(HAS_SGX, 'Pipe transports are specific to SGX PAL')
+    def test_023_poll_gcm(self):
+        try:
+            stdout, _ = self.run_binary(['poll_gcm'])
+        finally:
+            if os.path.exists("tmp/host_file"):
+                os.remove("tmp/host_file")
+        self.assertIn('TEST OK', stdout)
+
+    @unittest.skipUnless(HAS_SGX, 'Pipe transports are specific to SGX PAL')
+    def test_024_poll_closed_fd_gcm(self):
+        stdout, _ = self.run_binary(['poll_closed_fd_gcm'], timeout=60)
+        self.assertNotIn('poll with POLLIN failed', stdout)
+        self.assertIn('read on pipe: Hello from write end of pipe!', stdout)
+        self.assertIn('the peer closed its end of the pipe', stdout)
+
     def test_030_ppoll(self):
         stdout, _ = self.run_binary(['ppoll'])
         self.assertIn('ppoll(POLLOUT) returned 1 file descriptors', stdout)
@@ -1384,6 +1533,17 @@ class TC_80_Socket(RegressionTestCase):
         stdout, _ = self.run_binary(['pipe_ocloexec'])
         self.assertIn('TEST OK', stdout)
 
+    def test_093_pipe_throughput(self):
+        stdout, _ = self.run_binary(['pipe_throughput', '64', '4096'], timeout=120)
+        self.assertIn('64 MiB in blocks of 4096 bytes', stdout)
+        self.assertIn('TEST OK', stdout)
+
+    @unittest.skipUnless(HAS_SGX, 'Pipe transports are specific to SGX PAL')
+    def test_094_pipe_throughput_gcm(self):
+        stdout, _ = self.run_binary(['pipe_throughput_gcm', '64', '4096'], timeout=120)
+        self.assertIn('64 MiB in blocks of 4096 bytes', stdout)
+        self.assertIn('TEST OK', stdout)
+
     def test_095_mkfifo(self):
         try:
             stdout, _ = self.run_binary(['mkfifo'], timeout=60)
@@ -1393,10 +1553,25 @@ class TC_80_Socket(RegressionTestCase):
         self.assertIn('read on FIFO: Hello from write end of FIFO!', stdout)
         self.assertIn('[parent] TEST OK', stdout)
 
+    @unittest.skipUnless(HAS_SGX, 'Pipe transports are specific to SGX PAL')
+    def test_096_pipe_gcm(self):
+        stdout, _ = self.run_binary(['pipe_gcm'], timeout=60)
+        self.assertIn('read on pipe: Hello from write end of pipe!', stdout)
+
+    @unittest.skipUnless(HAS_SGX, 'Pipe transports are specific to SGX PAL')
+    def test_097_pipe_nonblocking_gcm(self):
+        stdout, _ = self.run_binary(['pipe_nonblocking_gcm'])
+        self.assertIn('TEST OK', stdout)
+
     def test_100_socket_unix(self):
         stdout, _ = self.run_binary(['unix'])
         self.assertIn('TEST OK', stdout)
 
+    @unittest.skipUnless(HAS_SGX, 'Pipe transports are specific to SGX PAL')
+    def test_101_socket_unix_gcm(self):
+        stdout, _ = self.run_binary(['unix_gcm'])
+        self.assertIn('TEST OK', stdout)
+
     def test_200_socket_udp(self):
         stdout, _ = self.run_binary(['udp'])
         self.assertIn('TEST OK', stdout)
@@ -0,0 +1,78 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Reads the given (trusted) file several times and checks that all reads return the same data. With
+ * `sgx.trusted_files_cache_size`, the first read verifies the chunks of the file and the following
+ * ones are served from the cache of verified chunks; the test checks the cache counters printed on
+ * exit with `sgx.enable_stats`.
+ */
+
+#define _GNU_SOURCE
+#include <err.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_READS 3
+#define READ_SIZE     4096
+
+static char* read_file(const char* path, size_t* out_size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        err(1, "open %s", path);
+
+    size_t size = 0;
+    size_t capacity = READ_SIZE;
+    char* data = malloc(capacity);
+    if (!data)
+        err(1, "malloc");
+
+    while (1) {
+        if (capacity - size < READ_SIZE) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+            if (!data)
+                err(1, "realloc");
+        }
+        ssize_t ret = read(fd, data + size, READ_SIZE);
+        if (ret < 0)
+            err(1, "read");
+        if (ret == 0)
+            break;
+        size += ret;
+    }
+
+    if (close(fd) < 0)
+        err(1, "close");
+    *out_size = size;
+    return data;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2)
+        errx(1, "usage: %s <file> [reads]", argv[0]);
+    unsigned long reads = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_READS;
+    if (!reads)
+        errx(1, "number of reads must be positive");
+
+    size_t size;
+    char* data = read_file(argv[1], &size);
+    if (!size)
+        errx(1, "%s is empty", argv[1]);
+
+    for (unsigned long i = 1; i < reads; i++) {
+        size_t new_size;
+        char* new_data = read_file(argv[1], &new_size);
+        if (new_size != size || memcmp(new_data, data, size))
+            errx(1, "read %lu of %s returned different data", i, argv[1]);
+        free(new_data);
+    }
+    free(data);
+
+    printf("read %lu bytes %lu times\n", size, reads);
+    puts("TEST OK");
+    return 0;
+}
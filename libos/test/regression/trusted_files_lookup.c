@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Test for trusted/allowed-file lookups while the manifest lists ~50k other trusted files (see
+ * `trusted_files_lookup.manifest.template`). Under SGX, every open() resolves the path against the
+ * trusted/allowed files, so the test checks that:
+ *
+ * - a trusted file listed after all the dummy entries can be opened, repeatedly (the time per
+ *   open() is reported, as it directly reflects the cost of the lookup),
+ * - a file under a trusted directory (`/lib`) can be opened,
+ * - an allowed file listed by its exact name can be opened,
+ * - a file that is not listed cannot be opened (only under SGX, where the test gets `EACCES` as
+ *   the expected errno; without SGX the open succeeds).
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common.h"
+
+#define DEFAULT_ITERATIONS 10000
+
+/* Returns 0 on success, errno of a failed open() otherwise. */
+static int try_open(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return errno;
+    CHECK(close(fd));
+    return 0;
+}
+
+static void open_first_file_in(const char* dir_path) {
+    DIR* dir = opendir(dir_path);
+    if (!dir)
+        err(1, "opendir(%s)", dir_path);
+
+    char path[512];
+    struct dirent* dent;
+    while ((dent = readdir(dir))) {
+        if (dent->d_type == DT_REG)
+            break;
+    }
+    if (!dent)
+        errx(1, "no regular files in %s", dir_path);
+    snprintf(path, sizeof(path), "%s/%s", dir_path, dent->d_name);
+    CHECK(closedir(dir));
+
+    int ret = try_open(path);
+    if (ret)
+        errx(1, "cannot open %s under a trusted directory: %s", path, strerror(ret));
+}
+
+int main(int argc, char** argv) {
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s <trusted file> <allowed file> <unlisted file> "
+                "<expected errno for unlisted file> [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    const char* trusted_path = argv[1];
+    const char* allowed_path = argv[2];
+    const char* unlisted_path = argv[3];
+    int unlisted_errno = atoi(argv[4]);
+    unsigned long iterations = argc > 5 ? strtoul(argv[5], NULL, 10) : DEFAULT_ITERATIONS;
+    if (!iterations)
+        errx(1, "number of iterations must be positive");
+
+    uint64_t start = time_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        int ret = try_open(trusted_path);
+        if (ret)
+            errx(1, "cannot open trusted file %s: %s", trusted_path, strerror(ret));
+    }
+    uint64_t end = time_ns();
+
+    open_first_file_in("/lib");
+
+    int ret = try_open(allowed_path);
+    if (ret)
+        errx(1, "cannot open allowed file %s: %s", allowed_path, strerror(ret));
+
+    ret = try_open(unlisted_path);
+    if (ret != unlisted_errno)
+        errx(1, "opening unlisted file %s: expected errno %d, got %d", unlisted_path,
+             unlisted_errno, ret);
+
+    printf("opened '%s' %lu times in %lu us (%lu ns per open)\n", trusted_path, iterations,
+           (end - start) / 1000, (end - start) / iterations);
+    puts("TEST OK");
+    return 0;
+}
@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Test for VMA lookups racing with VMA modifications: several threads concurrently mmap, mprotect
+ * and munmap private regions, and pass buffers to a syscall that validates user pointers (which
+ * looks up VMAs, and may do so without taking the VMA tree lock). The time per round is reported.
+ * Each thread checks that:
+ *
+ * - the contents of its mappings are not affected by other threads,
+ * - a buffer in writable memory is accepted, also when it spans a page whose protection was changed
+ *   back and forth (which may leave it in a separate VMA),
+ * - a buffer in read-only memory, in a just-unmapped page, or spanning a writable and a read-only
+ *   (or unmapped) page is rejected with EFAULT.
+ *
+ * The unmapped page is in the middle of the region, so that other threads cannot map their
+ * (bigger) regions in its place while the test expects it to be unmapped.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include "common.h"
+
+#define DEFAULT_THREADS    4
+#define DEFAULT_ITERATIONS 2000
+#define MAX_THREADS        16
+#define REGION_PAGES       4
+
+static unsigned long g_iterations;
+static size_t g_page_size;
+
+static void check_uname(void* buf, bool expect_ok, const char* desc) {
+    int ret = uname(buf);
+    if (expect_ok && ret < 0)
+        err(1, "uname on %s", desc);
+    if (!expect_ok && (ret != -1 || errno != EFAULT))
+        errx(1, "uname on %s did not fail with EFAULT (returned %d)", desc, ret);
+}
+
+static void* thread_func(void* arg) {
+    unsigned char pattern = (unsigned char)(uintptr_t)arg;
+    size_t size = REGION_PAGES * g_page_size;
+    /* offset of a `struct utsname` that spans the boundary of two pages */
+    size_t straddle = g_page_size - sizeof(struct utsname) / 2;
+    /* offset of the pattern byte in each page, not overwritten by uname() */
+    size_t mark = g_page_size / 2;
+
+    for (unsigned long i = 0; i < g_iterations; i++) {
+        unsigned char* region = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED)
+            err(1, "mmap");
+
+        for (size_t j = 0; j < REGION_PAGES; j++)
+            region[j * g_page_size + mark] = pattern;
+
+        check_uname(region + g_page_size, /*expect_ok=*/true, "writable page");
+
+        /* split the region into VMAs with different protections: R | RW | RW (changed back) | RW */
+        CHECK(mprotect(region, g_page_size, PROT_READ));
+        CHECK(mprotect(region + 2 * g_page_size, g_page_size, PROT_READ));
+        CHECK(mprotect(region + 2 * g_page_size, g_page_size, PROT_READ | PROT_WRITE));
+
+        check_uname(region, /*expect_ok=*/false, "read-only page");
+        check_uname(region + straddle, /*expect_ok=*/false, "read-only and writable pages");
+        check_uname(region + g_page_size + straddle, /*expect_ok=*/true, "two writable VMAs");
+
+        for (size_t j = 0; j < REGION_PAGES; j++) {
+            if (region[j * g_page_size + mark] != pattern)
+                errx(1, "region content changed by another thread");
+        }
+
+        CHECK(munmap(region + 2 * g_page_size, g_page_size));
+        check_uname(region + 2 * g_page_size, /*expect_ok=*/false, "unmapped page");
+        check_uname(region + g_page_size + straddle, /*expect_ok=*/false,
+                    "writable and unmapped pages");
+
+        CHECK(munmap(region, size));
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    unsigned long threads_cnt = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_THREADS;
+    g_iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : DEFAULT_ITERATIONS;
+    if (!threads_cnt || threads_cnt > MAX_THREADS)
+        errx(1, "number of threads must be in range [1, %d]", MAX_THREADS);
+    if (!g_iterations)
+        errx(1, "number of iterations must be positive");
+
+    long page_size = CHECK(sysconf(_SC_PAGESIZE));
+    g_page_size = page_size;
+
+    pthread_t threads[MAX_THREADS];
+
+    uint64_t start = time_ns();
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        int ret = pthread_create(&threads[i], NULL, thread_func, (void*)(uintptr_t)(i + 1));
+        if (ret != 0)
+            errx(1, "pthread_create: %d", ret);
+    }
+    for (unsigned long i = 0; i < threads_cnt; i++) {
+        int ret = pthread_join(threads[i], NULL);
+        if (ret != 0)
+            errx(1, "pthread_join: %d", ret);
+    }
+    uint64_t end = time_ns();
+
+    unsigned long total = threads_cnt * g_iterations;
+    printf("%lu threads did %lu mmap/mprotect/munmap rounds in %lu us (%lu ns per round)\n",
+           threads_cnt, total, (end - start) / 1000, (end - start) / total);
+    puts("TEST OK");
+    return 0;
+}
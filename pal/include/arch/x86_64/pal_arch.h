@@ -36,6 +36,8 @@ typedef struct pal_tcb {
     uint64_t stack_protector_canary;
     /* uint64_t for alignment */
     uint64_t libos_tcb[(PAL_LIBOS_TCB_SIZE + sizeof(uint64_t) - 1) / sizeof(uint64_t)];
+    /* per-thread cache of PAL's internal memory allocator (see pal/src/slab.c) */
+    void* slab_thread_cache;
     /* data private to PAL implementation follows this struct. */
 } PAL_TCB;
 
@@ -96,6 +96,7 @@ enum {
     PAL_TYPE_THREAD,
     PAL_TYPE_EVENT,
     PAL_TYPE_EVENTFD,
+    PAL_TYPE_EVENTSET,
     PAL_HANDLE_TYPE_BOUND,
 };
 
@@ -171,6 +172,14 @@ struct pal_public_state {
 
     size_t mem_total;
 
+    /*!
+     * \brief Frequency of the TSC, if the RDTSC instruction can be used for time measurements.
+     *
+     * Zero if RDTSC cannot be used (no invariant TSC, unknown frequency, RDTSC not allowed in the
+     * environment, or the PAL does not support it).
+     */
+    uint64_t tsc_hz;
+
     struct pal_cpu_info cpu_info;
     struct pal_topo_info topo_info; /* received from untrusted host, but sanitized */
 
@@ -396,6 +405,59 @@ int PalStreamRead(PAL_HANDLE handle, uint64_t offset, size_t* count, void* buffe
  */
 int PalStreamWrite(PAL_HANDLE handle, uint64_t offset, size_t* count, void* buffer);
 
+/*!
+ * \brief Copy data from a file to another stream on the host, without passing it through the
+ *        caller's buffers.
+ *
+ * \param         in_handle   Handle to the file to copy from.
+ * \param         in_offset   Offset in \p in_handle to copy from.
+ * \param         out_handle  Handle to a file or a TCP socket to copy to.
+ * \param         out_offset  Offset in \p out_handle to copy to. Ignored for sockets.
+ * \param[in,out] count       Maximum number of bytes to copy. On success, will be set to the number
+ *                            of bytes copied (0 means end of file).
+ *
+ * \returns 0 on success, negative error code on failure. `-PAL_ERROR_NOTSUPPORT` means that these
+ *          two handles cannot be connected and the caller should copy the data itself (using
+ *          #PalStreamRead and #PalStreamWrite or #PalSocketSend).
+ *
+ * Files whose contents are verified by PAL (e.g. trusted files on SGX) are still verified before
+ * the data is sent, so for them this may copy the data through PAL internally. Blocking behavior
+ * for sockets follows the mode of \p out_handle.
+ */
+int PalStreamSplice(PAL_HANDLE in_handle, uint64_t in_offset, PAL_HANDLE out_handle,
+                    uint64_t out_offset, size_t* count);
+
+enum pal_io_op_type {
+    PAL_IO_READ,  /*!< read into `buffer`, like #PalStreamRead */
+    PAL_IO_WRITE, /*!< write from `buffer`, like #PalStreamWrite */
+    PAL_IO_FLUSH, /*!< flush the stream, like #PalStreamFlush; `buffer` and `size` are ignored */
+};
+
+struct pal_io_op {
+    PAL_HANDLE handle;
+    enum pal_io_op_type type;
+    uint64_t offset; /*!< offset in the stream, ignored for streams without offsets */
+    void* buffer;
+    size_t size;
+    int64_t result;  /*!< set on return: number of bytes transferred or negative error code */
+};
+
+/*!
+ * \brief Execute a batch of stream operations.
+ *
+ * \param         ops    Array of operations, executed in order.
+ * \param[in,out] count  Contains the number of operations in \p ops. On success, will be set to
+ *                       the number of operations executed.
+ *
+ * \returns 0 on success, negative error code on failure.
+ *
+ * Execution stops after the first operation which fails or transfers less than `size` bytes (so
+ * that e.g. reading from consecutive offsets stops at the end of file). The `result` field is set
+ * for all executed operations. On hosts where stream operations are expensive (e.g. require an
+ * enclave exit), consecutive operations on host files are passed to the host all at once.
+ */
+int PalStreamBatch(struct pal_io_op* ops, size_t* count);
+
 enum pal_delete_mode {
     PAL_DELETE_ALL,  /*!< delete the whole resource / shut down both directions */
     PAL_DELETE_READ,  /*!< shut down the read side only */
@@ -803,6 +865,32 @@ void PalEventClear(PAL_HANDLE handle);
  */
 int PalEventWait(PAL_HANDLE handle, uint64_t* timeout_us);
 
+/*!
+ * \brief Wait on a futex word in memory shared with other processes.
+ *
+ * \param         addr        Futex word, 4-byte aligned. Must lie in the shared memory range
+ *                            (between `shared_address_start` and `shared_address_end`).
+ * \param         expected    Value of the futex word with which this function goes to sleep.
+ * \param[in,out] timeout_us  Timeout for the wait, as in #PalEventWait.
+ *
+ * \returns 0 if woken up or if `*addr` did not contain \p expected, #PAL_ERROR_TRYAGAIN in case of
+ *          timeout triggering, other negative error code otherwise.
+ *
+ * Unlike #PalEventWait, this function works on memory shared with other processes (e.g. mapped
+ * from a device), so that they can wake this thread using #PalSharedFutexWake. The futex word is
+ * untrusted on SGX: wake-ups may be spurious or missing, so callers must re-check their condition
+ * after returning and should use a timeout if a missed wake-up matters.
+ */
+int PalSharedFutexWait(uint32_t* addr, uint32_t expected, uint64_t* timeout_us);
+
+/*!
+ * \brief Wake threads waiting on a futex word in memory shared with other processes.
+ *
+ * \param addr   Futex word, see #PalSharedFutexWait.
+ * \param count  Maximal number of threads to wake.
+ */
+int PalSharedFutexWake(uint32_t* addr, uint32_t count);
+
 typedef uint32_t pal_wait_flags_t; /* bitfield */
 #define PAL_WAIT_READ     1
 #define PAL_WAIT_WRITE    2
@@ -827,6 +915,77 @@ typedef uint32_t pal_wait_flags_t; /* bitfield */
 int PalStreamsWaitEvents(size_t count, PAL_HANDLE* handle_array, pal_wait_flags_t* events,
                          pal_wait_flags_t* ret_events, uint64_t* timeout_us);
 
+/*!
+ * \brief Create an event set.
+ *
+ * \param[out] handle  On success contains the event set handle.
+ *
+ * \returns 0 on success, negative error code on failure (#PAL_ERROR_NOTIMPLEMENTED if this PAL
+ *          does not support event sets).
+ *
+ * An event set is a persistent set of handles (each with requested events and an opaque cookie),
+ * backed by a host-level notification mechanism (e.g. epoll on Linux). Unlike
+ * #PalStreamsWaitEvents, waiting on an event set costs time proportional to the number of ready
+ * handles, not to the number of handles in the set. Only handles with an underlying host fd (e.g.
+ * sockets) can be added. Event sets are level-triggered. The handle is closed with
+ * #PalObjectDestroy.
+ */
+int PalEventSetCreate(PAL_HANDLE* handle);
+
+enum pal_event_set_op {
+    PAL_EVENT_SET_ADD,
+    PAL_EVENT_SET_MODIFY,
+    PAL_EVENT_SET_DELETE,
+};
+
+struct pal_event_set_update {
+    enum pal_event_set_op op;
+    PAL_HANDLE handle;
+    /* `events` and `cookie` are ignored for `PAL_EVENT_SET_DELETE`. */
+    pal_wait_flags_t events;
+    uint64_t cookie;
+};
+
+struct pal_event_set_event {
+    uint64_t cookie;
+    pal_wait_flags_t events;
+};
+
+/*!
+ * \brief Update an event set and wait for events on it (and on additional handles).
+ *
+ * \param         set               Event set handle.
+ * \param         updates           Updates to apply to the set, in order, before waiting.
+ * \param         updates_count     The number of items in \p updates.
+ * \param         count             The number of items in \p handle_array.
+ * \param         handle_array      Additional handles to poll, see #PalStreamsWaitEvents.
+ * \param         events            Requested events for each handle in \p handle_array.
+ * \param[out]    ret_events        Events that were detected on each handle in \p handle_array.
+ * \param[out]    set_events        Events that were detected on handles in the set.
+ * \param[in,out] set_events_count  On entry the capacity of \p set_events, on return the number of
+ *                                  filled entries.
+ * \param[in,out] timeout_us        Timeout for the wait (`NULL` to block indefinitely).
+ *
+ * \returns 0 if there was an event on at least one handle (or if there was nothing to wait for,
+ *          i.e. \p count and \p set_events_count are both 0), negative error code otherwise
+ *          (#PAL_ERROR_TRYAGAIN in case of timeout).
+ *
+ * Updates are applied in a single host round-trip together with the wait. Adding a handle that is
+ * already in the set modifies it, modifying a handle that is not in the set adds it, and deleting
+ * a handle that is not in the set (e.g. because its host fd was already closed) is not an error.
+ * If an update fails, the remaining updates are not applied and the error is returned without
+ * waiting.
+ *
+ * The set never reports more than the requested events plus #PAL_WAIT_ERROR and
+ * #PAL_WAIT_HANG_UP. Reporting may be spurious (e.g. right after a handle was deleted from the set
+ * by a concurrent call), so callers must validate returned cookies.
+ */
+int PalEventSetWait(PAL_HANDLE set, const struct pal_event_set_update* updates,
+                    size_t updates_count, size_t count, PAL_HANDLE* handle_array,
+                    pal_wait_flags_t* events, pal_wait_flags_t* ret_events,
+                    struct pal_event_set_event* set_events, size_t* set_events_count,
+                    uint64_t* timeout_us);
+
 /*!
  * \brief Close and deallocate a PAL handle.
  */
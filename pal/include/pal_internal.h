@@ -48,6 +48,11 @@ struct handle_ops {
     int64_t (*read)(PAL_HANDLE handle, uint64_t offset, uint64_t count, void* buffer);
     int64_t (*write)(PAL_HANDLE handle, uint64_t offset, uint64_t count, const void* buffer);
 
+    /* 'batch' is used by PalStreamBatch and is optional. It executes a prefix of 'ops' (all of which
+     * refer to handles with these ops), sets 'result' of the executed operations and returns their
+     * number. It must stop after an operation which fails or transfers less than requested. */
+    int64_t (*batch)(struct pal_io_op* ops, size_t count);
+
     /* 'delete' is used by PalStreamDelete: for files and dirs it corresponds to unlinking, for
      * sockets it corresponds to shutting down a socket connection. */
     int (*delete)(PAL_HANDLE handle, enum pal_delete_mode delete_mode);
@@ -173,6 +178,8 @@ int _PalStreamOpen(PAL_HANDLE* handle, const char* uri, enum pal_access access,
 int _PalStreamDelete(PAL_HANDLE handle, enum pal_delete_mode delete_mode);
 int64_t _PalStreamRead(PAL_HANDLE handle, uint64_t offset, uint64_t count, void* buf);
 int64_t _PalStreamWrite(PAL_HANDLE handle, uint64_t offset, uint64_t count, const void* buf);
+int64_t _PalStreamSplice(PAL_HANDLE in_handle, uint64_t in_offset, PAL_HANDLE out_handle,
+                         uint64_t out_offset, uint64_t count);
 int _PalStreamAttributesQuery(const char* uri, PAL_STREAM_ATTR* attr);
 int _PalStreamAttributesQueryByHandle(PAL_HANDLE hdl, PAL_STREAM_ATTR* attr);
 int _PalStreamMap(PAL_HANDLE handle, void* addr, pal_prot_flags_t prot, uint64_t offset,
@@ -212,6 +219,8 @@ int _PalEventCreate(PAL_HANDLE* handle_ptr, bool init_signaled, bool auto_clear)
 void _PalEventSet(PAL_HANDLE handle);
 void _PalEventClear(PAL_HANDLE handle);
 int _PalEventWait(PAL_HANDLE handle, uint64_t* timeout_us);
+int _PalSharedFutexWait(uint32_t* addr, uint32_t expected, uint64_t* timeout_us);
+int _PalSharedFutexWake(uint32_t* addr, uint32_t count);
 
 /* PalVirtualMemory calls */
 int _PalVirtualMemoryAlloc(void* addr, uint64_t size, pal_prot_flags_t prot);
@@ -222,6 +231,12 @@ int _PalVirtualMemoryProtect(void* addr, uint64_t size, pal_prot_flags_t prot);
 void _PalObjectDestroy(PAL_HANDLE object_handle);
 int _PalStreamsWaitEvents(size_t count, PAL_HANDLE* handle_array, pal_wait_flags_t* events,
                           pal_wait_flags_t* ret_events, uint64_t* timeout_us);
+int _PalEventSetCreate(PAL_HANDLE* handle);
+int _PalEventSetWait(PAL_HANDLE set, const struct pal_event_set_update* updates,
+                     size_t updates_count, size_t count, PAL_HANDLE* handle_array,
+                     pal_wait_flags_t* events, pal_wait_flags_t* ret_events,
+                     struct pal_event_set_event* set_events, size_t* set_events_count,
+                     uint64_t* timeout_us);
 
 /* PalException calls & structures */
 pal_event_handler_t _PalGetExceptionHandler(enum pal_event event);
@@ -287,6 +302,10 @@ int pal_internal_memory_free(void* addr, size_t size);
 void pal_disable_early_memory_bookkeeping(void);
 
 void init_slab_mgr(void);
+/* Must be called once the TCB of the first thread is set up */
+void enable_slab_mgr_thread_cache(void);
+/* Must be called by each thread before it exits */
+void destroy_slab_mgr_thread_cache(void);
 void* malloc(size_t size);
 void* calloc(size_t num, size_t size);
 void free(void* mem);
@@ -23,6 +23,8 @@ int main(int argc, char** argv, char** envp) {
     PRINT_SYMBOL(PalStreamWaitForClient);
     PRINT_SYMBOL(PalStreamRead);
     PRINT_SYMBOL(PalStreamWrite);
+    PRINT_SYMBOL(PalStreamSplice);
+    PRINT_SYMBOL(PalStreamBatch);
     PRINT_SYMBOL(PalStreamDelete);
     PRINT_SYMBOL(PalStreamMap);
     PRINT_SYMBOL(PalStreamSetLength);
@@ -34,6 +36,8 @@ int main(int argc, char** argv, char** envp) {
     PRINT_SYMBOL(PalStreamAttributesSetByHandle);
     PRINT_SYMBOL(PalStreamChangeName);
     PRINT_SYMBOL(PalStreamsWaitEvents);
+    PRINT_SYMBOL(PalEventSetCreate);
+    PRINT_SYMBOL(PalEventSetWait);
 
     PRINT_SYMBOL(PalThreadCreate);
     PRINT_SYMBOL(PalThreadYieldExecution);
@@ -0,0 +1,209 @@
+/* Micro-benchmark of the string functions from the common library (`strlen`, `strnlen`, `strchr`,
+ * `memcmp` and backward `memmove`) against simple byte-at-a-time versions, for sizes from 8 B to
+ * 1 MiB. Also checks that both versions return the same results, and that the scanning functions do
+ * not read past the end of a string that ends just before an inaccessible page. */
+
+#include "api.h"
+#include "pal.h"
+#include "pal_regression.h"
+
+#define MAX_SIZE   (1024 * 1024)
+/* bytes processed by each function for each size, to get measurable times */
+#define TOTAL_SIZE (16 * 1024 * 1024)
+
+static const size_t g_sizes[] = {8, 64, 512, 4096, 32768, 262144, MAX_SIZE};
+
+static size_t byte_strlen(const char* str) {
+    size_t len;
+    for (len = 0; str[len] != '\0'; len++)
+        ;
+    return len;
+}
+
+static size_t byte_strnlen(const char* str, size_t maxlen) {
+    size_t len;
+    for (len = 0; len < maxlen && str[len] != '\0'; len++)
+        ;
+    return len;
+}
+
+static char* byte_strchr(const char* s, int c) {
+    while (true) {
+        if (*s == c)
+            return (char*)s;
+        if (*s == '\0')
+            return NULL;
+        s++;
+    }
+}
+
+static int byte_memcmp(const void* lhs, const void* rhs, size_t count) {
+    const unsigned char* l = lhs;
+    const unsigned char* r = rhs;
+    while (count && *l == *r) {
+        count--;
+        l++;
+        r++;
+    }
+    return count ? *l - *r : 0;
+}
+
+static void* byte_memmove_backward(void* dest, const void* src, size_t count) {
+    char* d = dest;
+    const char* s = src;
+    while (count--)
+        d[count] = s[count];
+    return dest;
+}
+
+static uint64_t time_us(void) {
+    uint64_t time;
+    CHECK(PalSystemTimeQuery(&time));
+    return time;
+}
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+/* `str` has `size - 1` non-zero bytes; `other` is a copy of it */
+static void bench_size(char* str, char* other, size_t size) {
+    size_t iterations = MAX(TOTAL_SIZE / size, (size_t)1);
+    uint64_t start;
+    uint64_t new_us[5];
+    uint64_t old_us[5];
+    size_t sum = 0;
+
+    start = time_us();
+    for (size_t i = 0; i < iterations; i++)
+        sum += strlen(str);
+    new_us[0] = time_us() - start;
+    start = time_us();
+    for (size_t i = 0; i < iterations; i++)
+        sum -= byte_strlen(str);
+    old_us[0] = time_us() - start;
+
+    start = time_us();
+    for (size_t i = 0; i < iterations; i++)
+        sum += strnlen(str, size);
+    new_us[1] = time_us() - start;
+    start = time_us();
+    for (size_t i = 0; i < iterations; i++)
+        sum -= byte_strnlen(str, size);
+    old_us[1] = time_us() - start;
+
+    start = time_us();
+    for (size_t i = 0; i < iterations; i++)
+        sum += (size_t)strchr(str, '!');
+    new_us[2] = time_us() - start;
+    start = time_us();
+    for (size_t i = 0; i < iterations; i++)
+        sum -= (size_t)byte_strchr(str, '!');
+    old_us[2] = time_us() - start;
+
+    start = time_us();
+    for (size_t i = 0; i < iterations; i++)
+        sum += memcmp(str, other, size);
+    new_us[3] = time_us() - start;
+    start = time_us();
+    for (size_t i = 0; i < iterations; i++)
+        sum -= byte_memcmp(str, other, size);
+    old_us[3] = time_us() - start;
+
+    /* overlapping copy to a higher address, in place in `other` */
+    start = time_us();
+    for (size_t i = 0; i < iterations; i++)
+        memmove(other + 1, other, size - 1);
+    new_us[4] = time_us() - start;
+    start = time_us();
+    for (size_t i = 0; i < iterations; i++)
+        byte_memmove_backward(other + 1, other, size - 1);
+    old_us[4] = time_us() - start;
+
+    if (sum != 0)
+        FAIL("results of the byte-at-a-time and the common functions differ (size %lu)", size);
+
+    pal_printf("size %7lu: strlen %lu/%lu us, strnlen %lu/%lu us, strchr %lu/%lu us, "
+               "memcmp %lu/%lu us, memmove %lu/%lu us (common/byte-at-a-time)\n",
+               size, new_us[0], old_us[0], new_us[1], old_us[1], new_us[2], old_us[2], new_us[3],
+               old_us[3], new_us[4], old_us[4]);
+}
+
+/* Checks all functions on a string of length `len` that ends at the end of an accessible page. */
+static void check_len(char* page_end, size_t len) {
+    char* str = page_end - len - 1;
+    for (size_t i = 0; i < len; i++)
+        str[i] = 'a' + i % 26;
+    str[len] = '\0';
+
+    for (size_t skip = 0; skip <= MIN(len, (size_t)32); skip++) {
+        char* s = str + skip;
+        size_t n = len - skip;
+        if (strlen(s) != n)
+            FAIL("strlen() of %lu bytes returned %lu", n, strlen(s));
+        for (size_t maxlen = 0; maxlen <= n + 1; maxlen++)
+            if (strnlen(s, maxlen) != MIN(n, maxlen))
+                FAIL("strnlen() of %lu bytes with limit %lu returned %lu", n, maxlen,
+                     strnlen(s, maxlen));
+        for (int c = 'a'; c <= 'z' + 1; c++)
+            if (strchr(s, c) != byte_strchr(s, c))
+                FAIL("strchr() of %lu bytes for '%c' returned a wrong result", n, c);
+        if (strchr(s, '\0') != s + n)
+            FAIL("strchr() of %lu bytes for '\\0' returned a wrong result", n);
+    }
+
+    /* a zero byte just before the string must not be taken for the terminator */
+    if (str > page_end - PAGE_SIZE) {
+        str[-1] = '\0';
+        if (strlen(str) != len)
+            FAIL("strlen() of %lu bytes preceded by '\\0' returned %lu", len, strlen(str));
+    }
+}
+
+int main(void) {
+    char* mem = NULL;
+    CHECK(memory_alloc(2 * MAX_SIZE + PAGE_SIZE, PAL_PROT_READ | PAL_PROT_WRITE, (void**)&mem));
+
+    /* strings end right before an inaccessible page */
+    char* guard = mem + 2 * MAX_SIZE;
+    CHECK(PalVirtualMemoryProtect(guard, PAGE_SIZE, /*prot=*/0));
+    for (size_t len = 0; len <= 200; len++)
+        check_len(guard, len);
+
+    char* a = mem;
+    char* b = mem + MAX_SIZE;
+    for (size_t i = 0; i < MAX_SIZE; i++)
+        a[i] = b[i] = 'a' + i % 26;
+    for (size_t i = 0; i < 64; i++)
+        for (size_t j = i; j < 64 + i; j++) {
+            b[j] ^= 1;
+            if (sign(memcmp(a + i, b + i, 64)) != sign(byte_memcmp(a + i, b + i, 64)))
+                FAIL("memcmp() at offset %lu with a difference at %lu returned a wrong result",
+                     i, j);
+            b[j] ^= 1;
+        }
+
+    /* overlapping copies to a higher address */
+    for (size_t shift = 1; shift <= 17; shift++)
+        for (size_t count = 0; count <= 100; count++) {
+            memcpy(b, a, 128);
+            byte_memmove_backward(b + shift, b, count);
+            memcpy(b + MAX_SIZE / 2, a, 128);
+            memmove(b + MAX_SIZE / 2 + shift, b + MAX_SIZE / 2, count);
+            if (memcmp(b, b + MAX_SIZE / 2, 128))
+                FAIL("memmove() of %lu bytes by %lu bytes returned a wrong result", count, shift);
+        }
+    memcpy(b, a, MAX_SIZE);
+
+    for (size_t i = 0; i < ARRAY_LEN(g_sizes); i++) {
+        size_t size = g_sizes[i];
+        a[size - 1] = '\0';
+        b[size - 1] = '\0';
+        bench_size(a, b, size);
+        a[size - 1] = 'a' + (size - 1) % 26;
+        memcpy(b, a, MAX_SIZE);
+    }
+
+    pal_printf("TEST OK\n");
+    return 0;
+}
@@ -33,6 +33,10 @@ class TC_00_Basic(RegressionTestCase):
         _, stderr = self.run_binary(['strtoll_test'])
         self.assertIn("TEST OK", stderr)
 
+    def test_005_string_bench(self):
+        _, stderr = self.run_binary(['string_bench'])
+        self.assertIn("TEST OK", stderr)
+
 
 class TC_00_BasicSet2(RegressionTestCase):
     @unittest.skipUnless(ON_X86, "x86-specific")
@@ -148,6 +152,8 @@ class TC_02_Symbols(RegressionTestCase):
         'PalStreamWaitForClient',
         'PalStreamRead',
         'PalStreamWrite',
+        'PalStreamSplice',
+        'PalStreamBatch',
         'PalStreamDelete',
         'PalStreamMap',
         'PalStreamSetLength',
@@ -168,6 +174,8 @@ class TC_02_Symbols(RegressionTestCase):
         'PalEventClear',
         'PalEventWait',
         'PalStreamsWaitEvents',
+        'PalEventSetCreate',
+        'PalEventSetWait',
         'PalObjectDestroy',
         'PalSystemTimeQuery',
         'PalRandomBitsRead',
@@ -18,7 +18,8 @@
 #define LOCAL_ATTESTATION_TAG_PARENT_STR "GRAMINE_LOCAL_ATTESTATION_TAG_PARENT"
 #define LOCAL_ATTESTATION_TAG_CHILD_STR "GRAMINE_LOCAL_ATTESTATION_TAG_CHILD"
 
-static int register_file(const char* uri, const char* hash_str, bool check_duplicates);
+static int register_file(const char* uri, const char* hash_str, const char* chunk_hashes_path,
+                         const char* chunk_hashes_hash_str, bool check_duplicates);
 
 uintptr_t g_enclave_base;
 uintptr_t g_enclave_top;
@@ -400,8 +401,28 @@ int sgx_get_seal_key(uint16_t key_policy, sgx_key_128bit_t* out_seal_key) {
     return 0;
 }
 
-DEFINE_LISTP(trusted_file);
-static LISTP_TYPE(trusted_file) g_trusted_file_list = LISTP_INIT;
+/*
+ * Trusted files are kept in a hash table keyed by the file path (trusted files must match exactly),
+ * and allowed files are kept in a trie of path components (an allowed directory matches all files
+ * under it). Both structures only grow at runtime (see `register_file()`), so readers traverse them
+ * without taking any lock: each new entry is fully initialized before being published with a
+ * release store, and readers observe it via acquire loads. Writers serialize on
+ * `g_trusted_file_lock`, which also protects the lazily calculated `chunk_hashes`.
+ */
+#define TRUSTED_FILES_HTABLE_MIN_SIZE 1024
+
+struct allowed_file_node {
+    struct allowed_file_node* children;     /* head of the singly-linked list of children */
+    struct allowed_file_node* next_sibling;
+    struct trusted_file* tf;     /* allowed file/dir URI ending at this node (no trailing slash) */
+    struct trusted_file* tf_dir; /* allowed dir URI ending at this node with a trailing slash */
+    size_t name_len;
+    char name[]; /* path component, not NULL-terminated */
+};
+
+static struct trusted_file** g_trusted_files_htable = NULL;
+static size_t g_trusted_files_htable_size = 0; /* always a power of two */
+static struct allowed_file_node g_allowed_files_root;
 static spinlock_t g_trusted_file_lock = INIT_SPINLOCK_UNLOCKED;
 static int g_file_check_policy = FILE_CHECK_POLICY_STRICT;
 
@@ -418,112 +439,252 @@ static void find_path_in_uri(const char* uri, size_t uri_len, const char** out_p
     *out_path_len = uri_len - URI_PREFIX_DEV_LEN;
 }
 
-/* assumes `path` is normalized */
-static bool path_is_equal_or_subpath(const struct trusted_file* tf, const char* path,
-                                     size_t path_len) {
-    const char* tf_path;
-    size_t tf_path_len;
-    find_path_in_uri(tf->uri, tf->uri_len, &tf_path, &tf_path_len);
-
-    if (tf_path_len > path_len || memcmp(tf_path, path, tf_path_len)) {
-        /* tf path is not a prefix of `path` */
-        return false;
-    }
-    if (tf_path_len == path_len) {
-        /* Both are equal */
-        return true;
-    }
-    if (tf_path[tf_path_len - 1] == '/') {
-        /* tf path is a subpath of `path` (with slash), e.g. "foo/" and "foo/bar" */
-        return true;
+/* FNV-1a; paths in the manifest typically share long prefixes, so we hash all bytes */
+static uint64_t hash_path(const char* path, size_t path_len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < path_len; i++) {
+        hash ^= (uint8_t)path[i];
+        hash *= 0x100000001b3ULL;
     }
-    if (path[tf_path_len] == '/') {
-        /* tf path is a subpath of `path` (without slash), e.g. "foo" and "foo/bar" */
-        return true;
+    return hash;
+}
+
+static struct trusted_file* find_trusted_file(const char* path, size_t path_len) {
+    struct trusted_file** htable = __atomic_load_n(&g_trusted_files_htable, __ATOMIC_ACQUIRE);
+    if (!htable)
+        return NULL;
+
+    size_t idx = hash_path(path, path_len) & (g_trusted_files_htable_size - 1);
+    struct trusted_file* tf = __atomic_load_n(&htable[idx], __ATOMIC_ACQUIRE);
+    for (; tf; tf = tf->htable_next) {
+        const char* tf_path;
+        size_t tf_path_len;
+        find_path_in_uri(tf->uri, tf->uri_len, &tf_path, &tf_path_len);
+        if (tf_path_len == path_len && !memcmp(tf_path, path, path_len))
+            return tf;
     }
-    return false;
+    return NULL;
 }
 
-struct trusted_file* get_trusted_or_allowed_file(const char* path) {
-    struct trusted_file* tf = NULL;
+/* must be called with `g_trusted_file_lock` held */
+static int ensure_trusted_files_htable(size_t size) {
+    if (g_trusted_files_htable)
+        return 0;
 
-    size_t path_len = strlen(path);
+    size_t htable_size = TRUSTED_FILES_HTABLE_MIN_SIZE;
+    while (htable_size < size)
+        htable_size *= 2;
 
-    spinlock_lock(&g_trusted_file_lock);
+    struct trusted_file** htable = calloc(htable_size, sizeof(*htable));
+    if (!htable)
+        return -PAL_ERROR_NOMEM;
 
-    struct trusted_file* tmp;
-    LISTP_FOR_EACH_ENTRY(tmp, &g_trusted_file_list, list) {
-        if (tmp->allowed) {
-            /* allowed files: must be a subfolder or file */
-            if (path_is_equal_or_subpath(tmp, path, path_len)) {
-                tf = tmp;
-                break;
-            }
-        } else {
-            /* trusted files: must be exactly the same URI */
-            const char* tf_path;
-            size_t tf_path_len;
-            find_path_in_uri(tmp->uri, tmp->uri_len, &tf_path, &tf_path_len);
-            if (tf_path_len == path_len && !memcmp(tf_path, path, path_len + 1)) {
-                tf = tmp;
-                break;
-            }
+    g_trusted_files_htable_size = htable_size;
+    __atomic_store_n(&g_trusted_files_htable, htable, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* must be called with `g_trusted_file_lock` held */
+static void add_trusted_file(struct trusted_file* tf, const char* path, size_t path_len) {
+    assert(g_trusted_files_htable);
+    size_t idx = hash_path(path, path_len) & (g_trusted_files_htable_size - 1);
+    tf->htable_next = g_trusted_files_htable[idx];
+    __atomic_store_n(&g_trusted_files_htable[idx], tf, __ATOMIC_RELEASE);
+}
+
+static struct allowed_file_node* find_allowed_file_child(struct allowed_file_node* node,
+                                                         const char* name, size_t name_len) {
+    struct allowed_file_node* child = __atomic_load_n(&node->children, __ATOMIC_ACQUIRE);
+    for (; child; child = child->next_sibling)
+        if (child->name_len == name_len && !memcmp(child->name, name, name_len))
+            return child;
+    return NULL;
+}
+
+/* Walks `path` component by component (an absolute path starts with an empty component). Matching
+ * rules are the same as in the original linear scan: allowed "foo" matches "foo" and "foo/bar" but
+ * not "foobar", and allowed "foo/" matches "foo/bar" (and "foo/") but not "foo". */
+static struct trusted_file* find_allowed_file(const char* path, size_t path_len) {
+    struct allowed_file_node* node = &g_allowed_files_root;
+    const char* path_end = path + path_len;
+    const char* name = path;
+
+    while (true) {
+        const char* name_end = name;
+        while (name_end < path_end && *name_end != '/')
+            name_end++;
+
+        node = find_allowed_file_child(node, name, name_end - name);
+        if (!node)
+            return NULL;
+
+        struct trusted_file* tf = __atomic_load_n(&node->tf, __ATOMIC_ACQUIRE);
+        if (tf)
+            return tf;
+
+        if (name_end == path_end)
+            return NULL;
+
+        /* there is a slash after this component */
+        tf = __atomic_load_n(&node->tf_dir, __ATOMIC_ACQUIRE);
+        if (tf)
+            return tf;
+
+        name = name_end + 1;
+    }
+}
+
+/* must be called with `g_trusted_file_lock` held; returns existing entry if the URI is a dup */
+static int add_allowed_file(struct trusted_file* tf, const char* path, size_t path_len,
+                            struct trusted_file** out_existing) {
+    *out_existing = NULL;
+
+    bool is_dir = path_len > 0 && path[path_len - 1] == '/';
+    if (is_dir)
+        path_len--;
+
+    struct allowed_file_node* node = &g_allowed_files_root;
+    const char* path_end = path + path_len;
+    const char* name = path;
+
+    while (true) {
+        const char* name_end = name;
+        while (name_end < path_end && *name_end != '/')
+            name_end++;
+        size_t name_len = name_end - name;
+
+        struct allowed_file_node* child = find_allowed_file_child(node, name, name_len);
+        if (!child) {
+            child = calloc(1, sizeof(*child) + name_len);
+            if (!child)
+                return -PAL_ERROR_NOMEM;
+            memcpy(child->name, name, name_len);
+            child->name_len = name_len;
+            child->next_sibling = node->children;
+            __atomic_store_n(&node->children, child, __ATOMIC_RELEASE);
         }
+        node = child;
+
+        if (name_end == path_end)
+            break;
+        name = name_end + 1;
     }
 
-    spinlock_unlock(&g_trusted_file_lock);
+    struct trusted_file** slot = is_dir ? &node->tf_dir : &node->tf;
+    if (*slot) {
+        *out_existing = *slot;
+        return 0;
+    }
+    __atomic_store_n(slot, tf, __ATOMIC_RELEASE);
+    return 0;
+}
 
-    return tf;
+struct trusted_file* get_trusted_or_allowed_file(const char* path) {
+    size_t path_len = strlen(path);
+
+    /* allowed files are registered before trusted files, so they take precedence (this mimics the
+     * order of the previously used single list of trusted and allowed files) */
+    struct trusted_file* tf = find_allowed_file(path, path_len);
+    if (tf)
+        return tf;
+
+    return find_trusted_file(path, path_len);
 }
 
-int load_trusted_or_allowed_file(struct trusted_file* tf, PAL_HANDLE file, bool create,
-                                 sgx_chunk_hash_t** out_chunk_hashes, uint64_t* out_size,
-                                 void** out_umem) {
+/* Loads chunk hashes of a trusted file from its "chunk hashes" file (generated at sign time, see
+ * `chunk_hashes_uri` in the manifest) into enclave memory and checks them against the reference
+ * hash of the chunk-hashes file from the manifest. The chunk-hashes file is untrusted and consists
+ * of all 128-bit chunk hashes of the trusted file, in order. */
+static int load_chunk_hashes_file(struct trusted_file* tf, sgx_chunk_hash_t** out_chunk_hashes) {
     int ret;
+    void* umem = NULL;
+    sgx_chunk_hash_t* chunk_hashes = NULL;
+    size_t chunk_hashes_size = sizeof(*chunk_hashes) * UDIV_ROUND_UP(tf->size, TRUSTED_CHUNK_SIZE);
+    assert(chunk_hashes_size > 0);
 
-    *out_chunk_hashes = NULL;
-    *out_size = 0;
-    *out_umem = NULL;
+    int fd = ocall_open(tf->chunk_hashes_path, O_RDONLY | O_CLOEXEC, /*mode=*/0);
+    if (fd < 0) {
+        log_warning("Cannot open chunk hashes file '%s' of trusted file '%s'",
+                    tf->chunk_hashes_path, tf->uri);
+        return unix_to_pal_error(fd);
+    }
 
-    if (create) {
-        assert(tf->allowed);
-        return register_file(tf->uri, /*hash_str=*/NULL, /*check_duplicates=*/true);
+    struct stat st;
+    ret = ocall_fstat(fd, &st);
+    if (ret < 0) {
+        ret = unix_to_pal_error(ret);
+        goto out;
     }
 
-    if (tf->allowed) {
-        /* allowed files: do not need any integrity, so no need for chunk hashes */
-        return 0;
+    /* the size of the trusted file is reported by the host; if it lies, the number of chunks does
+     * not match or the last chunk fails verification on access */
+    if ((uint64_t)st.st_size != chunk_hashes_size) {
+        log_warning("Size of chunk hashes file '%s' does not match size of trusted file '%s'",
+                    tf->chunk_hashes_path, tf->uri);
+        ret = -PAL_ERROR_DENIED;
+        goto out;
     }
 
-    /* trusted files: need integrity, so calculate chunk hashes and compare with hash in manifest */
-    if (!file->file.seekable) {
-        log_warning("Trusted file '%s' is not seekable, cannot load it", file->file.realpath);
-        return -PAL_ERROR_DENIED;
+    chunk_hashes = malloc(chunk_hashes_size);
+    if (!chunk_hashes) {
+        ret = -PAL_ERROR_NOMEM;
+        goto out;
     }
 
-    sgx_chunk_hash_t* chunk_hashes = NULL;
-    uint8_t* tmp_chunk = NULL; /* scratch buf to calculate whole-file and chunk-of-file hashes */
+    ret = ocall_mmap_untrusted(&umem, chunk_hashes_size, PROT_READ, MAP_SHARED, fd, /*offset=*/0);
+    if (ret < 0) {
+        umem = NULL;
+        ret = unix_to_pal_error(ret);
+        goto out;
+    }
 
-    /* mmap the whole trusted file in untrusted memory for future reads/writes; it is
-     * caller's responsibility to unmap those areas after use */
-    *out_size = tf->size;
-    if (*out_size) {
-        ret = ocall_mmap_untrusted(out_umem, tf->size, PROT_READ, MAP_SHARED, file->file.fd,
-                                   /*offset=*/0);
-        if (ret < 0) {
-            *out_umem = NULL;
-            ret = unix_to_pal_error(ret);
-            goto fail;
-        }
+    /* to prevent TOCTOU attacks, copy chunk hashes into the enclave before hashing */
+    if (!sgx_copy_to_enclave(chunk_hashes, chunk_hashes_size, umem, chunk_hashes_size)) {
+        ret = -PAL_ERROR_DENIED;
+        goto out;
     }
 
-    spinlock_lock(&g_trusted_file_lock);
-    if (tf->chunk_hashes) {
-        *out_chunk_hashes = tf->chunk_hashes;
-        spinlock_unlock(&g_trusted_file_lock);
-        return 0;
+    LIB_SHA256_CONTEXT sha;
+    ret = lib_SHA256Init(&sha);
+    if (ret < 0)
+        goto out;
+
+    ret = lib_SHA256Update(&sha, (uint8_t*)chunk_hashes, chunk_hashes_size);
+    if (ret < 0)
+        goto out;
+
+    sgx_file_hash_t chunk_hashes_file_hash;
+    ret = lib_SHA256Final(&sha, chunk_hashes_file_hash.bytes);
+    if (ret < 0)
+        goto out;
+
+    if (memcmp(&chunk_hashes_file_hash, &tf->chunk_hashes_file_hash,
+               sizeof(chunk_hashes_file_hash))) {
+        log_warning("Hash of chunk hashes file '%s' does not match with the reference hash in "
+                    "manifest", tf->chunk_hashes_path);
+        ret = -PAL_ERROR_DENIED;
+        goto out;
     }
-    spinlock_unlock(&g_trusted_file_lock);
+
+    *out_chunk_hashes = chunk_hashes;
+    chunk_hashes = NULL;
+    ret = 0;
+out:
+    if (umem)
+        ocall_munmap_untrusted(umem, chunk_hashes_size);
+    ocall_close(fd);
+    free(chunk_hashes);
+    return ret;
+}
+
+/* Calculates hashes of all chunks of a trusted file and, at the same time, the hash over the whole
+ * file; the latter is checked against the reference hash in the manifest. Note that SHA-256 of the
+ * whole file is inherently sequential, so this cannot be split between several threads. */
+static int calculate_chunk_hashes(struct trusted_file* tf, const char* path, const void* umem,
+                                  sgx_chunk_hash_t** out_chunk_hashes) {
+    int ret;
+    sgx_chunk_hash_t* chunk_hashes = NULL;
+    uint8_t* tmp_chunk = NULL; /* scratch buf to calculate whole-file and chunk-of-file hashes */
 
     chunk_hashes = malloc(sizeof(sgx_chunk_hash_t) * UDIV_ROUND_UP(tf->size, TRUSTED_CHUNK_SIZE));
     if (!chunk_hashes) {
@@ -557,8 +718,10 @@ int load_trusted_or_allowed_file(struct trusted_file* tf, PAL_HANDLE file, bool
             goto fail;
 
         /* to prevent TOCTOU attacks, copy file contents into the enclave before hashing */
-        if (!sgx_copy_to_enclave(tmp_chunk, TRUSTED_CHUNK_SIZE, *out_umem + offset, chunk_size))
+        if (!sgx_copy_to_enclave(tmp_chunk, TRUSTED_CHUNK_SIZE, umem + offset, chunk_size)) {
+            ret = -PAL_ERROR_DENIED;
             goto fail;
+        }
 
         ret = lib_SHA256Update(&file_sha, tmp_chunk, chunk_size);
         if (ret < 0)
@@ -586,24 +749,90 @@ int load_trusted_or_allowed_file(struct trusted_file* tf, PAL_HANDLE file, bool
     /* check the generated hash-over-whole-file against the reference hash in the manifest */
     if (memcmp(&file_hash, &tf->file_hash, sizeof(file_hash))) {
         log_warning("Hash of trusted file '%s' does not match with the reference hash in manifest",
-                    file->file.realpath);
+                    path);
         ret = -PAL_ERROR_DENIED;
         goto fail;
     }
 
+    *out_chunk_hashes = chunk_hashes;
+    free(tmp_chunk);
+    return 0;
+
+fail:
+    free(chunk_hashes);
+    free(tmp_chunk);
+    return ret;
+}
+
+int load_trusted_or_allowed_file(struct trusted_file* tf, PAL_HANDLE file, bool create,
+                                 sgx_chunk_hash_t** out_chunk_hashes, uint64_t* out_size,
+                                 void** out_umem) {
+    int ret;
+
+    *out_chunk_hashes = NULL;
+    *out_size = 0;
+    *out_umem = NULL;
+
+    if (create) {
+        assert(tf->allowed);
+        return register_file(tf->uri, /*hash_str=*/NULL, /*chunk_hashes_path=*/NULL,
+                             /*chunk_hashes_hash_str=*/NULL, /*check_duplicates=*/true);
+    }
+
+    if (tf->allowed) {
+        /* allowed files: do not need any integrity, so no need for chunk hashes */
+        return 0;
+    }
+
+    /* trusted files: need integrity, so calculate chunk hashes and compare with hash in manifest */
+    if (!file->file.seekable) {
+        log_warning("Trusted file '%s' is not seekable, cannot load it", file->file.realpath);
+        return -PAL_ERROR_DENIED;
+    }
+
+    sgx_chunk_hash_t* chunk_hashes = NULL;
+
+    /* mmap the whole trusted file in untrusted memory for future reads/writes; it is
+     * caller's responsibility to unmap those areas after use */
+    *out_size = tf->size;
+    if (*out_size) {
+        ret = ocall_mmap_untrusted(out_umem, tf->size, PROT_READ, MAP_SHARED, file->file.fd,
+                                   /*offset=*/0);
+        if (ret < 0) {
+            *out_umem = NULL;
+            ret = unix_to_pal_error(ret);
+            goto fail;
+        }
+    }
+
+    spinlock_lock(&g_trusted_file_lock);
+    if (tf->chunk_hashes) {
+        *out_chunk_hashes = tf->chunk_hashes;
+        spinlock_unlock(&g_trusted_file_lock);
+        return 0;
+    }
+    spinlock_unlock(&g_trusted_file_lock);
+
+    if (tf->chunk_hashes_path && tf->size) {
+        /* chunk hashes were precomputed at sign time, skip hashing the whole file: each chunk is
+         * verified against its hash only when it is accessed (see copy_and_verify_trusted_file) */
+        ret = load_chunk_hashes_file(tf, &chunk_hashes);
+    } else {
+        ret = calculate_chunk_hashes(tf, file->file.realpath, *out_umem, &chunk_hashes);
+    }
+    if (ret < 0)
+        goto fail;
+
     spinlock_lock(&g_trusted_file_lock);
     if (tf->chunk_hashes) {
         *out_chunk_hashes = tf->chunk_hashes;
         spinlock_unlock(&g_trusted_file_lock);
         free(chunk_hashes);
-        free(tmp_chunk);
         return 0;
     }
     tf->chunk_hashes = chunk_hashes;
     *out_chunk_hashes = chunk_hashes;
     spinlock_unlock(&g_trusted_file_lock);
-
-    free(tmp_chunk);
     return 0;
 
 fail:
@@ -611,8 +840,6 @@ fail:
         assert(*out_size > 0);
         ocall_munmap_untrusted(*out_umem, *out_size);
     }
-    free(chunk_hashes);
-    free(tmp_chunk);
     return ret;
 }
 
@@ -624,6 +851,127 @@ static void set_file_check_policy(int policy) {
     g_file_check_policy = policy;
 }
 
+/*
+ * Cache of already verified trusted-file chunks, so that repeated reads of hot chunks (e.g. of
+ * shared libraries or Python bytecode) become a plain memcpy instead of copy + SHA256. Chunks are
+ * keyed by the array of chunk hashes of the trusted file (unique per trusted file and never freed
+ * once published) and the chunk index. The cache is bounded by `sgx.trusted_files_cache_size`
+ * (disabled by default) and evicts least recently used chunks.
+ */
+DEFINE_LIST(tf_chunk);
+struct tf_chunk {
+    LIST_TYPE(tf_chunk) lru_list;    /* most recently used first */
+    struct tf_chunk* htable_next;
+    const sgx_chunk_hash_t* chunk_hashes;
+    uint64_t chunk_idx;
+    size_t size;
+    uint8_t data[TRUSTED_CHUNK_SIZE];
+};
+DEFINE_LISTP(tf_chunk);
+
+static struct {
+    spinlock_t lock;
+    LISTP_TYPE(tf_chunk) lru;
+    struct tf_chunk** htable;
+    size_t htable_size; /* always a power of two */
+    size_t chunks_cnt;
+    size_t max_chunks_cnt; /* 0 if cache is disabled */
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} g_tf_chunk_cache = {
+    .lock = INIT_SPINLOCK_UNLOCKED,
+    .lru  = LISTP_INIT,
+};
+
+static size_t tf_chunk_htable_idx(const sgx_chunk_hash_t* chunk_hashes, uint64_t chunk_idx) {
+    uint64_t hash = ((uintptr_t)chunk_hashes >> 4) * 0x9e3779b97f4a7c15ULL ^ chunk_idx;
+    hash *= 0xff51afd7ed558ccdULL;
+    return (hash ^ (hash >> 32)) & (g_tf_chunk_cache.htable_size - 1);
+}
+
+/* must be called with `g_tf_chunk_cache.lock` held */
+static struct tf_chunk** tf_chunk_lookup(const sgx_chunk_hash_t* chunk_hashes,
+                                         uint64_t chunk_idx) {
+    struct tf_chunk** pchunk = &g_tf_chunk_cache.htable[tf_chunk_htable_idx(chunk_hashes,
+                                                                            chunk_idx)];
+    for (; *pchunk; pchunk = &(*pchunk)->htable_next)
+        if ((*pchunk)->chunk_hashes == chunk_hashes && (*pchunk)->chunk_idx == chunk_idx)
+            return pchunk;
+    return pchunk;
+}
+
+/* copies `[copy_start, copy_end)` part of the chunk to `buf` if the chunk is cached */
+static bool tf_chunk_cache_get(const sgx_chunk_hash_t* chunk_hashes, uint64_t chunk_idx,
+                               size_t chunk_size, uint8_t* buf, size_t copy_start,
+                               size_t copy_end) {
+    if (!g_tf_chunk_cache.max_chunks_cnt)
+        return false;
+
+    bool found = false;
+    spinlock_lock(&g_tf_chunk_cache.lock);
+    struct tf_chunk* chunk = *tf_chunk_lookup(chunk_hashes, chunk_idx);
+    /* the size may differ if the host reported a different file size on another open() */
+    if (chunk && chunk->size == chunk_size) {
+        memcpy(buf, chunk->data + copy_start, copy_end - copy_start);
+        LISTP_DEL(chunk, &g_tf_chunk_cache.lru, lru_list);
+        LISTP_ADD(chunk, &g_tf_chunk_cache.lru, lru_list);
+        g_tf_chunk_cache.hits++;
+        found = true;
+    } else {
+        g_tf_chunk_cache.misses++;
+    }
+    spinlock_unlock(&g_tf_chunk_cache.lock);
+    return found;
+}
+
+/* `data` must be already verified against the chunk hash */
+static void tf_chunk_cache_put(const sgx_chunk_hash_t* chunk_hashes, uint64_t chunk_idx,
+                               const uint8_t* data, size_t chunk_size) {
+    if (!g_tf_chunk_cache.max_chunks_cnt)
+        return;
+
+    spinlock_lock(&g_tf_chunk_cache.lock);
+    struct tf_chunk** pchunk = tf_chunk_lookup(chunk_hashes, chunk_idx);
+    struct tf_chunk* chunk = *pchunk;
+    if (chunk) {
+        /* another thread already cached this chunk (or the file size changed in the meantime) */
+        memcpy(chunk->data, data, chunk_size);
+        chunk->size = chunk_size;
+        goto out;
+    }
+
+    if (g_tf_chunk_cache.chunks_cnt < g_tf_chunk_cache.max_chunks_cnt) {
+        chunk = malloc(sizeof(*chunk));
+        if (!chunk)
+            goto out;
+        g_tf_chunk_cache.chunks_cnt++;
+    } else {
+        /* evict the least recently used chunk and reuse its memory */
+        chunk = LISTP_LAST_ENTRY(&g_tf_chunk_cache.lru, struct tf_chunk, lru_list);
+        assert(chunk);
+        LISTP_DEL(chunk, &g_tf_chunk_cache.lru, lru_list);
+        struct tf_chunk** pvictim = tf_chunk_lookup(chunk->chunk_hashes, chunk->chunk_idx);
+        assert(*pvictim == chunk);
+        *pvictim = chunk->htable_next;
+        g_tf_chunk_cache.evictions++;
+        /* the victim might have been in the same bucket, so search again */
+        pchunk = tf_chunk_lookup(chunk_hashes, chunk_idx);
+    }
+
+    INIT_LIST_HEAD(chunk, lru_list);
+    chunk->chunk_hashes = chunk_hashes;
+    chunk->chunk_idx = chunk_idx;
+    chunk->size = chunk_size;
+    memcpy(chunk->data, data, chunk_size);
+    chunk->htable_next = NULL;
+    *pchunk = chunk;
+    LISTP_ADD(chunk, &g_tf_chunk_cache.lru, lru_list);
+out:
+    spinlock_unlock(&g_tf_chunk_cache.lock);
+}
+
 int copy_and_verify_trusted_file(const char* path, uint8_t* buf, const void* umem,
                                  off_t aligned_offset, off_t aligned_end, off_t offset, off_t end,
                                  sgx_chunk_hash_t* chunk_hashes, size_t file_size) {
@@ -645,8 +993,21 @@ int copy_and_verify_trusted_file(const char* path, uint8_t* buf, const void* ume
     for (; chunk_offset < aligned_end; chunk_offset += TRUSTED_CHUNK_SIZE, chunk_hashes_item++) {
         size_t chunk_size = MIN(file_size - chunk_offset, TRUSTED_CHUNK_SIZE);
         off_t chunk_end   = chunk_offset + chunk_size;
+        uint64_t chunk_idx = chunk_offset / TRUSTED_CHUNK_SIZE;
+
+        /* determine which part of the chunk is needed by the caller */
+        off_t copy_start = MAX(chunk_offset, offset);
+        off_t copy_end   = MIN(chunk_end, end);
+        assert(copy_end > copy_start);
+
+        if (tf_chunk_cache_get(chunk_hashes, chunk_idx, chunk_size, buf_pos,
+                               copy_start - chunk_offset, copy_end - chunk_offset)) {
+            buf_pos += copy_end - copy_start;
+            continue;
+        }
 
         sgx_chunk_hash_t chunk_hash[2]; /* each chunk_hash is 128 bits in size but we need 256 */
+        const uint8_t* verified_chunk;
 
         LIB_SHA256_CONTEXT chunk_sha;
         ret = lib_SHA256Init(&chunk_sha);
@@ -664,6 +1025,7 @@ int copy_and_verify_trusted_file(const char* path, uint8_t* buf, const void* ume
             if (ret < 0)
                 goto failed;
 
+            verified_chunk = buf_pos;
             buf_pos += chunk_size;
         } else {
             /* if current chunk-to-copy only partially overlaps with the requested region-to-copy,
@@ -677,12 +1039,8 @@ int copy_and_verify_trusted_file(const char* path, uint8_t* buf, const void* ume
             if (ret < 0)
                 goto failed;
 
-            /* determine which part of the chunk is needed by the caller */
-            off_t copy_start = MAX(chunk_offset, offset);
-            off_t copy_end   = MIN(chunk_offset + (off_t)chunk_size, end);
-            assert(copy_end > copy_start);
-
             memcpy(buf_pos, tmp_chunk + copy_start - chunk_offset, copy_end - copy_start);
+            verified_chunk = tmp_chunk;
             buf_pos += copy_end - copy_start;
         }
 
@@ -696,6 +1054,8 @@ int copy_and_verify_trusted_file(const char* path, uint8_t* buf, const void* ume
             ret = -PAL_ERROR_DENIED;
             goto failed;
         }
+
+        tf_chunk_cache_put(chunk_hashes, chunk_idx, verified_chunk, chunk_size);
     }
 
     free(tmp_chunk);
@@ -707,40 +1067,77 @@ failed:
     return ret;
 }
 
-static int register_file(const char* uri, const char* hash_str, bool check_duplicates) {
+int init_trusted_files_cache(void) {
+    uint64_t cache_size;
+    int ret = toml_sizestring_in(g_pal_public_state.manifest_root, "sgx.trusted_files_cache_size",
+                                 /*defaultval=*/0, &cache_size);
+    if (ret < 0) {
+        log_error("Cannot parse 'sgx.trusted_files_cache_size'");
+        return -PAL_ERROR_INVAL;
+    }
+
+    size_t max_chunks_cnt = cache_size / TRUSTED_CHUNK_SIZE;
+    if (!max_chunks_cnt)
+        return 0;
+
+    size_t htable_size = 1;
+    while (htable_size < max_chunks_cnt)
+        htable_size *= 2;
+
+    g_tf_chunk_cache.htable = calloc(htable_size, sizeof(*g_tf_chunk_cache.htable));
+    if (!g_tf_chunk_cache.htable)
+        return -PAL_ERROR_NOMEM;
+
+    g_tf_chunk_cache.htable_size = htable_size;
+    g_tf_chunk_cache.max_chunks_cnt = max_chunks_cnt;
+    return 0;
+}
+
+void print_trusted_files_cache_stats(void) {
+    if (!g_tf_chunk_cache.max_chunks_cnt)
+        return;
+
+    spinlock_lock(&g_tf_chunk_cache.lock);
+    log_always("----- Trusted files cache stats -----\n"
+               "  # of cached chunks:  %lu (max %lu)\n"
+               "  # of hits:           %lu\n"
+               "  # of misses:         %lu\n"
+               "  # of evictions:      %lu",
+               g_tf_chunk_cache.chunks_cnt, g_tf_chunk_cache.max_chunks_cnt,
+               g_tf_chunk_cache.hits, g_tf_chunk_cache.misses, g_tf_chunk_cache.evictions);
+    spinlock_unlock(&g_tf_chunk_cache.lock);
+}
+
+static int register_file(const char* uri, const char* hash_str, const char* chunk_hashes_path,
+                         const char* chunk_hashes_hash_str, bool check_duplicates) {
+    int ret;
+
     if (hash_str && strlen(hash_str) != sizeof(sgx_file_hash_t) * 2) {
         log_error("Hash (%s) of a trusted file %s is not a SHA256 hash", hash_str, uri);
         return -PAL_ERROR_INVAL;
     }
 
+    assert(!chunk_hashes_path || (hash_str && chunk_hashes_hash_str));
+    if (chunk_hashes_hash_str && strlen(chunk_hashes_hash_str) != sizeof(sgx_file_hash_t) * 2) {
+        log_error("Hash (%s) of chunk hashes of a trusted file %s is not a SHA256 hash",
+                  chunk_hashes_hash_str, uri);
+        return -PAL_ERROR_INVAL;
+    }
+
     size_t uri_len = strlen(uri);
     if (uri_len >= URI_MAX) {
         log_error("Size of file exceeds maximum %dB: %s", URI_MAX, uri);
         return -PAL_ERROR_INVAL;
     }
 
-    if (check_duplicates) {
-        /* this check is only done during runtime (when creating a new file) and not needed during
-         * initialization (because manifest is assumed to have no duplicates); skipping this check
-         * significantly improves startup time */
-        spinlock_lock(&g_trusted_file_lock);
-        struct trusted_file* tf;
-        LISTP_FOR_EACH_ENTRY(tf, &g_trusted_file_list, list) {
-            if (tf->uri_len == uri_len && !memcmp(tf->uri, uri, uri_len)) {
-                spinlock_unlock(&g_trusted_file_lock);
-                return 0;
-            }
-        }
-        spinlock_unlock(&g_trusted_file_lock);
-    }
-
     struct trusted_file* new = malloc(sizeof(*new) + uri_len + 1);
     if (!new)
         return -PAL_ERROR_NOMEM;
 
-    INIT_LIST_HEAD(new, list);
+    new->htable_next = NULL;
     new->size = 0;
     new->chunk_hashes = NULL;
+    new->chunk_hashes_path = NULL;
     new->allowed = false;
     new->uri_len = uri_len;
     memcpy(new->uri, uri, uri_len + 1);
@@ -755,47 +1152,72 @@ static int register_file(const char* uri, const char* hash_str, bool check_dupli
             free(new);
             return -PAL_ERROR_INVAL;
         }
+
+        if (chunk_hashes_path) {
+            bytes = hex2bytes(chunk_hashes_hash_str, strlen(chunk_hashes_hash_str),
+                              new->chunk_hashes_file_hash.bytes,
+                              sizeof(new->chunk_hashes_file_hash.bytes));
+            if (!bytes) {
+                log_error("Could not parse hash of chunk hashes of file: %s", uri);
+                free(new);
+                return -PAL_ERROR_INVAL;
+            }
+
+            new->chunk_hashes_path = strdup(chunk_hashes_path);
+            if (!new->chunk_hashes_path) {
+                free(new);
+                return -PAL_ERROR_NOMEM;
+            }
+        }
     } else {
         memset(&new->file_hash, 0, sizeof(new->file_hash));
         new->allowed = true;
     }
 
+    const char* path;
+    size_t path_len;
+    find_path_in_uri(new->uri, new->uri_len, &path, &path_len);
+
     spinlock_lock(&g_trusted_file_lock);
 
-    if (check_duplicates) {
-        /* this check is only done during runtime and not needed during initialization (see above);
-         * we check again because same file could have been added by another thread in meantime */
-        struct trusted_file* tf;
-        LISTP_FOR_EACH_ENTRY(tf, &g_trusted_file_list, list) {
-            if (tf->uri_len == uri_len && !memcmp(tf->uri, uri, uri_len)) {
+    if (new->allowed) {
+        /* duplicates are detected as a side effect of inserting into the trie */
+        struct trusted_file* existing;
+        ret = add_allowed_file(new, path, path_len, &existing);
+        if (ret < 0 || existing) {
+            spinlock_unlock(&g_trusted_file_lock);
+            free(new);
+            return ret;
+        }
+    } else {
+        /* this check is only needed during runtime (when creating a new file) and not during
+         * initialization (because manifest is assumed to have no duplicates); skipping this check
+         * significantly improves startup time */
+        if (check_duplicates) {
+            struct trusted_file* tf = find_trusted_file(path, path_len);
+            if (tf && tf->uri_len == uri_len && !memcmp(tf->uri, uri, uri_len)) {
                 spinlock_unlock(&g_trusted_file_lock);
+                free(new->chunk_hashes_path);
                 free(new);
                 return 0;
             }
         }
+
+        ret = ensure_trusted_files_htable(/*size=*/0);
+        if (ret < 0) {
+            spinlock_unlock(&g_trusted_file_lock);
+            free(new->chunk_hashes_path);
+            free(new);
+            return ret;
+        }
+        add_trusted_file(new, path, path_len);
     }
 
-    LISTP_ADD_TAIL(new, &g_trusted_file_list, list);
     spinlock_unlock(&g_trusted_file_lock);
-
     return 0;
 }
 
-static int normalize_and_register_file(const char* uri, const char* hash_str) {
-    int ret;
-
-    if (hash_str) {
-        if (!strstartswith(uri, URI_PREFIX_FILE)) {
-            log_error("Invalid URI [%s]: Trusted files must start with 'file:'", uri);
-            return -PAL_ERROR_INVAL;
-        }
-    } else {
-        if (!strstartswith(uri, URI_PREFIX_FILE) && !strstartswith(uri, URI_PREFIX_DEV)) {
-            log_error("Invalid URI [%s]: Allowed files must start with 'file:' or 'dev:'", uri);
-            return -PAL_ERROR_INVAL;
-        }
-    }
-
+static int normalize_uri(const char* uri, char** out_norm_uri) {
     const size_t norm_uri_size = strlen(uri) + 1;
     char* norm_uri = malloc(norm_uri_size);
     if (!norm_uri) {
@@ -817,13 +1239,56 @@ static int normalize_and_register_file(const char* uri, const char* hash_str) {
     size_t norm_path_size = norm_uri_size - uri_prefix_len;
     if (!get_norm_path(uri + uri_prefix_len, norm_uri + uri_prefix_len, &norm_path_size)) {
         log_error("Path (%s) normalization failed", uri);
-        ret = -PAL_ERROR_INVAL;
+        free(norm_uri);
+        return -PAL_ERROR_INVAL;
+    }
+
+    *out_norm_uri = norm_uri;
+    return 0;
+}
+
+static int normalize_and_register_file(const char* uri, const char* hash_str,
+                                       const char* chunk_hashes_uri,
+                                       const char* chunk_hashes_hash_str) {
+    int ret;
+
+    if (hash_str) {
+        if (!strstartswith(uri, URI_PREFIX_FILE)) {
+            log_error("Invalid URI [%s]: Trusted files must start with 'file:'", uri);
+            return -PAL_ERROR_INVAL;
+        }
+        if (chunk_hashes_uri && !strstartswith(chunk_hashes_uri, URI_PREFIX_FILE)) {
+            log_error("Invalid URI [%s]: Chunk hashes files must start with 'file:'",
+                      chunk_hashes_uri);
+            return -PAL_ERROR_INVAL;
+        }
+    } else {
+        assert(!chunk_hashes_uri);
+        if (!strstartswith(uri, URI_PREFIX_FILE) && !strstartswith(uri, URI_PREFIX_DEV)) {
+            log_error("Invalid URI [%s]: Allowed files must start with 'file:' or 'dev:'", uri);
+            return -PAL_ERROR_INVAL;
+        }
+    }
+
+    char* norm_uri = NULL;
+    char* norm_chunk_hashes_uri = NULL;
+
+    ret = normalize_uri(uri, &norm_uri);
+    if (ret < 0)
         goto out;
+
+    if (chunk_hashes_uri) {
+        ret = normalize_uri(chunk_hashes_uri, &norm_chunk_hashes_uri);
+        if (ret < 0)
+            goto out;
     }
 
-    ret = register_file(norm_uri, hash_str, /*check_duplicates=*/false);
+    ret = register_file(norm_uri, hash_str,
+                        norm_chunk_hashes_uri ? norm_chunk_hashes_uri + URI_PREFIX_FILE_LEN : NULL,
+                        chunk_hashes_hash_str, /*check_duplicates=*/false);
 out:
     free(norm_uri);
+    free(norm_chunk_hashes_uri);
     return ret;
 }
 
@@ -844,8 +1309,17 @@ int init_trusted_files(void) {
     if (toml_trusted_files_cnt == 0)
         return 0;
 
+    /* pre-size the hash table so that chains stay short even for huge manifests */
+    spinlock_lock(&g_trusted_file_lock);
+    ret = ensure_trusted_files_htable(toml_trusted_files_cnt * 2);
+    spinlock_unlock(&g_trusted_file_lock);
+    if (ret < 0)
+        return ret;
+
     char* toml_trusted_uri_str = NULL;
     char* toml_trusted_sha256_str = NULL;
+    char* toml_chunk_hashes_uri_str = NULL;
+    char* toml_chunk_hashes_sha256_str = NULL;
 
     for (ssize_t i = 0; i < toml_trusted_files_cnt; i++) {
         /* read `sgx.trusted_file = {uri = "file:foo", sha256 = "deadbeef"}` entry from manifest */
@@ -885,7 +1359,33 @@ int init_trusted_files(void) {
             goto out;
         }
 
-        ret = normalize_and_register_file(toml_trusted_uri_str, toml_trusted_sha256_str);
+        /* optional `chunk_hashes_uri = "file:foo.chunks", chunk_hashes_sha256 = "deadbeef"` keys */
+        ret = toml_string_in(toml_trusted_file, "chunk_hashes_uri", &toml_chunk_hashes_uri_str);
+        if (ret < 0) {
+            log_error("Invalid trusted file in manifest at index %ld ('chunk_hashes_uri' is not a "
+                      "string)", i);
+            ret = -PAL_ERROR_INVAL;
+            goto out;
+        }
+
+        ret = toml_string_in(toml_trusted_file, "chunk_hashes_sha256",
+                             &toml_chunk_hashes_sha256_str);
+        if (ret < 0) {
+            log_error("Invalid trusted file in manifest at index %ld ('chunk_hashes_sha256' is not "
+                      "a string)", i);
+            ret = -PAL_ERROR_INVAL;
+            goto out;
+        }
+
+        if (!toml_chunk_hashes_uri_str != !toml_chunk_hashes_sha256_str) {
+            log_error("Invalid trusted file in manifest at index %ld ('chunk_hashes_uri' and "
+                      "'chunk_hashes_sha256' must be specified together)", i);
+            ret = -PAL_ERROR_INVAL;
+            goto out;
+        }
+
+        ret = normalize_and_register_file(toml_trusted_uri_str, toml_trusted_sha256_str,
+                                          toml_chunk_hashes_uri_str, toml_chunk_hashes_sha256_str);
         if (ret < 0) {
             log_error("normalize_and_register_file(\"%s\", \"%s\") failed with error code: %s",
                       toml_trusted_uri_str, toml_trusted_sha256_str, pal_strerror(ret));
@@ -894,14 +1394,20 @@ int init_trusted_files(void) {
 
         free(toml_trusted_uri_str);
         free(toml_trusted_sha256_str);
+        free(toml_chunk_hashes_uri_str);
+        free(toml_chunk_hashes_sha256_str);
         toml_trusted_uri_str = NULL;
         toml_trusted_sha256_str = NULL;
+        toml_chunk_hashes_uri_str = NULL;
+        toml_chunk_hashes_sha256_str = NULL;
     }
 
     ret = 0;
 out:
     free(toml_trusted_uri_str);
     free(toml_trusted_sha256_str);
+    free(toml_chunk_hashes_uri_str);
+    free(toml_chunk_hashes_sha256_str);
     return ret;
 }
 
@@ -946,7 +1452,9 @@ int init_allowed_files(void) {
             goto out;
         }
 
-        ret = normalize_and_register_file(toml_allowed_file_str, /*hash_str=*/NULL);
+        ret = normalize_and_register_file(toml_allowed_file_str, /*hash_str=*/NULL,
+                                          /*chunk_hashes_uri=*/NULL,
+                                          /*chunk_hashes_hash_str=*/NULL);
         if (ret < 0) {
             log_error("normalize_and_register_file(\"%s\", NULL) failed with error: %s",
                       toml_allowed_file_str, pal_strerror(ret));
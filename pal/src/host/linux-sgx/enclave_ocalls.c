@@ -41,9 +41,110 @@
  * size of 8MB. Thus, 512KB limit also works well for the main thread. */
 #define MAX_UNTRUSTED_STACK_BUF (THREAD_STACK_SIZE / 4)
 
-/* global pointer to a single untrusted queue, all accesses must be protected by g_rpc_queue->lock
- */
+/* global pointer to the untrusted RPC queue with per-thread rings; set only once at enclave
+ * initialization */
 rpc_queue_t* g_rpc_queue = NULL;
+/* number of rings usable by enclave threads (trusted copy, derived from `sgx.max_threads`) */
+size_t g_rpc_rings_cnt = 0;
+
+/* Spin budget for each OCALL type: roughly twice the number of spin iterations that recent OCALLs
+ * of this type took to complete, within [RPC_SPIN_MIN, RPC_SPIN_MAX]. Zero means not yet learned.
+ * Updated racily by all enclave threads, which is fine for a heuristic. */
+static uint32_t g_rpc_spin_budget[OCALL_NR];
+
+static struct {
+    uint64_t spin_done;    /* OCALL completed while the enclave thread was spinning */
+    uint64_t slept;        /* enclave thread had to sleep on futex */
+    uint64_t direct;       /* OCALL may block, performed with enclave exit */
+    uint64_t ring_full;    /* no space in the ring, performed with enclave exit */
+    uint64_t depth_sum;    /* sum of ring depths (including the new request) at enqueue */
+    uint64_t depth_max;    /* max ring depth at enqueue */
+} g_rpc_stats;
+
+static void rpc_stats_inc(uint64_t* counter) {
+    __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+}
+
+/* OCALLs that return in bounded time regardless of the host file descriptor they operate on. All
+ * other OCALLs (e.g. read/write on pipes and sockets, connect, accept, poll, futex) may block for
+ * an unbounded time. A blocked OCALL occupies its RPC thread, which also serves the rings of other
+ * enclave threads; if one of them is the thread that would unblock the OCALL, the enclave
+ * deadlocks. Thus only the OCALLs listed here are sent to RPC threads, all other OCALLs always
+ * exit the enclave. */
+static bool ocall_never_blocks(uint64_t code) {
+    switch (code) {
+        case OCALL_MMAP_UNTRUSTED:
+        case OCALL_MUNMAP_UNTRUSTED:
+        case OCALL_PREAD:
+        case OCALL_PWRITE:
+        case OCALL_FSTAT:
+        case OCALL_FIONREAD:
+        case OCALL_FSETNONBLOCK:
+        case OCALL_FCHMOD:
+        case OCALL_FSYNC:
+        case OCALL_FTRUNCATE:
+        case OCALL_MKDIR:
+        case OCALL_GETDENTS:
+        case OCALL_RESUME_THREAD:
+        case OCALL_SCHED_SETAFFINITY:
+        case OCALL_SCHED_GETAFFINITY:
+        case OCALL_SOCKET:
+        case OCALL_BIND:
+        case OCALL_LISTEN_SIMPLE:
+        case OCALL_LISTEN:
+        case OCALL_SETSOCKOPT:
+        case OCALL_SHUTDOWN:
+        case OCALL_GETTIME:
+        case OCALL_RENAME:
+        case OCALL_DELETE:
+        case OCALL_DEBUG_MAP_ADD:
+        case OCALL_DEBUG_MAP_REMOVE:
+        case OCALL_DEBUG_DESCRIBE_LOCATION:
+        case OCALL_EVENTFD:
+        case OCALL_EDMM_RESTRICT_PAGES_PERM:
+        case OCALL_EDMM_MODIFY_PAGES_TYPE:
+        case OCALL_EDMM_REMOVE_PAGES:
+        case OCALL_EVENT_SET_CREATE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static uint32_t rpc_spin_budget(uint64_t code) {
+    uint32_t budget = __atomic_load_n(&g_rpc_spin_budget[code], __ATOMIC_RELAXED);
+    return budget ?: RPC_SPIN_MAX;
+}
+
+static void rpc_update_spin_budget(uint64_t code, uint32_t budget, bool done, uint32_t spins) {
+    uint32_t target;
+    if (done) {
+        /* converge to twice the observed latency, similar to glibc's adaptive mutexes */
+        target = MIN(MAX(2 * spins, (uint32_t)RPC_SPIN_MIN), (uint32_t)RPC_SPIN_MAX);
+        budget = budget - budget / 8 + target / 8;
+    } else {
+        /* OCALLs of this type currently take longer than we are willing to spin, back off */
+        budget = MAX(budget / 2, (uint32_t)RPC_SPIN_MIN);
+    }
+    __atomic_store_n(&g_rpc_spin_budget[code], budget, __ATOMIC_RELAXED);
+}
+
+void print_rpc_stats(void) {
+    if (!g_rpc_queue)
+        return;
+
+    uint64_t enqueued = g_rpc_stats.spin_done + g_rpc_stats.slept;
+    uint64_t depth_sum = g_rpc_stats.depth_sum;
+    log_always("----- Exitless OCALL stats -----\n"
+               "  # of completed while spinning:   %lu\n"
+               "  # of completed after sleeping:   %lu\n"
+               "  # of may-block (enclave exit):   %lu\n"
+               "  # of ring full (enclave exit):   %lu\n"
+               "  avg/max ring depth:              %lu.%02lu/%lu",
+               g_rpc_stats.spin_done, g_rpc_stats.slept, g_rpc_stats.direct, g_rpc_stats.ring_full,
+               enqueued ? depth_sum / enqueued : 0,
+               enqueued ? depth_sum * 100 / enqueued % 100 : 0, g_rpc_stats.depth_max);
+}
 
 static long sgx_exitless_ocall(uint64_t code, void* ocall_args) {
     /* perform OCALL with enclave exit if no RPC queue (i.e., no exitless); no need for atomics
@@ -51,6 +152,16 @@ static long sgx_exitless_ocall(uint64_t code, void* ocall_args) {
     if (!g_rpc_queue)
         return sgx_ocall(code, ocall_args);
 
+    if (!ocall_never_blocks(code)) {
+        rpc_stats_inc(&g_rpc_stats.direct);
+        return sgx_ocall(code, ocall_args);
+    }
+
+    uint64_t ring_idx = GET_ENCLAVE_TCB(thread_idx);
+    if (ring_idx >= g_rpc_rings_cnt)
+        return sgx_ocall(code, ocall_args);
+    rpc_ring_t* ring = &g_rpc_queue->rings[ring_idx];
+
     /* allocate request in a new stack frame on OCALL stack; note that request's lock is used in
      * futex() and must be aligned to at least 4B */
     void* old_ustack = sgx_prepare_ustack();
@@ -69,27 +180,44 @@ static long sgx_exitless_ocall(uint64_t code, void* ocall_args) {
      * of the lock */
     spinlock_lock(&req->lock);
 
-    /* enqueue OCALL request into RPC queue; some RPC thread will dequeue it, issue a syscall
-     * and, after syscall is finished, release the request's spinlock */
-    bool enqueued = rpc_enqueue(g_rpc_queue, req);
+    /* enqueue OCALL request into the ring of this thread; the RPC thread serving the ring will
+     * dequeue it, issue a syscall and, after syscall is finished, release the request's spinlock */
+    uint64_t depth;
+    bool enqueued = rpc_enqueue(ring, req, &depth);
     if (!enqueued) {
-        /* no space in queue: all RPC threads are busy with outstanding ocalls; fallback to normal
+        /* no space in the ring: too many nested OCALLs are outstanding; fallback to normal
          * syscall path with enclave exit */
+        rpc_stats_inc(&g_rpc_stats.ring_full);
         sgx_reset_ustack(old_ustack);
         return sgx_ocall(code, ocall_args);
     }
-
-    /* wait till request processing is finished; try spinlock first */
-    bool locked = spinlock_lock_timeout(&req->lock, RPC_SPINLOCK_TIMEOUT);
+    __atomic_add_fetch(&g_rpc_stats.depth_sum, depth, __ATOMIC_RELAXED);
+    uint64_t depth_max = __atomic_load_n(&g_rpc_stats.depth_max, __ATOMIC_RELAXED);
+    while (depth > depth_max && !__atomic_compare_exchange_n(&g_rpc_stats.depth_max, &depth_max,
+                                                             depth, /*weak=*/true,
+                                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    /* wait till request processing is finished; spin first, for as long as OCALLs of this type
+     * recently needed to complete */
+    uint32_t budget = rpc_spin_budget(code);
+    uint32_t spins = 0;
+    while (__atomic_load_n(&req->lock.lock, __ATOMIC_ACQUIRE) != SPINLOCK_UNLOCKED
+            && spins < budget) {
+        spins++;
+        CPU_RELAX();
+    }
+    bool done = spins < budget;
+    rpc_update_spin_budget(code, budget, done, spins);
+    rpc_stats_inc(done ? &g_rpc_stats.spin_done : &g_rpc_stats.slept);
 
     /* at this point:
-     * - either RPC thread is done with OCALL and released the request's spinlock,
-     *   and our enclave thread grabbed lock but it doesn't matter at this point
-     *   (OCALL is done, locked == true, no need to wait on futex)
+     * - either RPC thread is done with OCALL and released the request's spinlock
+     *   (OCALL is done, done == true, no need to wait on futex)
      * - or OCALL is still pending and the request is still blocked on spinlock
-     *   (OCALL is not done, locked == false, let's wait on futex) */
+     *   (OCALL is not done, done == false, let's wait on futex) */
 
-    if (!locked) {
+    if (!done) {
         /* OCALL takes a lot of time, so fallback to waiting on a futex; at this point we exit
          * enclave to perform syscall; this code is based on Mutex 2 from Futexes are Tricky */
         uint32_t c = SPINLOCK_UNLOCKED;
@@ -275,76 +403,122 @@ int ocall_munmap_untrusted(const void* addr, size_t size) {
 }
 
 /*
- * Memorize untrusted memory area to avoid mmap/munmap per each read/write IO. Because this cache
- * is per-thread, we don't worry about concurrency. The cache will be carried over thread
- * exit/creation. On fork/exec emulation, untrusted code does vfork/exec, so the mmapped cache
- * will be released by exec host syscall.
+ * Memorize untrusted memory areas to avoid mmap/munmap per each read/write IO. Each thread keeps
+ * one buffer per size class (see `struct untrusted_area_cache`), so that I/O alternating between
+ * different sizes does not remap the buffer each time. Because this cache is per-thread, we don't
+ * worry about concurrency. The cache will be carried over thread exit/creation. On fork/exec
+ * emulation, untrusted code does vfork/exec, so the mmapped cache will be released by exec host
+ * syscall.
  *
  * In case of AEX and consequent signal handling, current thread may be interrupted in the middle
  * of using the cache. If there are OCALLs during signal handling, they could interfere with the
  * normal-execution use of the cache, so 'in_use' atomic protects against it. OCALLs during signal
- * handling do not use the cache and always explicitly mmap/munmap untrusted memory; 'need_munmap'
- * indicates whether explicit munmap is needed at the end of such OCALL.
+ * handling do not use the per-thread cache but take buffers from a small global pool (and map new
+ * ones if the pool is empty); 'need_release' indicates whether the buffer must be given back to
+ * the pool (or unmapped) at the end of such OCALL.
  */
-static int ocall_mmap_untrusted_cache(size_t size, void** addrptr, bool* need_munmap) {
+#define UNTRUSTED_POOL_MAX 4 /* max # of free buffers of each size class in the global pool */
+
+static struct {
+    void* addr[UNTRUSTED_POOL_MAX];
+    size_t cnt;
+} g_untrusted_pool[UNTRUSTED_AREA_CLASSES];
+static spinlock_t g_untrusted_pool_lock = INIT_SPINLOCK_UNLOCKED;
+
+/* Returns the size class for `size`, or -1 if `size` is bigger than the largest class */
+static int untrusted_area_class(size_t size) {
+    for (int cls = 0; cls < UNTRUSTED_AREA_CLASSES; cls++)
+        if (size <= UNTRUSTED_AREA_CLASS_SIZE(cls))
+            return cls;
+    return -1;
+}
+
+/* The global pool may be used from nested signal handling, so never wait for its lock for long
+ * (the owner may be the interrupted context of this very thread) */
+static bool untrusted_pool_lock(void) {
+    return spinlock_lock_timeout(&g_untrusted_pool_lock, /*iterations=*/1000);
+}
+
+static int ocall_mmap_untrusted_cache(size_t size, void** addrptr, bool* need_release) {
     int ret;
 
     *addrptr = NULL;
-    *need_munmap = false;
+    *need_release = false;
 
-    struct untrusted_area* cache = &pal_get_enclave_tcb()->untrusted_area_cache;
+    int cls = untrusted_area_class(size);
+    size_t map_size = cls < 0 ? size : UNTRUSTED_AREA_CLASS_SIZE(cls);
+
+    struct untrusted_area_cache* cache = &pal_get_enclave_tcb()->untrusted_area_cache;
 
     uint64_t in_use = 0;
     if (!__atomic_compare_exchange_n(&cache->in_use, &in_use, 1, /*weak=*/false, __ATOMIC_RELAXED,
                                      __ATOMIC_RELAXED)) {
-        /* AEX signal handling case: cache is in use, so make explicit mmap/munmap */
-        ret = ocall_mmap_untrusted(addrptr, size, PROT_READ | PROT_WRITE,
-                                   MAP_ANONYMOUS | MAP_PRIVATE, /*fd=*/-1, /*offset=*/0);
-        if (ret < 0) {
-            return ret;
+        /* AEX signal handling case: cache is in use, so take a buffer from the global pool or
+         * make explicit mmap */
+        *need_release = true;
+        if (cls >= 0 && untrusted_pool_lock()) {
+            if (g_untrusted_pool[cls].cnt)
+                *addrptr = g_untrusted_pool[cls].addr[--g_untrusted_pool[cls].cnt];
+            spinlock_unlock(&g_untrusted_pool_lock);
+            if (*addrptr)
+                return 0;
         }
-        *need_munmap = true;
-        return 0;
+        return ocall_mmap_untrusted(addrptr, map_size, PROT_READ | PROT_WRITE,
+                                    MAP_ANONYMOUS | MAP_PRIVATE, /*fd=*/-1, /*offset=*/0);
     }
     COMPILER_BARRIER();
 
     /* normal execution case: cache was not in use, so use it/allocate new one for reuse */
-    if (cache->valid) {
-        if (cache->size >= size) {
-            *addrptr = cache->addr;
+    void** cached_addr = cls < 0 ? &cache->large_addr : &cache->addr[cls];
+    if (*cached_addr) {
+        if (cls >= 0 || cache->large_size >= size) {
+            *addrptr = *cached_addr;
             return 0;
         }
-        ret = ocall_munmap_untrusted(cache->addr, cache->size);
+        ret = ocall_munmap_untrusted(cache->large_addr, cache->large_size);
         if (ret < 0) {
-            cache->valid = false;
+            cache->large_addr = NULL;
             COMPILER_BARRIER();
             __atomic_store_n(&cache->in_use, 0, __ATOMIC_RELAXED);
             return ret;
         }
     }
 
-    ret = ocall_mmap_untrusted(addrptr, size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE,
-                               /*fd=*/-1, /*offset=*/0);
+    ret = ocall_mmap_untrusted(addrptr, map_size, PROT_READ | PROT_WRITE,
+                               MAP_ANONYMOUS | MAP_PRIVATE, /*fd=*/-1, /*offset=*/0);
     if (ret < 0) {
-        cache->valid = false;
+        *cached_addr = NULL;
         COMPILER_BARRIER();
         __atomic_store_n(&cache->in_use, 0, __ATOMIC_RELAXED);
     } else {
-        cache->valid = true;
-        cache->addr  = *addrptr;
-        cache->size  = size;
+        *cached_addr = *addrptr;
+        if (cls < 0)
+            cache->large_size = size;
     }
     return ret;
 }
 
-static void ocall_munmap_untrusted_cache(void* addr, size_t size, bool need_munmap) {
-    if (need_munmap) {
-        ocall_munmap_untrusted(addr, size);
-        /* there is not much we can do in case of error */
-    } else {
-        struct untrusted_area* cache = &pal_get_enclave_tcb()->untrusted_area_cache;
+static void ocall_munmap_untrusted_cache(void* addr, size_t size, bool need_release) {
+    if (!need_release) {
+        struct untrusted_area_cache* cache = &pal_get_enclave_tcb()->untrusted_area_cache;
         __atomic_store_n(&cache->in_use, 0, __ATOMIC_RELAXED);
+        return;
     }
+
+    int cls = untrusted_area_class(size);
+    if (cls >= 0 && untrusted_pool_lock()) {
+        bool pooled = false;
+        if (g_untrusted_pool[cls].cnt < UNTRUSTED_POOL_MAX) {
+            g_untrusted_pool[cls].addr[g_untrusted_pool[cls].cnt++] = addr;
+            pooled = true;
+        }
+        spinlock_unlock(&g_untrusted_pool_lock);
+        if (pooled)
+            return;
+    }
+
+    ocall_munmap_untrusted(addr, cls < 0 ? size : UNTRUSTED_AREA_CLASS_SIZE(cls));
+    /* there is not much we can do in case of error */
 }
 
 int ocall_cpuid(unsigned int leaf, unsigned int subleaf, unsigned int values[static 4]) {
@@ -703,6 +877,155 @@ out:
     return retval;
 }
 
+ssize_t ocall_splice(int in_fd, off_t in_offset, int out_fd, off_t out_offset, size_t count,
+                     bool out_is_file) {
+    ssize_t retval = 0;
+    struct ocall_splice* ocall_splice_args;
+
+    void* old_ustack = sgx_prepare_ustack();
+    ocall_splice_args = sgx_alloc_on_ustack_aligned(sizeof(*ocall_splice_args),
+                                                    alignof(*ocall_splice_args));
+    if (!ocall_splice_args) {
+        retval = -EPERM;
+        goto out;
+    }
+
+    COPY_VALUE_TO_UNTRUSTED(&ocall_splice_args->in_fd, in_fd);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_splice_args->in_offset, in_offset);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_splice_args->out_fd, out_fd);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_splice_args->out_offset, out_offset);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_splice_args->count, count);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_splice_args->out_is_file, out_is_file);
+
+    retval = sgx_exitless_ocall(OCALL_SPLICE, ocall_splice_args);
+
+    if (retval < 0 && retval != -EAGAIN && retval != -EWOULDBLOCK && retval != -EBADF &&
+            retval != -EFBIG && retval != -EINTR && retval != -EINVAL && retval != -EIO &&
+            retval != -ENOSPC && retval != -EOVERFLOW && retval != -EPIPE &&
+            retval != -ECONNRESET && retval != -ENOSYS && retval != -EXDEV &&
+            retval != -EOPNOTSUPP) {
+        retval = -EPERM;
+    }
+
+    if (retval > 0 && (size_t)retval > count) {
+        retval = -EPERM;
+        goto out;
+    }
+
+out:
+    sgx_reset_ustack(old_ustack);
+    return retval;
+}
+
+static bool io_batch_errno_valid(long err) {
+    /* union of the errors expected from read(), pread(), write(), pwrite() and fsync() */
+    return err == -EAGAIN || err == -EWOULDBLOCK || err == -EBADF || err == -EFBIG ||
+           err == -EINTR || err == -EINVAL || err == -EIO || err == -EISDIR || err == -ENOSPC ||
+           err == -ENXIO || err == -EOVERFLOW || err == -EPIPE || err == -ESPIPE ||
+           err == -EROFS || err == -EDQUOT;
+}
+
+ssize_t ocall_io_batch(struct ocall_io_op* ops, size_t count) {
+    ssize_t retval = 0;
+    void* obuf = NULL;
+    struct ocall_io_batch* ocall_io_batch_args;
+    struct ocall_io_op* untrusted_ops;
+    char* untrusted_bufs;
+    bool need_munmap = false;
+
+    size_t total_size = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (ops[i].type == OCALL_IO_OP_FSYNC)
+            continue;
+        if (ops[i].size && !sgx_is_completely_within_enclave(ops[i].buf, ops[i].size))
+            return -EPERM;
+        if (__builtin_add_overflow(total_size, ops[i].size, &total_size))
+            return -EINVAL;
+    }
+
+    void* old_ustack = sgx_prepare_ustack();
+    if (total_size > MAX_UNTRUSTED_STACK_BUF) {
+        retval = ocall_mmap_untrusted_cache(ALLOC_ALIGN_UP(total_size), &obuf, &need_munmap);
+        if (retval < 0) {
+            sgx_reset_ustack(old_ustack);
+            return retval;
+        }
+        untrusted_bufs = obuf;
+    } else {
+        untrusted_bufs = sgx_alloc_on_ustack(total_size);
+        if (!untrusted_bufs) {
+            retval = -EPERM;
+            goto out;
+        }
+    }
+
+    untrusted_ops = sgx_alloc_on_ustack_aligned(count * sizeof(*untrusted_ops),
+                                                alignof(*untrusted_ops));
+    ocall_io_batch_args = sgx_alloc_on_ustack_aligned(sizeof(*ocall_io_batch_args),
+                                                      alignof(*ocall_io_batch_args));
+    if (!untrusted_ops || !ocall_io_batch_args) {
+        retval = -EPERM;
+        goto out;
+    }
+
+    char* untrusted_buf = untrusted_bufs;
+    for (size_t i = 0; i < count; i++) {
+        bool has_buf = ops[i].type != OCALL_IO_OP_FSYNC;
+        COPY_VALUE_TO_UNTRUSTED(&untrusted_ops[i].fd, ops[i].fd);
+        COPY_VALUE_TO_UNTRUSTED(&untrusted_ops[i].type, ops[i].type);
+        COPY_VALUE_TO_UNTRUSTED(&untrusted_ops[i].offset, ops[i].offset);
+        COPY_VALUE_TO_UNTRUSTED(&untrusted_ops[i].buf, has_buf ? untrusted_buf : NULL);
+        COPY_VALUE_TO_UNTRUSTED(&untrusted_ops[i].size, has_buf ? ops[i].size : 0);
+        if (ops[i].type == OCALL_IO_OP_WRITE)
+            memcpy(untrusted_buf, ops[i].buf, ops[i].size);
+        if (has_buf)
+            untrusted_buf += ops[i].size;
+    }
+
+    COPY_VALUE_TO_UNTRUSTED(&ocall_io_batch_args->ops, untrusted_ops);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_io_batch_args->count, count);
+
+    retval = sgx_exitless_ocall(OCALL_IO_BATCH, ocall_io_batch_args);
+    if (retval < 0 || (size_t)retval > count || (count && retval == 0)) {
+        retval = -EPERM;
+        goto out;
+    }
+
+    untrusted_buf = untrusted_bufs;
+    for (ssize_t i = 0; i < retval; i++) {
+        bool has_buf = ops[i].type != OCALL_IO_OP_FSYNC;
+        ssize_t result = COPY_UNTRUSTED_VALUE(&untrusted_ops[i].result);
+        if (result < 0 && !io_batch_errno_valid(result)) {
+            result = -EPERM;
+        } else if (result > 0 && (!has_buf || (size_t)result > ops[i].size)) {
+            retval = -EPERM;
+            goto out;
+        }
+
+        if (ops[i].type == OCALL_IO_OP_READ && result > 0) {
+            if (!sgx_copy_to_enclave(ops[i].buf, ops[i].size, untrusted_buf, result)) {
+                retval = -EPERM;
+                goto out;
+            }
+        }
+        ops[i].result = result;
+        if (has_buf)
+            untrusted_buf += ops[i].size;
+
+        if (result < 0 || (has_buf && (size_t)result < ops[i].size)) {
+            /* the host must have stopped here, don't trust results of any further operations */
+            retval = i + 1;
+            break;
+        }
+    }
+
+out:
+    sgx_reset_ustack(old_ustack);
+    if (obuf)
+        ocall_munmap_untrusted_cache(obuf, ALLOC_ALIGN_UP(total_size), need_munmap);
+    return retval;
+}
+
 int ocall_fstat(int fd, struct stat* buf) {
     int retval = 0;
     struct ocall_fstat* ocall_fstat_args;
@@ -1875,6 +2198,112 @@ out:
     return retval;
 }
 
+int ocall_event_set_create(void) {
+    int retval = 0;
+
+    do {
+        retval = sgx_exitless_ocall(OCALL_EVENT_SET_CREATE, /*args=*/NULL);
+    } while (retval == -EINTR);
+
+    if (retval < 0 && retval != -EMFILE && retval != -ENFILE && retval != -ENOMEM) {
+        retval = -EPERM;
+    }
+
+    return retval;
+}
+
+int ocall_event_set_wait(int epfd, const struct ocall_event_set_update* updates,
+                         size_t updates_count, struct pollfd* fds, size_t nfds,
+                         struct epoll_event* events, size_t max_events, uint64_t* timeout_us) {
+    int retval = 0;
+    size_t updates_bytes = updates_count * sizeof(*updates);
+    size_t nfds_bytes = nfds * sizeof(*fds);
+    size_t events_bytes = max_events * sizeof(*events);
+    struct ocall_event_set_wait* ocall_args;
+    uint64_t remaining_time_us = timeout_us ? *timeout_us : (uint64_t)-1;
+
+    void* old_ustack = sgx_prepare_ustack();
+    ocall_args = sgx_alloc_on_ustack_aligned(sizeof(*ocall_args), alignof(*ocall_args));
+    if (!ocall_args) {
+        retval = -EPERM;
+        goto out;
+    }
+
+    void* untrusted_updates = NULL;
+    if (updates_count) {
+        untrusted_updates = sgx_copy_to_ustack(updates, updates_bytes);
+        if (!untrusted_updates) {
+            retval = -EPERM;
+            goto out;
+        }
+    }
+    void* untrusted_fds = NULL;
+    if (nfds) {
+        untrusted_fds = sgx_copy_to_ustack(fds, nfds_bytes);
+        if (!untrusted_fds) {
+            retval = -EPERM;
+            goto out;
+        }
+    }
+    void* untrusted_events = NULL;
+    if (max_events) {
+        untrusted_events = sgx_alloc_on_ustack_aligned(events_bytes, alignof(*events));
+        if (!untrusted_events) {
+            retval = -EPERM;
+            goto out;
+        }
+    }
+
+    COPY_VALUE_TO_UNTRUSTED(&ocall_args->epfd, epfd);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_args->updates, untrusted_updates);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_args->updates_count, updates_count);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_args->fds, untrusted_fds);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_args->nfds, nfds);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_args->events, untrusted_events);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_args->max_events, max_events);
+    COPY_VALUE_TO_UNTRUSTED(&ocall_args->timeout_us, remaining_time_us);
+
+    retval = sgx_exitless_ocall(OCALL_EVENT_SET_WAIT, ocall_args);
+
+    if (timeout_us) {
+        /* Unlike in `ocall_poll()`, 0 does not necessarily mean a timeout (some of `fds` may be
+         * ready), so the caller resets the remaining time itself if nothing was ready. */
+        remaining_time_us = COPY_UNTRUSTED_VALUE(&ocall_args->timeout_us);
+        if (remaining_time_us > *timeout_us) {
+            remaining_time_us = *timeout_us;
+        }
+    }
+
+    if (retval < 0 && retval != -EINTR && retval != -EINVAL && retval != -ENOMEM
+            && retval != -ENOSPC && retval != -EBADF) {
+        retval = -EPERM;
+    }
+
+    if (retval >= 0) {
+        if ((size_t)retval > max_events) {
+            retval = -EPERM;
+            goto out;
+        }
+        if (nfds && !sgx_copy_to_enclave(fds, nfds_bytes, untrusted_fds, nfds_bytes)) {
+            retval = -EPERM;
+            goto out;
+        }
+        size_t ret_events_bytes = (size_t)retval * sizeof(*events);
+        if (retval && !sgx_copy_to_enclave(events, events_bytes, untrusted_events,
+                                           ret_events_bytes)) {
+            retval = -EPERM;
+            goto out;
+        }
+    }
+
+out:
+    if (timeout_us) {
+        *timeout_us = remaining_time_us;
+    }
+    sgx_reset_ustack(old_ustack);
+    return retval;
+}
+
 int ocall_rename(const char* oldpath, const char* newpath) {
     int retval = 0;
     size_t old_size = oldpath ? strlen(oldpath) + 1 : 0;
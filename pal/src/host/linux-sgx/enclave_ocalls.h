@@ -5,6 +5,7 @@
 #pragma once
 
 #include <asm/stat.h>
+#include <linux/eventpoll.h>
 #include <linux/poll.h>
 #include <linux/socket.h>
 
@@ -12,6 +13,11 @@
 #include "pal_linux_types.h"
 #include "sgx_attest.h"
 
+/* number of exitless RPC rings usable by enclave threads, see `pal_rpc_queue.h` */
+extern size_t g_rpc_rings_cnt;
+
+void print_rpc_stats(void);
+
 noreturn void ocall_exit(int exitcode, int is_exitgroup);
 
 int ocall_mmap_untrusted(void** addrptr, size_t size, int prot, int flags, int fd, off_t offset);
@@ -95,6 +101,31 @@ void ocall_sched_yield(void);
 
 int ocall_poll(struct pollfd* fds, size_t nfds, uint64_t* timeout_us);
 
+int ocall_event_set_create(void);
+
+struct ocall_event_set_update;
+
+/* Applies `updates` to the host epoll `epfd`, then waits like `ocall_poll()` on `fds` (if `nfds` is
+ * not zero, the last one must be `epfd`) and harvests up to `max_events` ready events of `epfd`.
+ * Returns the number of harvested events or a negative error code (0 on timeout). */
+int ocall_event_set_wait(int epfd, const struct ocall_event_set_update* updates,
+                         size_t updates_count, struct pollfd* fds, size_t nfds,
+                         struct epoll_event* events, size_t max_events, uint64_t* timeout_us);
+
+/* Copies up to `count` bytes from file `in_fd` at `in_offset` to `out_fd` directly on the host:
+ * with copy_file_range() at `out_offset` if `out_is_file`, otherwise with sendfile() to a socket.
+ * Returns the number of bytes copied or a negative error code. */
+ssize_t ocall_splice(int in_fd, off_t in_offset, int out_fd, off_t out_offset, size_t count,
+                     bool out_is_file);
+
+struct ocall_io_op;
+
+/* Executes `count` read/write/fsync operations on host fds in one OCALL. `ops` and the buffers
+ * they point to are in enclave memory. Execution stops after the first operation which fails or
+ * transfers less than requested. Sets `result` of the executed operations and returns their
+ * number, or a negative error code. */
+ssize_t ocall_io_batch(struct ocall_io_op* ops, size_t count);
+
 int ocall_rename(const char* oldpath, const char* newpath);
 
 int ocall_delete(const char* pathname);
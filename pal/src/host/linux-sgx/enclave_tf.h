@@ -12,6 +12,11 @@
  * each chunk (of size TRUSTED_CHUNK_SIZE) in the file. The per-chunk hashes are used for partial
  * verification in future reads, to avoid re-verifying the whole file again or the need of caching
  * file contents.
+ *
+ * Alternatively, the per-chunk hashes may be precomputed at sign time and stored in a separate file
+ * (specified in the manifest as "chunk_hashes_uri", with its SHA256 hash in "chunk_hashes_sha256").
+ * In this case, Gramine only loads and verifies this file on open, and file chunks are verified
+ * lazily on access, so opening huge trusted files doesn't require reading them in their entirety.
  */
 
 /* TODO: Move trusted/allowed files implementation into a separate file (`enclave_tf.c`?) */
@@ -78,3 +83,13 @@ int copy_and_verify_trusted_file(const char* path, uint8_t* buf, const void* ume
 
 int init_trusted_files(void);
 int init_allowed_files(void);
+
+/*!
+ * \brief Initialize the cache of verified trusted-file chunks (`sgx.trusted_files_cache_size`).
+ */
+int init_trusted_files_cache(void);
+
+/*!
+ * \brief Print hit/miss/eviction counters of the cache of verified trusted-file chunks.
+ */
+void print_trusted_files_cache_stats(void);
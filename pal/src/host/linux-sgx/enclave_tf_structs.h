@@ -7,8 +7,6 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#include "list.h"
-
 enum {
     FILE_CHECK_POLICY_STRICT = 0,
     FILE_CHECK_POLICY_ALLOW_ALL_BUT_LOG,
@@ -27,13 +25,14 @@ typedef struct {
  * "sgx.allowed_files". For allowed files, `allowed = true`, `chunk_hashes = NULL`, and `uri` can be
  * not only a file but also a directory. TODO: Perhaps split "allowed_files" into a separate struct?
  */
-DEFINE_LIST(trusted_file);
 struct trusted_file {
-    LIST_TYPE(trusted_file) list;
+    struct trusted_file* htable_next; /* next trusted file in the same hash-table bucket */
     uint64_t size;
     bool allowed;
     sgx_file_hash_t file_hash;      /* hash over the whole file, retrieved from the manifest */
     sgx_chunk_hash_t* chunk_hashes; /* array of hashes over separate file chunks */
+    char* chunk_hashes_path;        /* optional file with precomputed `chunk_hashes` */
+    sgx_file_hash_t chunk_hashes_file_hash; /* hash over `chunk_hashes_path` file contents */
     size_t uri_len;
     char uri[]; /* must be NULL-terminated */
 };
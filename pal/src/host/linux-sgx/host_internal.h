@@ -46,6 +46,10 @@ struct pal_enclave {
     enum sgx_attestation_type attestation_type;
     char* libpal_uri; /* Path to the PAL binary */
 
+    /* pre-spawned child processes for fork, see `sgx_create_process()` */
+    unsigned long zygote_pool_size;
+    bool zygote_eager_warmup;
+
 #ifdef DEBUG
     /* profiling */
     bool profile_enable;
@@ -516,6 +516,7 @@ static int initialize_enclave(struct pal_enclave* enclave, const char* manifest_
                 gs->common.stack_protector_canary = STACK_PROTECTOR_CANARY_DEFAULT;
                 gs->enclave_size = enclave->size;
                 gs->tcs_offset = tcs_area->addr - enclave->baseaddr + g_page_size * t;
+                gs->thread_idx = t;
                 gs->initial_stack_addr = stack_areas[t].addr + ENCLAVE_STACK_SIZE;
                 gs->sig_stack_low = sig_stack_areas[t].addr;
                 gs->sig_stack_high = sig_stack_areas[t].addr + ENCLAVE_SIG_STACK_SIZE;
@@ -646,6 +647,7 @@ static int parse_loader_config(char* manifest, struct pal_enclave* enclave_info,
 #endif
     char* log_level_str = NULL;
     char* log_file = NULL;
+    char* zygote_warmup_str = NULL;
     char errbuf[256];
 
     manifest_root = toml_parse(manifest, errbuf, sizeof(errbuf));
@@ -726,8 +728,8 @@ static int parse_loader_config(char* manifest, struct pal_enclave* enclave_info,
     }
     enclave_info->rpc_thread_num = rpc_thread_num_int64;
 
-    if (enclave_info->rpc_thread_num && enclave_info->thread_num > RPC_QUEUE_SIZE) {
-        log_error("Too many threads for exitless feature (more than capacity of RPC queue)");
+    if (enclave_info->rpc_thread_num && enclave_info->thread_num > MAX_RPC_RINGS) {
+        log_error("Too many threads for exitless feature (more than %d RPC rings)", MAX_RPC_RINGS);
         ret = -EINVAL;
         goto out;
     }
@@ -740,6 +742,37 @@ static int parse_loader_config(char* manifest, struct pal_enclave* enclave_info,
         goto out;
     }
 
+    int64_t zygote_pool_size_int64;
+    ret = toml_int_in(manifest_root, "sgx.zygote_pool_size", /*defaultval=*/0,
+                      &zygote_pool_size_int64);
+    if (ret < 0) {
+        log_error("Cannot parse 'sgx.zygote_pool_size'");
+        ret = -EINVAL;
+        goto out;
+    }
+    if (zygote_pool_size_int64 < 0 || zygote_pool_size_int64 > MAX_ZYGOTE_POOL_SIZE) {
+        log_error("'sgx.zygote_pool_size' must be between 0 and %d", MAX_ZYGOTE_POOL_SIZE);
+        ret = -EINVAL;
+        goto out;
+    }
+    enclave_info->zygote_pool_size = zygote_pool_size_int64;
+
+    ret = toml_string_in(manifest_root, "sgx.zygote_warmup", &zygote_warmup_str);
+    if (ret < 0) {
+        log_error("Cannot parse 'sgx.zygote_warmup'");
+        ret = -EINVAL;
+        goto out;
+    }
+    if (!zygote_warmup_str || !strcmp(zygote_warmup_str, "lazy")) {
+        enclave_info->zygote_eager_warmup = false;
+    } else if (!strcmp(zygote_warmup_str, "eager")) {
+        enclave_info->zygote_eager_warmup = true;
+    } else {
+        log_error("Unknown 'sgx.zygote_warmup' (allowed: `lazy`, `eager`)");
+        ret = -EINVAL;
+        goto out;
+    }
+
     ret = toml_string_in(manifest_root, "sgx.sigfile", &dummy_sigfile_str);
     if (ret < 0 || dummy_sigfile_str) {
         log_error("sgx.sigfile is not supported anymore. Please update your manifest according to "
@@ -918,6 +951,7 @@ out:
 #endif
     free(log_level_str);
     free(log_file);
+    free(zygote_warmup_str);
     toml_free(manifest_root);
     return ret;
 }
@@ -925,7 +959,7 @@ out:
 /* Warning: This function does not free up resources on failure - it assumes that the whole process
  * exits after this function's failure. */
 static int load_enclave(struct pal_enclave* enclave, char* args, size_t args_size, char* env,
-                        size_t env_size, int parent_stream_fd,
+                        size_t env_size, int parent_stream_fd, bool is_zygote,
                         void* reserved_mem_ranges, size_t reserved_mem_ranges_size) {
     int ret;
     struct timeval tv;
@@ -1050,6 +1084,21 @@ static int load_enclave(struct pal_enclave* enclave, char* args, size_t args_siz
                    end_time - start_time);
     }
 
+    if (is_zygote) {
+        /* the enclave is created; wait until the parent hands a new process over to us */
+        ret = sgx_zygote_wait_for_handoff(parent_stream_fd, &reserved_mem_ranges,
+                                          &reserved_mem_ranges_size);
+        if (ret < 0) {
+            /* the parent exited without using this zygote */
+            log_debug("Zygote process exits unused: %s", unix_strerror(ret));
+            DO_SYSCALL(exit_group, 0);
+            die_or_inf_loop();
+        }
+    }
+
+    if (enclave->zygote_eager_warmup)
+        sgx_refill_zygote_pool();
+
     /* start running trusted PAL */
     ecall_enclave_start(enclave->libpal_uri, args, args_size, env, env_size, parent_stream_fd,
                         &qe_targetinfo, &topo_info, &dns_conf, enclave->edmm_enabled,
@@ -1144,6 +1193,7 @@ int main(int argc, char* argv[], char* envp[]) {
     char* manifest = NULL;
     void* reserved_mem_ranges = NULL;
     size_t reserved_mem_ranges_size = 0;
+    bool is_zygote = false;
 
 #ifdef DEBUG
     ret = debug_map_init_from_proc_maps();
@@ -1216,7 +1266,7 @@ int main(int argc, char* argv[], char* envp[]) {
         }
 
         ret = sgx_init_child_process(parent_stream_fd, &g_pal_enclave.application_path, &manifest,
-                                     &reserved_mem_ranges, &reserved_mem_ranges_size);
+                                     &is_zygote, &reserved_mem_ranges, &reserved_mem_ranges_size);
         if (ret < 0)
             return ret;
     }
@@ -1244,7 +1294,7 @@ int main(int argc, char* argv[], char* envp[]) {
     char* env = envp[0];
     size_t env_size = envc > 0 ? (envp[envc - 1] - envp[0]) + strlen(envp[envc - 1]) + 1 : 0;
 
-    ret = load_enclave(&g_pal_enclave, args, args_size, env, env_size, parent_stream_fd,
+    ret = load_enclave(&g_pal_enclave, args, args_size, env, env_size, parent_stream_fd, is_zygote,
                        reserved_mem_ranges, reserved_mem_ranges_size);
     if (ret < 0) {
         log_error("load_enclave() failed with error: %s", unix_strerror(ret));
@@ -150,6 +150,56 @@ static long sgx_ocall_pwrite(void* args) {
                                     ocall_pwrite_args->count, ocall_pwrite_args->offset);
 }
 
+static long sgx_ocall_splice(void* args) {
+    struct ocall_splice* ocall_splice_args = args;
+    off_t in_offset = ocall_splice_args->in_offset;
+    if (ocall_splice_args->out_is_file) {
+        off_t out_offset = ocall_splice_args->out_offset;
+        return DO_SYSCALL_INTERRUPTIBLE(copy_file_range, ocall_splice_args->in_fd, &in_offset,
+                                        ocall_splice_args->out_fd, &out_offset,
+                                        ocall_splice_args->count, /*flags=*/0);
+    }
+    return DO_SYSCALL_INTERRUPTIBLE(sendfile, ocall_splice_args->out_fd, ocall_splice_args->in_fd,
+                                    &in_offset, ocall_splice_args->count);
+}
+
+static long sgx_ocall_io_batch(void* args) {
+    struct ocall_io_batch* ocall_io_batch_args = args;
+    size_t i;
+    for (i = 0; i < ocall_io_batch_args->count; i++) {
+        struct ocall_io_op* op = &ocall_io_batch_args->ops[i];
+        long ret;
+        switch (op->type) {
+            case OCALL_IO_OP_READ:
+                if (op->offset < 0)
+                    ret = DO_SYSCALL_INTERRUPTIBLE(read, op->fd, op->buf, op->size);
+                else
+                    ret = DO_SYSCALL_INTERRUPTIBLE(pread64, op->fd, op->buf, op->size, op->offset);
+                break;
+            case OCALL_IO_OP_WRITE:
+                if (op->offset < 0)
+                    ret = DO_SYSCALL_INTERRUPTIBLE(write, op->fd, op->buf, op->size);
+                else
+                    ret = DO_SYSCALL_INTERRUPTIBLE(pwrite64, op->fd, op->buf, op->size, op->offset);
+                break;
+            case OCALL_IO_OP_FSYNC:
+                ret = DO_SYSCALL_INTERRUPTIBLE(fsync, op->fd);
+                break;
+            default:
+                ret = -EINVAL;
+                break;
+        }
+        op->result = ret;
+
+        if (ret < 0 || (op->type != OCALL_IO_OP_FSYNC && (size_t)ret < op->size)) {
+            /* failed or short operation, don't execute the rest */
+            i++;
+            break;
+        }
+    }
+    return i;
+}
+
 static long sgx_ocall_fstat(void* args) {
     struct ocall_fstat* ocall_fstat_args = args;
     return DO_SYSCALL_INTERRUPTIBLE(fstat, ocall_fstat_args->fd, &ocall_fstat_args->stat);
@@ -643,6 +693,84 @@ static long sgx_ocall_poll(void* args) {
     return ret;
 }
 
+static long sgx_ocall_event_set_create(void* args) {
+    __UNUSED(args);
+    return DO_SYSCALL(epoll_create1, EPOLL_CLOEXEC);
+}
+
+static long sgx_ocall_event_set_wait(void* args) {
+    struct ocall_event_set_wait* ocall_args = args;
+    long ret;
+
+    for (size_t i = 0; i < ocall_args->updates_count; i++) {
+        struct ocall_event_set_update* update = &ocall_args->updates[i];
+        struct epoll_event event = {
+            .events = update->events,
+            .data = (uint64_t)update->fd,
+        };
+        ret = DO_SYSCALL(epoll_ctl, ocall_args->epfd, update->op, update->fd, &event);
+        if (ret == -EEXIST && update->op == EPOLL_CTL_ADD) {
+            ret = DO_SYSCALL(epoll_ctl, ocall_args->epfd, EPOLL_CTL_MOD, update->fd, &event);
+        } else if (ret == -ENOENT && update->op == EPOLL_CTL_MOD) {
+            ret = DO_SYSCALL(epoll_ctl, ocall_args->epfd, EPOLL_CTL_ADD, update->fd, &event);
+        } else if ((ret == -ENOENT || ret == -EBADF) && update->op == EPOLL_CTL_DEL) {
+            ret = 0;
+        }
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    if (!ocall_args->nfds && !ocall_args->max_events) {
+        return 0;
+    }
+
+    struct timespec* timeout = NULL;
+    struct timespec end_time = { 0 };
+    bool have_timeout = ocall_args->timeout_us != (uint64_t)-1;
+    if (have_timeout) {
+        uint64_t timeout_ns = ocall_args->timeout_us * TIME_NS_IN_US;
+        timeout = __alloca(sizeof(*timeout));
+        timeout->tv_sec = timeout_ns / TIME_NS_IN_S;
+        timeout->tv_nsec = timeout_ns % TIME_NS_IN_S;
+        time_get_now_plus_ns(&end_time, timeout_ns);
+    }
+
+    bool set_ready = true;
+    if (ocall_args->nfds) {
+        ret = DO_SYSCALL_INTERRUPTIBLE(ppoll, ocall_args->fds, ocall_args->nfds, timeout, NULL);
+        set_ready = ret > 0 && ocall_args->max_events
+                    && ocall_args->fds[ocall_args->nfds - 1].revents;
+    }
+
+    if (ocall_args->max_events && set_ready) {
+        int timeout_ms = 0;
+        if (!ocall_args->nfds) {
+            /* Round up, so that we never return before the timeout expires. */
+            timeout_ms = have_timeout ? (int)MIN((ocall_args->timeout_us + TIME_US_IN_MS - 1)
+                                                     / TIME_US_IN_MS, (uint64_t)INT_MAX)
+                                      : -1;
+        }
+        ret = DO_SYSCALL_INTERRUPTIBLE(epoll_pwait, ocall_args->epfd, ocall_args->events,
+                                       ocall_args->max_events, timeout_ms, NULL, 0);
+    } else if (ret > 0) {
+        /* Only additional fds are ready (the caller distinguishes this from a timeout by looking
+         * at their `revents`). */
+        ret = 0;
+    }
+
+    if (have_timeout) {
+        int64_t diff = time_ns_diff_from_now(&end_time);
+        if (diff < 0) {
+            /* We might have slept a bit too long. */
+            diff = 0;
+        }
+        ocall_args->timeout_us = (uint64_t)diff / TIME_NS_IN_US;
+    }
+
+    return ret;
+}
+
 static long sgx_ocall_rename(void* args) {
     struct ocall_rename* ocall_rename_args = args;
     return DO_SYSCALL(rename, ocall_rename_args->oldpath, ocall_rename_args->newpath);
@@ -787,10 +915,35 @@ sgx_ocall_fn_t ocall_table[OCALL_NR] = {
     [OCALL_EDMM_MODIFY_PAGES_TYPE]   = sgx_ocall_edmm_modify_pages_type,
     [OCALL_EDMM_REMOVE_PAGES]        = sgx_ocall_edmm_remove_pages,
     [OCALL_EDMM_RESTRICT_PAGES_PERM] = sgx_ocall_edmm_restrict_pages_perm,
+    [OCALL_EVENT_SET_CREATE]         = sgx_ocall_event_set_create,
+    [OCALL_EVENT_SET_WAIT]           = sgx_ocall_event_set_wait,
+    [OCALL_SPLICE]                   = sgx_ocall_splice,
+    [OCALL_IO_BATCH]                 = sgx_ocall_io_batch,
 };
 
+/* Performs the OCALL of `req` and notifies the awaiting enclave thread when done */
+static void rpc_serve_request(rpc_request_t* req) {
+    /* call actual function and notify awaiting enclave thread when done */
+    sgx_ocall_fn_t f = ocall_table[req->ocall_index];
+    req->result = f(req->buffer);
+
+    /* this code is based on Mutex 2 from Futexes are Tricky */
+    int old_lock_state = __atomic_fetch_sub(&req->lock.lock, 1, __ATOMIC_ACQ_REL);
+    if (old_lock_state == SPINLOCK_LOCKED_WITH_WAITERS) {
+        /* must unlock and wake waiters */
+        spinlock_unlock(&req->lock);
+        int ret = DO_SYSCALL(futex, &req->lock.lock, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+        if (ret == -1)
+            log_error("RPC thread failed to wake up enclave thread");
+    }
+}
+
 static int rpc_thread_loop(void* arg) {
-    __UNUSED(arg);
+    /* this RPC thread serves rings `rpc_idx`, `rpc_idx + N`, `rpc_idx + 2N`, ... (where N is the
+     * number of RPC threads), so that every ring has exactly one consumer */
+    size_t rpc_idx = (size_t)arg;
+    size_t rpc_threads_num = g_pal_enclave.rpc_thread_num;
+    size_t rings_num = MIN(g_pal_enclave.thread_num, (size_t)MAX_RPC_RINGS);
     long mytid = DO_SYSCALL(gettid);
 
     /* block all signals except SIGUSR2 for RPC thread */
@@ -813,8 +966,17 @@ static int rpc_thread_loop(void* arg) {
     uint64_t sleep_time    = 0;
 
     while (1) {
-        rpc_request_t* req = rpc_dequeue(g_rpc_queue);
-        if (!req) {
+        bool served = false;
+        for (size_t i = rpc_idx; i < rings_num; i += rpc_threads_num) {
+            /* serve at most one request per ring in each round, for fairness between rings */
+            rpc_request_t* req = rpc_dequeue(&g_rpc_queue->rings[i]);
+            if (req) {
+                rpc_serve_request(req);
+                served = true;
+            }
+        }
+
+        if (!served) {
             if (spin_attempts == SPIN_ATTEMPTS_MAX) {
                 if (sleep_time < SLEEP_TIME_MAX)
                     sleep_time += SLEEP_TIME_STEP;
@@ -831,20 +993,6 @@ static int rpc_thread_loop(void* arg) {
         /* new request came, reset spin/sleep heuristics */
         spin_attempts = 0;
         sleep_time    = 0;
-
-        /* call actual function and notify awaiting enclave thread when done */
-        sgx_ocall_fn_t f = ocall_table[req->ocall_index];
-        req->result = f(req->buffer);
-
-        /* this code is based on Mutex 2 from Futexes are Tricky */
-        int old_lock_state = __atomic_fetch_sub(&req->lock.lock, 1, __ATOMIC_ACQ_REL);
-        if (old_lock_state == SPINLOCK_LOCKED_WITH_WAITERS) {
-            /* must unlock and wake waiters */
-            spinlock_unlock(&req->lock);
-            int ret = DO_SYSCALL(futex, &req->lock.lock, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
-            if (ret == -1)
-                log_error("RPC thread failed to wake up enclave thread");
-        }
     }
 
     /* NOTREACHED */
@@ -875,8 +1023,8 @@ int start_rpc(size_t threads_cnt) {
         int ret = clone(rpc_thread_loop, child_stack_top,
                         CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SYSVSEM |
                         CLONE_THREAD | CLONE_SIGHAND | CLONE_PTRACE | CLONE_PARENT_SETTID,
-                        /*arg=*/NULL, &dummy_parent_tid_field, /*tls=*/NULL, /*child_tid=*/NULL,
-                        thread_exit);
+                        /*arg=*/(void*)i, &dummy_parent_tid_field, /*tls=*/NULL,
+                        /*child_tid=*/NULL, thread_exit);
 
         if (ret < 0) {
             DO_SYSCALL(munmap, stack, RPC_STACK_SIZE);
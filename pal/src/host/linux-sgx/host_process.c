@@ -18,6 +18,7 @@
 #include "host_internal.h"
 #include "host_process.h"
 #include "linux_utils.h"
+#include "spinlock.h"
 
 extern char* g_pal_loader_path;
 extern char* g_libpal_path;
@@ -27,8 +28,28 @@ struct proc_args {
     size_t manifest_size; // manifest will follow application path on the pipe.
     int reserved_mem_ranges_fd;
     size_t reserved_mem_ranges_size;
+    bool is_zygote; // reserved memory ranges will be sent on hand-off, see below.
 };
 
+/*
+ * Zygotes are child processes spawned in advance (if `sgx.zygote_pool_size` is set in the
+ * manifest). A zygote creates its enclave right away (which is the expensive part of process
+ * creation: adding, measuring and initializing all enclave pages), then waits on its stream. When
+ * the parent creates a new process, it hands one of the zygotes over: sends it the reserved memory
+ * ranges, and the zygote starts its enclave. The secure channel between the enclaves is established
+ * only after that, as for any other child, so zygotes do not change the security properties.
+ *
+ * Hand-off protocol on the stream, after `struct proc_args` and the following data:
+ *   - zygote sends `int` status after reading the arguments (as every child),
+ *   - zygote sends `int` status after its enclave is created,
+ *   - parent sends `size_t` size of the reserved memory ranges, followed by the ranges.
+ */
+static int g_zygote_fds[MAX_ZYGOTE_POOL_SIZE];
+static size_t g_zygotes_cnt = 0;
+/* zygotes being spawned right now, so that concurrent refills do not overfill the pool */
+static size_t g_zygotes_spawning = 0;
+static spinlock_t g_zygote_pool_lock = INIT_SPINLOCK_UNLOCKED;
+
 static int vfork_exec(const char** argv) {
     int ret = vfork();
     if (ret)
@@ -40,8 +61,8 @@ static int vfork_exec(const char** argv) {
     die_or_inf_loop();
 }
 
-int sgx_create_process(size_t nargs, const char** args, const char* manifest,
-                       void* reserved_mem_ranges, size_t reserved_mem_ranges_size,
+static int spawn_child(size_t nargs, const char** args, const char* manifest,
+                       void* reserved_mem_ranges, size_t reserved_mem_ranges_size, bool is_zygote,
                        int* out_stream_fd) {
     int ret, rete;
     int reserved_mem_ranges_fd = -1;
@@ -67,11 +88,13 @@ int sgx_create_process(size_t nargs, const char** args, const char* manifest,
     memcpy(argv + 4, args, sizeof(const char*) * nargs);
     argv[nargs + 4] = NULL;
 
-    ret = create_reserved_mem_ranges_fd(reserved_mem_ranges, reserved_mem_ranges_size);
-    if (ret < 0) {
-        goto out;
+    if (!is_zygote) {
+        ret = create_reserved_mem_ranges_fd(reserved_mem_ranges, reserved_mem_ranges_size);
+        if (ret < 0) {
+            goto out;
+        }
+        reserved_mem_ranges_fd = ret;
     }
-    reserved_mem_ranges_fd = ret;
 
     /* child's signal handler may mess with parent's memory during vfork(), so block signals */
     ret = block_async_signals(true);
@@ -100,6 +123,7 @@ int sgx_create_process(size_t nargs, const char** args, const char* manifest,
         .manifest_size = strlen(manifest),
         .reserved_mem_ranges_fd = reserved_mem_ranges_fd,
         .reserved_mem_ranges_size = reserved_mem_ranges_size,
+        .is_zygote = is_zygote,
     };
 
     ret = write_all(fds[1], &proc_args, sizeof(proc_args));
@@ -117,14 +141,17 @@ int sgx_create_process(size_t nargs, const char** args, const char* manifest,
         goto out;
     }
 
-    ret = read_all(fds[1], &rete, sizeof(rete));
-    if (ret < 0) {
-        goto out;
-    }
+    /* a zygote's status is read on hand-off, so that spawning it does not wait for the child */
+    if (!is_zygote) {
+        ret = read_all(fds[1], &rete, sizeof(rete));
+        if (ret < 0) {
+            goto out;
+        }
 
-    if (rete < 0) {
-        ret = rete;
-        goto out;
+        if (rete < 0) {
+            ret = rete;
+            goto out;
+        }
     }
 
     *out_stream_fd = fds[1];
@@ -144,8 +171,95 @@ out:
     return ret;
 }
 
+void sgx_refill_zygote_pool(void) {
+    while (true) {
+        spinlock_lock(&g_zygote_pool_lock);
+        bool full = g_zygotes_cnt + g_zygotes_spawning >= g_pal_enclave.zygote_pool_size;
+        if (!full)
+            g_zygotes_spawning++;
+        spinlock_unlock(&g_zygote_pool_lock);
+        if (full)
+            return;
+
+        int stream_fd;
+        int ret = spawn_child(/*nargs=*/0, /*args=*/NULL, g_pal_enclave.raw_manifest_data,
+                              /*reserved_mem_ranges=*/NULL, /*reserved_mem_ranges_size=*/0,
+                              /*is_zygote=*/true, &stream_fd);
+
+        spinlock_lock(&g_zygote_pool_lock);
+        g_zygotes_spawning--;
+        if (ret == 0)
+            g_zygote_fds[g_zygotes_cnt++] = stream_fd;
+        spinlock_unlock(&g_zygote_pool_lock);
+
+        if (ret < 0) {
+            log_warning("Spawning a zygote process failed: %s", unix_strerror(ret));
+            return;
+        }
+    }
+}
+
+/* Takes a zygote from the pool and hands it over; returns its stream or a negative error code if
+ * there is no usable zygote. */
+static int handoff_zygote(void* reserved_mem_ranges, size_t reserved_mem_ranges_size) {
+    while (true) {
+        int stream_fd = -1;
+        spinlock_lock(&g_zygote_pool_lock);
+        if (g_zygotes_cnt)
+            stream_fd = g_zygote_fds[--g_zygotes_cnt];
+        spinlock_unlock(&g_zygote_pool_lock);
+        if (stream_fd < 0)
+            return -EAGAIN;
+
+        /* wait for both statuses; the zygote may still be creating its enclave */
+        int ret;
+        int status[2];
+        ret = read_all(stream_fd, &status, sizeof(status));
+        if (ret == 0 && (status[0] < 0 || status[1] < 0))
+            ret = status[0] < 0 ? status[0] : status[1];
+        if (ret == 0)
+            ret = write_all(stream_fd, &reserved_mem_ranges_size,
+                            sizeof(reserved_mem_ranges_size));
+        if (ret == 0)
+            ret = write_all(stream_fd, reserved_mem_ranges, reserved_mem_ranges_size);
+        if (ret == 0)
+            return stream_fd;
+
+        /* this zygote failed (e.g. could not create its enclave), try the next one */
+        log_warning("Zygote process is not usable: %s", unix_strerror(ret));
+        DO_SYSCALL(close, stream_fd);
+    }
+}
+
+int sgx_create_process(size_t nargs, const char** args, const char* manifest,
+                       void* reserved_mem_ranges, size_t reserved_mem_ranges_size,
+                       int* out_stream_fd) {
+    /* zygotes are spawned without arguments, so they can only be used for processes without them
+     * (e.g. `fork()`, but not the first process of a new Gramine instance) */
+    if (!g_pal_enclave.zygote_pool_size || nargs) {
+        return spawn_child(nargs, args, manifest, reserved_mem_ranges, reserved_mem_ranges_size,
+                           /*is_zygote=*/false, out_stream_fd);
+    }
+
+    int ret = handoff_zygote(reserved_mem_ranges, reserved_mem_ranges_size);
+    if (ret < 0) {
+        /* pool is empty (e.g. on the first fork with lazy warm-up) */
+        ret = spawn_child(nargs, args, manifest, reserved_mem_ranges, reserved_mem_ranges_size,
+                          /*is_zygote=*/false, out_stream_fd);
+    } else {
+        *out_stream_fd = ret;
+        ret = 0;
+    }
+
+    /* The new zygotes create their enclaves in their own processes, concurrently with the child
+     * started above, so only spawning them (not their initialization) adds to this call. */
+    sgx_refill_zygote_pool();
+    return ret;
+}
+
 int sgx_init_child_process(int parent_stream_fd, char** out_application_path, char** out_manifest,
-                           void** out_reserved_mem_ranges, size_t* out_reserved_mem_ranges_size) {
+                           bool* out_is_zygote, void** out_reserved_mem_ranges,
+                           size_t* out_reserved_mem_ranges_size) {
     int ret;
     struct proc_args proc_args;
     char* manifest = NULL;
@@ -187,28 +301,32 @@ int sgx_init_child_process(int parent_stream_fd, char** out_application_path, ch
     }
 
     void* reserved_mem_ranges = NULL;
-    if (proc_args.reserved_mem_ranges_size) {
-        reserved_mem_ranges = (void*)DO_SYSCALL(mmap, NULL, proc_args.reserved_mem_ranges_size,
-                                                PROT_READ, MAP_PRIVATE | MAP_POPULATE,
-                                                proc_args.reserved_mem_ranges_fd, /*offset=*/0);
-        if (IS_PTR_ERR(reserved_mem_ranges)) {
-            ret = PTR_TO_ERR(reserved_mem_ranges);
-            goto out;
+    if (!proc_args.is_zygote) {
+        if (proc_args.reserved_mem_ranges_size) {
+            reserved_mem_ranges = (void*)DO_SYSCALL(mmap, NULL, proc_args.reserved_mem_ranges_size,
+                                                    PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+                                                    proc_args.reserved_mem_ranges_fd,
+                                                    /*offset=*/0);
+            if (IS_PTR_ERR(reserved_mem_ranges)) {
+                ret = PTR_TO_ERR(reserved_mem_ranges);
+                goto out;
+            }
         }
-    }
 
-    ret = DO_SYSCALL(close, proc_args.reserved_mem_ranges_fd);
-    if (ret < 0) {
-        if (proc_args.reserved_mem_ranges_size) {
-            DO_SYSCALL(munmap, reserved_mem_ranges, proc_args.reserved_mem_ranges_size);
+        ret = DO_SYSCALL(close, proc_args.reserved_mem_ranges_fd);
+        if (ret < 0) {
+            if (proc_args.reserved_mem_ranges_size) {
+                DO_SYSCALL(munmap, reserved_mem_ranges, proc_args.reserved_mem_ranges_size);
+            }
+            goto out;
         }
-        goto out;
     }
 
     *out_application_path = application_path;
     *out_manifest = manifest;
+    *out_is_zygote = proc_args.is_zygote;
     *out_reserved_mem_ranges = reserved_mem_ranges;
-    *out_reserved_mem_ranges_size = proc_args.reserved_mem_ranges_size;
+    *out_reserved_mem_ranges_size = proc_args.is_zygote ? 0 : proc_args.reserved_mem_ranges_size;
     ret = 0;
 out:
     if (ret < 0) {
@@ -218,3 +336,35 @@ out:
 
     return ret;
 }
+
+int sgx_zygote_wait_for_handoff(int parent_stream_fd, void** out_reserved_mem_ranges,
+                                size_t* out_reserved_mem_ranges_size) {
+    int enclave_status = 0;
+    int ret = write_all(parent_stream_fd, &enclave_status, sizeof(enclave_status));
+    if (ret < 0)
+        return ret;
+
+    size_t reserved_mem_ranges_size;
+    ret = read_all(parent_stream_fd, &reserved_mem_ranges_size, sizeof(reserved_mem_ranges_size));
+    if (ret < 0)
+        return ret;
+
+    void* reserved_mem_ranges = NULL;
+    if (reserved_mem_ranges_size) {
+        reserved_mem_ranges = (void*)DO_SYSCALL(mmap, NULL, reserved_mem_ranges_size,
+                                                PROT_READ | PROT_WRITE,
+                                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (IS_PTR_ERR(reserved_mem_ranges))
+            return PTR_TO_ERR(reserved_mem_ranges);
+
+        ret = read_all(parent_stream_fd, reserved_mem_ranges, reserved_mem_ranges_size);
+        if (ret < 0) {
+            DO_SYSCALL(munmap, reserved_mem_ranges, reserved_mem_ranges_size);
+            return ret;
+        }
+    }
+
+    *out_reserved_mem_ranges = reserved_mem_ranges;
+    *out_reserved_mem_ranges_size = reserved_mem_ranges_size;
+    return 0;
+}
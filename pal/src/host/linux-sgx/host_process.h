@@ -5,11 +5,23 @@
 
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 
+#define MAX_ZYGOTE_POOL_SIZE 64
+
 int sgx_create_process(size_t nargs, const char** args, const char* manifest,
                        void* reserved_mem_ranges, size_t reserved_mem_ranges_size,
                        int* out_stream_fd);
 
 int sgx_init_child_process(int parent_stream_fd, char** out_application_path, char** out_manifest,
-                           void** out_reserved_mem_ranges, size_t* out_reserved_mem_ranges_size);
+                           bool* out_is_zygote, void** out_reserved_mem_ranges,
+                           size_t* out_reserved_mem_ranges_size);
+
+/* Spawns zygote processes until the pool configured in the manifest is full. */
+void sgx_refill_zygote_pool(void);
+
+/* Called in a zygote process after its enclave is created; returns the reserved memory ranges of
+ * the process it becomes. */
+int sgx_zygote_wait_for_handoff(int parent_stream_fd, void** out_reserved_mem_ranges,
+                                size_t* out_reserved_mem_ranges_size);
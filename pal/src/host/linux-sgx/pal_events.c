@@ -201,6 +201,27 @@ int _PalEventWait(PAL_HANDLE handle, uint64_t* timeout_us) {
     }
 }
 
+/* The futex word is in untrusted memory shared with other processes, so its value cannot be
+ * trusted; callers re-check their conditions after each wake-up anyway. */
+int _PalSharedFutexWait(uint32_t* addr, uint32_t expected, uint64_t* timeout_us) {
+    int ret = ocall_futex(addr, FUTEX_WAIT, (int)expected, timeout_us);
+    if (ret == -EAGAIN || ret == -EINTR) {
+        return 0;
+    }
+    if (ret == -ETIMEDOUT) {
+        return -PAL_ERROR_TRYAGAIN;
+    }
+    return ret < 0 ? unix_to_pal_error(ret) : 0;
+}
+
+int _PalSharedFutexWake(uint32_t* addr, uint32_t count) {
+    int ret;
+    do {
+        ret = ocall_futex(addr, FUTEX_WAKE, (int)MIN(count, (uint32_t)INT_MAX), /*timeout=*/NULL);
+    } while (ret == -EINTR);
+    return ret < 0 ? unix_to_pal_error(ret) : 0;
+}
+
 static void event_destroy(PAL_HANDLE handle) {
     assert(handle->hdr.type == PAL_TYPE_EVENT);
 
@@ -20,6 +20,7 @@
 #include "pal_linux.h"
 #include "pal_linux_defs.h"
 #include "pal_linux_error.h"
+#include "pal_ocall_types.h"
 #include "pal_sgx.h"
 #include "path_utils.h"
 #include "stat.h"
@@ -398,6 +399,66 @@ static int file_flush(PAL_HANDLE handle) {
     return 0;
 }
 
+/* max number of operations passed to the host in one OCALL by 'batch' */
+#define FILE_BATCH_MAX_OPS 64
+
+/* 'batch' operation for file streams: operations on files whose contents are not verified by PAL
+ * are passed to the host in one OCALL */
+static int64_t file_batch(struct pal_io_op* ops, size_t count) {
+    if (ops[0].handle->file.chunk_hashes) {
+        /* trusted file: each operation has to go through verification */
+        switch (ops[0].type) {
+            case PAL_IO_READ:
+                ops[0].result = file_read(ops[0].handle, ops[0].offset, ops[0].size,
+                                          ops[0].buffer);
+                break;
+            case PAL_IO_WRITE:
+                ops[0].result = file_write(ops[0].handle, ops[0].offset, ops[0].size,
+                                           ops[0].buffer);
+                break;
+            case PAL_IO_FLUSH:
+                ops[0].result = file_flush(ops[0].handle);
+                break;
+        }
+        return 1;
+    }
+
+    struct ocall_io_op io_ops[FILE_BATCH_MAX_OPS];
+    size_t n = 0;
+    for (; n < MIN(count, (size_t)FILE_BATCH_MAX_OPS); n++) {
+        PAL_HANDLE handle = ops[n].handle;
+        if (handle->file.chunk_hashes)
+            break;
+        if (ops[n].offset > INT64_MAX)
+            return n ? (int64_t)n : -PAL_ERROR_INVAL;
+
+        io_ops[n].fd     = handle->file.fd;
+        io_ops[n].offset = handle->file.seekable ? (off_t)ops[n].offset : -1;
+        io_ops[n].buf    = ops[n].buffer;
+        io_ops[n].size   = ops[n].size;
+        switch (ops[n].type) {
+            case PAL_IO_READ:
+                io_ops[n].type = OCALL_IO_OP_READ;
+                break;
+            case PAL_IO_WRITE:
+                io_ops[n].type = OCALL_IO_OP_WRITE;
+                break;
+            case PAL_IO_FLUSH:
+                io_ops[n].type = OCALL_IO_OP_FSYNC;
+                break;
+        }
+    }
+
+    ssize_t ret = ocall_io_batch(io_ops, n);
+    if (ret < 0)
+        return unix_to_pal_error(ret);
+
+    for (ssize_t i = 0; i < ret; i++)
+        ops[i].result = io_ops[i].result < 0 ? unix_to_pal_error(io_ops[i].result)
+                                             : io_ops[i].result;
+    return ret;
+}
+
 /* 'attrquery' operation for file streams */
 static int file_attrquery(const char* type, const char* uri, PAL_STREAM_ATTR* attr) {
     if (strcmp(type, URI_TYPE_FILE) && strcmp(type, URI_TYPE_DIR))
@@ -483,10 +544,118 @@ static int file_rename(PAL_HANDLE handle, const char* type, const char* uri) {
     return 0;
 }
 
+/* Size of the enclave buffer used to stream trusted files, a multiple of TRUSTED_CHUNK_SIZE so that
+ * each chunk is verified only once. */
+#define SPLICE_TRUSTED_BUF_SIZE (TRUSTED_CHUNK_SIZE * 16)
+
+static int64_t splice_write(PAL_HANDLE out_handle, uint64_t out_offset, const void* buf,
+                            size_t count) {
+    if (out_handle->hdr.type == PAL_TYPE_FILE)
+        return ocall_pwrite(out_handle->file.fd, buf, count, out_offset);
+
+    struct iovec iov = {
+        .iov_base = (void*)buf,
+        .iov_len = count,
+    };
+    return ocall_send(out_handle->sock.fd, &iov, 1, /*addr=*/NULL, /*addrlen=*/0,
+                      /*control=*/NULL, /*controllen=*/0, /*flags=*/0);
+}
+
+/* Trusted files must be verified inside the enclave before their contents leave it, so they cannot
+ * be connected to `out_handle` on the host. Stream them through one bounded enclave buffer
+ * instead, reading (and verifying) whole chunks at a time. */
+static int64_t splice_trusted_file(PAL_HANDLE in_handle, uint64_t in_offset, PAL_HANDLE out_handle,
+                                   uint64_t out_offset, uint64_t count) {
+    size_t buf_size = MIN(count, SPLICE_TRUSTED_BUF_SIZE);
+    void* buf = malloc(buf_size);
+    if (!buf)
+        return -PAL_ERROR_NOMEM;
+
+    int64_t ret = 0;
+    uint64_t copied = 0;
+    while (copied < count) {
+        uint64_t to_read = MIN(count - copied, buf_size);
+        ret = file_read(in_handle, in_offset + copied, to_read, buf);
+        if (ret <= 0)
+            break;
+
+        uint64_t read = ret;
+        ret = splice_write(out_handle, out_offset + copied, buf, read);
+        if (ret < 0) {
+            ret = unix_to_pal_error(ret);
+            break;
+        }
+        copied += ret;
+        if ((uint64_t)ret < read || read < to_read) {
+            /* short write or end of file */
+            break;
+        }
+    }
+
+    free(buf);
+    /* Report errors only if nothing was copied, like a short write would. */
+    return copied ? (int64_t)copied : ret;
+}
+
+int64_t _PalStreamSplice(PAL_HANDLE in_handle, uint64_t in_offset, PAL_HANDLE out_handle,
+                         uint64_t out_offset, uint64_t count) {
+    assert(in_handle->hdr.type == PAL_TYPE_FILE);
+
+    if (!in_handle->file.seekable) {
+        return -PAL_ERROR_NOTSUPPORT;
+    }
+    if (in_offset > INT64_MAX || out_offset > INT64_MAX) {
+        return -PAL_ERROR_INVAL;
+    }
+
+    bool out_is_file;
+    int out_fd;
+    switch (out_handle->hdr.type) {
+        case PAL_TYPE_FILE:
+            if (out_handle->file.chunk_hashes) {
+                log_warning("Writing to a trusted file (%s) is disallowed!",
+                            out_handle->file.realpath);
+                return -PAL_ERROR_DENIED;
+            }
+            if (!out_handle->file.seekable) {
+                return -PAL_ERROR_NOTSUPPORT;
+            }
+            out_is_file = true;
+            out_fd = out_handle->file.fd;
+            break;
+        case PAL_TYPE_SOCKET:
+            if (out_handle->sock.type != PAL_SOCKET_TCP) {
+                return -PAL_ERROR_NOTSUPPORT;
+            }
+            out_is_file = false;
+            out_fd = out_handle->sock.fd;
+            break;
+        default:
+            return -PAL_ERROR_NOTSUPPORT;
+    }
+
+    if (in_handle->file.chunk_hashes) {
+        return splice_trusted_file(in_handle, in_offset, out_handle, out_offset, count);
+    }
+
+    /* Allowed file: its contents are not protected anyway, let the host copy them directly. */
+    ssize_t ret = ocall_splice(in_handle->file.fd, in_offset, out_fd, out_offset, count,
+                               out_is_file);
+    if (ret == -ENOSYS || ret == -EXDEV || ret == -EOPNOTSUPP) {
+        /* Old host kernel or files on different/unsupported filesystems. */
+        return -PAL_ERROR_NOTSUPPORT;
+    }
+    if (ret < 0)
+        return unix_to_pal_error(ret);
+
+    return ret;
+}
+
 struct handle_ops g_file_ops = {
     .open           = &file_open,
     .read           = &file_read,
     .write          = &file_write,
+    .batch          = &file_batch,
     .destroy        = &file_destroy,
     .delete         = &file_delete,
     .map            = &file_map,
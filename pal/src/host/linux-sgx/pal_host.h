@@ -63,6 +63,7 @@ typedef struct {
             PAL_SESSION_KEY session_key;
             bool handshake_done;
             void* ssl_ctx;
+            void* gcm_ctx; /* lean transport instead of TLS (`sgx.pipe_transport = "gcm"`) */
             void* handshake_helper_thread_hdl;
         } pipe;
 
@@ -145,6 +146,17 @@ typedef struct {
              * word because Intel SGX implies a little-endian CPU. */
             uint64_t* signaled_untrusted;
         } event;
+
+        struct {
+            /* host epoll fd */
+            PAL_IDX fd;
+            /* Guards `entries` and `entries_count`. */
+            spinlock_t lock;
+            /* Trusted copy of the set, indexed by host fd of the member handle. The host returns
+             * only fds of ready handles, cookies are looked up here so that it cannot forge them. */
+            struct pal_event_set_entry* entries;
+            size_t entries_count;
+        } event_set;
     };
 }* PAL_HANDLE;
 
@@ -34,6 +34,8 @@ extern struct pal_linuxsgx_state {
     /* enclave information */
     bool enclave_initialized;        /* thread creation ECALL is allowed only after this is set */
     bool edmm_enabled;
+    bool enable_stats;               /* print in-enclave statistics on exit (`sgx.enable_stats`) */
+    bool pipes_use_gcm;              /* lean AES-GCM pipes (`sgx.pipe_transport = "gcm"`) */
     sgx_target_info_t qe_targetinfo; /* received from untrusted host, use carefully */
     sgx_report_body_t enclave_info;  /* cached self-report result, trusted */
 
@@ -208,4 +210,10 @@ int _PalStreamSecureSave(LIB_SSL_CONTEXT* ssl_ctx, const uint8_t** obuf, size_t*
 
 void fixup_socket_handle_after_deserialization(PAL_HANDLE handle);
 
+/* Waits until the secure session of a `pipe` or `pipecli` handle is established. */
+void pipe_wait_for_session(PAL_HANDLE handle);
+/* Serialize/deserialize the state of the lean AES-GCM pipe transport (`handle->pipe.gcm_ctx`). */
+int pipe_gcm_save(PAL_HANDLE handle, void** out_data, size_t* out_size);
+int pipe_gcm_restore(PAL_HANDLE handle, const void* data, size_t size);
+
 #endif /* IN_ENCLAVE */
@@ -36,6 +36,7 @@ static_assert(SSA_XSAVE_SIZE_MAX + /* GPRs size in SSA */176 <= SSA_FRAME_SIZE -
 #define DEBUG_ECALL 0
 #define DEBUG_OCALL 0
 
+/* must be kept in sync with TRUSTED_CHUNK_SIZE in python/graminelibos/manifest.py */
 #define TRUSTED_CHUNK_SIZE (PRESET_PAGESIZE * 4UL)
 
 #define MAX_ARGS_SIZE 10000000
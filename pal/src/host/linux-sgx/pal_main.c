@@ -38,7 +38,7 @@ PAL_SESSION_KEY g_master_key = {0};
 
 const size_t g_page_size = PRESET_PAGESIZE;
 
-static bool verify_and_init_rpc_queue(void* untrusted_rpc_queue) {
+static bool verify_and_init_rpc_queue(void* untrusted_rpc_queue, size_t threads_cnt) {
     if (!untrusted_rpc_queue) {
         /* user app didn't request RPC queue (i.e., the app didn't request exitless syscalls) */
         return true;
@@ -51,6 +51,7 @@ static bool verify_and_init_rpc_queue(void* untrusted_rpc_queue) {
     }
 
     g_rpc_queue = untrusted_rpc_queue;
+    g_rpc_rings_cnt = MIN(threads_cnt, (size_t)MAX_RPC_RINGS);
     return true;
 }
 
@@ -698,6 +699,7 @@ noreturn void pal_linux_main(void* uptr_libpal_uri, size_t libpal_uri_len, void*
      * which unsets invariant TSC, and we end up falling back to the slower ocall_gettime() */
     init_tsc();
     (void)get_tsc(); /* must be after `ready_for_exceptions=1` since it may generate SIGILL */
+    g_pal_public_state.tsc_hz = g_tsc_hz;
 
     ret = init_cpuid();
     if (ret < 0) {
@@ -772,7 +774,7 @@ noreturn void pal_linux_main(void* uptr_libpal_uri, size_t libpal_uri_len, void*
         ocall_exit(1, /*is_exitgroup=*/true);
     }
     if (rpc_thread_num > 0) {
-        if (!verify_and_init_rpc_queue(uptr_rpc_queue)) {
+        if (!verify_and_init_rpc_queue(uptr_rpc_queue, thread_num_int64)) {
             log_error("Invalid rpc queue pointer");
             ocall_exit(1, /*is_exitgroup=*/true);
         }
@@ -789,6 +791,30 @@ noreturn void pal_linux_main(void* uptr_libpal_uri, size_t libpal_uri_len, void*
         }
     }
 
+    ret = toml_bool_in(g_pal_public_state.manifest_root, "sgx.enable_stats", /*defaultval=*/false,
+                       &g_pal_linuxsgx_state.enable_stats);
+    if (ret < 0) {
+        log_error("Cannot parse 'sgx.enable_stats' (the value must be `true` or `false`)");
+        ocall_exit(1, /*is_exitgroup=*/true);
+    }
+
+    char* pipe_transport_str = NULL;
+    ret = toml_string_in(g_pal_public_state.manifest_root, "sgx.pipe_transport",
+                         &pipe_transport_str);
+    if (ret < 0) {
+        log_error("Cannot parse 'sgx.pipe_transport'");
+        ocall_exit(1, /*is_exitgroup=*/true);
+    }
+    if (!pipe_transport_str || !strcmp(pipe_transport_str, "tls")) {
+        g_pal_linuxsgx_state.pipes_use_gcm = false;
+    } else if (!strcmp(pipe_transport_str, "gcm")) {
+        g_pal_linuxsgx_state.pipes_use_gcm = true;
+    } else {
+        log_error("Invalid 'sgx.pipe_transport' value (must be \"tls\" or \"gcm\")");
+        ocall_exit(1, /*is_exitgroup=*/true);
+    }
+    free(pipe_transport_str);
+
     bool preheat_enclave;
     ret = toml_bool_in(g_pal_public_state.manifest_root, "sgx.preheat_enclave",
                        /*defaultval=*/false, &preheat_enclave);
@@ -824,6 +850,11 @@ noreturn void pal_linux_main(void* uptr_libpal_uri, size_t libpal_uri_len, void*
         ocall_exit(1, /*is_exitgroup=*/true);
     }
 
+    if ((ret = init_trusted_files_cache()) < 0) {
+        log_error("Failed to initialize trusted files cache: %s", pal_strerror(ret));
+        ocall_exit(1, /*is_exitgroup=*/true);
+    }
+
     ret = toml_bool_in(g_pal_public_state.manifest_root,
                        "sys.enable_extra_runtime_domain_names_conf", /*defaultval*/false,
                        &g_pal_public_state.extra_runtime_domain_names_conf);
@@ -4,6 +4,7 @@
  *                    Borys Popławski <borysp@invisiblethingslab.com>
  */
 
+#include <linux/eventpoll.h>
 #include <linux/poll.h>
 
 #include "cpu.h"
@@ -11,12 +12,26 @@
 #include "pal.h"
 #include "pal_error.h"
 #include "pal_internal.h"
+#include "pal_linux.h"
 #include "pal_linux_error.h"
+#include "pal_ocall_types.h"
 
 /* To avoid expensive malloc/free (due to locking), use stack if the required space is small
  * enough. */
 #define NFDS_LIMIT_TO_USE_STACK 16
 
+/* Maximal number of events returned from an event set by one `_PalEventSetWait()` call. Event sets
+ * are level-triggered, so remaining ready handles are simply reported by the next call. */
+#define EVENT_SET_MAX_EVENTS 64
+/* Maximal number of event set updates sent to the host in one ocall. */
+#define EVENT_SET_MAX_UPDATES 64
+
+struct pal_event_set_entry {
+    uint64_t cookie;
+    pal_wait_flags_t events;
+    bool used;
+};
+
 int _PalStreamsWaitEvents(size_t count, PAL_HANDLE* handle_array, pal_wait_flags_t* events,
                           pal_wait_flags_t* ret_events, uint64_t* timeout_us) {
     struct pollfd* fds = NULL;
@@ -52,9 +67,7 @@ int _PalStreamsWaitEvents(size_t count, PAL_HANDLE* handle_array, pal_wait_flags
             fds[i].events = fdevents;
 
             if (handle->hdr.type == PAL_TYPE_PIPE) {
-                while (!__atomic_load_n(&handle->pipe.handshake_done, __ATOMIC_ACQUIRE)) {
-                    CPU_RELAX();
-                }
+                pipe_wait_for_session(handle);
             }
         } else {
             fds[i].fd = -1;
@@ -109,3 +122,291 @@ out:
     }
     return ret;
 }
+
+int _PalEventSetCreate(PAL_HANDLE* handle_ptr) {
+    int fd = ocall_event_set_create();
+    if (fd < 0) {
+        return unix_to_pal_error(fd);
+    }
+
+    PAL_HANDLE handle = calloc(1, HANDLE_SIZE(event_set));
+    if (!handle) {
+        ocall_close(fd);
+        return -PAL_ERROR_NOMEM;
+    }
+
+    init_handle_hdr(handle, PAL_TYPE_EVENTSET);
+    /* The epoll fd itself is not meant to be polled with `_PalStreamsWaitEvents()`. */
+    handle->flags = 0;
+    handle->event_set.fd = fd;
+    spinlock_init(&handle->event_set.lock);
+    handle->event_set.entries = NULL;
+    handle->event_set.entries_count = 0;
+
+    *handle_ptr = handle;
+    return 0;
+}
+
+/* Records `update` in the trusted copy of the set and translates it for the host. */
+static int event_set_record_update(PAL_HANDLE set, const struct pal_event_set_update* update,
+                                   struct ocall_event_set_update* host_update) {
+    PAL_HANDLE handle = update->handle;
+    if (!(handle->flags & (PAL_HANDLE_FD_READABLE | PAL_HANDLE_FD_WRITABLE))) {
+        return -PAL_ERROR_BADHANDLE;
+    }
+
+    size_t fd = handle->generic.fd;
+    host_update->fd = handle->generic.fd;
+    /* Same as in `_PalStreamsWaitEvents()`: always ask for `EPOLLRDHUP`. */
+    host_update->events = EPOLLRDHUP;
+    if (update->events & PAL_WAIT_READ) {
+        host_update->events |= EPOLLIN;
+    }
+    if (update->events & PAL_WAIT_WRITE) {
+        host_update->events |= EPOLLOUT;
+    }
+
+    int ret = 0;
+    spinlock_lock(&set->event_set.lock);
+    switch (update->op) {
+        case PAL_EVENT_SET_ADD:
+        case PAL_EVENT_SET_MODIFY:
+            host_update->op = update->op == PAL_EVENT_SET_ADD ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+            if (fd >= set->event_set.entries_count) {
+                size_t new_count = MAX(MAX(fd + 1, set->event_set.entries_count * 2), (size_t)64);
+                struct pal_event_set_entry* new_entries = calloc(new_count, sizeof(*new_entries));
+                if (!new_entries) {
+                    ret = -PAL_ERROR_NOMEM;
+                    break;
+                }
+                if (set->event_set.entries_count) {
+                    memcpy(new_entries, set->event_set.entries,
+                           set->event_set.entries_count * sizeof(*new_entries));
+                }
+                free(set->event_set.entries);
+                set->event_set.entries = new_entries;
+                set->event_set.entries_count = new_count;
+            }
+            set->event_set.entries[fd].cookie = update->cookie;
+            set->event_set.entries[fd].events = update->events;
+            set->event_set.entries[fd].used = true;
+            break;
+        case PAL_EVENT_SET_DELETE:
+            host_update->op = EPOLL_CTL_DEL;
+            if (fd < set->event_set.entries_count) {
+                set->event_set.entries[fd].used = false;
+            }
+            break;
+        default:
+            ret = -PAL_ERROR_INVAL;
+            break;
+    }
+    spinlock_unlock(&set->event_set.lock);
+    return ret;
+}
+
+static pal_wait_flags_t epoll_to_pal_events(uint32_t events) {
+    pal_wait_flags_t ret = 0;
+    if (events & EPOLLIN)
+        ret |= PAL_WAIT_READ;
+    if (events & EPOLLOUT)
+        ret |= PAL_WAIT_WRITE;
+    if (events & EPOLLERR)
+        ret |= PAL_WAIT_ERROR;
+    if (events & (EPOLLHUP | EPOLLRDHUP))
+        ret |= PAL_WAIT_HANG_UP;
+    return ret;
+}
+
+int _PalEventSetWait(PAL_HANDLE set, const struct pal_event_set_update* updates,
+                     size_t updates_count, size_t count, PAL_HANDLE* handle_array,
+                     pal_wait_flags_t* events, pal_wait_flags_t* ret_events,
+                     struct pal_event_set_event* set_events, size_t* set_events_count,
+                     uint64_t* timeout_us) {
+    int ret;
+    int epfd = set->event_set.fd;
+    size_t max_events = MIN(*set_events_count, (size_t)EVENT_SET_MAX_EVENTS);
+    *set_events_count = 0;
+
+    /* All updates but the last batch are sent in separate ocalls, the last batch is sent together
+     * with the wait. */
+    struct ocall_event_set_update host_updates[EVENT_SET_MAX_UPDATES];
+    size_t host_updates_count = 0;
+    for (size_t i = 0; i < updates_count; i++) {
+        if (host_updates_count == ARRAY_SIZE(host_updates)) {
+            ret = ocall_event_set_wait(epfd, host_updates, host_updates_count, /*fds=*/NULL,
+                                       /*nfds=*/0, /*events=*/NULL, /*max_events=*/0,
+                                       /*timeout_us=*/NULL);
+            if (ret < 0) {
+                return unix_to_pal_error(ret);
+            }
+            host_updates_count = 0;
+        }
+        ret = event_set_record_update(set, &updates[i], &host_updates[host_updates_count]);
+        if (ret < 0) {
+            /* Still apply the preceding updates. */
+            if (host_updates_count) {
+                ocall_event_set_wait(epfd, host_updates, host_updates_count, /*fds=*/NULL,
+                                     /*nfds=*/0, /*events=*/NULL, /*max_events=*/0,
+                                     /*timeout_us=*/NULL);
+            }
+            return ret;
+        }
+        host_updates_count++;
+    }
+
+    if (!count && !max_events) {
+        if (!host_updates_count) {
+            return 0;
+        }
+        ret = ocall_event_set_wait(epfd, host_updates, host_updates_count, /*fds=*/NULL,
+                                   /*nfds=*/0, /*events=*/NULL, /*max_events=*/0,
+                                   /*timeout_us=*/NULL);
+        return ret < 0 ? unix_to_pal_error(ret) : 0;
+    }
+
+    /* Additional handles are polled together with the epoll fd (which is readable when any handle
+     * in the set is ready), see `ocall_event_set_wait()`. */
+    size_t nfds = count ? count + (max_events ? 1 : 0) : 0;
+    struct pollfd* fds = NULL;
+    bool allocate_on_stack = nfds <= NFDS_LIMIT_TO_USE_STACK;
+
+    if (allocate_on_stack) {
+        static_assert(sizeof(*fds) * NFDS_LIMIT_TO_USE_STACK <= 128,
+                      "Would use too much space on stack, reduce the limit");
+        fds = __builtin_alloca(nfds * sizeof(*fds));
+    } else {
+        fds = malloc(nfds * sizeof(*fds));
+        if (!fds) {
+            return -PAL_ERROR_NOMEM;
+        }
+    }
+    memset(fds, 0, nfds * sizeof(*fds));
+
+    for (size_t i = 0; i < count; i++) {
+        ret_events[i] = 0;
+
+        PAL_HANDLE handle = handle_array[i];
+        /* If `handle` does not have a host fd, just ignore it. */
+        if (handle && (handle->flags & (PAL_HANDLE_FD_READABLE | PAL_HANDLE_FD_WRITABLE))) {
+            short fdevents = POLLRDHUP;
+            if (events[i] & PAL_WAIT_READ) {
+                fdevents |= POLLIN;
+            }
+            if (events[i] & PAL_WAIT_WRITE) {
+                fdevents |= POLLOUT;
+            }
+            fds[i].fd = handle->generic.fd;
+            fds[i].events = fdevents;
+
+            if (handle->hdr.type == PAL_TYPE_PIPE) {
+                pipe_wait_for_session(handle);
+            }
+        } else {
+            fds[i].fd = -1;
+        }
+    }
+    if (count && max_events) {
+        fds[count].fd = epfd;
+        fds[count].events = POLLIN;
+    }
+
+    struct epoll_event host_events[EVENT_SET_MAX_EVENTS];
+    ret = ocall_event_set_wait(epfd, host_updates, host_updates_count, fds, nfds, host_events,
+                               max_events, timeout_us);
+    if (ret < 0) {
+        ret = unix_to_pal_error(ret);
+        goto out;
+    }
+    size_t host_events_count = (size_t)ret;
+
+    /* The epoll fd being ready without any harvested events is not a timeout, just a spurious
+     * wakeup (e.g. a handle in the set stopped being ready in the meantime). */
+    bool any_ready = host_events_count || (nfds && max_events && fds[count].revents);
+
+    for (size_t i = 0; i < count; i++) {
+        PAL_HANDLE handle = handle_array[i];
+        if (!handle || !(handle->flags & (PAL_HANDLE_FD_READABLE | PAL_HANDLE_FD_WRITABLE))) {
+            /* We skipped this fd. */
+            continue;
+        }
+
+        if (fds[i].revents & POLLIN)
+            ret_events[i] |= PAL_WAIT_READ;
+        if (fds[i].revents & POLLOUT)
+            ret_events[i] |= PAL_WAIT_WRITE;
+
+        /* report error events on this FD */
+        if (fds[i].revents & (POLLERR | POLLNVAL))
+            handle->flags |= PAL_HANDLE_FD_ERROR;
+        if (handle->flags & PAL_HANDLE_FD_ERROR)
+            ret_events[i] |= PAL_WAIT_ERROR;
+
+        /* report hang-up events on this FD */
+        if (fds[i].revents & (POLLHUP | POLLRDHUP))
+            handle->flags |= PAL_HANDLE_FD_HANG_UP;
+        if (handle->flags & PAL_HANDLE_FD_HANG_UP)
+            ret_events[i] |= PAL_WAIT_HANG_UP;
+
+        if (ret_events[i]) {
+            any_ready = true;
+        }
+    }
+
+    if (!any_ready) {
+        /* timed out */
+        if (timeout_us) {
+            *timeout_us = 0;
+        }
+        ret = -PAL_ERROR_TRYAGAIN;
+        goto out;
+    }
+
+    /* The host reports host fds only; drop the ones not in the set (stale events of handles deleted
+     * by a concurrent call, or forged by a malicious host) and events that were not requested. */
+    size_t set_events_filled = 0;
+    spinlock_lock(&set->event_set.lock);
+    for (size_t i = 0; i < host_events_count; i++) {
+        uint64_t fd = host_events[i].data;
+        if (fd >= set->event_set.entries_count || !set->event_set.entries[fd].used) {
+            continue;
+        }
+        pal_wait_flags_t ready = epoll_to_pal_events(host_events[i].events)
+                                 & (set->event_set.entries[fd].events | PAL_WAIT_ERROR
+                                    | PAL_WAIT_HANG_UP);
+        if (!ready) {
+            continue;
+        }
+        set_events[set_events_filled].cookie = set->event_set.entries[fd].cookie;
+        set_events[set_events_filled].events = ready;
+        set_events_filled++;
+    }
+    spinlock_unlock(&set->event_set.lock);
+    *set_events_count = set_events_filled;
+
+    ret = 0;
+
+out:
+    if (!allocate_on_stack) {
+        free(fds);
+    }
+    return ret;
+}
+
+static void event_set_destroy(PAL_HANDLE handle) {
+    assert(handle->hdr.type == PAL_TYPE_EVENTSET);
+
+    int ret = ocall_close(handle->event_set.fd);
+    if (ret < 0) {
+        log_error("closing event set host fd %d failed: %s", handle->event_set.fd,
+                  unix_strerror(ret));
+        /* We cannot do anything about it anyway... */
+    }
+
+    free(handle->event_set.entries);
+    free(handle);
+}
+
+struct handle_ops g_event_set_ops = {
+    .destroy = event_set_destroy,
+};
@@ -7,6 +7,7 @@
  * These structures are used in trusted -> untrusted world calls (OCALLS).
  */
 
+#include <linux/eventpoll.h>
 #include <stdbool.h>
 #include <stddef.h>
 
@@ -73,6 +74,10 @@ enum {
     OCALL_EDMM_RESTRICT_PAGES_PERM,
     OCALL_EDMM_MODIFY_PAGES_TYPE,
     OCALL_EDMM_REMOVE_PAGES,
+    OCALL_EVENT_SET_CREATE,
+    OCALL_EVENT_SET_WAIT,
+    OCALL_SPLICE,
+    OCALL_IO_BATCH,
     OCALL_NR,
 };
 
@@ -301,6 +306,52 @@ struct ocall_poll {
     uint64_t timeout_us;
 };
 
+struct ocall_event_set_update {
+    int fd;
+    int op;          /* EPOLL_CTL_* */
+    uint32_t events; /* EPOLL* flags; the host uses `fd` as epoll data */
+};
+
+struct ocall_event_set_wait {
+    int epfd;
+    struct ocall_event_set_update* updates;
+    size_t updates_count;
+    struct pollfd* fds;
+    size_t nfds;
+    struct epoll_event* events;
+    size_t max_events;
+    uint64_t timeout_us;
+};
+
+struct ocall_splice {
+    int in_fd;
+    off_t in_offset;
+    int out_fd;
+    off_t out_offset;
+    size_t count;
+    bool out_is_file;
+};
+
+enum {
+    OCALL_IO_OP_READ,
+    OCALL_IO_OP_WRITE,
+    OCALL_IO_OP_FSYNC,
+};
+
+struct ocall_io_op {
+    int fd;
+    int type;       /* OCALL_IO_OP_* */
+    off_t offset;   /* -1 to use read()/write() instead of pread()/pwrite() */
+    void* buf;
+    size_t size;
+    ssize_t result;
+};
+
+struct ocall_io_batch {
+    struct ocall_io_op* ops;
+    size_t count;
+};
+
 struct ocall_rename {
     const char* oldpath;
     const char* newpath;
@@ -38,6 +38,488 @@ static int pipe_session_key(const char* name, size_t name_size, PAL_SESSION_KEY*
                            (uint8_t*)session_key, sizeof(*session_key));
 }
 
+/*
+ * Lean AES-GCM transport (`sgx.pipe_transport = "gcm"`), used instead of TLS.
+ *
+ * Both ends of a pipe already share the session key derived from the pipe name and the master key
+ * (the latter is established by `_PalStreamKeyExchange()` between the enclaves of the same
+ * application), so a full TLS handshake is not needed. Instead, each end sends a random salt as
+ * the first bytes on the pipe, and both ends derive one AES-GCM key per direction from the session
+ * key and both salts. The salts make the keys unique for each connection, so that records from
+ * another connection cannot be replayed.
+ *
+ * Data is then sent as records: a header with the plaintext size (authenticated as additional
+ * data), the ciphertext and the tag. The nonce of a record is its sequence number in the given
+ * direction, so records cannot be reordered, dropped or replayed within a connection either.
+ * Records are up to 64KB (TLS records are limited to 16KB), and one write sends up to
+ * PIPE_GCM_MAX_BATCH records with a single host write. The receiving end reads the header and then
+ * the rest of one record, never more, so that the enclave doesn't keep data which the host would
+ * not report as readable in poll() (except for the rest of a record that did not fit in the
+ * caller's buffer, as with TLS).
+ *
+ * The accepting end receives the salt of the connecting end in `pipe_waitforclient()` (the
+ * connecting end sent it right after connecting). The connecting end cannot wait for the salt of
+ * the accepting end in `pipe_connect()`, as the accepting end is typically created by the same
+ * thread after `pipe_connect()` returns, so it receives it on first use of the pipe (see
+ * `pipe_wait_for_session()`). This replaces the TLS handshake helper thread.
+ *
+ * As in mbedTLS, a write that fails with -PAL_ERROR_TRYAGAIN or -PAL_ERROR_INTERRUPTED after its
+ * records were encrypted keeps them pending, and the next write sends them (and returns their size)
+ * before encrypting anything new, so the caller must retry with the same data. If the retried
+ * buffer is shorter, the write reports at most its size and the following writes report the rest
+ * of the already sent data without sending anything, so the caller never sees more than it asked
+ * for (and must keep retrying with the data following what was reported). Encrypted records
+ * are never discarded, as that would require reusing their nonces.
+ *
+ * Concurrent reads (and concurrent writes) are serialized by a sleeping lock per direction, which
+ * is held across the host I/O. The sequence numbers and the received data are protected by a
+ * spinlock that is never held across the host I/O, so that saving the state on fork doesn't wait
+ * for a read or write blocked on the host.
+ */
+#define PIPE_GCM_SALT_SIZE  32
+#define PIPE_GCM_KEY_SIZE   16
+#define PIPE_GCM_TAG_SIZE   16
+#define PIPE_GCM_MAX_RECORD (64 * 1024)
+#define PIPE_GCM_MAX_BATCH  4
+/* initial size of the receive buffer, grown on demand up to one full record */
+#define PIPE_GCM_READ_BUF_SIZE (4 * 1024)
+
+struct pipe_gcm_header {
+    uint32_t size; /* size of the plaintext, 1 to PIPE_GCM_MAX_RECORD */
+} __attribute__((packed));
+
+#define PIPE_GCM_OVERHEAD (sizeof(struct pipe_gcm_header) + PIPE_GCM_TAG_SIZE)
+
+struct pipe_gcm_ctx {
+    uint8_t salt[PIPE_GCM_SALT_SIZE]; /* our salt, used until the session is established */
+    bool session_claimed; /* connecting end: set by the thread receiving the other end's salt */
+    bool broken;          /* session could not be established */
+
+    uint8_t send_key[PIPE_GCM_KEY_SIZE];
+    uint8_t recv_key[PIPE_GCM_KEY_SIZE];
+
+    /* sleeping locks (auto-clear events) serializing the readers and the writers, respectively */
+    PAL_HANDLE recv_mutex;
+    PAL_HANDLE send_mutex;
+
+    /* protects the sequence numbers and the receive buffer; never held across host I/O */
+    spinlock_t lock;
+    uint64_t recv_seq;
+    uint64_t send_seq;
+
+    /* modified only with `recv_mutex` and `lock` held */
+    uint8_t* recv_buf;
+    size_t recv_buf_size;
+    size_t plain_off;  /* decrypted data not read yet: [plain_off, plain_off + plain_size) */
+    size_t plain_size;
+    size_t raw_off;    /* received data not decrypted yet: [raw_off, raw_end) */
+    size_t raw_end;
+
+    /* protected by `send_mutex` */
+    uint8_t* send_buf;
+    size_t send_buf_size;
+    size_t pending_off;   /* encrypted data not sent yet: [pending_off, pending_end) */
+    size_t pending_end;
+    size_t pending_plain; /* size of the plaintext of the pending records, not reported yet */
+};
+
+/* serialized pipe_gcm_ctx, followed by the decrypted and the received data */
+struct pipe_gcm_state {
+    uint8_t send_key[PIPE_GCM_KEY_SIZE];
+    uint8_t recv_key[PIPE_GCM_KEY_SIZE];
+    uint64_t send_seq;
+    uint64_t recv_seq;
+    uint32_t plain_size;
+    uint32_t raw_size;
+};
+
+static void pipe_gcm_free(struct pipe_gcm_ctx* ctx) {
+    if (ctx->recv_mutex)
+        _PalObjectDestroy(ctx->recv_mutex);
+    if (ctx->send_mutex)
+        _PalObjectDestroy(ctx->send_mutex);
+    free(ctx->recv_buf);
+    free(ctx->send_buf);
+    erase_memory(ctx, sizeof(*ctx));
+    free(ctx);
+}
+
+static struct pipe_gcm_ctx* pipe_gcm_alloc(void) {
+    struct pipe_gcm_ctx* ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+        return NULL;
+    if (_PalEventCreate(&ctx->recv_mutex, /*init_signaled=*/true, /*auto_clear=*/true) < 0
+            || _PalEventCreate(&ctx->send_mutex, /*init_signaled=*/true, /*auto_clear=*/true) < 0) {
+        pipe_gcm_free(ctx);
+        return NULL;
+    }
+    spinlock_init(&ctx->lock);
+    return ctx;
+}
+
+static int pipe_gcm_send_salt(PAL_HANDLE handle, struct pipe_gcm_ctx* ctx) {
+    int ret = _PalRandomBitsRead(ctx->salt, sizeof(ctx->salt));
+    if (ret < 0)
+        return ret;
+
+    for (size_t done = 0; done < sizeof(ctx->salt);) {
+        ssize_t bytes = ocall_write(handle->pipe.fd, ctx->salt + done, sizeof(ctx->salt) - done);
+        if (bytes == -EINTR)
+            continue;
+        if (bytes <= 0)
+            return bytes < 0 ? unix_to_pal_error(bytes) : -PAL_ERROR_DENIED;
+        done += bytes;
+    }
+    return 0;
+}
+
+/* Receives the salt of the other end and derives the keys of both directions. */
+static int pipe_gcm_derive_keys(PAL_HANDLE handle, struct pipe_gcm_ctx* ctx, bool is_connecting) {
+    /* salt of the connecting end first */
+    uint8_t salts[2 * PIPE_GCM_SALT_SIZE];
+    uint8_t* peer_salt = is_connecting ? salts + PIPE_GCM_SALT_SIZE : salts;
+    memcpy(is_connecting ? salts : salts + PIPE_GCM_SALT_SIZE, ctx->salt, PIPE_GCM_SALT_SIZE);
+
+    for (size_t done = 0; done < PIPE_GCM_SALT_SIZE;) {
+        ssize_t bytes = ocall_read(handle->pipe.fd, peer_salt + done, PIPE_GCM_SALT_SIZE - done);
+        if (bytes == -EINTR)
+            continue;
+        if (bytes <= 0)
+            return bytes < 0 ? unix_to_pal_error(bytes) : -PAL_ERROR_DENIED;
+        done += bytes;
+    }
+
+    static const char connecting_to_accepting[] = "pipe connecting to accepting end";
+    static const char accepting_to_connecting[] = "pipe accepting to connecting end";
+    const char* send_info = is_connecting ? connecting_to_accepting : accepting_to_connecting;
+    const char* recv_info = is_connecting ? accepting_to_connecting : connecting_to_accepting;
+
+    int ret = lib_HKDF_SHA256((uint8_t*)&handle->pipe.session_key,
+                              sizeof(handle->pipe.session_key), salts, sizeof(salts),
+                              (const uint8_t*)send_info, strlen(send_info), ctx->send_key,
+                              sizeof(ctx->send_key));
+    if (ret < 0)
+        return ret;
+    return lib_HKDF_SHA256((uint8_t*)&handle->pipe.session_key, sizeof(handle->pipe.session_key),
+                           salts, sizeof(salts), (const uint8_t*)recv_info, strlen(recv_info),
+                           ctx->recv_key, sizeof(ctx->recv_key));
+}
+
+static void pipe_gcm_nonce(uint64_t seq, uint8_t nonce[12]) {
+    memset(nonce, 0, 12);
+    memcpy(nonce + 4, &seq, sizeof(seq));
+}
+
+/* Grows the receive buffer to at least `size` bytes, moving the received data to its start.
+ * Requires that there is no decrypted data in the buffer. */
+static int pipe_gcm_grow_recv_buf(struct pipe_gcm_ctx* ctx, size_t size) {
+    assert(!ctx->plain_size);
+    size_t raw_size = ctx->raw_end - ctx->raw_off;
+
+    if (size > ctx->recv_buf_size) {
+        uint8_t* buf = malloc(size);
+        if (!buf)
+            return -PAL_ERROR_NOMEM;
+        if (raw_size)
+            memcpy(buf, ctx->recv_buf + ctx->raw_off, raw_size);
+        free(ctx->recv_buf);
+        ctx->recv_buf = buf;
+        ctx->recv_buf_size = size;
+    } else if (ctx->raw_off) {
+        memmove(ctx->recv_buf, ctx->recv_buf + ctx->raw_off, raw_size);
+    }
+    ctx->raw_off = 0;
+    ctx->raw_end = raw_size;
+    return 0;
+}
+
+/* Acquires a sleeping lock of the transport; the wait on the host is retried if interrupted, so
+ * that a blocking read or write doesn't fail before it even started the I/O. */
+static int pipe_gcm_lock(PAL_HANDLE mutex) {
+    int ret;
+    do {
+        ret = _PalEventWait(mutex, /*timeout_us=*/NULL);
+    } while (ret == -PAL_ERROR_INTERRUPTED);
+    return ret;
+}
+
+static int64_t pipe_gcm_read(PAL_HANDLE handle, struct pipe_gcm_ctx* ctx, uint64_t len,
+                             uint8_t* buffer) {
+    uint64_t copied = 0;
+
+    int64_t ret = pipe_gcm_lock(ctx->recv_mutex);
+    if (ret < 0)
+        return ret;
+
+    spinlock_lock(&ctx->lock);
+    while (copied < len) {
+        if (ctx->plain_size) {
+            size_t size = MIN(ctx->plain_size, len - copied);
+            memcpy(buffer + copied, ctx->recv_buf + ctx->plain_off, size);
+            ctx->plain_off += size;
+            ctx->plain_size -= size;
+            copied += size;
+            continue;
+        }
+
+        size_t raw_size = ctx->raw_end - ctx->raw_off;
+        size_t record_size = 0;
+        if (raw_size >= sizeof(struct pipe_gcm_header)) {
+            struct pipe_gcm_header* header = (void*)(ctx->recv_buf + ctx->raw_off);
+            if (header->size == 0 || header->size > PIPE_GCM_MAX_RECORD) {
+                log_error("Pipe record with invalid size %u", header->size);
+                ret = -PAL_ERROR_DENIED;
+                goto out;
+            }
+            record_size = header->size + PIPE_GCM_OVERHEAD;
+        }
+
+        if (record_size && raw_size >= record_size) {
+            /* decrypt directly to the user buffer if the whole record fits there */
+            uint8_t* header = ctx->recv_buf + ctx->raw_off;
+            uint8_t* data = header + sizeof(struct pipe_gcm_header);
+            size_t size = record_size - PIPE_GCM_OVERHEAD;
+            bool to_user = size <= len - copied;
+            uint8_t nonce[12];
+            pipe_gcm_nonce(ctx->recv_seq, nonce);
+            ret = lib_AESGCMDecrypt(ctx->recv_key, sizeof(ctx->recv_key), nonce, data, size,
+                                    header, sizeof(struct pipe_gcm_header),
+                                    to_user ? buffer + copied : data, data + size,
+                                    PIPE_GCM_TAG_SIZE);
+            if (ret < 0) {
+                log_error("Pipe record failed authentication");
+                ret = -PAL_ERROR_DENIED;
+                goto out;
+            }
+            ctx->recv_seq++;
+            ctx->raw_off += record_size;
+            if (to_user) {
+                copied += size;
+            } else {
+                ctx->plain_off = data - ctx->recv_buf;
+                ctx->plain_size = size;
+            }
+            continue;
+        }
+
+        /* don't wait for more data if we already have some */
+        if (copied)
+            break;
+
+        ret = pipe_gcm_grow_recv_buf(ctx, MAX(record_size, (size_t)PIPE_GCM_READ_BUF_SIZE));
+        if (ret < 0)
+            goto out;
+
+        /* the buffer past `raw_end` is only accessed by the holder of `recv_mutex` */
+        size_t want = record_size ? record_size : sizeof(struct pipe_gcm_header);
+        uint8_t* read_buf = ctx->recv_buf + ctx->raw_end;
+        spinlock_unlock(&ctx->lock);
+        ssize_t bytes = ocall_read(handle->pipe.fd, read_buf, want - raw_size);
+        spinlock_lock(&ctx->lock);
+        if (bytes < 0) {
+            ret = unix_to_pal_error(bytes);
+            goto out;
+        }
+        if (bytes == 0) {
+            if (ctx->raw_end != ctx->raw_off) {
+                log_error("Pipe closed in the middle of a record");
+                ret = -PAL_ERROR_DENIED;
+                goto out;
+            }
+            break;
+        }
+        ctx->raw_end += bytes;
+    }
+    ret = copied;
+out:
+    spinlock_unlock(&ctx->lock);
+    _PalEventSet(ctx->recv_mutex);
+    return ret;
+}
+
+static int64_t pipe_gcm_write(PAL_HANDLE handle, struct pipe_gcm_ctx* ctx, uint64_t len,
+                              const uint8_t* buffer) {
+    if (!len)
+        return 0;
+
+    int64_t ret = pipe_gcm_lock(ctx->send_mutex);
+    if (ret < 0)
+        return ret;
+
+    if (ctx->pending_off == ctx->pending_end && !ctx->pending_plain) {
+        size_t plain = MIN(len, (uint64_t)PIPE_GCM_MAX_BATCH * PIPE_GCM_MAX_RECORD);
+        size_t records = UDIV_ROUND_UP(plain, PIPE_GCM_MAX_RECORD);
+        size_t size = plain + records * PIPE_GCM_OVERHEAD;
+        if (size > ctx->send_buf_size) {
+            uint8_t* buf = malloc(size);
+            if (!buf) {
+                ret = -PAL_ERROR_NOMEM;
+                goto out;
+            }
+            free(ctx->send_buf);
+            ctx->send_buf = buf;
+            ctx->send_buf_size = size;
+        }
+
+        /* reserve the nonces of the records; a nonce must never be used twice, even if the
+         * encryption was not complete */
+        spinlock_lock(&ctx->lock);
+        uint64_t seq = ctx->send_seq;
+        ctx->send_seq += records;
+        spinlock_unlock(&ctx->lock);
+
+        uint8_t* pos = ctx->send_buf;
+        for (size_t done = 0; done < plain;) {
+            size_t record = MIN(plain - done, (size_t)PIPE_GCM_MAX_RECORD);
+            struct pipe_gcm_header header = { .size = record };
+            memcpy(pos, &header, sizeof(header));
+            uint8_t* data = pos + sizeof(header);
+            uint8_t nonce[12];
+            pipe_gcm_nonce(seq++, nonce);
+            ret = lib_AESGCMEncrypt(ctx->send_key, sizeof(ctx->send_key), nonce, buffer + done,
+                                    record, pos, sizeof(header), data, data + record,
+                                    PIPE_GCM_TAG_SIZE);
+            if (ret < 0)
+                goto out;
+            done += record;
+            pos = data + record + PIPE_GCM_TAG_SIZE;
+        }
+        ctx->pending_off = 0;
+        ctx->pending_end = size;
+        ctx->pending_plain = plain;
+    }
+
+    while (ctx->pending_off < ctx->pending_end) {
+        ssize_t bytes = ocall_write(handle->pipe.fd, ctx->send_buf + ctx->pending_off,
+                                    ctx->pending_end - ctx->pending_off);
+        if (bytes < 0) {
+            ret = unix_to_pal_error(bytes);
+            goto out;
+        }
+        if (bytes == 0) {
+            ret = -PAL_ERROR_DENIED;
+            goto out;
+        }
+        ctx->pending_off += bytes;
+    }
+    /* the caller may retry with a shorter buffer than the one the pending records were encrypted
+     * from, never report more than it asked for */
+    ret = MIN(ctx->pending_plain, len);
+    ctx->pending_plain -= ret;
+out:
+    _PalEventSet(ctx->send_mutex);
+    return ret;
+}
+
+void pipe_wait_for_session(PAL_HANDLE handle) {
+    struct pipe_gcm_ctx* ctx = handle->pipe.gcm_ctx;
+    if (__atomic_load_n(&handle->pipe.handshake_done, __ATOMIC_ACQUIRE))
+        return;
+
+    bool claimed = false;
+    if (ctx && __atomic_compare_exchange_n(&ctx->session_claimed, &claimed, true,
+                                           /*weak=*/false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        /* connecting end of a pipe with the lean transport: the other end sent its salt when it
+         * accepted the connection */
+        assert(handle->hdr.type == PAL_TYPE_PIPE);
+        int ret = pipe_gcm_derive_keys(handle, ctx, /*is_connecting=*/true);
+        if (ret < 0) {
+            log_error("Failed to initialize secure pipe: %s", pal_strerror(ret));
+            ctx->broken = true;
+        } else if (handle->pipe.nonblocking) {
+            ret = ocall_fsetnonblock(handle->pipe.fd, /*nonblocking=*/1);
+            if (ret < 0) {
+                log_error("Failed to set handle as non-blocking: %s", unix_strerror(ret));
+                ctx->broken = true;
+            }
+        }
+        __atomic_store_n(&handle->pipe.handshake_done, true, __ATOMIC_RELEASE);
+        return;
+    }
+
+    /* TLS handshake helper thread or another thread with the lean transport */
+    while (!__atomic_load_n(&handle->pipe.handshake_done, __ATOMIC_ACQUIRE))
+        CPU_RELAX();
+}
+
+int pipe_gcm_save(PAL_HANDLE handle, void** out_data, size_t* out_size) {
+    struct pipe_gcm_ctx* ctx = handle->pipe.gcm_ctx;
+    assert(ctx);
+
+    pipe_wait_for_session(handle);
+    if (ctx->broken)
+        return -PAL_ERROR_NOTCONNECTION;
+
+    int ret;
+    /* doesn't take `recv_mutex` and `send_mutex`: another thread may be blocked in a read or write
+     * on the host; records encrypted but not sent yet are left to this process, which sends them
+     * when the write is retried */
+    spinlock_lock(&ctx->lock);
+
+    size_t raw_size = ctx->raw_end - ctx->raw_off;
+    size_t size = sizeof(struct pipe_gcm_state) + ctx->plain_size + raw_size;
+    struct pipe_gcm_state* state = malloc(size);
+    if (!state) {
+        ret = -PAL_ERROR_NOMEM;
+        goto out;
+    }
+    memcpy(state->send_key, ctx->send_key, sizeof(state->send_key));
+    memcpy(state->recv_key, ctx->recv_key, sizeof(state->recv_key));
+    state->send_seq = ctx->send_seq;
+    state->recv_seq = ctx->recv_seq;
+    state->plain_size = ctx->plain_size;
+    state->raw_size = raw_size;
+    uint8_t* data = (uint8_t*)(state + 1);
+    if (ctx->plain_size)
+        memcpy(data, ctx->recv_buf + ctx->plain_off, ctx->plain_size);
+    if (raw_size)
+        memcpy(data + ctx->plain_size, ctx->recv_buf + ctx->raw_off, raw_size);
+
+    *out_data = state;
+    *out_size = size;
+    ret = 0;
+out:
+    spinlock_unlock(&ctx->lock);
+    return ret;
+}
+
+int pipe_gcm_restore(PAL_HANDLE handle, const void* data, size_t size) {
+    const struct pipe_gcm_state* state = data;
+    if (size < sizeof(*state) || state->plain_size > PIPE_GCM_MAX_RECORD
+            || state->raw_size > PIPE_GCM_MAX_RECORD + PIPE_GCM_OVERHEAD
+            || size != sizeof(*state) + state->plain_size + state->raw_size)
+        return -PAL_ERROR_DENIED;
+
+    struct pipe_gcm_ctx* ctx = pipe_gcm_alloc();
+    if (!ctx)
+        return -PAL_ERROR_NOMEM;
+
+    memcpy(ctx->send_key, state->send_key, sizeof(ctx->send_key));
+    memcpy(ctx->recv_key, state->recv_key, sizeof(ctx->recv_key));
+    ctx->send_seq = state->send_seq;
+    ctx->recv_seq = state->recv_seq;
+    ctx->session_claimed = true;
+
+    size_t buffered = state->plain_size + state->raw_size;
+    if (buffered) {
+        ctx->recv_buf_size = MAX(buffered, (size_t)PIPE_GCM_READ_BUF_SIZE);
+        ctx->recv_buf = malloc(ctx->recv_buf_size);
+        if (!ctx->recv_buf) {
+            pipe_gcm_free(ctx);
+            return -PAL_ERROR_NOMEM;
+        }
+        memcpy(ctx->recv_buf, state + 1, buffered);
+        ctx->plain_size = state->plain_size;
+        ctx->raw_off = state->plain_size;
+        ctx->raw_end = buffered;
+    }
+
+    handle->pipe.gcm_ctx = ctx;
+    handle->pipe.ssl_ctx = NULL;
+    handle->pipe.handshake_done = true;
+    return 0;
+}
+
 static noreturn int thread_handshake_func(void* param) {
     PAL_HANDLE handle = (PAL_HANDLE)param;
 
@@ -143,6 +625,7 @@ static int pipe_listen(PAL_HANDLE* handle, const char* name, pal_stream_options_
 
     /* pipesrv handle is only intermediate so it doesn't need SSL context or session key */
     hdl->pipe.ssl_ctx        = NULL;
+    hdl->pipe.gcm_ctx        = NULL;
     hdl->pipe.is_server      = false;
     hdl->pipe.handshake_done = true; /* pipesrv doesn't do any handshake so consider it done */
 
@@ -199,14 +682,33 @@ static int pipe_waitforclient(PAL_HANDLE handle, PAL_HANDLE* client, pal_stream_
     /* create the SSL pre-shared key for this end of the pipe; note that SSL context is initialized
      * lazily on first read/write on this pipe */
     clnt->pipe.ssl_ctx        = NULL;
+    clnt->pipe.gcm_ctx        = NULL;
     clnt->pipe.is_server      = false;
     clnt->pipe.handshake_done = false;
     COPY_ARRAY(clnt->pipe.session_key, handle->pipe.session_key);
 
-    ret = _PalStreamSecureInit(clnt, clnt->pipe.is_server, &clnt->pipe.session_key,
-                               (LIB_SSL_CONTEXT**)&clnt->pipe.ssl_ctx, NULL, 0);
-    if (ret < 0) {
-        goto out_err;
+    if (g_pal_linuxsgx_state.pipes_use_gcm) {
+        struct pipe_gcm_ctx* ctx = pipe_gcm_alloc();
+        if (!ctx) {
+            ret = -PAL_ERROR_NOMEM;
+            goto out_err;
+        }
+        clnt->pipe.gcm_ctx = ctx;
+        ctx->session_claimed = true;
+
+        ret = pipe_gcm_send_salt(clnt, ctx);
+        if (ret < 0)
+            goto out_err;
+        /* the connecting end sent its salt right after connecting, so this doesn't block */
+        ret = pipe_gcm_derive_keys(clnt, ctx, /*is_connecting=*/false);
+        if (ret < 0)
+            goto out_err;
+    } else {
+        ret = _PalStreamSecureInit(clnt, clnt->pipe.is_server, &clnt->pipe.session_key,
+                                   (LIB_SSL_CONTEXT**)&clnt->pipe.ssl_ctx, NULL, 0);
+        if (ret < 0) {
+            goto out_err;
+        }
     }
     if (clnt->pipe.nonblocking) {
         ret = ocall_fsetnonblock(clnt->pipe.fd, /*nonblocking=*/1);
@@ -225,6 +727,9 @@ out_err:
     if (clnt->pipe.ssl_ctx) {
         _PalStreamSecureFree(clnt->pipe.ssl_ctx);
     }
+    if (clnt->pipe.gcm_ctx) {
+        pipe_gcm_free(clnt->pipe.gcm_ctx);
+    }
     free(clnt);
     return ret;
 }
@@ -282,9 +787,30 @@ static int pipe_connect(PAL_HANDLE* handle, const char* name, pal_stream_options
 
     hdl->pipe.handshake_helper_thread_hdl = NULL;
     hdl->pipe.ssl_ctx        = NULL;
+    hdl->pipe.gcm_ctx        = NULL;
     hdl->pipe.is_server      = true;
     hdl->pipe.handshake_done = false;
 
+    if (g_pal_linuxsgx_state.pipes_use_gcm) {
+        /* the keys are derived on first use of the pipe, see pipe_wait_for_session() */
+        struct pipe_gcm_ctx* ctx = pipe_gcm_alloc();
+        if (!ctx) {
+            ocall_close(hdl->pipe.fd);
+            free(hdl);
+            return -PAL_ERROR_NOMEM;
+        }
+        ret = pipe_gcm_send_salt(hdl, ctx);
+        if (ret < 0) {
+            pipe_gcm_free(ctx);
+            ocall_close(hdl->pipe.fd);
+            free(hdl);
+            return ret;
+        }
+        hdl->pipe.gcm_ctx = ctx;
+        *handle = hdl;
+        return 0;
+    }
+
     /* create a helper thread to initialize the SSL context (by performing SSL handshake);
      * we need a separate thread because the underlying handshake implementation is blocking
      * and assumes that client and server are two parallel entities (e.g., two threads) */
@@ -364,8 +890,14 @@ static int64_t pipe_read(PAL_HANDLE handle, uint64_t offset, uint64_t len, void*
 
     ssize_t bytes;
     /* use a secure session (should be already initialized) */
-    while (!__atomic_load_n(&handle->pipe.handshake_done, __ATOMIC_ACQUIRE))
-        CPU_RELAX();
+    pipe_wait_for_session(handle);
+
+    struct pipe_gcm_ctx* gcm_ctx = handle->pipe.gcm_ctx;
+    if (gcm_ctx) {
+        if (gcm_ctx->broken)
+            return -PAL_ERROR_NOTCONNECTION;
+        return pipe_gcm_read(handle, gcm_ctx, len, buffer);
+    }
 
     if (!handle->pipe.ssl_ctx)
         return -PAL_ERROR_NOTCONNECTION;
@@ -395,8 +927,14 @@ static int64_t pipe_write(PAL_HANDLE handle, uint64_t offset, uint64_t len, cons
 
     ssize_t bytes;
     /* use a secure session (should be already initialized) */
-    while (!__atomic_load_n(&handle->pipe.handshake_done, __ATOMIC_ACQUIRE))
-        CPU_RELAX();
+    pipe_wait_for_session(handle);
+
+    struct pipe_gcm_ctx* gcm_ctx = handle->pipe.gcm_ctx;
+    if (gcm_ctx) {
+        if (gcm_ctx->broken)
+            return -PAL_ERROR_NOTCONNECTION;
+        return pipe_gcm_write(handle, gcm_ctx, len, buffer);
+    }
 
     if (!handle->pipe.ssl_ctx)
         return -PAL_ERROR_NOTCONNECTION;
@@ -416,12 +954,16 @@ static void pipe_destroy(PAL_HANDLE handle) {
     assert(handle->hdr.type == PAL_TYPE_PIPESRV || handle->hdr.type == PAL_TYPE_PIPECLI
             || handle->hdr.type == PAL_TYPE_PIPE);
 
-    while (!__atomic_load_n(&handle->pipe.handshake_done, __ATOMIC_ACQUIRE))
-        CPU_RELAX();
+    /* the lean transport doesn't need its session to be established before closing the pipe */
+    if (!handle->pipe.gcm_ctx)
+        pipe_wait_for_session(handle);
 
     if (handle->pipe.ssl_ctx) {
         _PalStreamSecureFree((LIB_SSL_CONTEXT*)handle->pipe.ssl_ctx);
     }
+    if (handle->pipe.gcm_ctx) {
+        pipe_gcm_free(handle->pipe.gcm_ctx);
+    }
 
     int ret = ocall_close(handle->pipe.fd);
     if (ret < 0) {
@@ -456,10 +998,9 @@ static int pipe_delete(PAL_HANDLE handle, enum pal_delete_mode delete_mode) {
             return -PAL_ERROR_INVAL;
     }
 
-    /* This pipe might use a secure session, make sure all initial work is done. */
-    while (!__atomic_load_n(&handle->pipe.handshake_done, __ATOMIC_ACQUIRE)) {
-        CPU_RELAX();
-    }
+    /* This pipe might use a TLS session, make sure all initial work is done. */
+    if (!handle->pipe.gcm_ctx)
+        pipe_wait_for_session(handle);
 
     ocall_shutdown(handle->pipe.fd, shutdown);
     return 0;
@@ -506,9 +1047,7 @@ static int pipe_attrquerybyhdl(PAL_HANDLE handle, PAL_STREAM_ATTR* attr) {
  */
 static int pipe_attrsetbyhdl(PAL_HANDLE handle, PAL_STREAM_ATTR* attr) {
     /* This pipe might use a secure session, make sure all initial work is done. */
-    while (!__atomic_load_n(&handle->pipe.handshake_done, __ATOMIC_ACQUIRE)) {
-        CPU_RELAX();
-    }
+    pipe_wait_for_session(handle);
 
     bool* nonblocking = &handle->pipe.nonblocking;
 
@@ -11,6 +11,7 @@
 
 #include "api.h"
 #include "crypto.h"
+#include "enclave_tf.h"
 #include "pal.h"
 #include "pal_error.h"
 #include "pal_internal.h"
@@ -246,6 +247,10 @@ out_error:
 noreturn void _PalProcessExit(int exitcode) {
     if (exitcode)
         log_debug("PalProcessExit: Returning exit code %d", exitcode);
+    if (g_pal_linuxsgx_state.enable_stats) {
+        print_trusted_files_cache_stats();
+        print_rpc_stats();
+    }
     ocall_exit(exitcode, /*is_exitgroup=*/true);
     /* Unreachable. */
 }
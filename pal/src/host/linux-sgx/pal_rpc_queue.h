@@ -15,24 +15,29 @@
  * RPC threads. If user specifies "0" or omits this directive, then no RPC threads are created and
  * all syscalls perform an enclave exit (as in previous versions of Gramine).
  *
- * All enclave and RPC threads work on a single shared RPC queue (global variable `g_rpc_queue`).
- * To issue a syscall, enclave thread enqueues syscall request in the queue and spins waiting for
- * result. RPC threads spin waiting for syscall requests; when request comes, first lucky RPC
- * thread grabs request, issues syscall to OS, and notifies enclave thread by releasing the request
- * lock. RPC queue is implemented as a FIFO ring buffer with one global lock.
+ * Every enclave thread has its own single-producer/single-consumer ring of requests (`rpc_ring_t`,
+ * indexed by the TCS number of the thread), and every ring is served by exactly one RPC thread: RPC
+ * thread `i` polls rings `i`, `i + N`, `i + 2N`, ... (where `N` is the number of RPC threads).
+ * Thus enqueuing and dequeuing never take a lock and enclave threads never contend with each
+ * other. The rings with their requests reside in *untrusted memory*. The enclave code accessing
+ * the rings must be carefully written to withstand attacks tampering with them.
  *
- * The RPC queue with its ring buffer resides in *untrusted memory*. The enclave code accessing the
- * RPC queue must be carefully written to withstand attacks tampering with the queue.
+ * A ring can have up to RPC_RING_SIZE requests simultaneously (an enclave thread normally has only
+ * one outstanding request, but OCALLs may nest if an exception is handled while the thread waits
+ * for the result). All requests are allocated on the untrusted stack of the enclave thread;
+ * enclave thread owns its requests and pops them off stack when done with the system call. After
+ * enqueuing the request, enclave thread first spins for some time in hope the system call returns
+ * immediately (fast path), then sleeps waiting on futex (slow path, useful for blocking syscalls).
+ * The spin budget is learned separately for each OCALL type from the recent latencies of that
+ * OCALL. Only OCALLs which never block (e.g. `ocall_pread()`) are sent to RPC threads; all other
+ * OCALLs (e.g. `ocall_read()` on a pipe or `ocall_futex()`) are performed with a normal enclave
+ * exit. Otherwise a blocked OCALL would occupy an RPC thread which serves several rings, and could
+ * deadlock if it waits for an enclave thread whose ring is served by the same RPC thread.
  *
- * RPC queue can have up to RPC_QUEUE_SIZE requests simultaneously. All requests are allocated on
- * the untrusted stack of the enclave thread; enclave thread owns its requests and pops them off
- * stack when done with the system call. After enqueuing the request, enclave thread first spins
- * for some time in hope the system call returns immediately (fast path), then sleeps waiting on
- * futex (slow path, useful for blocking syscalls).
- *
- * NOTE: number of created RPC threads must match max number of simultaneous enclave threads. If
- * there are more RPC threads, CPU time is wasted. If there are less, some enclave threads may
- * starve, especially if there are many blocking syscalls by other enclave threads.
+ * NOTE: An RPC thread burns CPU time while polling its rings. If there are more RPC threads than
+ * enclave threads, CPU time is wasted. If there are less, the rings of several enclave threads
+ * are served by the same RPC thread, which adds latency when these enclave threads issue OCALLs
+ * at the same time.
  *
  * NOTE: The Exitless feature trades slow OCALLs/ECALLs for fast RPC-queue communication at the
  * cost of occupying more CPU cores and burning more CPU cycles. For example, a single-threaded
@@ -50,14 +55,17 @@
 
 #include "spinlock.h"
 
-/* Number of iterations to spin before sleeping. We choose 1M as follows: we want to sleep on
- * blocking syscalls but we want to allow ample time for fast syscalls to complete. We choose
- * 1 millisecond -- more than enough time to complete any non-blocking syscall. Assuming a 1GHz
- * CPU and no pipelining (and ignoring the pause instruction), 1 millisecond is 1M cycles. This
- * works well in practice. */
-#define RPC_SPINLOCK_TIMEOUT 1000000
-
-#define RPC_QUEUE_SIZE  1024 /* max # of requests in RPC queue */
+/* Bounds for the number of iterations an enclave thread spins before sleeping. The upper bound
+ * is 1M and is chosen as follows: we want to sleep on blocking syscalls but we want to allow ample
+ * time for fast syscalls to complete. We choose 1 millisecond -- more than enough time to complete
+ * any non-blocking syscall. Assuming a 1GHz CPU and no pipelining (and ignoring the pause
+ * instruction), 1 millisecond is 1M cycles. The actual budget is adapted to the observed latency
+ * of each OCALL type, see `sgx_exitless_ocall()`. */
+#define RPC_SPIN_MIN 1000
+#define RPC_SPIN_MAX 1000000
+
+#define RPC_RING_SIZE   8    /* max # of requests in one ring, must be a power of two */
+#define MAX_RPC_RINGS   1024 /* max # of rings, i.e. enclave threads using exitless OCALLs */
 #define MAX_RPC_THREADS 256  /* max number of RPC threads */
 
 typedef struct {
@@ -67,89 +75,84 @@ typedef struct {
     void* buffer;
 } rpc_request_t;
 
+/* `head` is written only by the RPC thread serving the ring and `tail` only by the enclave thread
+ * owning it; they are kept in separate cache lines to avoid false sharing */
+typedef struct {
+    uint64_t head __attribute__((aligned(64)));
+    uint64_t tail __attribute__((aligned(64)));
+    rpc_request_t* slots[RPC_RING_SIZE];
+} rpc_ring_t;
+
 typedef struct rpc_queue {
-    spinlock_t lock;                  /* global lock for enclave and RPC threads */
-    uint64_t front, rear;             /* indexes into front and rear ends of q */
-    rpc_request_t* q[RPC_QUEUE_SIZE]; /* queue of syscall requests */
+    spinlock_t lock;                  /* protects `rpc_threads` and `rpc_threads_cnt` */
     int rpc_threads[MAX_RPC_THREADS]; /* RPC threads (thread IDs) */
     size_t rpc_threads_cnt;           /* number of RPC threads */
+    rpc_ring_t rings[MAX_RPC_RINGS];  /* one ring per enclave thread */
 } rpc_queue_t;
 
 extern rpc_queue_t* g_rpc_queue;  /* global RPC queue */
 
 static inline void rpc_queue_init(rpc_queue_t* q) {
     spinlock_init(&q->lock);
-    q->front = 0;
-    q->rear  = 0;
-    for (size_t i = 0; i < RPC_QUEUE_SIZE; i++)
-        q->q[i] = NULL;
+    q->rpc_threads_cnt = 0;
+    for (size_t i = 0; i < MAX_RPC_RINGS; i++) {
+        q->rings[i].head = 0;
+        q->rings[i].tail = 0;
+        for (size_t j = 0; j < RPC_RING_SIZE; j++)
+            q->rings[i].slots[j] = NULL;
+    }
 }
 
 /*!
- * \brief Enqueue OCALL request `req` in the shared RPC queue `q`.
+ * \brief Enqueue OCALL request `req` in the RPC ring `ring`.
+ *
+ * \param      ring   Ring owned by the calling enclave thread.
+ * \param      req    Request to enqueue.
+ * \param[out] depth  On success, number of requests in the ring (including `req`).
+ *
+ * \returns true if enqueued, false if the ring is full.
  *
  * This function is called from the enclave code and thus must be written carefully to withstand
- * attacks tampering with untrusted `req` and untrusted `q`. In particular, `req` and `q` must not
- * have arbitrary pointers (or alternatively the code below must sanitize possible pointer values)
- * to prevent arbitrary writes to/reads from the enclave memory. Similarly, `q->q[idx]` code must
- * ensure that `idx` points inside the `q->q` array to prevent buffer overflows.
+ * attacks tampering with untrusted `req` and untrusted `ring`. In particular, `req` and `ring`
+ * must not have arbitrary pointers (or alternatively the code below must sanitize possible pointer
+ * values) to prevent arbitrary writes to/reads from the enclave memory. Similarly,
+ * `ring->slots[idx]` code must ensure that `idx` points inside the `ring->slots` array to prevent
+ * buffer overflows. The enclave thread must not be interrupted by another enqueue to the same ring
+ * (e.g. from a nested OCALL) in the middle of this function.
  */
-static inline bool rpc_enqueue(rpc_queue_t* q, rpc_request_t* req) {
-    bool ret = false;
-    spinlock_lock(&q->lock);
+static inline bool rpc_enqueue(rpc_ring_t* ring, rpc_request_t* req, uint64_t* depth) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
 
-    if (q->rear - q->front >= RPC_QUEUE_SIZE) {
-        /* queue is full, cannot enqueue */
-        goto out;
+    if (tail - head >= RPC_RING_SIZE) {
+        /* ring is full (or the untrusted indexes are garbage), cannot enqueue */
+        return false;
     }
 
-    if (q->q[q->rear % RPC_QUEUE_SIZE]) {
-        /* current slot is occupied, cannot enqueue but the caller can try again */
-        q->rear++;
-        goto out;
-    }
-
-    q->q[q->rear % RPC_QUEUE_SIZE] = req;
-    q->rear++;
-    ret = true;
-out:
-    spinlock_unlock(&q->lock);
-    return ret;
+    __atomic_store_n(&ring->slots[tail % RPC_RING_SIZE], req, __ATOMIC_RELAXED);
+    /* publish the request to the RPC thread */
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    *depth = tail + 1 - head;
+    return true;
 }
 
 /*!
- * \brief Dequeue OCALL request `req` from the shared RPC queue `q`.
+ * \brief Dequeue OCALL request from the RPC ring `ring`.
  *
- * This function is called only from the untrusted code and thus has no security implications.
+ * This function is called only from the untrusted code (by the single RPC thread serving `ring`)
+ * and thus has no security implications.
  */
-static inline rpc_request_t* rpc_dequeue(rpc_queue_t* q) {
-    if (__atomic_load_n(&q->front, __ATOMIC_RELAXED) ==
-            __atomic_load_n(&q->rear,  __ATOMIC_RELAXED)) {
-        /* quick check that queue is empty; this doesn't acquire a spinlock and thus lowers latency
-         * on rpc_enqueue() performed by enclave threads (they don't have to wait for spinlock
-         * release); note that untrusted RPC threads will simply retry again if this check fails */
+static inline rpc_request_t* rpc_dequeue(rpc_ring_t* ring) {
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+        /* ring is empty, nothing to dequeue */
         return NULL;
     }
 
-    rpc_request_t* ret = NULL;
-    spinlock_lock(&q->lock);
-
-    if (q->front == q->rear) {
-        /* queue is empty, nothing to dequeue */
-        goto out;
-    }
-
-    if (!q->q[q->front % RPC_QUEUE_SIZE]) {
-        /* current slot is empty, cannot dequeue but the caller can try next one */
-        q->front++;
-        goto out;
-    }
-
-    ret = q->q[q->front % RPC_QUEUE_SIZE];
-    q->q[q->front % RPC_QUEUE_SIZE] = NULL;
-    q->front++;
-out:
-    spinlock_unlock(&q->lock);
+    rpc_request_t* ret = __atomic_load_n(&ring->slots[head % RPC_RING_SIZE], __ATOMIC_RELAXED);
+    ring->slots[head % RPC_RING_SIZE] = NULL;
+    /* free the slot for the enclave thread */
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
     return ret;
 }
 
@@ -46,7 +46,12 @@ static ssize_t handle_serialize(PAL_HANDLE handle, void** data) {
         case PAL_TYPE_PIPE:
         case PAL_TYPE_PIPECLI:
             /* session key is part of handle but need to serialize SSL context */
-            if (handle->pipe.ssl_ctx) {
+            if (handle->pipe.gcm_ctx) {
+                free_field = true;
+                ret = pipe_gcm_save(handle, (void**)&field, &field_size);
+                if (ret < 0)
+                    return -PAL_ERROR_DENIED;
+            } else if (handle->pipe.ssl_ctx) {
                 free_field = true;
                 ret = _PalStreamSecureSave(handle->pipe.ssl_ctx, (const uint8_t**)&field,
                                            &field_size);
@@ -135,9 +140,13 @@ static int handle_deserialize(PAL_HANDLE* handle, const void* data, size_t size,
         case PAL_TYPE_PIPECLI:
             /* session key is part of handle but need to deserialize SSL context */
             hdl->pipe.fd = host_fd; /* correct host FD must be passed to SSL context */
-            ret = _PalStreamSecureInit(hdl, hdl->pipe.is_server, &hdl->pipe.session_key,
-                                       (LIB_SSL_CONTEXT**)&hdl->pipe.ssl_ctx,
-                                       (const uint8_t*)data + hdl_size, size - hdl_size);
+            if (hdl->pipe.gcm_ctx) {
+                ret = pipe_gcm_restore(hdl, (const uint8_t*)data + hdl_size, size - hdl_size);
+            } else {
+                ret = _PalStreamSecureInit(hdl, hdl->pipe.is_server, &hdl->pipe.session_key,
+                                           (LIB_SSL_CONTEXT**)&hdl->pipe.ssl_ctx,
+                                           (const uint8_t*)data + hdl_size, size - hdl_size);
+            }
             if (ret < 0) {
                 free(hdl);
                 return -PAL_ERROR_DENIED;
@@ -146,6 +155,7 @@ static int handle_deserialize(PAL_HANDLE* handle, const void* data, size_t size,
             break;
         case PAL_TYPE_PIPESRV:
             hdl->pipe.ssl_ctx = NULL;
+            hdl->pipe.gcm_ctx = NULL;
             hdl->pipe.handshake_helper_thread_hdl = NULL;
             break;
         case PAL_TYPE_CONSOLE:
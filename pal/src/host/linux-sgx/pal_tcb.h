@@ -7,12 +7,19 @@
 #include "pal.h"
 #include "sgx_arch.h"
 
-struct untrusted_area {
-    void* addr;
-    size_t size;
+/* Untrusted buffers used for OCALL payloads too big for the untrusted stack are kept mapped in
+ * power-of-two size classes, from 1MB (`1 << UNTRUSTED_AREA_MIN_SHIFT`) up to 16MB; bigger
+ * payloads use a single buffer which is remapped when a bigger size comes along. */
+#define UNTRUSTED_AREA_MIN_SHIFT 20
+#define UNTRUSTED_AREA_CLASSES   5
+#define UNTRUSTED_AREA_CLASS_SIZE(cls) (1UL << (UNTRUSTED_AREA_MIN_SHIFT + (cls)))
+
+struct untrusted_area_cache {
+    void* addr[UNTRUSTED_AREA_CLASSES]; /* NULL if this size class was not mapped yet */
+    void* large_addr;                   /* NULL if not mapped yet */
+    size_t large_size;
     uint64_t in_use; /* must be uint64_t, because SET_ENCLAVE_TCB() currently supports only 8-byte
                       * types. TODO: fix this. */
-    bool valid;
 };
 
 /*
@@ -26,6 +33,7 @@ struct pal_enclave_tcb {
     /* private to Linux-SGX PAL */
     uint64_t  enclave_size;
     uint64_t  tcs_offset;
+    uint64_t  thread_idx; /* index of this TCS, also selects the exitless RPC ring of the thread */
     uint64_t  initial_stack_addr;
     uint64_t  tmp_rip;
     uint64_t  sig_stack_low;
@@ -46,7 +54,7 @@ struct pal_enclave_tcb {
     void*     heap_min;
     void*     heap_max;
     int*      clear_child_tid;
-    struct untrusted_area untrusted_area_cache;
+    struct untrusted_area_cache untrusted_area_cache;
 };
 
 #ifndef DEBUG
@@ -160,6 +160,8 @@ void pal_start_thread(void) {
     pal_set_tcb_stack_canary(stack_protector_canary);
     PAL_TCB* pal_tcb = pal_get_tcb();
     memset(&pal_tcb->libos_tcb, 0, sizeof(pal_tcb->libos_tcb));
+    /* the TCS may be reused after another thread, which left its slab cache destroyed */
+    pal_tcb->slab_thread_cache = NULL;
     callback((void*)param);
     _PalThreadExit(/*clear_child_tid=*/NULL);
     /* UNREACHABLE */
@@ -227,6 +229,8 @@ void _PalThreadYieldExecution(void) {
 noreturn void _PalThreadExit(int* clear_child_tid) {
     struct pal_handle_thread* exiting_thread = GET_ENCLAVE_TCB(thread);
 
+    destroy_slab_mgr_thread_cache();
+
     /* thread is ready to exit, must inform LibOS by erasing clear_child_tid;
      * note that we don't do it now (because this thread still occupies SGX
      * TCS slot) but during handle_thread_reset in assembly code */
@@ -105,4 +105,38 @@ int _PalEventWait(PAL_HANDLE handle, uint64_t* timeout_us) {
     return ret;
 }
 
+/* The futex word is shared with other processes, so these functions cannot use private futexes. */
+int _PalSharedFutexWait(uint32_t* addr, uint32_t expected, uint64_t* timeout_us) {
+    struct timespec timeout = { 0 };
+    if (timeout_us) {
+        time_get_now_plus_ns(&timeout, *timeout_us * TIME_NS_IN_US);
+    }
+
+    /* Using `FUTEX_WAIT_BITSET` to have an absolute timeout. */
+    int ret = DO_SYSCALL(futex, addr, FUTEX_WAIT_BITSET, expected, timeout_us ? &timeout : NULL,
+                         NULL, FUTEX_BITSET_MATCH_ANY);
+    if (ret == -EAGAIN) {
+        /* `*addr` did not contain `expected` */
+        ret = 0;
+    } else if (ret == -ETIMEDOUT) {
+        ret = -PAL_ERROR_TRYAGAIN;
+    } else if (ret < 0) {
+        ret = unix_to_pal_error(ret);
+    }
+
+    if (timeout_us) {
+        int64_t diff = time_ns_diff_from_now(&timeout);
+        if (diff < 0) {
+            diff = 0;
+        }
+        *timeout_us = (uint64_t)diff / TIME_NS_IN_US;
+    }
+    return ret;
+}
+
+int _PalSharedFutexWake(uint32_t* addr, uint32_t count) {
+    int ret = DO_SYSCALL(futex, addr, FUTEX_WAKE, MIN(count, (uint32_t)INT_MAX), NULL, NULL, 0);
+    return ret < 0 ? unix_to_pal_error(ret) : 0;
+}
+
 struct handle_ops g_event_ops = {};
@@ -234,6 +234,49 @@ static int file_rename(PAL_HANDLE handle, const char* type, const char* uri) {
     return 0;
 }
 
+int64_t _PalStreamSplice(PAL_HANDLE in_handle, uint64_t in_offset, PAL_HANDLE out_handle,
+                         uint64_t out_offset, uint64_t count) {
+    assert(in_handle->hdr.type == PAL_TYPE_FILE);
+
+    if (!in_handle->file.seekable) {
+        return -PAL_ERROR_NOTSUPPORT;
+    }
+    if (in_offset > INT64_MAX || out_offset > INT64_MAX) {
+        return -PAL_ERROR_INVAL;
+    }
+
+    int64_t in_off = in_offset;
+    int64_t ret;
+    switch (out_handle->hdr.type) {
+        case PAL_TYPE_FILE: {
+            if (!out_handle->file.seekable) {
+                return -PAL_ERROR_NOTSUPPORT;
+            }
+            int64_t out_off = out_offset;
+            ret = DO_SYSCALL(copy_file_range, in_handle->file.fd, &in_off, out_handle->file.fd,
+                             &out_off, count, /*flags=*/0);
+            if (ret == -ENOSYS || ret == -EXDEV || ret == -EOPNOTSUPP) {
+                /* Old host kernel or files on different/unsupported filesystems. */
+                return -PAL_ERROR_NOTSUPPORT;
+            }
+            break;
+        }
+        case PAL_TYPE_SOCKET:
+            if (out_handle->sock.type != PAL_SOCKET_TCP) {
+                return -PAL_ERROR_NOTSUPPORT;
+            }
+            ret = DO_SYSCALL(sendfile, out_handle->sock.fd, in_handle->file.fd, &in_off, count);
+            break;
+        default:
+            return -PAL_ERROR_NOTSUPPORT;
+    }
+
+    if (ret < 0)
+        return unix_to_pal_error(ret);
+
+    return ret;
+}
+
 struct handle_ops g_file_ops = {
     .open           = &file_open,
     .read           = &file_read,
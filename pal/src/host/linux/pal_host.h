@@ -108,6 +108,11 @@ typedef struct {
             uint32_t signaled;
             bool auto_clear;
         } event;
+
+        struct {
+            /* host epoll fd */
+            PAL_IDX fd;
+        } event_set;
     };
 }* PAL_HANDLE;
 
@@ -88,6 +88,7 @@ int pal_thread_init(void* tcbptr);
 static inline void pal_linux_tcb_init(PAL_LINUX_TCB* tcb, PAL_HANDLE handle, void* alt_stack,
                                       int (*callback)(void*), void* param) {
     tcb->common.self = &tcb->common;
+    tcb->common.slab_thread_cache = NULL;
     tcb->handle      = handle;
     tcb->alt_stack   = alt_stack; // Stack bottom
     tcb->callback    = callback;
@@ -4,6 +4,7 @@
  *                    Borys Popławski <borysp@invisiblethingslab.com>
  */
 
+#include <linux/eventpoll.h>
 #include <linux/poll.h>
 
 #include "linux_utils.h"
@@ -16,6 +17,10 @@
  * enough. */
 #define NFDS_LIMIT_TO_USE_STACK 16
 
+/* Maximal number of events returned from an event set by one `_PalEventSetWait()` call. Event sets
+ * are level-triggered, so remaining ready handles are simply reported by the next call. */
+#define EVENT_SET_MAX_EVENTS 64
+
 int _PalStreamsWaitEvents(size_t count, PAL_HANDLE* handle_array, pal_wait_flags_t* events,
                           pal_wait_flags_t* ret_events, uint64_t* timeout_us) {
     int ret;
@@ -127,3 +132,262 @@ out:
     }
     return ret;
 }
+
+int _PalEventSetCreate(PAL_HANDLE* handle_ptr) {
+    int fd = DO_SYSCALL(epoll_create1, EPOLL_CLOEXEC);
+    if (fd < 0) {
+        return unix_to_pal_error(fd);
+    }
+
+    PAL_HANDLE handle = calloc(1, HANDLE_SIZE(event_set));
+    if (!handle) {
+        DO_SYSCALL(close, fd);
+        return -PAL_ERROR_NOMEM;
+    }
+
+    init_handle_hdr(handle, PAL_TYPE_EVENTSET);
+    /* The epoll fd itself is not meant to be polled with `_PalStreamsWaitEvents()`. */
+    handle->flags = 0;
+    handle->event_set.fd = fd;
+
+    *handle_ptr = handle;
+    return 0;
+}
+
+static int event_set_apply_update(int epfd, const struct pal_event_set_update* update) {
+    PAL_HANDLE handle = update->handle;
+    if (!(handle->flags & (PAL_HANDLE_FD_READABLE | PAL_HANDLE_FD_WRITABLE))) {
+        return -PAL_ERROR_BADHANDLE;
+    }
+
+    struct epoll_event event = {
+        /* Same as in `_PalStreamsWaitEvents()`: always ask for `EPOLLRDHUP`. */
+        .events = EPOLLRDHUP,
+        .data = update->cookie,
+    };
+    if (update->events & PAL_WAIT_READ) {
+        event.events |= EPOLLIN;
+    }
+    if (update->events & PAL_WAIT_WRITE) {
+        event.events |= EPOLLOUT;
+    }
+
+    int ret;
+    switch (update->op) {
+        case PAL_EVENT_SET_ADD:
+            ret = DO_SYSCALL(epoll_ctl, epfd, EPOLL_CTL_ADD, handle->generic.fd, &event);
+            if (ret == -EEXIST) {
+                ret = DO_SYSCALL(epoll_ctl, epfd, EPOLL_CTL_MOD, handle->generic.fd, &event);
+            }
+            break;
+        case PAL_EVENT_SET_MODIFY:
+            ret = DO_SYSCALL(epoll_ctl, epfd, EPOLL_CTL_MOD, handle->generic.fd, &event);
+            if (ret == -ENOENT) {
+                ret = DO_SYSCALL(epoll_ctl, epfd, EPOLL_CTL_ADD, handle->generic.fd, &event);
+            }
+            break;
+        case PAL_EVENT_SET_DELETE:
+            ret = DO_SYSCALL(epoll_ctl, epfd, EPOLL_CTL_DEL, handle->generic.fd, NULL);
+            if (ret == -ENOENT || ret == -EBADF) {
+                /* Host fd was already closed (which removes it from the set) or never added. */
+                ret = 0;
+            }
+            break;
+        default:
+            return -PAL_ERROR_INVAL;
+    }
+
+    return ret < 0 ? unix_to_pal_error(ret) : 0;
+}
+
+static pal_wait_flags_t epoll_to_pal_events(uint32_t events) {
+    pal_wait_flags_t ret = 0;
+    if (events & EPOLLIN)
+        ret |= PAL_WAIT_READ;
+    if (events & EPOLLOUT)
+        ret |= PAL_WAIT_WRITE;
+    if (events & EPOLLERR)
+        ret |= PAL_WAIT_ERROR;
+    if (events & (EPOLLHUP | EPOLLRDHUP))
+        ret |= PAL_WAIT_HANG_UP;
+    return ret;
+}
+
+int _PalEventSetWait(PAL_HANDLE set, const struct pal_event_set_update* updates,
+                     size_t updates_count, size_t count, PAL_HANDLE* handle_array,
+                     pal_wait_flags_t* events, pal_wait_flags_t* ret_events,
+                     struct pal_event_set_event* set_events, size_t* set_events_count,
+                     uint64_t* timeout_us) {
+    int ret;
+    int epfd = set->event_set.fd;
+
+    for (size_t i = 0; i < updates_count; i++) {
+        ret = event_set_apply_update(epfd, &updates[i]);
+        if (ret < 0) {
+            *set_events_count = 0;
+            return ret;
+        }
+    }
+
+    size_t max_events = MIN(*set_events_count, (size_t)EVENT_SET_MAX_EVENTS);
+    *set_events_count = 0;
+    if (!count && !max_events) {
+        return 0;
+    }
+
+    /* Additional handles are polled with `ppoll()` together with the epoll fd (which is readable
+     * when any handle in the set is ready); the set is then harvested with a non-blocking
+     * `epoll_pwait()`. Without additional handles we block in `epoll_pwait()` directly. */
+    size_t nfds = count ? count + (max_events ? 1 : 0) : 0;
+    struct pollfd* fds = NULL;
+    bool allocate_on_stack = nfds <= NFDS_LIMIT_TO_USE_STACK;
+
+    if (allocate_on_stack) {
+        static_assert(sizeof(*fds) * NFDS_LIMIT_TO_USE_STACK <= 128,
+                      "Would use too much space on stack, reduce the limit");
+        fds = __builtin_alloca(nfds * sizeof(*fds));
+    } else {
+        fds = malloc(nfds * sizeof(*fds));
+        if (!fds) {
+            return -PAL_ERROR_NOMEM;
+        }
+    }
+    memset(fds, 0, nfds * sizeof(*fds));
+
+    for (size_t i = 0; i < count; i++) {
+        PAL_HANDLE handle = handle_array[i];
+        /* If `handle` does not have a host fd, just ignore it. */
+        if (handle && (handle->flags & (PAL_HANDLE_FD_READABLE | PAL_HANDLE_FD_WRITABLE))) {
+            short fdevents = POLLRDHUP;
+            if (events[i] & PAL_WAIT_READ) {
+                fdevents |= POLLIN;
+            }
+            if (events[i] & PAL_WAIT_WRITE) {
+                fdevents |= POLLOUT;
+            }
+            fds[i].fd = handle->generic.fd;
+            fds[i].events = fdevents;
+        } else {
+            fds[i].fd = -1;
+        }
+        ret_events[i] = 0;
+    }
+    if (count && max_events) {
+        fds[count].fd = epfd;
+        fds[count].events = POLLIN;
+    }
+
+    struct epoll_event host_events[EVENT_SET_MAX_EVENTS];
+
+    struct timespec end_time = { 0 };
+    if (timeout_us) {
+        time_get_now_plus_ns(&end_time, *timeout_us * TIME_NS_IN_US);
+    }
+
+    bool set_ready = true;
+    if (nfds) {
+        struct timespec* timeout = NULL;
+        if (timeout_us) {
+            uint64_t timeout_ns = *timeout_us * TIME_NS_IN_US;
+            timeout = __alloca(sizeof(*timeout));
+            timeout->tv_sec = timeout_ns / TIME_NS_IN_S;
+            timeout->tv_nsec = timeout_ns % TIME_NS_IN_S;
+        }
+        ret = DO_SYSCALL(ppoll, fds, nfds, timeout, NULL, 0);
+        if (ret < 0) {
+            ret = unix_to_pal_error(ret);
+            goto out;
+        } else if (ret == 0) {
+            /* timed out */
+            ret = -PAL_ERROR_TRYAGAIN;
+            goto out;
+        }
+        set_ready = max_events && fds[count].revents;
+    }
+
+    size_t host_events_count = 0;
+    if (max_events && set_ready) {
+        int timeout_ms = 0;
+        if (!nfds) {
+            /* Round up, so that we never return before the timeout expires. */
+            timeout_ms = timeout_us ? (int)MIN((*timeout_us + TIME_US_IN_MS - 1) / TIME_US_IN_MS,
+                                               (uint64_t)INT32_MAX)
+                                    : -1;
+        }
+        ret = DO_SYSCALL(epoll_pwait, epfd, host_events, max_events, timeout_ms, NULL, 0);
+        if (ret < 0) {
+            ret = unix_to_pal_error(ret);
+            goto out;
+        } else if (ret == 0 && !nfds) {
+            /* timed out */
+            ret = -PAL_ERROR_TRYAGAIN;
+            goto out;
+        }
+        host_events_count = (size_t)ret;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (fds[i].fd == -1) {
+            /* We skipped this fd. */
+            continue;
+        }
+
+        if (fds[i].revents & POLLIN)
+            ret_events[i] |= PAL_WAIT_READ;
+        if (fds[i].revents & POLLOUT)
+            ret_events[i] |= PAL_WAIT_WRITE;
+
+        PAL_HANDLE handle = handle_array[i];
+
+        /* report error events on this FD */
+        if (fds[i].revents & (POLLERR | POLLNVAL))
+            handle->flags |= PAL_HANDLE_FD_ERROR;
+        if (handle->flags & PAL_HANDLE_FD_ERROR)
+            ret_events[i] |= PAL_WAIT_ERROR;
+
+        /* report hang-up events on this FD */
+        if (fds[i].revents & (POLLHUP | POLLRDHUP))
+            handle->flags |= PAL_HANDLE_FD_HANG_UP;
+        if (handle->flags & PAL_HANDLE_FD_HANG_UP)
+            ret_events[i] |= PAL_WAIT_HANG_UP;
+    }
+
+    for (size_t i = 0; i < host_events_count; i++) {
+        set_events[i].cookie = host_events[i].data;
+        set_events[i].events = epoll_to_pal_events(host_events[i].events);
+    }
+    *set_events_count = host_events_count;
+
+    ret = 0;
+
+out:
+    if (timeout_us) {
+        int64_t diff = time_ns_diff_from_now(&end_time);
+        if (diff < 0) {
+            /* We might have slept a bit too long. */
+            diff = 0;
+        }
+        *timeout_us = (uint64_t)diff / TIME_NS_IN_US;
+    }
+    if (!allocate_on_stack) {
+        free(fds);
+    }
+    return ret;
+}
+
+static void event_set_destroy(PAL_HANDLE handle) {
+    assert(handle->hdr.type == PAL_TYPE_EVENTSET);
+
+    int ret = DO_SYSCALL(close, handle->event_set.fd);
+    if (ret < 0) {
+        log_error("closing event set host fd %d failed: %s", handle->event_set.fd,
+                  unix_strerror(ret));
+        /* We cannot do anything about it anyway... */
+    }
+
+    free(handle);
+}
+
+struct handle_ops g_event_set_ops = {
+    .destroy = event_set_destroy,
+};
@@ -324,6 +324,63 @@ static int64_t proc_write(PAL_HANDLE handle, uint64_t offset, uint64_t count, co
     return bytes;
 }
 
+/* max number of operations passed to the host in one `writev()` by 'batch' */
+#define PROC_BATCH_MAX_OPS 64
+
+/* 'batch' operation for process streams: consecutive writes to the same stream are gathered in one
+ * `writev()` */
+static int64_t proc_batch(struct pal_io_op* ops, size_t count) {
+    PAL_HANDLE handle = ops[0].handle;
+    if (ops[0].type != PAL_IO_WRITE || ops[0].offset) {
+        switch (ops[0].type) {
+            case PAL_IO_READ:
+                ops[0].result = proc_read(handle, ops[0].offset, ops[0].size, ops[0].buffer);
+                break;
+            case PAL_IO_WRITE:
+                ops[0].result = proc_write(handle, ops[0].offset, ops[0].size, ops[0].buffer);
+                break;
+            case PAL_IO_FLUSH:
+                ops[0].result = 0;
+                break;
+        }
+        return 1;
+    }
+
+    struct iovec iov[PROC_BATCH_MAX_OPS];
+    size_t n = 0;
+    for (; n < MIN(count, (size_t)PROC_BATCH_MAX_OPS); n++) {
+        if (ops[n].handle != handle || ops[n].type != PAL_IO_WRITE || ops[n].offset)
+            break;
+        iov[n].iov_base = ops[n].buffer;
+        iov[n].iov_len  = ops[n].size;
+    }
+
+    int64_t bytes = DO_SYSCALL(writev, handle->process.stream, iov, n);
+    if (bytes < 0) {
+        switch (bytes) {
+            case -EWOULDBLOCK:
+                ops[0].result = -PAL_ERROR_TRYAGAIN;
+                break;
+            case -EINTR:
+                ops[0].result = -PAL_ERROR_INTERRUPTED;
+                break;
+            default:
+                ops[0].result = -PAL_ERROR_DENIED;
+                break;
+        }
+        return 1;
+    }
+
+    /* distribute the written bytes over the operations, stopping at the first short one */
+    size_t i = 0;
+    do {
+        ops[i].result = MIN((uint64_t)bytes, ops[i].size);
+        bytes -= ops[i].result;
+        i++;
+    } while (i < n && (size_t)ops[i - 1].result == ops[i - 1].size && bytes > 0);
+    return i;
+}
+
 static void proc_destroy(PAL_HANDLE handle) {
     assert(handle->hdr.type == PAL_TYPE_PROCESS);
 
@@ -392,6 +449,7 @@ static int proc_attrsetbyhdl(PAL_HANDLE handle, PAL_STREAM_ATTR* attr) {
 struct handle_ops g_proc_ops = {
     .read           = &proc_read,
     .write          = &proc_write,
+    .batch          = &proc_batch,
     .destroy        = &proc_destroy,
     .delete         = &proc_delete,
     .attrquerybyhdl = &proc_attrquerybyhdl,
@@ -195,6 +195,8 @@ noreturn void _PalThreadExit(int* clear_child_tid) {
     PAL_HANDLE handle = tcb->handle;
     assert(handle);
 
+    destroy_slab_mgr_thread_cache();
+
     block_async_signals(true);
     if (tcb->alt_stack) {
         stack_t ss;
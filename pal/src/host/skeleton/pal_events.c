@@ -25,6 +25,14 @@ int _PalEventWait(PAL_HANDLE handle, uint64_t* timeout_us) {
     return -PAL_ERROR_NOTIMPLEMENTED;
 }
 
+int _PalSharedFutexWait(uint32_t* addr, uint32_t expected, uint64_t* timeout_us) {
+    return -PAL_ERROR_NOTIMPLEMENTED;
+}
+
+int _PalSharedFutexWake(uint32_t* addr, uint32_t count) {
+    return -PAL_ERROR_NOTIMPLEMENTED;
+}
+
 static void event_destroy(PAL_HANDLE handle) {
     /* noop */
 }
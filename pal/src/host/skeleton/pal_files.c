@@ -66,6 +66,11 @@ static int file_rename(PAL_HANDLE handle, const char* type, const char* uri) {
     return -PAL_ERROR_NOTIMPLEMENTED;
 }
 
+int64_t _PalStreamSplice(PAL_HANDLE in_handle, uint64_t in_offset, PAL_HANDLE out_handle,
+                         uint64_t out_offset, uint64_t count) {
+    return -PAL_ERROR_NOTIMPLEMENTED;
+}
+
 struct handle_ops g_file_ops = {
     .open           = &file_open,
     .read           = &file_read,
@@ -14,3 +14,17 @@ int _PalStreamsWaitEvents(size_t count, PAL_HANDLE* handle_array, pal_wait_flags
                           pal_wait_flags_t* ret_events, uint64_t* timeout_us) {
     return -PAL_ERROR_NOTIMPLEMENTED;
 }
+
+int _PalEventSetCreate(PAL_HANDLE* handle) {
+    return -PAL_ERROR_NOTIMPLEMENTED;
+}
+
+int _PalEventSetWait(PAL_HANDLE set, const struct pal_event_set_update* updates,
+                     size_t updates_count, size_t count, PAL_HANDLE* handle_array,
+                     pal_wait_flags_t* events, pal_wait_flags_t* ret_events,
+                     struct pal_event_set_event* set_events, size_t* set_events_count,
+                     uint64_t* timeout_us) {
+    return -PAL_ERROR_NOTIMPLEMENTED;
+}
+
+struct handle_ops g_event_set_ops = {};
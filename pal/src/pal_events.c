@@ -26,3 +26,15 @@ int PalEventWait(PAL_HANDLE handle, uint64_t* timeout_us) {
     assert(handle && handle->hdr.type == PAL_TYPE_EVENT);
     return _PalEventWait(handle, timeout_us);
 }
+
+int PalSharedFutexWait(uint32_t* addr, uint32_t expected, uint64_t* timeout_us) {
+    if (!IS_ALIGNED_PTR(addr, sizeof(*addr)))
+        return -PAL_ERROR_INVAL;
+    return _PalSharedFutexWait(addr, expected, timeout_us);
+}
+
+int PalSharedFutexWake(uint32_t* addr, uint32_t count) {
+    if (!IS_ALIGNED_PTR(addr, sizeof(*addr)))
+        return -PAL_ERROR_INVAL;
+    return _PalSharedFutexWake(addr, count);
+}
@@ -380,6 +380,9 @@ noreturn void pal_main(uint64_t instance_id,       /* current instance id */
     g_pal_public_state.instance_id = instance_id;
     g_pal_common_state.parent_process = parent_process;
 
+    /* the host-specific loader has set up the TCB of the first thread by now */
+    enable_slab_mgr_thread_cache();
+
     ssize_t ret;
 
     assert(g_pal_public_state.manifest_root);
@@ -34,3 +34,25 @@ int PalStreamsWaitEvents(size_t count, PAL_HANDLE* handle_array, pal_wait_flags_
 
     return _PalStreamsWaitEvents(count, handle_array, events, ret_events, timeout_us);
 }
+
+int PalEventSetCreate(PAL_HANDLE* handle) {
+    *handle = NULL;
+    return _PalEventSetCreate(handle);
+}
+
+int PalEventSetWait(PAL_HANDLE set, const struct pal_event_set_update* updates,
+                    size_t updates_count, size_t count, PAL_HANDLE* handle_array,
+                    pal_wait_flags_t* events, pal_wait_flags_t* ret_events,
+                    struct pal_event_set_event* set_events, size_t* set_events_count,
+                    uint64_t* timeout_us) {
+    assert(set && set->hdr.type == PAL_TYPE_EVENTSET);
+    for (size_t i = 0; i < updates_count; i++) {
+        assert(updates[i].handle && updates[i].handle->hdr.type < PAL_HANDLE_TYPE_BOUND);
+    }
+    for (size_t i = 0; i < count; i++) {
+        assert(!handle_array[i] || handle_array[i]->hdr.type < PAL_HANDLE_TYPE_BOUND);
+    }
+
+    return _PalEventSetWait(set, updates, updates_count, count, handle_array, events, ret_events,
+                            set_events, set_events_count, timeout_us);
+}
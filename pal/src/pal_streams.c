@@ -21,19 +21,21 @@ extern struct handle_ops g_thread_ops;
 extern struct handle_ops g_proc_ops;
 extern struct handle_ops g_event_ops;
 extern struct handle_ops g_eventfd_ops;
+extern struct handle_ops g_event_set_ops;
 
 const struct handle_ops* g_pal_handle_ops[PAL_HANDLE_TYPE_BOUND] = {
-    [PAL_TYPE_FILE]    = &g_file_ops,
-    [PAL_TYPE_PIPE]    = &g_pipe_ops,
-    [PAL_TYPE_PIPESRV] = &g_pipe_ops,
-    [PAL_TYPE_PIPECLI] = &g_pipe_ops,
-    [PAL_TYPE_CONSOLE] = &g_console_ops,
-    [PAL_TYPE_DEV]     = &g_dev_ops,
-    [PAL_TYPE_DIR]     = &g_dir_ops,
-    [PAL_TYPE_PROCESS] = &g_proc_ops,
-    [PAL_TYPE_THREAD]  = &g_thread_ops,
-    [PAL_TYPE_EVENT]   = &g_event_ops,
-    [PAL_TYPE_EVENTFD] = &g_eventfd_ops,
+    [PAL_TYPE_FILE]     = &g_file_ops,
+    [PAL_TYPE_PIPE]     = &g_pipe_ops,
+    [PAL_TYPE_PIPESRV]  = &g_pipe_ops,
+    [PAL_TYPE_PIPECLI]  = &g_pipe_ops,
+    [PAL_TYPE_CONSOLE]  = &g_console_ops,
+    [PAL_TYPE_DEV]      = &g_dev_ops,
+    [PAL_TYPE_DIR]      = &g_dir_ops,
+    [PAL_TYPE_PROCESS]  = &g_proc_ops,
+    [PAL_TYPE_THREAD]   = &g_thread_ops,
+    [PAL_TYPE_EVENT]    = &g_event_ops,
+    [PAL_TYPE_EVENTFD]  = &g_eventfd_ops,
+    [PAL_TYPE_EVENTSET] = &g_event_set_ops,
 };
 
 /* `out_type` is provided by the caller; `out_uri` is the pointer inside `typed_uri` */
@@ -197,6 +199,88 @@ int PalStreamWrite(PAL_HANDLE handle, uint64_t offset, size_t* count, void* buff
     return 0;
 }
 
+int PalStreamSplice(PAL_HANDLE in_handle, uint64_t in_offset, PAL_HANDLE out_handle,
+                    uint64_t out_offset, size_t* count) {
+    if (!in_handle || !out_handle) {
+        return -PAL_ERROR_INVAL;
+    }
+
+    if (in_handle->hdr.type != PAL_TYPE_FILE) {
+        return -PAL_ERROR_NOTSUPPORT;
+    }
+    if (out_handle->hdr.type != PAL_TYPE_FILE && out_handle->hdr.type != PAL_TYPE_SOCKET) {
+        return -PAL_ERROR_NOTSUPPORT;
+    }
+
+    int64_t ret = _PalStreamSplice(in_handle, in_offset, out_handle, out_offset, *count);
+
+    if (ret < 0) {
+        return ret;
+    }
+
+    *count = ret;
+    return 0;
+}
+
+static int64_t stream_batch_single(struct pal_io_op* op) {
+    switch (op->type) {
+        case PAL_IO_READ:
+            return _PalStreamRead(op->handle, op->offset, op->size, op->buffer);
+        case PAL_IO_WRITE:
+            return _PalStreamWrite(op->handle, op->offset, op->size, op->buffer);
+        case PAL_IO_FLUSH:
+            return _PalStreamFlush(op->handle);
+    }
+    return -PAL_ERROR_INVAL;
+}
+
+int PalStreamBatch(struct pal_io_op* ops, size_t* count) {
+    size_t total = *count;
+
+    for (size_t i = 0; i < total; i++) {
+        if (!ops[i].handle) {
+            return -PAL_ERROR_INVAL;
+        }
+        if (ops[i].type != PAL_IO_READ && ops[i].type != PAL_IO_WRITE
+                && ops[i].type != PAL_IO_FLUSH) {
+            return -PAL_ERROR_INVAL;
+        }
+    }
+
+    size_t done = 0;
+    while (done < total) {
+        struct pal_io_op* op = &ops[done];
+        const struct handle_ops* hops = HANDLE_OPS(op->handle);
+
+        size_t executed = 1;
+        if (hops && hops->batch) {
+            /* pass the whole run of operations on the same kind of handles at once */
+            size_t run = 1;
+            while (done + run < total && HANDLE_OPS(ops[done + run].handle) == hops)
+                run++;
+
+            int64_t ret = hops->batch(op, run);
+            if (ret < 0) {
+                if (done)
+                    break;
+                return ret;
+            }
+            assert(ret > 0 && (size_t)ret <= run);
+            executed = ret;
+        } else {
+            op->result = stream_batch_single(op);
+        }
+        done += executed;
+
+        struct pal_io_op* last = &ops[done - 1];
+        if (last->result < 0 || (last->type != PAL_IO_FLUSH && (size_t)last->result < last->size))
+            break;
+    }
+
+    *count = done;
+    return 0;
+}
+
 int _PalStreamAttributesQuery(const char* typed_uri, PAL_STREAM_ATTR* attr) {
     char type[URI_PREFIX_MAX_LEN + 1];
     const char* uri;
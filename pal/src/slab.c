@@ -23,6 +23,15 @@ static inline void system_mem_free(void* addr, size_t size);
 #define system_malloc(size) system_mem_alloc(size)
 #define system_free(addr, size) system_mem_free(addr, size)
 
+/* Set once the TCB of the first thread is set up; before that, the host-specific loader may run on
+ * a temporary TCB, so all allocations go to the global lists. */
+static bool g_slab_thread_cache_enabled = false;
+
+#define SLAB_THREAD_CACHE() \
+    (__atomic_load_n(&g_slab_thread_cache_enabled, __ATOMIC_RELAXED) \
+         ? &pal_get_tcb()->slab_thread_cache                          \
+         : NULL)
+
 #include "slabmgr.h"
 
 static inline void* system_mem_alloc(size_t size) {
@@ -70,6 +79,14 @@ void init_slab_mgr(void) {
         INIT_FAIL("cannot initialize slab manager");
 }
 
+void enable_slab_mgr_thread_cache(void) {
+    __atomic_store_n(&g_slab_thread_cache_enabled, true, __ATOMIC_RELAXED);
+}
+
+void destroy_slab_mgr_thread_cache(void) {
+    slab_thread_cache_destroy(g_slab_mgr);
+}
+
 void* malloc(size_t size) {
     void* ptr = slab_alloc(g_slab_mgr, size);
 
@@ -25,6 +25,10 @@ DEFAULT_ENCLAVE_SIZE_NO_EDMM = '256M'
 DEFAULT_ENCLAVE_SIZE_WITH_EDMM = '1024G'  # 1TB; note that DebugInfo is at 1TB and ASan at 1.5TB
 DEFAULT_THREAD_NUM = 4
 
+# must be kept in sync with TRUSTED_CHUNK_SIZE in pal/src/host/linux-sgx/pal_linux_defs.h
+TRUSTED_CHUNK_SIZE = 16 * 1024
+TRUSTED_CHUNK_HASH_SIZE = 16
+
 class ManifestError(Exception):
     """Thrown at errors in manifest parsing and handling.
 
@@ -120,28 +124,42 @@ class TrustedFile:
         uri (str): URI
         sha256 (str or None): sha256
         chroot (pathlib.Path or None): optional path to chroot, if being measured in chroot dir
+        chunk_hashes_uri (str or None): optional URI of the file with precomputed chunk hashes
+        chunk_hashes_sha256 (str or None): sha256 of the file with chunk hashes
 
     Raises:
         graminelibos.ManifestError: on invalid URI values, or when *chroot* is not None and realpath
             is not absolute
     """
-    def __init__(self, uri, sha256=None, *, chroot=None):
+    def __init__(self, uri, sha256=None, *, chroot=None, chunk_hashes_uri=None,
+            chunk_hashes_sha256=None):
         #: URI of the trusted file
         self.uri = uri
         #: sha256 of the trusted file as str of hex digits, or None if not measured
         self.sha256 = sha256
         #: optional chroot, if the file is to be measured in a subdirectory
         self.chroot = pathlib.Path(chroot) if chroot is not None else chroot
+        #: optional URI of the file with precomputed chunk hashes (allows lazy verification)
+        self.chunk_hashes_uri = chunk_hashes_uri
+        #: sha256 of the file with chunk hashes as str of hex digits, or None if not generated
+        self.chunk_hashes_sha256 = chunk_hashes_sha256
 
         #: real path to the file on disk, including chroot path if specified
-        self.realpath = None
+        self.realpath = self._uri2realpath(uri)
+        #: real path to the file with chunk hashes, or None
+        self.chunk_hashes_realpath = (self._uri2realpath(chunk_hashes_uri)
+            if chunk_hashes_uri is not None else None)
+
+        if chunk_hashes_sha256 is not None and chunk_hashes_uri is None:
+            raise ManifestError(f'Trusted file {uri!r} has chunk_hashes_sha256 but no '
+                'chunk_hashes_uri')
 
+    def _uri2realpath(self, uri):
         path = pathlib.PurePosixPath(uri2path(uri))
 
         if self.chroot is None:
-            self.realpath = pathlib.Path(path)
-        else:
-            self.realpath = chroot / resolve_symlinks(path, chroot=self.chroot).relative_to('/')
+            return pathlib.Path(path)
+        return self.chroot / resolve_symlinks(path, chroot=self.chroot).relative_to('/')
 
     @classmethod
     def from_manifest(cls, data, *, chroot=None):
@@ -157,19 +175,24 @@ class TrustedFile:
         Raises:
             graminelibos.ManifestError: on errors in data
         """
+        chunk_hashes_uri, chunk_hashes_sha256 = None, None
+
         if isinstance(data, str):
             uri, sha256 = data, None
 
         elif isinstance(data, dict):
             uri, sha256 = data.pop('uri'), data.pop('sha256', None)
+            chunk_hashes_uri = data.pop('chunk_hashes_uri', None)
+            chunk_hashes_sha256 = data.pop('chunk_hashes_sha256', None)
             if data:
-                # there are some unknown keys left after two .pop()s above
+                # there are some unknown keys left after .pop()s above
                 raise ManifestError(f'Leftover trusted file items: {data!r}')
 
         else:
             raise ManifestError(f'Unknown trusted file format: {data!r}')
 
-        return cls(uri, sha256, chroot=chroot)
+        return cls(uri, sha256, chroot=chroot, chunk_hashes_uri=chunk_hashes_uri,
+            chunk_hashes_sha256=chunk_hashes_sha256)
 
     @classmethod
     def from_realpath(cls, realpath, *, chroot=None):
@@ -196,7 +219,8 @@ class TrustedFile:
 
     def __repr__(self):
         return (f'<{type(self).__name__}('
-                    f'uri={self.uri!r}, sha256={self.sha256!r}, chroot={self.chroot!r}'
+                    f'uri={self.uri!r}, sha256={self.sha256!r}, chroot={self.chroot!r}, '
+                    f'chunk_hashes_uri={self.chunk_hashes_uri!r}'
                 f') realpath={self.realpath!r}>')
 
 
@@ -206,18 +230,24 @@ class TrustedFile:
         Returns:
             str or dict: To be included as element in ``sgx.trusted_files`` list.
         """
-        if self.sha256 is None:
+        if self.sha256 is None and self.chunk_hashes_uri is None:
             return self.uri
-        return {
+        data = {
             'uri': self.uri,
             'sha256': self.sha256,
         }
+        if self.chunk_hashes_uri is not None:
+            data['chunk_hashes_uri'] = self.chunk_hashes_uri
+            data['chunk_hashes_sha256'] = self.chunk_hashes_sha256
+        return {k: v for k, v in data.items() if v is not None}
 
 
     def ensure_hash(self):
         """Ensures that the trusted file carries the sha256 sum.
 
-        If not, this method will open the file and measure it.
+        If not, this method will open the file and measure it. If the file has ``chunk_hashes_uri``
+        but no ``chunk_hashes_sha256``, this method will also (re)generate the file with chunk
+        hashes and measure it.
 
         Returns:
             TrustedFile: self
@@ -228,6 +258,28 @@ class TrustedFile:
                 for chunk in iter(lambda: file.read(128 * sha.block_size), b''):
                     sha.update(chunk)
                 self.sha256 = sha.hexdigest()
+        if self.chunk_hashes_uri is not None and self.chunk_hashes_sha256 is None:
+            self.generate_chunk_hashes()
+        return self
+
+
+    def generate_chunk_hashes(self):
+        """Writes the file with chunk hashes of this trusted file.
+
+        The file consists of truncated (128-bit) sha256 hashes of all consecutive
+        ``TRUSTED_CHUNK_SIZE`` chunks of the trusted file. It is read by Gramine on file open instead
+        of hashing the whole trusted file; each chunk is then verified only when accessed.
+
+        Returns:
+            TrustedFile: self
+        """
+        with open(self.realpath, 'rb') as file, open(self.chunk_hashes_realpath, 'wb') as out:
+            sha = hashlib.sha256()
+            for chunk in iter(lambda: file.read(TRUSTED_CHUNK_SIZE), b''):
+                chunk_hash = hashlib.sha256(chunk).digest()[:TRUSTED_CHUNK_HASH_SIZE]
+                out.write(chunk_hash)
+                sha.update(chunk_hash)
+            self.chunk_hashes_sha256 = sha.hexdigest()
         return self
 
 
@@ -259,6 +311,8 @@ class TrustedFile:
                 raise ManifestError(f'URI {self.uri!r} ends with "/" but is not a directory')
             if self.sha256 is not None:
                 raise ManifestError(f'Directory URI ({self.uri!r}) has sha256 specified')
+            if self.chunk_hashes_uri is not None:
+                raise ManifestError(f'Directory URI ({self.uri!r}) has chunk_hashes_uri specified')
 
             for realpath in sorted(self.realpath.glob('*')):
                 # this conditional could be one-lined, but please don't, it would be unreadable
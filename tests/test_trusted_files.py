@@ -0,0 +1,45 @@
+import hashlib
+
+import pytest
+from graminelibos import manifest
+
+
+# TODO: use tmp_path after deprecating *EL8
+if tuple(int(i) for i in pytest.__version__.split('.')[:2]) < (3, 9):
+    import pathlib
+    @pytest.fixture
+    def tmp_path(tmpdir):
+        return pathlib.Path(tmpdir)
+
+
+def test_chunk_hashes(tmp_path):
+    data = bytes(range(256)) * (manifest.TRUSTED_CHUNK_SIZE // 128 + 3)
+    (tmp_path / 'file').write_bytes(data)
+
+    tf = manifest.TrustedFile.from_manifest({
+        'uri': f'file:{tmp_path}/file',
+        'chunk_hashes_uri': f'file:{tmp_path}/file.chunks',
+    }).ensure_hash()
+
+    chunk_hashes = (tmp_path / 'file.chunks').read_bytes()
+    assert len(chunk_hashes) == 3 * manifest.TRUSTED_CHUNK_HASH_SIZE
+    for i in range(3):
+        chunk = data[i * manifest.TRUSTED_CHUNK_SIZE:(i + 1) * manifest.TRUSTED_CHUNK_SIZE]
+        assert (chunk_hashes[i * manifest.TRUSTED_CHUNK_HASH_SIZE:
+                             (i + 1) * manifest.TRUSTED_CHUNK_HASH_SIZE]
+            == hashlib.sha256(chunk).digest()[:manifest.TRUSTED_CHUNK_HASH_SIZE])
+
+    assert tf.to_manifest() == {
+        'uri': f'file:{tmp_path}/file',
+        'sha256': hashlib.sha256(data).hexdigest(),
+        'chunk_hashes_uri': f'file:{tmp_path}/file.chunks',
+        'chunk_hashes_sha256': hashlib.sha256(chunk_hashes).hexdigest(),
+    }
+
+
+def test_chunk_hashes_sha256_without_uri():
+    with pytest.raises(manifest.ManifestError):
+        manifest.TrustedFile.from_manifest({
+            'uri': 'file:/file',
+            'chunk_hashes_sha256': '00' * 32,
+        })
@@ -0,0 +1,278 @@
+/* SPDX-License-Identifier: LGPL-3.0-or-later */
+/* Copyright (C) 2026 Intel Corporation */
+
+/*
+ * Host benchmark for the LRU cache used by protected files (`lru_cache.c`). It drives the cache the
+ * same way `protected_files.c` does -- `lruc_get()` on every access, `lruc_add()` on a miss and
+ * `lruc_remove_last()` once the cache is over its limit -- with sequential and random access
+ * patterns, and prints throughput and hit ratio for each.
+ *
+ * Before timing a pattern, the tool replays its first accesses against a simple reference LRU list
+ * and fails if the cache disagrees with it: on hits and misses, on the returned objects, on the
+ * evicted entry, on the recency order seen through `lruc_get_first()`/`lruc_get_next()`, and on the
+ * error paths (adding a duplicate key, queries and eviction on an empty cache).
+ */
+
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "lru_cache.h"
+#include "util.h"
+
+#define DEFAULT_CACHE_SIZE  48
+#define DEFAULT_WORKING_SET 64
+#define DEFAULT_OPERATIONS  10000000UL
+#define CHECK_OPERATIONS    100000UL
+#define CHECK_ORDER_EVERY   1000
+
+struct option g_options[] = {
+    { "cache-size", required_argument, 0, 'c' },
+    { "working-set", required_argument, 0, 'w' },
+    { "operations", required_argument, 0, 'n' },
+    { "help", no_argument, 0, 'h' },
+    { 0, 0, 0, 0 }
+};
+
+static void usage(const char* argv0) {
+    INFO("\nUsage: %s [options]\n", argv0);
+    INFO("\nAvailable options:\n");
+    INFO("  --help, -h              Display this help\n");
+    INFO("  --cache-size, -c N      Maximum number of cached entries (default: %d)\n",
+         DEFAULT_CACHE_SIZE);
+    INFO("  --working-set, -w N     Number of distinct keys accessed (default: %d)\n",
+         DEFAULT_WORKING_SET);
+    INFO("  --operations, -n N      Number of accesses per pattern (default: %lu)\n",
+         DEFAULT_OPERATIONS);
+}
+
+static uint64_t time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t next_key(bool random, uint64_t i, uint64_t* rng_state, uint64_t working_set) {
+    if (!random)
+        return i % working_set;
+
+    /* xorshift64 */
+    uint64_t x = *rng_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *rng_state = x;
+    return x % working_set;
+}
+
+/* Reference LRU list: `keys[0]` is the most recently used entry. */
+struct model {
+    uint64_t* keys;
+    size_t count;
+};
+
+static ssize_t model_find(struct model* model, uint64_t key) {
+    for (size_t i = 0; i < model->count; i++) {
+        if (model->keys[i] == key)
+            return i;
+    }
+    return -1;
+}
+
+static void model_bump(struct model* model, size_t pos) {
+    uint64_t key = model->keys[pos];
+    memmove(&model->keys[1], &model->keys[0], pos * sizeof(*model->keys));
+    model->keys[0] = key;
+}
+
+static bool check_order(lruc_context_t* lruc, struct model* model, char* objects) {
+    void* data = lruc_get_first(lruc);
+    for (size_t i = 0; i < model->count; i++) {
+        if (data != &objects[model->keys[i]])
+            return false;
+        data = lruc_get_next(lruc);
+    }
+    return data == NULL;
+}
+
+static int check_empty(lruc_context_t* lruc) {
+    if (lruc_size(lruc) || lruc_get(lruc, 0) || lruc_find(lruc, 0) || lruc_get_first(lruc)
+            || lruc_get_next(lruc) || lruc_get_last(lruc)) {
+        ERROR("Empty cache returned an entry\n");
+        return -1;
+    }
+    lruc_remove_last(lruc);
+    return lruc_size(lruc) ? -1 : 0;
+}
+
+static int check_pattern(const char* name, bool random, size_t cache_size, uint64_t working_set,
+                         uint64_t operations, char* objects) {
+    int ret = -1;
+    struct model model = { .keys = malloc((cache_size + 1) * sizeof(*model.keys)), .count = 0 };
+    lruc_context_t* lruc = lruc_create();
+    if (!model.keys || !lruc) {
+        ERROR("Out of memory\n");
+        goto out;
+    }
+
+    if (check_empty(lruc) < 0)
+        goto out;
+
+    uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+    for (uint64_t i = 0; i < operations; i++) {
+        uint64_t key = next_key(random, i, &rng_state, working_set);
+        ssize_t pos = model_find(&model, key);
+        void* expected = pos >= 0 ? &objects[key] : NULL;
+        void* last = lruc_get_last(lruc);
+
+        /* `lruc_find()` must not change the recency order */
+        if (lruc_find(lruc, key) != expected || lruc_get_last(lruc) != last) {
+            ERROR("%s: lruc_find() of key %lu disagrees with the reference\n", name, key);
+            goto out;
+        }
+        if (lruc_get(lruc, key) != expected) {
+            ERROR("%s: lruc_get() of key %lu disagrees with the reference\n", name, key);
+            goto out;
+        }
+
+        if (pos >= 0) {
+            model_bump(&model, pos);
+        } else {
+            if (!lruc_add(lruc, key, &objects[key])) {
+                ERROR("%s: failed to add key %lu\n", name, key);
+                goto out;
+            }
+            if (lruc_add(lruc, key, &objects[key])) {
+                ERROR("%s: key %lu was added twice\n", name, key);
+                goto out;
+            }
+            model.keys[model.count] = key;
+            model_bump(&model, model.count++);
+        }
+
+        while (lruc_size(lruc) > cache_size) {
+            if (lruc_get_last(lruc) != &objects[model.keys[model.count - 1]]) {
+                ERROR("%s: wrong entry to evict after key %lu\n", name, key);
+                goto out;
+            }
+            lruc_remove_last(lruc);
+            model.count--;
+        }
+
+        if (lruc_size(lruc) != model.count
+                || (i % CHECK_ORDER_EVERY == 0 && !check_order(lruc, &model, objects))) {
+            ERROR("%s: cache contents disagree with the reference after key %lu\n", name, key);
+            goto out;
+        }
+    }
+
+    while (lruc_size(lruc))
+        lruc_remove_last(lruc);
+    ret = check_empty(lruc);
+out:
+    if (lruc)
+        lruc_destroy(lruc);
+    free(model.keys);
+    return ret;
+}
+
+static int run_pattern(const char* name, bool random, size_t cache_size, uint64_t working_set,
+                       uint64_t operations, char* objects) {
+    lruc_context_t* lruc = lruc_create();
+    if (!lruc) {
+        ERROR("Failed to create LRU cache\n");
+        return -1;
+    }
+
+    uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+    uint64_t hits = 0;
+
+    uint64_t start = time_ns();
+    for (uint64_t i = 0; i < operations; i++) {
+        uint64_t key = next_key(random, i, &rng_state, working_set);
+        if (lruc_get(lruc, key)) {
+            hits++;
+            continue;
+        }
+        if (!lruc_add(lruc, key, &objects[key])) {
+            ERROR("Failed to add key %lu\n", key);
+            lruc_destroy(lruc);
+            return -1;
+        }
+        while (lruc_size(lruc) > cache_size)
+            lruc_remove_last(lruc);
+    }
+    uint64_t end = time_ns();
+
+    lruc_destroy(lruc);
+
+    uint64_t ns = end - start ?: 1;
+    INFO("%-10s: %lu ops in %lu us (%.1f Mops/s), hit ratio %.1f%%\n", name, operations, ns / 1000,
+         (double)operations * 1000.0 / ns, (double)hits * 100.0 / operations);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    size_t cache_size = DEFAULT_CACHE_SIZE;
+    uint64_t working_set = DEFAULT_WORKING_SET;
+    uint64_t operations = DEFAULT_OPERATIONS;
+
+    while (true) {
+        int this_option = getopt_long(argc, argv, "c:w:n:h", g_options, NULL);
+        if (this_option == -1)
+            break;
+
+        switch (this_option) {
+            case 'c':
+                cache_size = strtoul(optarg, NULL, 10);
+                break;
+            case 'w':
+                working_set = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                operations = strtoul(optarg, NULL, 10);
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return -1;
+        }
+    }
+
+    if (!cache_size || !working_set || !operations) {
+        ERROR("Cache size, working set and number of operations must be positive\n");
+        return -1;
+    }
+
+    /* dummy objects, only their addresses are stored in the cache */
+    char* objects = malloc(working_set);
+    if (!objects) {
+        ERROR("Out of memory\n");
+        return -1;
+    }
+
+    INFO("cache size %zu, working set %lu\n", cache_size, working_set);
+    uint64_t check_operations = MIN(operations, CHECK_OPERATIONS);
+    int ret = check_pattern("sequential", /*random=*/false, cache_size, working_set,
+                            check_operations, objects);
+    if (ret == 0)
+        ret = run_pattern("sequential", /*random=*/false, cache_size, working_set, operations,
+                          objects);
+    if (ret == 0)
+        ret = check_pattern("random", /*random=*/true, cache_size, working_set, check_operations,
+                            objects);
+    if (ret == 0)
+        ret = run_pattern("random", /*random=*/true, cache_size, working_set, operations, objects);
+
+    free(objects);
+    return ret;
+}